@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The largest light address, so that an address fits in 4 bits. A light's address is its device's logical address.
+ */
+#define LIGHTING_MAX_ADDRESS (15)
+
+/**
+ * Flags for the fields of a light's state which a command sets. The fields a command doesn't set keep their current
+ * values, and the ones it does set are absolute, so a command can be applied any number of times with the same result.
+ */
+#define LIGHTING_FIELD_BRIGHTNESS 0x01 // The brightness
+#define LIGHTING_FIELD_COLOUR 0x02 // The hue and saturation
+#define LIGHTING_FIELD_FADE 0x04 // The time to fade to the new brightness and colour, instead of changing straight away
+#define LIGHTING_FIELDS_MASK 0x07
+
+/**
+ * The most bytes a command can take up in a packet, with every field set. Along with the sequence number, this is also
+ * the largest packet holding a single command.
+ */
+#define LIGHTING_MAX_COMMAND_LENGTH (7)
+
+/**
+ * A command which sets the state of a light.
+ */
+typedef struct {
+    uint8_t address; // The light's address, up to 'LIGHTING_MAX_ADDRESS'
+    uint8_t fields; // The fields which the command sets, as 'LIGHTING_FIELD_' flags
+    uint8_t brightness; // From 0 (off) to 255 (full brightness)
+    uint8_t hue; // From 0 to 255 around the colour wheel, starting and ending at red
+    uint8_t saturation; // From 0 (white) to 255 (the pure hue)
+    uint16_t fade_time; // In hundredths of a second
+} lighting_command;
+
+/**
+ * @brief Encodes commands into a packet, in order, stopping at the first command which doesn't fit or is invalid. A
+ *        command which sets the same fields to the same values as the command before it takes up a single byte, so a
+ *        scene where many lights share a state is cheap to send.
+ * @param sequence_number: The packet's sequence number, which should be one more than the previous packet's, so that
+ *                         lights can tell when packets arrive out of order.
+ * @param commands: A pointer to the first command to encode.
+ * @param command_count: The number of commands.
+ * @param packet: A pointer to the buffer to encode the packet into.
+ * @param max_length: The number of bytes available in the buffer.
+ * @param length: A pointer to where to write the number of bytes in the packet.
+ * @returns The number of commands encoded. A command is invalid if its address is too large or it sets no fields.
+ */
+uint8_t lighting_encode(uint8_t sequence_number, const lighting_command *commands, uint8_t command_count, uint8_t *packet, uint8_t max_length, uint8_t *length);
+
+/**
+ * @brief Decodes every command in a packet.
+ * @param packet: A pointer to the first byte in the packet.
+ * @param length: The number of bytes in the packet.
+ * @param sequence_number: A pointer to where to write the packet's sequence number.
+ * @param commands: A pointer to the buffer to decode the commands into.
+ * @param max_count: The number of commands the buffer has space for.
+ * @param command_count: A pointer to where to write the number of commands decoded.
+ * @returns 'true' if the packet was decoded, or 'false' if it's malformed or has too many commands, in which case none
+ *          of it should be used.
+ */
+bool lighting_decode(const uint8_t *packet, uint8_t length, uint8_t *sequence_number, lighting_command *commands, uint8_t max_count, uint8_t *command_count);
+
+/**
+ * @brief Checks that every entry in a packet can be decoded, without keeping the commands. A malformed packet should be
+ *        dropped before anything is taken from it, including its sequence number.
+ * @param packet: A pointer to the first byte in the packet.
+ * @param length: The number of bytes in the packet.
+ * @returns 'true' if the packet is well formed, or 'false' if it's malformed.
+ */
+bool lighting_validate(const uint8_t *packet, uint8_t length);
+
+/**
+ * @brief Finds the command for one light in a packet, without decoding the commands for the other lights.
+ * @param packet: A pointer to the first byte in the packet.
+ * @param length: The number of bytes in the packet.
+ * @param address: The light's address.
+ * @param sequence_number: A pointer to where to write the packet's sequence number.
+ * @param command: A pointer to where to write the command. If the packet holds more than one command for the light, the
+ *                 last one is used.
+ * @returns 'true' if the packet holds a command for the light, or 'false' if it doesn't or it's malformed.
+ */
+bool lighting_find_command(const uint8_t *packet, uint8_t length, uint8_t address, uint8_t *sequence_number, lighting_command *command);
+
+/**
+ * @brief Checks whether a packet was sent before the last packet applied from the same sender, so that a late packet
+ *        doesn't undo a newer one. Packets don't need to be retransmitted when they're lost: the next packet sets the
+ *        same absolute state, and a repeated packet has no further effect.
+ * @param sequence_number: The packet's sequence number.
+ * @param last_sequence_number: The sequence number of the last packet applied.
+ * @returns 'true' if the packet is older and should be ignored, or 'false' if it's the same or newer.
+ */
+bool lighting_is_stale(uint8_t sequence_number, uint8_t last_sequence_number);
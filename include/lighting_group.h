@@ -0,0 +1,55 @@
+#pragma once
+
+#include "lighting.h"
+#include "network_stack/net.h"
+#include "network_stack/tra.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The transport layer ports that lighting packets are sent on, which other components mustn't register. A packet sent
+ * to a light or to a group controller goes on 'LIGHTING_PORT'. A group controller passes it on to the lights in its
+ * group on 'LIGHTING_GROUP_PORT', after a byte holding the address of the device that sent it:
+ * [ORIGIN] [LIGHTING PACKET...]
+ */
+#define LIGHTING_PORT ((tra_port) 0x03)
+#define LIGHTING_GROUP_PORT ((tra_port) 0x04)
+
+/**
+ * @brief A callback function pointer for applying a command to this device's light.
+ * @param command: A pointer to the command, which is only valid until the function returns.
+ */
+typedef void (*lighting_apply_callback)(const lighting_command *command);
+
+/**
+ * @brief Initialises the lighting carrier. Must be called once at the start of the program, after 'tra_initialise()'.
+ *        Registers the lighting ports, and leaves this device outside of any group.
+ * @param callback: The function to be called with each command for this device's light.
+ */
+void lighting_group_initialise(lighting_apply_callback callback);
+
+/**
+ * @brief Passes on the packet received since the last update to the lights in this device's group. This should be
+ *        called periodically, along with 'tra_update()'.
+ */
+void lighting_group_update();
+
+/**
+ * @brief Makes this device the group controller for a set of lights. A packet sent to a group controller is passed on
+ *        to every light in its group which has a command in it, so a scene for many lights costs the sender a single
+ *        packet, and each light picks out its own command. The group controller applies its own command too.
+ * @param members: A mask of the lights' addresses, where bit 'n' is set if the light with address 'n' is in the group, or
+ *                 0 for no group.
+ */
+void lighting_group_set_members(uint16_t members);
+
+/**
+ * @brief Sends a lighting packet, made with 'lighting_encode()', to a light or a group controller. Packets are sent once
+ *        as datagrams: commands are absolute, so a lost packet is made up for by the next one, and a light ignores a
+ *        packet which arrives after a newer one from the same sender.
+ * @param destination: The logical address of the light or group controller.
+ * @param packet: A pointer to the first byte in the packet.
+ * @param length: The number of bytes in the packet, up to 'TRA_MAX_PAYLOAD_LENGTH' - 1.
+ * @returns The result of sending the packet.
+ */
+tra_send_status lighting_group_send(net_address destination, const uint8_t *packet, uint8_t length);
@@ -1,3 +1,126 @@
 #pragma once
 
-// Application layer API...
+#include "network_stack/net.h"
+#include "network_stack/tra.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The transport layer ports that requests and responses are sent on, which other components mustn't register.
+ */
+#define APP_RELIABLE_PORT ((tra_port) 0x01)
+#define APP_UNRELIABLE_PORT ((tra_port) 0x02)
+
+/**
+ * The largest method number.
+ */
+#define APP_MAX_METHOD ((app_method) 0x7F)
+
+/**
+ * The largest number of bytes in a request's arguments or a response's result, so that it fits in a transport layer
+ * payload on its own.
+ */
+#define APP_MAX_ARGUMENTS_LENGTH (TRA_MAX_PAYLOAD_LENGTH - 3)
+#define APP_MAX_RESULT_LENGTH (TRA_MAX_PAYLOAD_LENGTH - 3)
+
+/**
+ * Identifies a procedure that other devices can call, between 0 and 'APP_MAX_METHOD'.
+ */
+typedef uint8_t app_method;
+
+/**
+ * Identifies an outstanding request, so that its response can be matched to it.
+ */
+typedef uint8_t app_request_id;
+
+/**
+ * The result of a request.
+ */
+typedef enum {
+    APP_RPC_SUCCESS = 0, // The method was called, and the response holds its result
+    APP_RPC_UNKNOWN_METHOD = 1, // The destination has no handler for the method
+    APP_RPC_FAILED = 2, // The method's handler couldn't carry out the request
+    APP_RPC_TIMEOUT = 3, // No response arrived before the request's timeout
+} app_rpc_status;
+
+/**
+ * @brief A callback function pointer for handling a request from another device.
+ * @param source: The source address that the request came from.
+ * @param arguments: A pointer to the first byte in the request's arguments, which is only valid until the function
+ *                   returns.
+ * @param length: The number of bytes in the arguments.
+ * @param result: A pointer to the buffer to write the result into, which has space for 'APP_MAX_RESULT_LENGTH' bytes.
+ * @param result_length: A pointer to the number of bytes in the result, which is 0 until the function sets it.
+ * @returns The status to respond with. 'APP_RPC_TIMEOUT' can't be used.
+ */
+typedef app_rpc_status (*app_method_handler)(net_address source, uint8_t *arguments, uint8_t length, uint8_t *result, uint8_t *result_length);
+
+/**
+ * @brief A callback function pointer for handling the response to a request, or its timeout.
+ * @param destination: The destination address that the request was sent to.
+ * @param id: The request's ID, as returned by 'app_call()'.
+ * @param status: The result of the request.
+ * @param result: A pointer to the first byte in the result, which is only valid until the function returns. This pointer
+ *                is 'NULL' if the request timed out.
+ * @param length: The number of bytes in the result.
+ */
+typedef void (*app_response_callback)(net_address destination, app_request_id id, app_rpc_status status, uint8_t *result, uint8_t length);
+
+/**
+ * The result of making a request.
+ */
+typedef enum {
+    APP_CALL_SUCCESS = 0, // The request was queued, and its callback will be called with the response or a timeout
+    APP_CALL_BUSY = 1, // Too many requests are outstanding, or there's no space to batch the request, so try again later
+    APP_CALL_INVALID = 2, // The request's destination, method or length is invalid
+} app_call_status;
+
+/**
+ * @brief Initialises the application layer. Must be called once at the start of the program, after 'tra_initialise()'
+ *        and before calling any other 'app_()' functions. Registers the application layer's transport layer ports, and
+ *        clears every registered method.
+ */
+void app_initialise();
+
+/**
+ * @brief Updates the application layer logic, timing out requests and sending the requests and responses batched
+ *        since the last update. A request which times out before its batch is sent is taken out of the batch. This
+ *        should be called periodically, along with 'tra_update()'.
+ */
+void app_update();
+
+/**
+ * @brief Registers a method, so that other devices can call it.
+ * @param method: The method to register.
+ * @param handler: The function to be called with each request for the method.
+ * @returns 'true' if the method was registered, or 'false' if it's invalid, already registered, or there's no space for
+ *          it.
+ */
+bool app_register_method(app_method method, app_method_handler handler);
+
+/**
+ * @brief Calls a method on another device. The request isn't sent straight away: requests and responses to the same
+ *        destination are batched into one payload until the next 'app_update()', so several requests made together
+ *        cost a single packet. Any number of requests can be outstanding to the same destination, up to
+ *        'APP_MAX_OUTSTANDING_REQUESTS' in total. The arguments are copied, so the buffer can be reused as soon as the
+ *        function returns.
+ * @param destination: The logical address to send the request to.
+ * @param method: The method to call.
+ * @param arguments: A pointer to the first byte in the request's arguments, or 'NULL' if there are none.
+ * @param length: The number of bytes in the arguments, up to 'APP_MAX_ARGUMENTS_LENGTH'.
+ * @param delivery: How the request and its response are delivered. An unreliable request is sent once, and it or its
+ *                  response may be lost, so it suits requests which are safe to repeat after a timeout, e.g. reading a
+ *                  light's state.
+ * @param timeout_milliseconds: How long to wait for the response, from now.
+ * @param callback: The function to be called with the response, or with 'APP_RPC_TIMEOUT' once the timeout passes.
+ * @param id: A pointer to where to write the request's ID, or 'NULL' if it isn't needed.
+ * @returns The result of queueing the request.
+ */
+app_call_status app_call(net_address destination, app_method method, const uint8_t *arguments, uint8_t length, tra_delivery delivery, uint16_t timeout_milliseconds, app_response_callback callback, app_request_id *id);
+
+/**
+ * @brief Returns the number of requests sent to a destination which are still waiting for a response.
+ * @param destination: The destination's logical address.
+ * @returns The number of outstanding requests.
+ */
+uint8_t app_get_outstanding_count(net_address destination);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "time.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 // DLL address
@@ -8,10 +10,18 @@ typedef uint8_t dll_address;
 // Address which broadcasts to all nodes
 #define DLL_BROADCAST_ADDRESS ((dll_address) 0xFF)
 
+// Largest packet that can be broadcast
+// Broadcast frames are not acknowledged, so a broadcast packet must fit in a single frame
+#define DLL_MAX_BROADCAST_PACKET_LENGTH (23)
+
 // typedef uint8_t BYTE;
 typedef void (*dll_callback)(dll_address sender_address, uint8_t *data, uint8_t length);
 // Defines the type dll_callback, which is a pointer to a function with these parameters, that returns void
 
+typedef void (*dll_delivery_callback)(dll_address destination_address, bool is_delivered, uint8_t retransmission_count);
+// Defines the type dll_delivery_callback, which is called after every unicast packet with whether it was acknowledged
+// and how many frames had to be retransmitted
+
 typedef enum {
     DLL_TRANSMISSION_SUCCESS,
     DLL_NODE_UNREACHABLE,
@@ -26,9 +36,32 @@ uint8_t *dll_create_data_buffer(uint8_t net_packet_length);
 // Sends data in the packet buffer to a given address (or broadcast for address 0xFF)
 dll_send_response dll_send_packet(dll_address destination_address, uint8_t packet_length);
 
+// Sends data in a given buffer, instead of the packet buffer, to a given address (or broadcast for address 0xFF)
+// This lets NET send a packet it is holding without first copying it into the packet buffer
+dll_send_response dll_send_buffer(const uint8_t *packet, dll_address destination_address, uint8_t packet_length);
+
+// Gives DLL a new buffer (of at least 128 bytes) to put received packets into
+// Must only be called from inside the receive callback, after which the buffer that the callback was given belongs to
+// the caller, so a received packet can be kept without copying it
+void dll_replace_receive_buffer(uint8_t *buffer);
+
 // Sets the NET layer function to be called when a frame is received
 // Pass a pointer to the function that should be called
 void dll_set_callback(dll_callback callback);
 
+// Sets the NET layer function to be called after a unicast packet has been delivered, or has failed to be delivered
+// Broadcast packets are never acknowledged, so they don't report their delivery
+// Pass a pointer to the function that should be called
+void dll_set_delivery_callback(dll_delivery_callback callback);
+
+// Returns when the last frame of the packet most recently passed to the NET callback ended, as captured by PHY at its
+// STOP condition
+// Only valid from inside the receive callback, and the same moment that the sender's transmit time was captured
+time dll_get_receive_time();
+
+// Returns when the last frame sent ended, as captured by PHY at its STOP condition
+// Straight after dll_send_packet() or dll_send_buffer() returns, this is when that packet's last frame was sent
+time dll_get_transmit_time();
+
 // Update function to be repeatedly
 void dll_update();
\ No newline at end of file
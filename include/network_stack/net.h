@@ -1,5 +1,6 @@
 #pragma once
 
+#include "time.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -13,6 +14,16 @@ typedef uint8_t net_address;
  */
 #define NET_MAX_ADDRESS ((net_address) 15)
 
+/**
+ * The traffic class of a packet, which decides how urgently it's sent on by each node along its path. Packets in a
+ * higher class are always sent before packets in a lower class, and packets in the same class are sent in order.
+ */
+typedef enum {
+    NET_TRAFFIC_CLASS_BULK = 0, // Data which nobody is waiting for, e.g. status reports
+    NET_TRAFFIC_CLASS_CONTROL = 1, // Network control traffic, e.g. link state packets
+    NET_TRAFFIC_CLASS_INTERACTIVE = 2, // Data which a user is waiting for, e.g. a light switch command
+} net_traffic_class;
+
 /**
  * @brief A callback function pointer for handling a received network data packet.
  * @param source: The source address that the packet came from.
@@ -23,6 +34,43 @@ typedef uint8_t net_address;
  */
 typedef void (*net_receive_callback)(net_address source, uint8_t *payload, uint8_t length);
 
+/**
+ * The result of sending a data packet.
+ */
+typedef enum {
+    NET_SEND_SUCCESS = 0, // The packet was delivered to the next node on its route
+    NET_SEND_PENDING = 1, // There's no route to the destination yet, so the packet is being held until there is
+    NET_SEND_FAILED = 2, // The next node on the packet's route didn't acknowledge it
+    NET_SEND_NO_ROUTE = 3, // No route to the destination was found in time, or there was no space to hold the packet
+    NET_SEND_INVALID = 4, // The packet's destination, length or traffic class is invalid
+} net_send_status;
+
+/**
+ * @brief A callback function pointer for finding out what happened to a data packet which was held because there was no
+ *        route to its destination ('net_send_data_packet()' returned 'NET_SEND_PENDING').
+ * @param destination: The destination address that the packet was sent to.
+ * @param status: 'NET_SEND_SUCCESS' or 'NET_SEND_FAILED' if a route was found and the packet was sent, or
+ *                'NET_SEND_NO_ROUTE' if the packet expired first, or was replaced by a newer packet to the same
+ *                destination.
+ */
+typedef void (*net_send_callback)(net_address destination, net_send_status status);
+
+/**
+ * @brief A callback function pointer for an action scheduled with 'net_schedule_action()'.
+ * @param network_time: The network time that the action was scheduled for.
+ */
+typedef void (*net_action_callback)(time network_time);
+
+/**
+ * Statistics about the queue of packets waiting to be forwarded to other nodes.
+ */
+typedef struct {
+    uint8_t depth; // The number of packets currently in the queue
+    uint8_t max_depth; // The largest number of packets that have been in the queue at once
+    uint16_t queued_count; // The number of packets that have been added to the queue
+    uint16_t dropped_count; // The number of packets that have been dropped because the queue was full
+} net_queue_statistics;
+
 /**
  * @brief Initialises the network layer. Must be called once at the start of the program before calling any other
  *        'net_()' functions.
@@ -53,6 +101,12 @@ bool net_is_device_online(net_address address);
  */
 void net_set_receive_callback(net_receive_callback callback);
 
+/**
+ * @brief Sets the user function to be called when a held data packet is finally sent or given up on.
+ * @param callback: The function to be called. Set to 'NULL' to not use a callback (default).
+ */
+void net_set_send_callback(net_send_callback callback);
+
 /**
  * @brief Returns a buffer which is used for writing data packets. The size of the buffer can be retrieved with
  *        'net_get_data_buffer_size()'.
@@ -67,8 +121,49 @@ uint8_t *net_get_data_buffer();
 uint8_t net_get_data_buffer_size();
 
 /**
- * @brief Sends a data packet, with whatever data is in the data buffer, to the given destination.
+ * @brief Sends a data packet, with whatever data is in the data buffer, to the given destination. If there's no route
+ *        to the destination yet (e.g. shortly after start-up), the packet is held and sent as soon as a route is found.
+ *        Only the newest packet to each destination is held. The send callback reports what finally happened to a
+ *        held packet.
  * @param destination: The logical address to send the packet to.
  * @param data_length: The number of bytes to send from the data buffer.
+ * @param traffic_class: The packet's traffic class.
+ * @param is_payload_checked: Whether the packet's checksum should cover its payload as well as its header. If it does,
+ *                            packets whose payload is corrupted on the way are dropped rather than delivered, at the cost
+ *                            of every node along the path checking the whole packet.
+ * @returns The result of sending the packet, or 'NET_SEND_PENDING' if it's being held.
+ */
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked);
+
+/**
+ * @brief Returns statistics about the queue of packets waiting to be forwarded to other nodes.
+ * @returns The queue's statistics.
+ */
+net_queue_statistics net_get_queue_statistics();
+
+/**
+ * @brief Returns whether this device's clock is synchronised with the network time. The network time is the clock of
+ *        the root (the device with the lowest address that's sending time sync packets), which every other device
+ *        estimates from its neighbours' time sync packets, allowing for its clock's offset and drift. A device only
+ *        synchronises once it has heard from a synchronised neighbour twice.
+ * @returns 'true' if this device is the root or has an estimate of the root's clock, or 'false' otherwise.
+ */
+bool net_is_time_synchronised();
+
+/**
+ * @brief Returns the current network time, which is the same on every synchronised device to within a few
+ *        milliseconds, so that devices can act together. Before this device is synchronised, this is its own clock.
+ * @returns The network time.
+ */
+time net_get_network_time();
+
+/**
+ * @brief Schedules an action for a network time, e.g. so that every light in a scene changes at once however many hops
+ *        the command took to reach each of them. The action is called from 'net_update()' once the network time has
+ *        been reached, or straight away at the next update if it has already passed. An action can be scheduled before
+ *        the device is synchronised, since the time is only compared when it's due.
+ * @param network_time: The network time to call the action at.
+ * @param callback: The function to call.
+ * @returns 'true' if the action was scheduled, or 'false' if there's no space for it or the callback is 'NULL'.
  */
-void net_send_data_packet(net_address destination, uint8_t data_length);
+bool net_schedule_action(time network_time, net_action_callback callback);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "time.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -29,3 +30,25 @@ bool phy_transmit_frame(const uint8_t *data, uint8_t length);
  *         'max_length' or PHY_MAX_RX_FRAME_SIZE'. If no frame has been received, zero is returned.
  */
 uint8_t phy_receive_frame(uint8_t *output_buffer, uint8_t max_length);
+
+/**
+ * @brief Returns an estimate of how busy the bus has been recently, from the bytes sent on it by every device. The
+ *        estimate is updated at most every 100 milliseconds, so this can be called as often as needed.
+ * @returns The percentage of the time that the bus was busy, from 0 to 100.
+ */
+uint8_t phy_get_bus_utilisation();
+
+/**
+ * @brief Returns when the frame last returned by 'phy_receive_frame()' ended. The time is captured in the interrupt
+ *        routine as soon as the STOP condition is seen, so it doesn't depend on how long the frame waited to be read,
+ *        and every device on the bus captures it at the same moment.
+ * @returns The time at which the frame's STOP condition was received.
+ */
+time phy_get_receive_time();
+
+/**
+ * @brief Returns when the frame last sent by 'phy_transmit_frame()' ended, captured as the STOP condition was sent.
+ *        This only changes when a frame is transmitted in full, so it's left as it was if arbitration was lost.
+ * @returns The time at which the frame's STOP condition was sent.
+ */
+time phy_get_transmit_time();
@@ -1,3 +1,145 @@
 #pragma once
 
-// Transport layer API...
+#include "network_stack/net.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The largest payload that can be sent with 'tra_send()'.
+ */
+#define TRA_MAX_PAYLOAD_LENGTH (64)
+
+/**
+ * Identifies the application component that a payload is for, so that each component can have its own callbacks.
+ */
+typedef uint8_t tra_port;
+
+/**
+ * How payloads on a port are delivered. Both ends of a port must register it the same way.
+ */
+typedef enum {
+    TRA_DELIVERY_RELIABLE = 0, // Payloads are retransmitted until acknowledged, and delivered exactly once and in order
+    TRA_DELIVERY_UNRELIABLE = 1, // Payloads are sent once, outside of any connection, and may be lost or reordered
+} tra_delivery;
+
+/**
+ * @brief A callback function pointer for handling a payload received from another device on a port. Reliable payloads
+ *        from the same source are delivered exactly once and in the order they were sent.
+ * @param source: The source address that the payload came from.
+ * @param payload: A pointer to the first byte in the payload, which points straight into the received packet rather
+ *                 than a copy of it. Note that this pointer is only valid until the function returns, so if the data is
+ *                 needed for longer it must be copied to a separate buffer.
+ * @param length: The number of bytes in the payload.
+ */
+typedef void (*tra_receive_callback)(net_address source, uint8_t *payload, uint8_t length);
+
+/**
+ * @brief A callback function pointer for handling a message received from another device on a port, one chunk at a time, so that
+ *        a message can be much larger than the memory available to hold it. The chunks of a message are delivered in
+ *        order, and messages from the same source are delivered in the order they were sent.
+ * @param source: The source address that the message came from.
+ * @param offset: The position of the chunk's first byte in the message.
+ * @param length: The total number of bytes in the message. The message is complete once 'offset + chunk_length' reaches
+ *                it.
+ * @param chunk: A pointer to the first byte in the chunk, which is only valid until the function returns. This pointer
+ *               is 'NULL' if the message was abandoned partway through, because the source restarted its stream.
+ * @param chunk_length: The number of bytes in the chunk.
+ */
+typedef void (*tra_message_callback)(net_address source, uint16_t offset, uint16_t length, uint8_t *chunk, uint8_t chunk_length);
+
+/**
+ * @brief A callback function pointer for reading a chunk of a message being sent, so that a message doesn't have to be
+ *        held in memory all at once. It's called in order, as space for each chunk becomes free.
+ * @param destination: The destination address that the message is being sent to.
+ * @param offset: The position of the chunk's first byte in the message.
+ * @param chunk: A pointer to the buffer to copy the chunk into.
+ * @param chunk_length: The number of bytes to copy.
+ */
+typedef void (*tra_message_source)(net_address destination, uint16_t offset, uint8_t *chunk, uint8_t chunk_length);
+
+/**
+ * @brief A callback function pointer for finding out what happened to the payloads sent to a destination.
+ * @param destination: The destination address that the payloads were sent to.
+ * @param is_delivered: 'true' once every payload sent to the destination has been acknowledged, or 'false' if the
+ *                      destination stopped acknowledging them and the payloads that were still unacknowledged were
+ *                      dropped, or if a message partway through being sent was dropped because the destination lost
+ *                      track of the connection.
+ */
+typedef void (*tra_send_callback)(net_address destination, bool is_delivered);
+
+/**
+ * The result of sending a payload.
+ */
+typedef enum {
+    TRA_SEND_SUCCESS = 0, // The payload was queued, and will be sent and retransmitted until it's acknowledged
+    TRA_SEND_BUSY = 1, // The destination's window is full, or a message to it is still being read, so try again later
+    TRA_SEND_NO_CONNECTION = 2, // Every connection is in use, and none of them are idle
+    TRA_SEND_INVALID = 3, // The payload's destination, port or length is invalid
+    TRA_SEND_FAILED = 4, // An unreliable payload couldn't be sent to the next node on its route
+} tra_send_status;
+
+/**
+ * @brief Initialises the transport layer. Must be called once at the start of the program, after 'net_initialise()'
+ *        and before calling any other 'tra_()' functions. The transport layer takes over the network layer's receive
+ *        callback, and clears every registered port.
+ */
+void tra_initialise();
+
+/**
+ * @brief Updates the transport layer logic, sending and retransmitting payloads and acknowledgements. This should be
+ *        called periodically, along with 'net_update()'.
+ */
+void tra_update();
+
+/**
+ * @brief Registers a port, so that payloads can be sent on it and payloads received on it are passed to its callbacks.
+ *        Payloads received on a port that isn't registered, or with the wrong delivery, are dropped.
+ * @param port: The port to register.
+ * @param delivery: How payloads on the port are delivered.
+ * @param receive_callback: The function to be called when a payload is received on the port, or 'NULL'.
+ * @param message_callback: The function to be called with each chunk of a message received on the port, or 'NULL'.
+ *                          Only used on reliable ports.
+ * @returns 'true' if the port was registered, or 'false' if it's already registered or there's no space for it.
+ */
+bool tra_register_port(tra_port port, tra_delivery delivery, tra_receive_callback receive_callback, tra_message_callback message_callback);
+
+/**
+ * @brief Sets the user function to be called when the payloads sent to a destination have all been acknowledged, or have
+ *        been given up on.
+ * @param callback: The function to be called. Set to 'NULL' to not use a callback (default).
+ */
+void tra_set_send_callback(tra_send_callback callback);
+
+/**
+ * @brief Sends a payload on a port to the given destination. A reliable payload is queued, and an unreliable one is sent
+ *        straight away. Either way the payload is copied, so the buffer can be reused as soon as the function returns.
+ * @param destination: The logical address to send the payload to.
+ * @param port: The registered port to send the payload on.
+ * @param data: A pointer to the first byte in the payload.
+ * @param length: The number of bytes in the payload, which must be between 1 and 'TRA_MAX_PAYLOAD_LENGTH'.
+ * @param traffic_class: The traffic class of the network packets carrying the payload.
+ * @returns The result of queueing the payload.
+ */
+tra_send_status tra_send(net_address destination, tra_port port, const uint8_t *data, uint8_t length, net_traffic_class traffic_class);
+
+/**
+ * @brief Starts reliably sending a message of any length to the given destination. The message is split into chunks
+ *        which are read from the source function as they're sent, and delivered to the destination's message callback
+ *        in order. Only one message can be sent to a destination at once, and payloads can't be sent to it with
+ *        'tra_send()' until the whole message has been read. The send callback reports when the message has been
+ *        acknowledged.
+ * @param destination: The logical address to send the message to.
+ * @param port: The registered reliable port to send the message on.
+ * @param length: The number of bytes in the message, which must be at least 1.
+ * @param source: The function to read the message's chunks from.
+ * @param traffic_class: The traffic class of the network packets carrying the message.
+ * @returns The result of starting to send the message.
+ */
+tra_send_status tra_send_message(net_address destination, tra_port port, uint16_t length, tra_message_source source, net_traffic_class traffic_class);
+
+/**
+ * @brief Returns the number of payloads sent to a destination which haven't been acknowledged yet.
+ * @param destination: The destination's logical address.
+ * @returns The number of unacknowledged payloads.
+ */
+uint8_t tra_get_unacknowledged_count(net_address destination);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The number of bytes of non-volatile storage available.
+ */
+#define STORAGE_SIZE ((uint16_t) 2048)
+
+/**
+ * @brief Reads a block of bytes from non-volatile storage.
+ * @param address: The storage address of the first byte to read.
+ * @param data: A pointer to the buffer to copy the bytes into.
+ * @param data_length: The number of bytes to read.
+ */
+void storage_read(uint16_t address, void *data, uint16_t data_length);
+
+/**
+ * @brief Returns whether the storage is ready for another byte to be written. Writing a byte takes several
+ *        milliseconds, during which no other byte can be written.
+ * @returns 'true' if a byte can be written straight away; 'false' if the last write is still in progress.
+ */
+bool storage_is_ready();
+
+/**
+ * @brief Starts writing a byte to non-volatile storage. The byte is only written if it's different from the stored
+ *        byte, to avoid wearing out the storage. If the last write is still in progress, this waits for it to finish.
+ * @param address: The storage address of the byte to write.
+ * @param value: The byte to write.
+ */
+void storage_write_byte(uint16_t address, uint8_t value);
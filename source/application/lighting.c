@@ -0,0 +1,208 @@
+#include "lighting.h"
+#include <stddef.h>
+#include <string.h>
+
+// A packet is a sequence number followed by one entry for each command:
+// [SEQUENCE NUMBER] [ENTRY...]
+// An entry starts with the light's address and the fields the command sets, followed by only those fields:
+// [ADDRESS:4 | FIELDS:4] [BRIGHTNESS] [HUE] [SATURATION] [FADE TIME...]
+// An entry which sets no fields repeats the previous entry's fields and values for another light:
+#define ENTRY_ADDRESS_SHIFT 4
+#define ENTRY_FIELDS_MASK 0x0F
+#define ENTRY_FIELDS_REPEAT 0x00
+
+// The fade time is 7 bits to a byte starting with the lowest, with the top bit set in every byte but the last, so a fade
+// of up to 1.27 seconds takes one byte and the longest takes three:
+#define VARINT_FLAG_MORE 0x80
+#define VARINT_VALUE_MASK 0x7F
+#define VARINT_VALUE_BITS (7)
+#define VARINT_MAX_LENGTH (3)
+
+static bool is_valid(const lighting_command *command);
+static bool is_same_state(const lighting_command *command, const lighting_command *other_command);
+static uint8_t encode_command(const lighting_command *command, const lighting_command *previous_command, uint8_t *entry);
+static bool decode_entry(const uint8_t *packet, uint8_t length, uint8_t *offset, lighting_command *command);
+
+uint8_t lighting_encode(uint8_t sequence_number, const lighting_command *commands, uint8_t command_count, uint8_t *packet, uint8_t max_length, uint8_t *length) {
+    *length = 0;
+    if (max_length < 1) {
+        return 0;
+    }
+    packet[0] = sequence_number;
+    *length = 1;
+
+    // Add each command while it fits, comparing it to the command before it so that a repeated state costs one byte:
+    uint8_t command_index = 0;
+    for (; command_index < command_count; command_index++) {
+        const lighting_command *command = &commands[command_index];
+        if (is_valid(command) == false) {
+            break;
+        }
+        uint8_t entry[LIGHTING_MAX_COMMAND_LENGTH];
+        uint8_t entry_length = encode_command(command, (command_index > 0) ? &commands[command_index - 1] : NULL, entry);
+        if (entry_length > max_length - *length) {
+            break;
+        }
+        memcpy(&packet[*length], entry, entry_length);
+        *length += entry_length;
+    }
+    return command_index;
+}
+
+bool lighting_decode(const uint8_t *packet, uint8_t length, uint8_t *sequence_number, lighting_command *commands, uint8_t max_count, uint8_t *command_count) {
+    *command_count = 0;
+    if (length < 1) {
+        return false;
+    }
+    *sequence_number = packet[0];
+
+    // Each command starts as a copy of the one before it, which a repeat entry keeps:
+    lighting_command command = { .fields = ENTRY_FIELDS_REPEAT };
+    uint8_t offset = 1;
+    while (offset < length) {
+        if (*command_count >= max_count || decode_entry(packet, length, &offset, &command) == false) {
+            *command_count = 0;
+            return false;
+        }
+        commands[*command_count] = command;
+        (*command_count)++;
+    }
+    return true;
+}
+
+bool lighting_validate(const uint8_t *packet, uint8_t length) {
+    if (length < 1) {
+        return false;
+    }
+    lighting_command command = { .fields = ENTRY_FIELDS_REPEAT };
+    uint8_t offset = 1;
+    while (offset < length) {
+        if (decode_entry(packet, length, &offset, &command) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool lighting_find_command(const uint8_t *packet, uint8_t length, uint8_t address, uint8_t *sequence_number, lighting_command *command) {
+    if (length < 1) {
+        return false;
+    }
+    *sequence_number = packet[0];
+
+    // Go through every entry, even after finding the light's command, so that a malformed packet is never used:
+    lighting_command current_command = { .fields = ENTRY_FIELDS_REPEAT };
+    bool is_found = false;
+    uint8_t offset = 1;
+    while (offset < length) {
+        if (decode_entry(packet, length, &offset, &current_command) == false) {
+            return false;
+        }
+        if (current_command.address == address) {
+            *command = current_command;
+            is_found = true;
+        }
+    }
+    return is_found;
+}
+
+bool lighting_is_stale(uint8_t sequence_number, uint8_t last_sequence_number) {
+    // Sequence numbers wrap around, so a packet is older if it's less than half the sequence space behind:
+    return (int8_t) (sequence_number - last_sequence_number) < 0;
+}
+
+static bool is_valid(const lighting_command *command) {
+    return command->address <= LIGHTING_MAX_ADDRESS && command->fields != 0 && (command->fields & ~LIGHTING_FIELDS_MASK) == 0;
+}
+
+static bool is_same_state(const lighting_command *command, const lighting_command *other_command) {
+    // Only the fields which are set need to match:
+    if (command->fields != other_command->fields) {
+        return false;
+    }
+    if ((command->fields & LIGHTING_FIELD_BRIGHTNESS) && command->brightness != other_command->brightness) {
+        return false;
+    }
+    if ((command->fields & LIGHTING_FIELD_COLOUR) && (command->hue != other_command->hue || command->saturation != other_command->saturation)) {
+        return false;
+    }
+    if ((command->fields & LIGHTING_FIELD_FADE) && command->fade_time != other_command->fade_time) {
+        return false;
+    }
+    return true;
+}
+
+static uint8_t encode_command(const lighting_command *command, const lighting_command *previous_command, uint8_t *entry) {
+    uint8_t entry_length = 1;
+    if (previous_command != NULL && is_same_state(command, previous_command)) {
+        entry[0] = (command->address << ENTRY_ADDRESS_SHIFT) | ENTRY_FIELDS_REPEAT;
+        return entry_length;
+    }
+
+    entry[0] = (command->address << ENTRY_ADDRESS_SHIFT) | command->fields;
+    if (command->fields & LIGHTING_FIELD_BRIGHTNESS) {
+        entry[entry_length++] = command->brightness;
+    }
+    if (command->fields & LIGHTING_FIELD_COLOUR) {
+        entry[entry_length++] = command->hue;
+        entry[entry_length++] = command->saturation;
+    }
+    if (command->fields & LIGHTING_FIELD_FADE) {
+        uint16_t fade_time = command->fade_time;
+        while (fade_time > VARINT_VALUE_MASK) {
+            entry[entry_length++] = (fade_time & VARINT_VALUE_MASK) | VARINT_FLAG_MORE;
+            fade_time >>= VARINT_VALUE_BITS;
+        }
+        entry[entry_length++] = fade_time;
+    }
+    return entry_length;
+}
+
+static bool decode_entry(const uint8_t *packet, uint8_t length, uint8_t *offset, lighting_command *command) {
+    // The command holds the previous entry's state, which a repeat entry only changes the address of. A repeat entry
+    // with nothing before it, or an entry with unknown fields, makes the packet malformed:
+    uint8_t address = packet[*offset] >> ENTRY_ADDRESS_SHIFT;
+    uint8_t fields = packet[*offset] & ENTRY_FIELDS_MASK;
+    (*offset)++;
+    if (fields == ENTRY_FIELDS_REPEAT) {
+        command->address = address;
+        return command->fields != ENTRY_FIELDS_REPEAT;
+    }
+    if (fields & ~LIGHTING_FIELDS_MASK) {
+        return false;
+    }
+    *command = (lighting_command) { .address = address, .fields = fields };
+
+    // Read each field which is set, checking that it doesn't run past the end of the packet:
+    if (fields & LIGHTING_FIELD_BRIGHTNESS) {
+        if (length - *offset < 1) {
+            return false;
+        }
+        command->brightness = packet[(*offset)++];
+    }
+    if (fields & LIGHTING_FIELD_COLOUR) {
+        if (length - *offset < 2) {
+            return false;
+        }
+        command->hue = packet[(*offset)++];
+        command->saturation = packet[(*offset)++];
+    }
+    if (fields & LIGHTING_FIELD_FADE) {
+        uint32_t fade_time = 0;
+        for (uint8_t byte_index = 0;; byte_index++) {
+            if (byte_index >= VARINT_MAX_LENGTH || *offset >= length) {
+                return false;
+            }
+            uint8_t value = packet[(*offset)++];
+            fade_time |= (uint32_t) (value & VARINT_VALUE_MASK) << (byte_index * VARINT_VALUE_BITS);
+            if ((value & VARINT_FLAG_MORE) == 0) {
+                break;
+            }
+        }
+        if (fade_time > UINT16_MAX) {
+            return false;
+        }
+        command->fade_time = fade_time;
+    }
+    return true;
+}
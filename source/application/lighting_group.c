@@ -0,0 +1,114 @@
+#include "lighting_group.h"
+#include <stddef.h>
+#include <string.h>
+
+// Lighting packets are sent in the interactive traffic class, since somebody is waiting for the lights to change:
+#define LIGHTING_TRAFFIC_CLASS NET_TRAFFIC_CLASS_INTERACTIVE
+
+// A packet passed on to the group starts with the address of the device that sent it to the group controller:
+// [ORIGIN] [LIGHTING PACKET...]
+#define GROUP_HEADER_SIZE (1)
+
+static void handle_packet(net_address source, uint8_t *payload, uint8_t length);
+static void handle_group_packet(net_address source, uint8_t *payload, uint8_t length);
+static bool apply_packet(net_address origin, const uint8_t *packet, uint8_t length);
+
+static lighting_apply_callback apply_callback = NULL;
+
+// The lights in this device's group, with bit 'n' set for the light with address 'n':
+static uint16_t group_members = 0;
+
+// The sequence number of the last packet applied from each sender, which is only known for the senders in
+// 'known_origins':
+static uint8_t last_sequence_numbers[NET_MAX_ADDRESS + 1];
+static uint16_t known_origins = 0;
+
+// The packet waiting to be passed on to the group, and the lights it still has to be passed on to. It's passed on to
+// one light at each update, so that a scene doesn't fill the network layer's queue in one go. A newer packet replaces
+// one which hasn't been passed on to every light yet, as it sets a newer state:
+static uint8_t group_packet[TRA_MAX_PAYLOAD_LENGTH];
+static uint8_t group_packet_length = 0;
+static uint16_t pending_members = 0;
+
+void lighting_group_initialise(lighting_apply_callback callback) {
+    apply_callback = callback;
+    group_members = 0;
+    known_origins = 0;
+    pending_members = 0;
+    tra_register_port(LIGHTING_PORT, TRA_DELIVERY_UNRELIABLE, handle_packet, NULL);
+    tra_register_port(LIGHTING_GROUP_PORT, TRA_DELIVERY_UNRELIABLE, handle_group_packet, NULL);
+}
+
+void lighting_group_update() {
+    // Pass the packet on to the next light which has a command in it. Each light gets it once as a datagram, so a light
+    // which misses it catches up with the next packet:
+    uint8_t sequence_number;
+    lighting_command command;
+    for (net_address member = 0; member <= LIGHTING_MAX_ADDRESS && pending_members != 0; member++) {
+        if ((pending_members & ((uint16_t) 1 << member)) == 0) {
+            continue;
+        }
+        pending_members &= ~((uint16_t) 1 << member);
+        if (lighting_find_command(&group_packet[GROUP_HEADER_SIZE], group_packet_length - GROUP_HEADER_SIZE, member, &sequence_number, &command)) {
+            tra_send(member, LIGHTING_GROUP_PORT, group_packet, group_packet_length, LIGHTING_TRAFFIC_CLASS);
+            return;
+        }
+    }
+}
+
+void lighting_group_set_members(uint16_t members) {
+    group_members = members;
+    pending_members &= members;
+}
+
+tra_send_status lighting_group_send(net_address destination, const uint8_t *packet, uint8_t length) {
+    // Leave space for the header that a group controller adds when it passes the packet on:
+    if (length == 0 || length > TRA_MAX_PAYLOAD_LENGTH - GROUP_HEADER_SIZE) {
+        return TRA_SEND_INVALID;
+    }
+    return tra_send(destination, LIGHTING_PORT, packet, length, LIGHTING_TRAFFIC_CLASS);
+}
+
+static void handle_packet(net_address source, uint8_t *payload, uint8_t length) {
+    // Apply this device's own command, and keep the packet to pass on to the rest of the group (but not back to the
+    // sender):
+    if (apply_packet(source, payload, length) == false || group_members == 0 || length > TRA_MAX_PAYLOAD_LENGTH - GROUP_HEADER_SIZE) {
+        return;
+    }
+    group_packet[0] = source;
+    memcpy(&group_packet[GROUP_HEADER_SIZE], payload, length);
+    group_packet_length = GROUP_HEADER_SIZE + length;
+    pending_members = group_members & ~(((uint16_t) 1 << net_get_own_address()) | ((uint16_t) 1 << source));
+}
+
+static void handle_group_packet(net_address source, uint8_t *payload, uint8_t length) {
+    // A packet passed on by a group controller is only applied, and never passed on again:
+    if (length <= GROUP_HEADER_SIZE || payload[0] > NET_MAX_ADDRESS) {
+        return;
+    }
+    apply_packet(payload[0], &payload[GROUP_HEADER_SIZE], length - GROUP_HEADER_SIZE);
+}
+
+static bool apply_packet(net_address origin, const uint8_t *packet, uint8_t length) {
+    // Drop a malformed packet before taking its sequence number, so that it can't make the sender's later packets look
+    // stale, and isn't passed on:
+    if (lighting_validate(packet, length) == false) {
+        return false;
+    }
+
+    // Ignore a packet which arrives after a newer one from the same sender, so that it can't undo it. Sequence numbers
+    // are kept for the sender rather than for the group controller which passed the packet on, so a packet that arrives
+    // both straight from the sender and through the group controller is only applied in order:
+    if ((known_origins & ((uint16_t) 1 << origin)) && lighting_is_stale(packet[0], last_sequence_numbers[origin])) {
+        return false;
+    }
+    known_origins |= (uint16_t) 1 << origin;
+    last_sequence_numbers[origin] = packet[0];
+
+    uint8_t sequence_number;
+    lighting_command command;
+    if (apply_callback != NULL && lighting_find_command(packet, length, net_get_own_address(), &sequence_number, &command)) {
+        apply_callback(&command);
+    }
+    return true;
+}
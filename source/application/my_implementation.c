@@ -1,7 +1,42 @@
+#include "lighting_group.h"
+#include "network_stack/app.h"
+#include "network_stack/dll.h"
+#include "network_stack/net.h"
+#include "network_stack/phy.h"
+#include "network_stack/tra.h"
+#include "time.h"
+
+// The state of this device's light, which each command updates:
+static lighting_command light_state = { 0 };
+
+static void apply_command(const lighting_command *command) {
+    if (command->fields & LIGHTING_FIELD_BRIGHTNESS) {
+        light_state.brightness = command->brightness;
+    }
+    if (command->fields & LIGHTING_FIELD_COLOUR) {
+        light_state.hue = command->hue;
+        light_state.saturation = command->saturation;
+    }
+    if (command->fields & LIGHTING_FIELD_FADE) {
+        light_state.fade_time = command->fade_time;
+    }
+}
+
 int main() {
     // Setup...
+    phy_initialise();
+    time_initialise();
+    net_initialise();
+    tra_initialise();
+    app_initialise();
+    lighting_group_initialise(apply_command);
 
     while (1) {
         // Loop...
+        dll_update();
+        net_update();
+        tra_update();
+        app_update();
+        lighting_group_update();
     }
 }
@@ -0,0 +1,14 @@
+#include "storage.h"
+#include <avr/eeprom.h>
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    eeprom_read_block(data, (const void *) address, data_length);
+}
+
+bool storage_is_ready() {
+    return eeprom_is_ready();
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+    eeprom_update_byte((uint8_t *) address, value);
+}
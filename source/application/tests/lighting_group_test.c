@@ -0,0 +1,137 @@
+#include "lighting_group.h"
+#include "network_stack/net.h"
+#include "network_stack/tra.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * This test emulates the transport layer, and checks how lighting packets reach the lights. This device has the logical
+ * address 0x01.
+ *
+ * As a light, a packet from 0x0A should have this device's command applied, and a packet without a command for it should
+ * be ignored. A packet from 0x0A which is older than the last one applied from it should be ignored, while a packet from
+ * 0x0B has its own sequence numbers. A truncated packet from 0x0C with a high sequence number should be dropped
+ * without recording it, so the valid packet from 0x0C after it is applied. A packet passed on by the group controller
+ * 0x05 should be treated as coming from the device that sent it to the group controller.
+ *
+ * As the group controller for 0x01, 0x02, 0x03, 0x04 and 0x06, a packet from 0x0A with commands for 0x01, 0x02, 0x03 and
+ * 0x06 should have this device's command applied, and be passed on to 0x02, 0x03 and 0x06 one at each update, after
+ * the byte 0x0A. 0x04 has no command in it, so it shouldn't be sent the packet. A malformed packet shouldn't be passed
+ * on. A packet which is too long to pass on should be refused when it's sent.
+ */
+
+// The emulated transport layer's receive callbacks for the lighting ports:
+tra_receive_callback emulated_packet_callback = NULL;
+tra_receive_callback emulated_group_packet_callback = NULL;
+
+void apply_command(const lighting_command *command) {
+    uart_put_string("Applying command: fields ");
+    uart_print_hex_8(command->fields);
+    uart_put_string(", brightness ");
+    uart_print_hex_8(command->brightness);
+    uart_put_string("\n\r");
+}
+
+void emulate_packet(net_address source, tra_port port, const uint8_t *payload, uint8_t length) {
+    uart_put_string("Emulating packet from ");
+    uart_print_hex_8(source);
+    uart_put_string(" on ");
+    uart_print_hex_8(port);
+    uart_put_string("\n\r");
+    uint8_t copy[TRA_MAX_PAYLOAD_LENGTH];
+    for (uint8_t i = 0; i < length; i++) {
+        copy[i] = payload[i];
+    }
+    if (port == LIGHTING_PORT) {
+        emulated_packet_callback(source, copy, length);
+    } else {
+        emulated_group_packet_callback(source, copy, length);
+    }
+}
+
+void send_scene(uint8_t sequence_number, const lighting_command *commands, uint8_t command_count) {
+    uint8_t packet[TRA_MAX_PAYLOAD_LENGTH];
+    uint8_t length;
+    lighting_encode(sequence_number, commands, command_count, packet, sizeof(packet), &length);
+    emulate_packet(0x0A, LIGHTING_PORT, packet, length);
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+    lighting_group_initialise(apply_command);
+
+    uart_put_string("\n\r--- Packets for this light ---\n\r");
+    emulate_packet(0x0A, LIGHTING_PORT, (const uint8_t[]) { 0x10, 0x11, 0x80, 0x20 }, 4);
+    emulate_packet(0x0A, LIGHTING_PORT, (const uint8_t[]) { 0x11, 0x21, 0x60 }, 3);
+    emulate_packet(0x0A, LIGHTING_PORT, (const uint8_t[]) { 0x0F, 0x11, 0x40 }, 3);
+    emulate_packet(0x0A, LIGHTING_PORT, (const uint8_t[]) { 0x12, 0x11, 0xC0 }, 3);
+    emulate_packet(0x0B, LIGHTING_PORT, (const uint8_t[]) { 0x05, 0x11, 0xA0 }, 3);
+    emulate_packet(0x0C, LIGHTING_PORT, (const uint8_t[]) { 0x7F, 0x13, 0x10 }, 3);
+    emulate_packet(0x0C, LIGHTING_PORT, (const uint8_t[]) { 0x01, 0x11, 0x50 }, 3);
+
+    uart_put_string("\n\r--- Packets passed on by the group controller 0x05 ---\n\r");
+    emulate_packet(0x05, LIGHTING_GROUP_PORT, (const uint8_t[]) { 0x0A, 0x11, 0x11, 0x00 }, 4);
+    emulate_packet(0x05, LIGHTING_GROUP_PORT, (const uint8_t[]) { 0x0A, 0x13, 0x11, 0xE0 }, 4);
+
+    uart_put_string("\n\r--- Passing a scene on to the group ---\n\r");
+    lighting_group_set_members(0x005E);
+    const lighting_command scene[] = {
+        { .address = 0x01, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0xFF },
+        { .address = 0x02, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0xFF },
+        { .address = 0x03, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0x80 },
+        { .address = 0x06, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0x80 },
+    };
+    send_scene(0x14, scene, 4);
+    for (uint8_t update = 0; update < 4; update++) {
+        uart_put_string("Update\n\r");
+        lighting_group_update();
+    }
+    emulate_packet(0x0A, LIGHTING_PORT, (const uint8_t[]) { 0x15, 0x11, 0x60, 0x23 }, 4);
+    uart_put_string("Update\n\r");
+    lighting_group_update();
+
+    uart_put_string("\n\r--- Sending packets ---\n\r");
+    uint8_t packet[TRA_MAX_PAYLOAD_LENGTH] = { 0x15, 0x61, 0x40 };
+    uart_put_string("Send status: ");
+    uart_print_hex_8(lighting_group_send(0x05, packet, 3));
+    uart_put_string("\n\rSend status, too long: ");
+    uart_print_hex_8(lighting_group_send(0x05, packet, TRA_MAX_PAYLOAD_LENGTH));
+    uart_put_string("\n\r");
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** tra.h emulated implementation *************************//
+
+bool tra_register_port(tra_port port, tra_delivery delivery, tra_receive_callback receive_callback, tra_message_callback message_callback) {
+    if (port == LIGHTING_PORT) {
+        emulated_packet_callback = receive_callback;
+    } else {
+        emulated_group_packet_callback = receive_callback;
+    }
+    return true;
+}
+
+tra_send_status tra_send(net_address destination, tra_port port, const uint8_t *data, uint8_t length, net_traffic_class traffic_class) {
+    uart_put_string("Send packet to ");
+    uart_print_hex_8(destination);
+    uart_put_string(" on ");
+    uart_print_hex_8(port);
+    uart_put_string(": ");
+    for (uint8_t i = 0; i < length; i++) {
+        uart_print_hex_8(data[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+    return TRA_SEND_SUCCESS;
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
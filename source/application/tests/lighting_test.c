@@ -0,0 +1,225 @@
+#include "lighting.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This test encodes and decodes lighting packets, and compares the bytes needed to send scenes with them against sending
+ * each light a fixed-size command.
+ *
+ * A command setting every field with a long fade should take up 7 bytes, and one setting only the brightness 2 bytes.
+ * Lights sharing the previous light's state should take up one byte each. Each packet should decode back to the same
+ * commands, and finding one light's command should give the last command for it.
+ *
+ * Encoding into a buffer which is too small, or a command with an invalid address or no fields, should stop at that
+ * command. Packets which are truncated, start with a repeat entry, set the reserved field or have a fade time over 16
+ * bits should be refused whole. A truncated packet should fail validation, and the valid packet after it should pass.
+ *
+ * Sequence numbers should be stale only when they're behind the last one applied, including across wrapping around.
+ */
+
+// The naive format sends each light a fixed 6-byte command: [ADDRESS] [BRIGHTNESS] [HUE] [SATURATION] [FADE TIME x2]
+#define NAIVE_COMMAND_LENGTH (6)
+
+// Every packet sent as a transport layer datagram costs its header, the network layer's full data header and checksum,
+// and the data link layer's framing for each frame of up to 23 bytes (acknowledgements aren't counted):
+#define DATAGRAM_HEADER_LENGTH (2)
+#define NET_DATA_OVERHEAD (7)
+#define DLL_FRAME_DATA_LENGTH (23)
+#define DLL_FRAME_OVERHEAD (9)
+
+uint16_t wire_length(uint8_t payload_length) {
+    uint16_t packet_length = payload_length + DATAGRAM_HEADER_LENGTH + NET_DATA_OVERHEAD;
+    uint16_t frame_count = (packet_length + DLL_FRAME_DATA_LENGTH - 1) / DLL_FRAME_DATA_LENGTH;
+    return packet_length + frame_count * DLL_FRAME_OVERHEAD;
+}
+
+void print_command(const lighting_command *command) {
+    uart_put_string("  light ");
+    uart_print_hex_8(command->address);
+    uart_put_string(" fields ");
+    uart_print_hex_8(command->fields);
+    if (command->fields & LIGHTING_FIELD_BRIGHTNESS) {
+        uart_put_string(" brightness ");
+        uart_print_hex_8(command->brightness);
+    }
+    if (command->fields & LIGHTING_FIELD_COLOUR) {
+        uart_put_string(" colour ");
+        uart_print_hex_8(command->hue);
+        uart_put_byte('/');
+        uart_print_hex_8(command->saturation);
+    }
+    if (command->fields & LIGHTING_FIELD_FADE) {
+        uart_put_string(" fade ");
+        uart_print_hex_16(command->fade_time);
+    }
+    uart_put_string("\n\r");
+}
+
+void print_packet(const uint8_t *packet, uint8_t length) {
+    uart_put_string("Packet (");
+    uart_print_hex_8(length);
+    uart_put_string(" bytes): ");
+    for (uint8_t i = 0; i < length; i++) {
+        uart_print_hex_8(packet[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+void decode(const uint8_t *packet, uint8_t length) {
+    uint8_t sequence_number = 0;
+    lighting_command commands[LIGHTING_MAX_ADDRESS + 1];
+    uint8_t command_count = 0;
+    bool is_decoded = lighting_decode(packet, length, &sequence_number, commands, LIGHTING_MAX_ADDRESS + 1, &command_count);
+    uart_put_string("Decoded: ");
+    uart_print_hex_8(is_decoded);
+    uart_put_string(", sequence number ");
+    uart_print_hex_8(sequence_number);
+    uart_put_string(", commands ");
+    uart_print_hex_8(command_count);
+    uart_put_string("\n\r");
+    for (uint8_t i = 0; i < command_count; i++) {
+        print_command(&commands[i]);
+    }
+}
+
+void validate(const uint8_t *packet, uint8_t length) {
+    uart_put_string("Valid: ");
+    uart_print_hex_8(lighting_validate(packet, length));
+    uart_put_string("\n\r");
+}
+
+void encode(uint8_t sequence_number, const lighting_command *commands, uint8_t command_count, uint8_t max_length) {
+    uint8_t packet[128];
+    uint8_t length = 0;
+    uint8_t encoded_count = lighting_encode(sequence_number, commands, command_count, packet, max_length, &length);
+    uart_put_string("Encoded commands: ");
+    uart_print_hex_8(encoded_count);
+    uart_put_string(" of ");
+    uart_print_hex_8(command_count);
+    uart_put_string("\n\r");
+    print_packet(packet, length);
+    decode(packet, length);
+}
+
+void find(const uint8_t *packet, uint8_t length, uint8_t address) {
+    uint8_t sequence_number = 0;
+    lighting_command command;
+    uart_put_string("Command for ");
+    uart_print_hex_8(address);
+    uart_put_string(": ");
+    if (lighting_find_command(packet, length, address, &sequence_number, &command)) {
+        uart_put_string("found\n\r");
+        print_command(&command);
+    } else {
+        uart_put_string("not found\n\r");
+    }
+}
+
+void compare_scene(const char *name, const lighting_command *commands, uint8_t command_count) {
+    // Sending each light its own packet, in the naive format and in the lighting format, against one packet for every
+    // light. Each is shown as payload bytes, then wire bytes:
+    uint16_t naive_payload = 0, naive_wire = 0, separate_payload = 0, separate_wire = 0;
+    for (uint8_t i = 0; i < command_count; i++) {
+        uint8_t packet[LIGHTING_MAX_COMMAND_LENGTH + 1];
+        uint8_t length = 0;
+        lighting_encode(0x00, &commands[i], 1, packet, sizeof(packet), &length);
+        naive_payload += NAIVE_COMMAND_LENGTH;
+        naive_wire += wire_length(NAIVE_COMMAND_LENGTH);
+        separate_payload += length;
+        separate_wire += wire_length(length);
+    }
+    uint8_t packet[128];
+    uint8_t length = 0;
+    lighting_encode(0x00, commands, command_count, packet, sizeof(packet), &length);
+
+    uart_put_string(name);
+    uart_put_string(": naive ");
+    uart_print_hex_16(naive_payload);
+    uart_put_byte('/');
+    uart_print_hex_16(naive_wire);
+    uart_put_string(", separate ");
+    uart_print_hex_16(separate_payload);
+    uart_put_byte('/');
+    uart_print_hex_16(separate_wire);
+    uart_put_string(", one packet ");
+    uart_print_hex_16(length);
+    uart_put_byte('/');
+    uart_print_hex_16(wire_length(length));
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- Encoding and decoding ---\n\r");
+    encode(0x21, (const lighting_command[]) {
+        { .address = 0x01, .fields = LIGHTING_FIELD_BRIGHTNESS | LIGHTING_FIELD_COLOUR | LIGHTING_FIELD_FADE, .brightness = 0xFF, .hue = 0x20, .saturation = 0x80, .fade_time = 6000 },
+        { .address = 0x02, .fields = LIGHTING_FIELD_BRIGHTNESS | LIGHTING_FIELD_COLOUR | LIGHTING_FIELD_FADE, .brightness = 0xFF, .hue = 0x20, .saturation = 0x80, .fade_time = 6000 },
+        { .address = 0x03, .fields = LIGHTING_FIELD_BRIGHTNESS | LIGHTING_FIELD_COLOUR | LIGHTING_FIELD_FADE, .brightness = 0xFF, .hue = 0x20, .saturation = 0x80, .fade_time = 6000 },
+        { .address = 0x04, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0x00 },
+        { .address = 0x05, .fields = LIGHTING_FIELD_FADE | LIGHTING_FIELD_BRIGHTNESS, .brightness = 0x40, .fade_time = 50 },
+        { .address = 0x0F, .fields = LIGHTING_FIELD_COLOUR, .hue = 0xA0, .saturation = 0xFF },
+    }, 6, 128);
+    uint8_t repeated_packet[] = { 0x22, 0x31, 0x10, 0x20, 0x31, 0x80 };
+    find(repeated_packet, sizeof(repeated_packet), 0x03);
+    find(repeated_packet, sizeof(repeated_packet), 0x02);
+    find(repeated_packet, sizeof(repeated_packet), 0x04);
+
+    uart_put_string("\n\r--- Encoding what doesn't fit or is invalid ---\n\r");
+    const lighting_command valid_commands[] = {
+        { .address = 0x01, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0x10 },
+        { .address = 0x02, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0x20 },
+        { .address = 0x03, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = 0x20 },
+    };
+    encode(0x23, valid_commands, 3, 5);
+    encode(0x24, valid_commands, 3, 6);
+    encode(0x25, (const lighting_command[]) { valid_commands[0], { .address = 0x10, .fields = LIGHTING_FIELD_BRIGHTNESS } }, 2, 128);
+    encode(0x26, (const lighting_command[]) { valid_commands[0], { .address = 0x02, .fields = 0 } }, 2, 128);
+    encode(0x27, (const lighting_command[]) { valid_commands[0], { .address = 0x02, .fields = 0x08 } }, 2, 128);
+
+    uart_put_string("\n\r--- Decoding malformed packets ---\n\r");
+    decode((const uint8_t[]) { 0x28, 0x13, 0x10, 0x20 }, 4);
+    decode((const uint8_t[]) { 0x29, 0x10, 0x20 }, 3);
+    decode((const uint8_t[]) { 0x2A, 0x19, 0x10 }, 3);
+    decode((const uint8_t[]) { 0x2B, 0x14, 0xFF, 0xFF, 0x03 }, 5);
+    decode((const uint8_t[]) { 0x2C, 0x14, 0xFF, 0xFF, 0x04 }, 5);
+    decode((const uint8_t[]) { 0x2C, 0x14, 0xFF, 0xFF, 0x83, 0x00 }, 6);
+    decode((const uint8_t[]) { 0x2D, 0x14, 0xFF, 0xFF }, 4);
+    decode((const uint8_t[]) { 0x2E }, 1);
+    find((const uint8_t[]) { 0x2F, 0x11, 0x10, 0x21 }, 4, 0x01);
+    validate((const uint8_t[]) { 0xF0, 0x13, 0x10 }, 3);
+    validate((const uint8_t[]) { 0x30, 0x11, 0x40 }, 3);
+
+    uart_put_string("\n\r--- Stale sequence numbers ---\n\r");
+    const uint8_t sequence_pairs[][2] = { { 0x10, 0x10 }, { 0x11, 0x10 }, { 0x0F, 0x10 }, { 0x02, 0xFE }, { 0xFE, 0x02 }, { 0x90, 0x10 } };
+    for (uint8_t i = 0; i < 6; i++) {
+        uart_print_hex_8(sequence_pairs[i][0]);
+        uart_put_string(" after ");
+        uart_print_hex_8(sequence_pairs[i][1]);
+        uart_put_string(" stale: ");
+        uart_print_hex_8(lighting_is_stale(sequence_pairs[i][0], sequence_pairs[i][1]));
+        uart_put_string("\n\r");
+    }
+
+    uart_put_string("\n\r--- Bytes per scene (payload/wire) ---\n\r");
+    lighting_command scene[LIGHTING_MAX_ADDRESS];
+    for (uint8_t i = 0; i < LIGHTING_MAX_ADDRESS; i++) {
+        scene[i] = (lighting_command) { .address = i + 1, .fields = LIGHTING_FIELD_BRIGHTNESS | LIGHTING_FIELD_COLOUR | LIGHTING_FIELD_FADE, .brightness = 0xC0, .hue = 0x18, .saturation = 0x60, .fade_time = 200 };
+    }
+    compare_scene("1 light, every field", scene, 1);
+    compare_scene("4 lights, same state", scene, 4);
+    compare_scene("15 lights, same state", scene, 15);
+    for (uint8_t i = 0; i < LIGHTING_MAX_ADDRESS; i++) {
+        scene[i] = (lighting_command) { .address = i + 1, .fields = LIGHTING_FIELD_BRIGHTNESS, .brightness = i * 0x11 };
+    }
+    compare_scene("15 lights, brightness ramp", scene, 15);
+    for (uint8_t i = 0; i < LIGHTING_MAX_ADDRESS; i++) {
+        scene[i] = (lighting_command) { .address = i + 1, .fields = LIGHTING_FIELD_BRIGHTNESS | LIGHTING_FIELD_COLOUR | LIGHTING_FIELD_FADE, .brightness = 0x80 + i, .hue = i * 0x11, .saturation = 0xFF, .fade_time = 3000 };
+    }
+    compare_scene("15 lights, every field differs", scene, 15);
+
+    uart_put_string("\n\rFinished.\n\r");
+}
@@ -0,0 +1,200 @@
+#include "network_stack/app.h"
+#include "network_stack/net.h"
+#include "network_stack/tra.h"
+#include "methods.h"
+#include "requests.h"
+#include "time.h"
+#include <stddef.h>
+#include <string.h>
+
+// Every request and response is an entry in a payload, and a payload holds as many entries as fit, one after the other:
+// [ID] [KIND] [LENGTH] [ARGUMENTS OR RESULT...]
+// The kind is the method in a request, or the response flag and the status in a response:
+#define ENTRY_HEADER_SIZE (3)
+#define ENTRY_FLAG_RESPONSE 0x80
+#define ENTRY_STATUS_MASK 0x7F
+
+// Requests and responses are sent in the interactive traffic class, since a device is waiting for each of them:
+#define APP_TRAFFIC_CLASS NET_TRAFFIC_CLASS_INTERACTIVE
+
+static void handle_reliable_payload(net_address source, uint8_t *payload, uint8_t length);
+static void handle_unreliable_payload(net_address source, uint8_t *payload, uint8_t length);
+static void handle_payload(net_address source, uint8_t *payload, uint8_t length, tra_delivery delivery);
+static void handle_request(net_address source, app_request_id id, app_method method, uint8_t *arguments, uint8_t length, tra_delivery delivery);
+static void handle_response(net_address source, app_request_id id, app_rpc_status status, uint8_t *result, uint8_t length);
+static bool add_entry(net_address destination, tra_delivery delivery, app_request_id id, uint8_t kind, const uint8_t *data, uint8_t length);
+static void send_batches();
+static void time_out_requests(time now);
+static void remove_batched_request(net_address destination, app_request_id id);
+
+void app_initialise() {
+    app_initialise_requests();
+    app_initialise_methods();
+    tra_register_port(APP_RELIABLE_PORT, TRA_DELIVERY_RELIABLE, handle_reliable_payload, NULL);
+    tra_register_port(APP_UNRELIABLE_PORT, TRA_DELIVERY_UNRELIABLE, handle_unreliable_payload, NULL);
+}
+
+void app_update() {
+    time_out_requests(time_now());
+    send_batches();
+}
+
+bool app_register_method(app_method method, app_method_handler handler) {
+    if (method > APP_MAX_METHOD || handler == NULL) {
+        return false;
+    }
+    return app_add_method(method, handler);
+}
+
+app_call_status app_call(net_address destination, app_method method, const uint8_t *arguments, uint8_t length, tra_delivery delivery, uint16_t timeout_milliseconds, app_response_callback callback, app_request_id *id) {
+    if (destination > NET_MAX_ADDRESS || destination == net_get_own_address() || method > APP_MAX_METHOD || length > APP_MAX_ARGUMENTS_LENGTH
+        || (arguments == NULL && length != 0) || delivery > TRA_DELIVERY_UNRELIABLE || callback == NULL) {
+        return APP_CALL_INVALID;
+    }
+
+    // The request needs both an outstanding request entry and space in a batch:
+    app_request *request = app_add_request(destination, callback, time_add_milliseconds(time_now(), timeout_milliseconds));
+    if (request == NULL) {
+        return APP_CALL_BUSY;
+    }
+    if (add_entry(destination, delivery, request->id, method, arguments, length) == false) {
+        request->is_used = false;
+        return APP_CALL_BUSY;
+    }
+    if (id != NULL) {
+        *id = request->id;
+    }
+    return APP_CALL_SUCCESS;
+}
+
+uint8_t app_get_outstanding_count(net_address destination) {
+    uint8_t count = 0;
+    for (uint8_t request_index = 0; request_index < APP_MAX_OUTSTANDING_REQUESTS; request_index++) {
+        app_request *request = app_get_request(request_index);
+        if (request->is_used && request->destination == destination) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static void handle_reliable_payload(net_address source, uint8_t *payload, uint8_t length) {
+    handle_payload(source, payload, length, TRA_DELIVERY_RELIABLE);
+}
+
+static void handle_unreliable_payload(net_address source, uint8_t *payload, uint8_t length) {
+    handle_payload(source, payload, length, TRA_DELIVERY_UNRELIABLE);
+}
+
+static void handle_payload(net_address source, uint8_t *payload, uint8_t length, tra_delivery delivery) {
+    // Handle each entry in turn, ignoring the rest of the payload if an entry runs past its end. Nothing is sent until
+    // the next update, so the payload stays valid while the handlers and callbacks run:
+    uint8_t offset = 0;
+    while (length - offset >= ENTRY_HEADER_SIZE) {
+        uint8_t *entry = &payload[offset];
+        uint8_t data_length = entry[2];
+        if (data_length > length - offset - ENTRY_HEADER_SIZE) {
+            break;
+        }
+        if (entry[1] & ENTRY_FLAG_RESPONSE) {
+            handle_response(source, entry[0], entry[1] & ENTRY_STATUS_MASK, &entry[ENTRY_HEADER_SIZE], data_length);
+        } else {
+            handle_request(source, entry[0], entry[1], &entry[ENTRY_HEADER_SIZE], data_length, delivery);
+        }
+        offset += ENTRY_HEADER_SIZE + data_length;
+    }
+}
+
+static void handle_request(net_address source, app_request_id id, app_method method, uint8_t *arguments, uint8_t length, tra_delivery delivery) {
+    // Call the method's handler, and batch the response to go back the same way as the request at the next update. If
+    // there's no space for the response it's dropped, and the request times out at the source. The result buffer is 61
+    // bytes on the stack, on top of the transport and network layers' receive paths, which is the deepest the stack
+    // gets in the application layer:
+    uint8_t result[APP_MAX_RESULT_LENGTH];
+    uint8_t result_length = 0;
+    app_rpc_status status = APP_RPC_UNKNOWN_METHOD;
+    app_method_handler handler = app_find_method(method);
+    if (handler != NULL) {
+        status = handler(source, arguments, length, result, &result_length);
+    }
+    add_entry(source, delivery, id, ENTRY_FLAG_RESPONSE | status, result, result_length);
+}
+
+static void handle_response(net_address source, app_request_id id, app_rpc_status status, uint8_t *result, uint8_t length) {
+    // Ignore a response to a request which has already timed out, or a repeat of one:
+    app_request *request = app_find_request(source, id);
+    if (request == NULL) {
+        return;
+    }
+
+    // Free the entry before calling the callback, so that the callback can make another request:
+    request->is_used = false;
+    request->callback(source, id, status, result, length);
+}
+
+static bool add_entry(net_address destination, tra_delivery delivery, app_request_id id, uint8_t kind, const uint8_t *data, uint8_t length) {
+    app_batch *batch = app_find_batch(destination, delivery, ENTRY_HEADER_SIZE + length);
+    if (batch == NULL) {
+        return false;
+    }
+    uint8_t *entry = &batch->payload[batch->length];
+    entry[0] = id;
+    entry[1] = kind;
+    entry[2] = length;
+    if (length > 0) {
+        memcpy(&entry[ENTRY_HEADER_SIZE], data, length);
+    }
+    batch->length += ENTRY_HEADER_SIZE + length;
+    return true;
+}
+
+static void send_batches() {
+    for (uint8_t batch_index = 0; batch_index < APP_BATCH_COUNT; batch_index++) {
+        app_batch *batch = app_get_batch(batch_index);
+        if (batch->is_used == false) {
+            continue;
+        }
+
+        // Keep the batch until the next update if the transport layer has no space for it yet, so that more entries can
+        // join it. Otherwise it's done with: if it couldn't be sent at all, its requests time out:
+        tra_port port = (batch->delivery == TRA_DELIVERY_RELIABLE) ? APP_RELIABLE_PORT : APP_UNRELIABLE_PORT;
+        tra_send_status status = tra_send(batch->destination, port, batch->payload, batch->length, APP_TRAFFIC_CLASS);
+        if (status != TRA_SEND_BUSY && status != TRA_SEND_NO_CONNECTION) {
+            batch->is_used = false;
+        }
+    }
+}
+
+static void time_out_requests(time now) {
+    for (uint8_t request_index = 0; request_index < APP_MAX_OUTSTANDING_REQUESTS; request_index++) {
+        app_request *request = app_get_request(request_index);
+        if (request->is_used && time_delta_milliseconds(request->timeout_time, now) >= 0) {
+            request->is_used = false;
+            remove_batched_request(request->destination, request->id);
+            request->callback(request->destination, request->id, APP_RPC_TIMEOUT, NULL, 0);
+        }
+    }
+}
+
+static void remove_batched_request(net_address destination, app_request_id id) {
+    // A request which times out while its batch is still waiting for the transport layer is taken out of the batch, so
+    // that it isn't sent after the caller has given up on it. A batch left empty is freed:
+    for (uint8_t batch_index = 0; batch_index < APP_BATCH_COUNT; batch_index++) {
+        app_batch *batch = app_get_batch(batch_index);
+        if (batch->is_used == false || batch->destination != destination) {
+            continue;
+        }
+        uint8_t offset = 0;
+        while (offset < batch->length) {
+            uint8_t *entry = &batch->payload[offset];
+            uint8_t entry_length = ENTRY_HEADER_SIZE + entry[2];
+            if (entry[0] == id && (entry[1] & ENTRY_FLAG_RESPONSE) == 0) {
+                batch->length -= entry_length;
+                memmove(entry, &entry[entry_length], batch->length - offset);
+                batch->is_used = (batch->length > 0);
+                return;
+            }
+            offset += entry_length;
+        }
+    }
+}
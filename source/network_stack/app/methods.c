@@ -0,0 +1,30 @@
+#include "methods.h"
+#include <stddef.h>
+
+// Table of registered methods, in the order they were registered. A device registers a handful of methods, so searching
+// the table is quicker than indexing a table of every possible method would be worth in RAM.
+static app_method_entry methods[APP_MAX_METHODS];
+static uint8_t method_count = 0;
+
+void app_initialise_methods() {
+    method_count = 0;
+}
+
+bool app_add_method(app_method method, app_method_handler handler) {
+    if (method_count == APP_MAX_METHODS || app_find_method(method) != NULL) {
+        return false;
+    }
+    app_method_entry *entry = &methods[method_count++];
+    entry->method = method;
+    entry->handler = handler;
+    return true;
+}
+
+app_method_handler app_find_method(app_method method) {
+    for (uint8_t method_index = 0; method_index < method_count; method_index++) {
+        if (methods[method_index].method == method) {
+            return methods[method_index].handler;
+        }
+    }
+    return NULL;
+}
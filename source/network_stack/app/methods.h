@@ -0,0 +1,40 @@
+#pragma once
+
+#include "network_stack/app.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The number of methods that can be registered at once.
+ */
+#ifndef APP_MAX_METHODS
+#define APP_MAX_METHODS (8)
+#endif
+
+/**
+ * A registered method.
+ */
+typedef struct {
+    app_method method; // The method number
+    app_method_handler handler; // Called with each request for the method
+} app_method_entry;
+
+/**
+ * @brief Clears every registered method.
+ */
+void app_initialise_methods();
+
+/**
+ * @brief Adds a method to the table of registered methods.
+ * @param method: The method number.
+ * @param handler: The method's handler.
+ * @returns 'true' if the method was added, or 'false' if it's already in the table or the table is full.
+ */
+bool app_add_method(app_method method, app_method_handler handler);
+
+/**
+ * @brief Finds a registered method's handler.
+ * @param method: The method number.
+ * @returns The method's handler, or 'NULL' if it isn't registered.
+ */
+app_method_handler app_find_method(app_method method);
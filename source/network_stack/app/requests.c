@@ -0,0 +1,81 @@
+#include "requests.h"
+#include <stddef.h>
+#include <string.h>
+
+// Table of outstanding requests. The entries aren't kept in any order.
+static app_request requests[APP_MAX_OUTSTANDING_REQUESTS];
+
+// The ID given to the next request. IDs are handed out in turn, so an ID isn't reused until long after its request has
+// finished, and a late response to an old request can't be mistaken for the response to a new one.
+static app_request_id next_id = 0;
+
+// List of batches waiting to be sent. The batches aren't kept in any order.
+static app_batch batches[APP_BATCH_COUNT];
+
+void app_initialise_requests() {
+    memset(requests, 0, sizeof(requests));
+    memset(batches, 0, sizeof(batches));
+}
+
+app_request *app_get_request(uint8_t request_index) {
+    return &requests[request_index];
+}
+
+app_request *app_add_request(net_address destination, app_response_callback callback, time timeout_time) {
+    app_request *free_request = NULL;
+    for (uint8_t request_index = 0; request_index < APP_MAX_OUTSTANDING_REQUESTS; request_index++) {
+        if (requests[request_index].is_used == false) {
+            free_request = &requests[request_index];
+            break;
+        }
+    }
+    if (free_request == NULL) {
+        return NULL;
+    }
+
+    // Skip any IDs still held by outstanding requests to the same destination (only possible after 256 requests):
+    while (app_find_request(destination, next_id) != NULL) {
+        next_id++;
+    }
+    free_request->destination = destination;
+    free_request->id = next_id++;
+    free_request->callback = callback;
+    free_request->timeout_time = timeout_time;
+    free_request->is_used = true;
+    return free_request;
+}
+
+app_request *app_find_request(net_address destination, app_request_id id) {
+    for (uint8_t request_index = 0; request_index < APP_MAX_OUTSTANDING_REQUESTS; request_index++) {
+        app_request *request = &requests[request_index];
+        if (request->is_used && request->destination == destination && request->id == id) {
+            return request;
+        }
+    }
+    return NULL;
+}
+
+app_batch *app_get_batch(uint8_t batch_index) {
+    return &batches[batch_index];
+}
+
+app_batch *app_find_batch(net_address destination, tra_delivery delivery, uint8_t entry_length) {
+    app_batch *free_batch = NULL;
+    for (uint8_t batch_index = 0; batch_index < APP_BATCH_COUNT; batch_index++) {
+        app_batch *batch = &batches[batch_index];
+        if (batch->is_used == false) {
+            if (free_batch == NULL) {
+                free_batch = batch;
+            }
+        } else if (batch->destination == destination && batch->delivery == delivery && batch->length + entry_length <= TRA_MAX_PAYLOAD_LENGTH) {
+            return batch;
+        }
+    }
+    if (free_batch != NULL) {
+        free_batch->length = 0;
+        free_batch->destination = destination;
+        free_batch->delivery = delivery;
+        free_batch->is_used = true;
+    }
+    return free_batch;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "network_stack/app.h"
+#include "time.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The number of requests that can be waiting for a response at once, shared between all destinations.
+ */
+#ifndef APP_MAX_OUTSTANDING_REQUESTS
+#define APP_MAX_OUTSTANDING_REQUESTS (8)
+#endif
+
+/**
+ * The number of payloads of batched requests and responses that can be waiting to be sent at once, shared between all
+ * destinations.
+ */
+#ifndef APP_BATCH_COUNT
+#define APP_BATCH_COUNT (2)
+#endif
+
+/**
+ * A request which is waiting for a response.
+ */
+typedef struct {
+    net_address destination; // The address that the request was sent to
+    app_request_id id; // The request's ID, which the response carries
+    app_response_callback callback; // Called with the response, or once the request times out
+    time timeout_time; // The time after which the request times out
+    bool is_used; // Whether this entry holds a request
+} app_request;
+
+/**
+ * Requests and responses to the same destination which are sent together in one payload.
+ */
+typedef struct {
+    uint8_t payload[TRA_MAX_PAYLOAD_LENGTH]; // The entries added so far, one after the other
+    uint8_t length; // The number of bytes in the payload
+    net_address destination; // The address that the payload is sent to
+    tra_delivery delivery; // How the payload is delivered
+    bool is_used; // Whether this batch holds any entries
+} app_batch;
+
+/**
+ * @brief Clears every outstanding request and batch.
+ */
+void app_initialise_requests();
+
+/**
+ * @brief Returns an outstanding request table entry.
+ * @param request_index: The entry's index, less than 'APP_MAX_OUTSTANDING_REQUESTS'.
+ * @returns A pointer to the entry.
+ */
+app_request *app_get_request(uint8_t request_index);
+
+/**
+ * @brief Adds a request to the table of outstanding requests, giving it an ID which no other outstanding request has.
+ * @param destination: The address that the request is sent to.
+ * @param callback: The request's response callback.
+ * @param timeout_time: The time after which the request times out.
+ * @returns A pointer to the request's entry, or 'NULL' if the table is full.
+ */
+app_request *app_add_request(net_address destination, app_response_callback callback, time timeout_time);
+
+/**
+ * @brief Finds the outstanding request that a response is for.
+ * @param destination: The address that the response came from.
+ * @param id: The ID that the response carries.
+ * @returns A pointer to the request's entry, or 'NULL' if there isn't one (e.g. it already timed out).
+ */
+app_request *app_find_request(net_address destination, app_request_id id);
+
+/**
+ * @brief Returns a batch.
+ * @param batch_index: The batch's index, less than 'APP_BATCH_COUNT'.
+ * @returns A pointer to the batch.
+ */
+app_batch *app_get_batch(uint8_t batch_index);
+
+/**
+ * @brief Finds a batch to a destination with space for an entry, or starts a new one if there isn't one.
+ * @param destination: The address that the entry is sent to.
+ * @param delivery: How the entry is delivered.
+ * @param entry_length: The number of bytes in the entry, including its header.
+ * @returns A pointer to the batch, or 'NULL' if every batch is in use.
+ */
+app_batch *app_find_batch(net_address destination, tra_delivery delivery, uint8_t entry_length);
@@ -0,0 +1,243 @@
+#include "network_stack/app.h"
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * This test emulates the transport layer, and checks how the application layer batches requests and responses and
+ * matches responses to requests. This device has the logical address 0x01, and registers the methods 0x10 (which
+ * returns a level) and 0x11 (which sets it).
+ *
+ * Calls to this device itself and to an invalid method should be refused. Calling 0x10, 0x11 and the unknown method 0x20
+ * on 0x02 together, the three requests should be sent in one reliable payload at the next update. Responses arriving in
+ * a different order should be passed to the callbacks with the right IDs, a response with an ID that isn't outstanding
+ * should be ignored, and the request without a response should time out.
+ *
+ * Receiving two requests from 0x03 in one unreliable payload, both responses should be sent back in one unreliable
+ * payload. An entry which runs past the end of its payload should be ignored.
+ *
+ * While the transport layer has no space for a payload to 0x04, its batch should be kept and later requests should join
+ * it. A request to 0x06 which times out while the transport layer is still busy should be taken out of its batch, so
+ * that only the later request to 0x06 is sent. Once every outstanding request entry is in use, further calls should be
+ * refused.
+ */
+
+// The emulated current time in milliseconds:
+time current_time = TIME_ZERO;
+
+// The emulated transport layer's receive callbacks for the application layer's ports, and the status it sends with:
+tra_receive_callback emulated_reliable_callback = NULL;
+tra_receive_callback emulated_unreliable_callback = NULL;
+tra_send_status emulated_send_status = TRA_SEND_SUCCESS;
+
+// The level set by method 0x11:
+uint8_t level = 0x40;
+
+// The number of silent requests which have finished:
+uint8_t finished_count = 0;
+
+app_rpc_status get_level(net_address source, uint8_t *arguments, uint8_t length, uint8_t *result, uint8_t *result_length) {
+    result[0] = level;
+    *result_length = 1;
+    return APP_RPC_SUCCESS;
+}
+
+app_rpc_status set_level(net_address source, uint8_t *arguments, uint8_t length, uint8_t *result, uint8_t *result_length) {
+    if (length != 1) {
+        return APP_RPC_FAILED;
+    }
+    level = arguments[0];
+    return APP_RPC_SUCCESS;
+}
+
+void response_received(net_address destination, app_request_id id, app_rpc_status status, uint8_t *result, uint8_t length) {
+    uart_put_string("Response from ");
+    uart_print_hex_8(destination);
+    uart_put_string(" to ");
+    uart_print_hex_8(id);
+    uart_put_string(", status ");
+    uart_print_hex_8(status);
+    uart_put_string(": ");
+    for (uint8_t i = 0; i < length; i++) {
+        uart_print_hex_8(result[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+void response_counted(net_address destination, app_request_id id, app_rpc_status status, uint8_t *result, uint8_t length) {
+    finished_count++;
+}
+
+void call(net_address destination, app_method method, const uint8_t *arguments, uint8_t length, tra_delivery delivery) {
+    app_request_id id = 0;
+    app_call_status status = app_call(destination, method, arguments, length, delivery, 500, response_received, &id);
+    uart_put_string("Call status: ");
+    uart_print_hex_8(status);
+    uart_put_string(", ID ");
+    uart_print_hex_8(id);
+    uart_put_string("\n\r");
+}
+
+void print_outstanding_count(net_address destination) {
+    uart_put_string("Outstanding requests to ");
+    uart_print_hex_8(destination);
+    uart_put_string(": ");
+    uart_print_hex_8(app_get_outstanding_count(destination));
+    uart_put_string("\n\r");
+}
+
+void emulate_payload(net_address source, tra_delivery delivery, const uint8_t *payload, uint8_t length) {
+    uart_put_string("Emulating payload from ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r");
+    uint8_t copy[TRA_MAX_PAYLOAD_LENGTH];
+    for (uint8_t i = 0; i < length; i++) {
+        copy[i] = payload[i];
+    }
+    if (delivery == TRA_DELIVERY_RELIABLE) {
+        emulated_reliable_callback(source, copy, length);
+    } else {
+        emulated_unreliable_callback(source, copy, length);
+    }
+}
+
+void advance_time(int32_t milliseconds) {
+    current_time = time_add_milliseconds(current_time, milliseconds);
+    app_update();
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+    app_initialise();
+    uart_put_string("Registered 0x80: ");
+    uart_print_hex_8(app_register_method(0x80, get_level));
+    uart_put_string("\n\rRegistered 0x10: ");
+    uart_print_hex_8(app_register_method(0x10, get_level));
+    uart_put_string("\n\rRegistered 0x11: ");
+    uart_print_hex_8(app_register_method(0x11, set_level));
+    uart_put_string("\n\rRegistered 0x10 again: ");
+    uart_print_hex_8(app_register_method(0x10, set_level));
+    uart_put_string("\n\r");
+
+    uart_put_string("\n\r--- Calling 0x02 three times at once ---\n\r");
+    call(0x01, 0x10, NULL, 0, TRA_DELIVERY_RELIABLE);
+    call(0x02, 0x80, NULL, 0, TRA_DELIVERY_RELIABLE);
+    call(0x02, 0x10, NULL, 0, TRA_DELIVERY_RELIABLE);
+    call(0x02, 0x11, (const uint8_t[]) { 0x7F }, 1, TRA_DELIVERY_RELIABLE);
+    call(0x02, 0x20, NULL, 0, TRA_DELIVERY_RELIABLE);
+    print_outstanding_count(0x02);
+    advance_time(10);
+
+    uart_put_string("\n\r--- Responses from 0x02 out of order, one for an unknown ID ---\n\r");
+    emulate_payload(0x02, TRA_DELIVERY_RELIABLE, (const uint8_t[]) { 0x01, 0x80, 0x00, 0x09, 0x80, 0x00, 0x00, 0x80, 0x01, 0x3C }, 10);
+    print_outstanding_count(0x02);
+    advance_time(480);
+    advance_time(10);
+    print_outstanding_count(0x02);
+
+    uart_put_string("\n\r--- Two requests from 0x03 in one payload ---\n\r");
+    emulate_payload(0x03, TRA_DELIVERY_UNRELIABLE, (const uint8_t[]) { 0x50, 0x11, 0x01, 0x22, 0x51, 0x10, 0x00 }, 7);
+    advance_time(10);
+    emulate_payload(0x03, TRA_DELIVERY_RELIABLE, (const uint8_t[]) { 0x52, 0x21, 0x00, 0x53, 0x10, 0x05, 0x00 }, 7);
+    advance_time(10);
+
+    uart_put_string("\n\r--- Calling 0x04 while the transport layer is busy ---\n\r");
+    emulated_send_status = TRA_SEND_BUSY;
+    call(0x04, 0x10, NULL, 0, TRA_DELIVERY_RELIABLE);
+    advance_time(10);
+    call(0x04, 0x10, NULL, 0, TRA_DELIVERY_RELIABLE);
+    emulated_send_status = TRA_SEND_SUCCESS;
+    advance_time(10);
+    advance_time(500);
+
+    uart_put_string("\n\r--- Calling 0x06 while the transport layer stays busy ---\n\r");
+    emulated_send_status = TRA_SEND_BUSY;
+    call(0x06, 0x10, NULL, 0, TRA_DELIVERY_RELIABLE);
+    advance_time(300);
+    call(0x06, 0x11, (const uint8_t[]) { 0x20 }, 1, TRA_DELIVERY_RELIABLE);
+    advance_time(300);
+    emulated_send_status = TRA_SEND_SUCCESS;
+    advance_time(10);
+    advance_time(500);
+
+    uart_put_string("\n\r--- Filling the outstanding requests ---\n\r");
+    uint8_t success_count = 0;
+    while (app_call(0x05, 0x10, NULL, 0, TRA_DELIVERY_UNRELIABLE, 100, response_counted, NULL) == APP_CALL_SUCCESS) {
+        success_count++;
+    }
+    uart_put_string("Calls accepted: ");
+    uart_print_hex_8(success_count);
+    uart_put_string("\n\r");
+    advance_time(10);
+    advance_time(100);
+    uart_put_string("Calls timed out: ");
+    uart_print_hex_8(finished_count);
+    uart_put_string("\n\r");
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** tra.h emulated implementation *************************//
+
+bool tra_register_port(tra_port port, tra_delivery delivery, tra_receive_callback receive_callback, tra_message_callback message_callback) {
+    uart_put_string("Registering port ");
+    uart_print_hex_8(port);
+    uart_put_string("\n\r");
+    if (delivery == TRA_DELIVERY_RELIABLE) {
+        emulated_reliable_callback = receive_callback;
+    } else {
+        emulated_unreliable_callback = receive_callback;
+    }
+    return true;
+}
+
+tra_send_status tra_send(net_address destination, tra_port port, const uint8_t *data, uint8_t length, net_traffic_class traffic_class) {
+    uart_put_string("Send payload to ");
+    uart_print_hex_8(destination);
+    uart_put_string(" on ");
+    uart_print_hex_8(port);
+    uart_put_string(" at ");
+    uart_print_hex_16(current_time);
+    uart_put_string(emulated_send_status == TRA_SEND_SUCCESS ? ": " : " (busy): ");
+    for (uint8_t i = 0; i < length && i < 16; i++) {
+        uart_print_hex_8(data[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string(length > 16 ? "...\n\r" : "\n\r");
+    return emulated_send_status;
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
@@ -0,0 +1,253 @@
+#include "network_stack/app.h"
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * This benchmark measures how long a controller takes to poll the level of every light, one light at a time and with
+ * several requests outstanding. This device is the controller, with the logical address 0x00, and the lights are every
+ * other address, 0x01 to 0x0F. Lights 0x01 to 0x05 are one hop away, 0x06 to 0x0A two hops, and 0x0B to 0x0F three hops.
+ *
+ * Requests are made with the application layer, on the unreliable port, and the transport layer is emulated. Each hop
+ * takes 1 millisecond for each frame of up to 23 bytes of a packet, and 1 millisecond for DLL's ACK. The hops beyond
+ * the controller's own link are separate links, but every request and response crosses the controller's link, which
+ * carries one frame at a time. A light answers each payload of requests with one payload of responses, 5 milliseconds
+ * after it arrives.
+ *
+ * For each number of outstanding requests, the mean time in milliseconds to poll all 15 lights over 20 rounds is
+ * printed, along with the number of responses and of requests which timed out. One outstanding request is a sequential
+ * poll.
+ */
+
+// The number of rounds to poll every light for:
+#ifndef POLL_BENCHMARK_ROUND_COUNT
+#define POLL_BENCHMARK_ROUND_COUNT (20)
+#endif
+
+#define CONTROLLER_ADDRESS (0x00)
+#define LIGHT_COUNT (NET_MAX_ADDRESS)
+#define LIGHTS_PER_HOP (5)
+#define GET_LEVEL_METHOD (0x10)
+#define REQUEST_TIMEOUT_MILLISECONDS (500)
+#define PACKET_HEADER_LENGTH (7)
+#define FRAME_DATA_LENGTH (23)
+#define FRAME_MILLISECONDS (1)
+#define ACK_MILLISECONDS (1)
+#define LIGHT_DELAY_MILLISECONDS (5)
+#define MAX_PAYLOADS_IN_FLIGHT (32)
+#define ENTRY_HEADER_LENGTH (3)
+#define ENTRY_FLAG_RESPONSE (0x80)
+
+typedef struct {
+    bool is_used;
+    bool is_waiting_for_link; // Whether the payload still has to cross the controller's link at 'next_time'
+    time next_time;
+    net_address light;
+    bool is_to_controller;
+    uint8_t length;
+    uint8_t data[TRA_MAX_PAYLOAD_LENGTH];
+} emulated_payload;
+
+const uint8_t outstanding_counts[] = { 1, 2, 4, 8 };
+
+time current_time = TIME_ZERO;
+
+// The emulated transport layer's receive callback for the application layer's unreliable port:
+tra_receive_callback emulated_unreliable_callback = NULL;
+
+// The payloads in flight, and the time the controller's link is next free:
+emulated_payload payloads[MAX_PAYLOADS_IN_FLIGHT];
+time link_free_time = TIME_ZERO;
+
+uint8_t outstanding_count = 0;
+uint16_t responses_received = 0;
+uint16_t timeouts = 0;
+
+uint8_t get_hop_count(net_address light) {
+    return 1 + (light - 1) / LIGHTS_PER_HOP;
+}
+
+uint8_t get_hop_milliseconds(uint8_t length) {
+    uint8_t frame_count = (PACKET_HEADER_LENGTH + length + FRAME_DATA_LENGTH - 1) / FRAME_DATA_LENGTH;
+    return frame_count * FRAME_MILLISECONDS + ACK_MILLISECONDS;
+}
+
+void cross_controller_link(emulated_payload *payload) {
+    // Wait for the controller's link to be free, and then take it for this payload's hop:
+    time start_time = current_time;
+    if (time_delta_milliseconds(start_time, link_free_time) > 0) {
+        start_time = link_free_time;
+    }
+    link_free_time = time_add_milliseconds(start_time, get_hop_milliseconds(payload->length));
+    payload->next_time = link_free_time;
+    payload->is_waiting_for_link = false;
+}
+
+emulated_payload *add_payload(net_address light, bool is_to_controller, const uint8_t *data, uint8_t length) {
+    for (uint8_t index = 0; index < MAX_PAYLOADS_IN_FLIGHT; index++) {
+        emulated_payload *payload = &payloads[index];
+        if (payload->is_used == false) {
+            payload->is_used = true;
+            payload->light = light;
+            payload->is_to_controller = is_to_controller;
+            payload->length = length;
+            memcpy(payload->data, data, length);
+            return payload;
+        }
+    }
+    return NULL;
+}
+
+void answer_requests(const emulated_payload *request) {
+    // Answer every request entry in the payload with the light's level, in one payload:
+    uint8_t response[TRA_MAX_PAYLOAD_LENGTH];
+    uint8_t response_length = 0;
+    uint8_t offset = 0;
+    while (request->length - offset >= ENTRY_HEADER_LENGTH && response_length + ENTRY_HEADER_LENGTH + 1 <= sizeof(response)) {
+        const uint8_t *entry = &request->data[offset];
+        response[response_length] = entry[0];
+        response[response_length + 1] = ENTRY_FLAG_RESPONSE | APP_RPC_SUCCESS;
+        response[response_length + 2] = 1;
+        response[response_length + 3] = request->light;
+        response_length += ENTRY_HEADER_LENGTH + 1;
+        offset += ENTRY_HEADER_LENGTH + entry[2];
+    }
+
+    // The response crosses the other hops on its way back, and then waits for the controller's link:
+    emulated_payload *payload = add_payload(request->light, true, response, response_length);
+    if (payload != NULL) {
+        uint8_t other_hop_milliseconds = (get_hop_count(request->light) - 1) * get_hop_milliseconds(response_length);
+        payload->next_time = time_add_milliseconds(current_time, LIGHT_DELAY_MILLISECONDS + other_hop_milliseconds);
+        payload->is_waiting_for_link = true;
+    }
+}
+
+void deliver_arrived_payloads() {
+    for (uint8_t index = 0; index < MAX_PAYLOADS_IN_FLIGHT; index++) {
+        emulated_payload *payload = &payloads[index];
+        if (payload->is_used == false || time_delta_milliseconds(payload->next_time, current_time) < 0) {
+            continue;
+        }
+        if (payload->is_waiting_for_link) {
+            cross_controller_link(payload);
+            continue;
+        }
+        payload->is_used = false;
+        if (payload->is_to_controller) {
+            emulated_unreliable_callback(payload->light, payload->data, payload->length);
+        } else {
+            answer_requests(payload);
+        }
+    }
+}
+
+void response_received(net_address destination, app_request_id id, app_rpc_status status, uint8_t *result, uint8_t length) {
+    outstanding_count--;
+    if (status == APP_RPC_TIMEOUT) {
+        timeouts++;
+    } else {
+        responses_received++;
+    }
+}
+
+void run_case(uint8_t max_outstanding_count) {
+    memset(payloads, 0, sizeof(payloads));
+    link_free_time = current_time;
+    outstanding_count = 0;
+    responses_received = 0;
+    timeouts = 0;
+    app_initialise();
+
+    uint32_t round_total = 0;
+    for (uint8_t round = 0; round < POLL_BENCHMARK_ROUND_COUNT; round++) {
+        time start_time = current_time;
+        net_address next_light = 1;
+        while (next_light <= LIGHT_COUNT || outstanding_count != 0) {
+            current_time = time_add_milliseconds(current_time, 1);
+            deliver_arrived_payloads();
+            while (next_light <= LIGHT_COUNT && outstanding_count < max_outstanding_count
+                && app_call(next_light, GET_LEVEL_METHOD, NULL, 0, TRA_DELIVERY_UNRELIABLE, REQUEST_TIMEOUT_MILLISECONDS, response_received, NULL) == APP_CALL_SUCCESS) {
+                outstanding_count++;
+                next_light++;
+            }
+            app_update();
+        }
+        round_total += time_delta_milliseconds(start_time, current_time);
+    }
+
+    uart_put_string("  Outstanding ");
+    uart_print_hex_8(max_outstanding_count);
+    uart_put_string(": poll mean ");
+    uart_print_hex_16(round_total / POLL_BENCHMARK_ROUND_COUNT);
+    uart_put_string(", responses ");
+    uart_print_hex_16(responses_received);
+    uart_put_string(", timeouts ");
+    uart_print_hex_16(timeouts);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- Polling 15 lights ---\n\r");
+    for (uint8_t index = 0; index < sizeof(outstanding_counts); index++) {
+        run_case(outstanding_counts[index]);
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** tra.h emulated implementation *************************//
+
+bool tra_register_port(tra_port port, tra_delivery delivery, tra_receive_callback receive_callback, tra_message_callback message_callback) {
+    if (delivery == TRA_DELIVERY_UNRELIABLE) {
+        emulated_unreliable_callback = receive_callback;
+    }
+    return true;
+}
+
+tra_send_status tra_send(net_address destination, tra_port port, const uint8_t *data, uint8_t length, net_traffic_class traffic_class) {
+    // The request crosses the controller's link first, and then the other hops:
+    emulated_payload *payload = add_payload(destination, false, data, length);
+    if (payload == NULL) {
+        return TRA_SEND_BUSY;
+    }
+    cross_controller_link(payload);
+    payload->next_time = time_add_milliseconds(payload->next_time, (get_hop_count(destination) - 1) * get_hop_milliseconds(length));
+    return TRA_SEND_SUCCESS;
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x00 as our own address:
+    return CONTROLLER_ADDRESS;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
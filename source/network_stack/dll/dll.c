@@ -5,22 +5,34 @@
 #include "dll_private.h"
 //s#include "uart.h"
 #include "network_stack/phy.h"
+#include "time.h"
 #include <stdbool.h>
 #include <string.h>
 #include <stddef.h>
 
 static uint8_t packet_buffer_tx[BUFSIZE] = {0};
-static uint8_t packet_buffer_rx[BUFSIZE] = {0};
+static uint8_t packet_buffer_rx_storage[BUFSIZE] = {0};
+static uint8_t *packet_buffer_rx = packet_buffer_rx_storage; // Can be replaced by NET, see dll_replace_receive_buffer()
 static uint8_t frame_buffer_tx[FRAMEBUFSIZE] = {0};
 static uint8_t frame_buffer_rx[FRAMEBUFSIZE] = {0};
 
 uint8_t received_packet_length = 0;
+time received_packet_time = 0; // When the last frame of the received packet ended, see dll_get_receive_time()
+uint8_t received_packet_source = 0; // The address of the node that sent the packet being received (or last received)
+time received_frame_time = 0; // When the last data frame was added to the packet being received
 uint8_t sequence_number_counter;
+uint8_t completed_packet_source = DLL_BROADCAST_ADDRESS; // The sender of the last unicast packet passed to NET (broadcast if none has been)
+uint8_t completed_packet_sequence_bits = 0; // The sequence and packet bits of that packet's final frame
+time completed_packet_time = 0; // When that packet's final frame was received
+uint8_t packet_sequence_bits[32] = {0}; // Bit n is set if the next packet to address n is sent with its packet bit set
 uint8_t ack = 0;
+uint8_t ack_address = 0; // The node that the frame waiting for an ACK was sent to
+uint8_t ack_sequence_bits = 0; // The sequence and packet bits that the ACK of that frame echoes
 uint8_t rtc = 0;
 uint8_t ctc = 0;
 
 dll_callback net_callback_ptr; // A pointer that will point to the net callback function
+dll_delivery_callback net_delivery_callback_ptr = NULL; // A pointer that will point to the net delivery callback function
 
 uint8_t *dll_create_data_buffer(uint8_t net_packet_length) {
     if(net_packet_length > 128) {
@@ -33,12 +45,17 @@ uint8_t *dll_create_data_buffer(uint8_t net_packet_length) {
 }
 
 // Sends data in the packet buffer to a given address (or broadcast for address 0xFF)
+dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_length) {
+    return dll_send_buffer(packet_buffer_tx, destination_address, packet_length);
+}
+
+// Sends data in a given buffer to a given address (or broadcast for address 0xFF)
 // Returns 1 if packet is successfully transmitted
 // Returns 0 if a node is unreachable
 // This function really only prepares frames for transmission
-dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_length) {
+dll_send_response dll_send_buffer(const uint8_t *packet, uint8_t destination_address, uint8_t packet_length) {
 
-    if(packet_length > 128 || (destination_address == 0xFF && packet_length > 23)) {
+    if(packet_length > 128 || (destination_address == DLL_BROADCAST_ADDRESS && packet_length > DLL_MAX_BROADCAST_PACKET_LENGTH)) {
         return DLL_PACKET_TOO_BIG;
     }
 
@@ -49,6 +66,9 @@ dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_le
     uint8_t sequence_number = 0;
     uint8_t frame_data_length;
     uint8_t checksum_result;
+    uint8_t retransmissions = 0;
+    uint8_t total_retransmissions = 0; // Retransmissions across all frames, reported to NET as a measure of link quality
+    uint8_t packet_bit = 0;
     
     if(packet_length > 23) {
         multiple_frames = true;
@@ -64,6 +84,13 @@ dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_le
         return DLL_NODE_UNREACHABLE;
     }
 
+    // Each packet to a node flips the packet bit, so the node can tell a new packet from a retransmission of the final
+    // frame of the packet before it
+    if(destination_address != DLL_BROADCAST_ADDRESS) {
+        packet_bit = packet_sequence_bits[destination_address >> 3] & 1 << (destination_address & 7);
+        packet_sequence_bits[destination_address >> 3] ^= 1 << (destination_address & 7);
+    }
+
     //printf("\n");
 
     while(1) {
@@ -87,9 +114,14 @@ dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_le
         frame_buffer_tx[FRAME_CONTROL_FIELD] = 0x00;
         frame_buffer_tx[FRAME_CONTROL_FIELD + 1] = 0b00000001;
 
+        if(packet_bit) {
+            // Sets bit 1 to 1 if the packet bit is 1
+            frame_buffer_tx[FRAME_CONTROL_FIELD + 1] |= CONTROL_PACKET_BIT;
+        }
+
         if(sequence_number) {
             // Sets bit 2 to 1 if the sequence number is 1
-            frame_buffer_tx[FRAME_CONTROL_FIELD + 1] |= 1 << 2;
+            frame_buffer_tx[FRAME_CONTROL_FIELD + 1] |= CONTROL_SEQUENCE_BIT;
         }
     
         if(last_frame) {
@@ -111,10 +143,10 @@ dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_le
 
         if(!last_frame) {
             frame_buffer_tx[FRAME_LENGTH_FIELD] = 23;
-            memcpy(&frame_buffer_tx[FRAME_DATA_FIELD], &packet_buffer_tx[frame_number * 23], 23);
+            memcpy(&frame_buffer_tx[FRAME_DATA_FIELD], &packet[frame_number * 23], 23);
         } else {
             frame_buffer_tx[FRAME_LENGTH_FIELD] = bytes_left_to_transmit;
-            memcpy(&frame_buffer_tx[FRAME_DATA_FIELD], &packet_buffer_tx[frame_number * 23], bytes_left_to_transmit);
+            memcpy(&frame_buffer_tx[FRAME_DATA_FIELD], &packet[frame_number * 23], bytes_left_to_transmit);
         }
 
         //---PREPARING CHECKSUM FIELD---//
@@ -155,17 +187,27 @@ dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_le
             return DLL_NODE_UNREACHABLE;
         }*/
 
-        if(transmit_frame(finished_frame_length)) {
-            return DLL_NODE_UNREACHABLE;
-        }
-        //put_str("\nWaiting for ACK...");
-        while(1) {
-            dll_check_for_transmission();
-            if(ack) {
-                ack = 0;
-                break;
+        if(destination_address == DLL_BROADCAST_ADDRESS) {
+            // Broadcast frames are not acknowledged
+            transmit_frame(finished_frame_length);
+        } else {
+            // Only an ACK from the destination echoing this frame's sequence and packet bits acknowledges it, so a late
+            // or repeated ACK of an earlier frame can't
+            ack_address = destination_address;
+            ack_sequence_bits = frame_buffer_tx[FRAME_CONTROL_FIELD + 1] & CONTROL_SEQUENCE_BITS;
+            ack = 0;
+            if(transmit_frame(finished_frame_length) || !wait_for_ack()) {
+                // Frame was not acknowledged in time, so the frame is rebuilt and retransmitted
+                retransmissions++;
+                total_retransmissions++;
+                if(retransmissions > MAX_RETRANSMISSIONS) {
+                    report_delivery(destination_address, false, total_retransmissions);
+                    return DLL_NODE_UNREACHABLE;
+                }
+                continue;
             }
         }
+        retransmissions = 0;
         
         // Once confirmation of frame reception is received
         if(multiple_frames && !last_frame) {
@@ -177,17 +219,63 @@ dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_le
                 frame_data_length = bytes_left_to_transmit;
             }
         } else {
+            if(destination_address != DLL_BROADCAST_ADDRESS) {
+                report_delivery(destination_address, true, total_retransmissions);
+            }
             return DLL_TRANSMISSION_SUCCESS;
         }
     }
 }
 
+// Waits for the ACK of the last transmitted frame
+// Returns 1 if the ACK was received, or 0 if ACK_TIMEOUT_MS passed without one
+uint8_t wait_for_ack() {
+    //put_str("\nWaiting for ACK...");
+    time start_time = time_now();
+    while(time_delta_milliseconds(start_time, time_now()) < ACK_TIMEOUT_MS) {
+        dll_check_for_transmission();
+        if(ack) {
+            ack = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Tells NET whether a unicast packet was delivered to the given address, and how many frames had to be retransmitted
+void report_delivery(uint8_t address, bool delivered, uint8_t retransmission_count) {
+    if(net_delivery_callback_ptr != NULL) {
+        (*net_delivery_callback_ptr)(address, delivered, retransmission_count);
+    }
+}
+
+// Replaces the buffer that received packets are put into
+// Only called by NET from inside the receive callback, which then keeps the old buffer
+void dll_replace_receive_buffer(uint8_t *buffer) {
+    packet_buffer_rx = buffer;
+}
+
 // Sets the NET layer function to be called when a frame is received
 // Pass a pointer to the function that should be called
 void dll_set_callback(dll_callback callback) {
     net_callback_ptr = callback;
 }
 
+// Sets the NET layer function to be called after a unicast packet is delivered or fails to be delivered
+void dll_set_delivery_callback(dll_delivery_callback callback) {
+    net_delivery_callback_ptr = callback;
+}
+
+// Returns when the last frame of the packet most recently passed to NET ended
+time dll_get_receive_time() {
+    return received_packet_time;
+}
+
+// Returns when the last frame sent ended
+time dll_get_transmit_time() {
+    return phy_get_transmit_time();
+}
+
 // Performs byte stuffing on the frame
 // Length of frame to stuff must be passed in
 // Returns the resulting length of the frame
@@ -218,7 +306,7 @@ uint8_t byte_stuff_frame(uint8_t length) {
 uint8_t establish_connection(uint8_t address) {
     return 0;
     sequence_number_counter = 0;
-    uint8_t control_frame_stuffed_length = prepare_control_frame(address, CONTROL_RTC);
+    uint8_t control_frame_stuffed_length = prepare_control_frame(address, CONTROL_RTC, 0);
     //put_str("\nTransmitting control frame: RTC");
     transmit_frame(control_frame_stuffed_length);
 
@@ -237,14 +325,15 @@ uint8_t establish_connection(uint8_t address) {
 
 // Prepares frame_buffer_tx with a control frame
 // Pass the destination address, and a control frame type to the function
+// For an ACK, also pass the sequence and packet bits of the data frame being acknowledged
 // Does byte stuffing on frame
 // Returns length of frame
-uint8_t prepare_control_frame(uint8_t address, control_frame_types type) {
+uint8_t prepare_control_frame(uint8_t address, control_frame_types type, uint8_t sequence_bits) {
     // Setting first control byte
     frame_buffer_tx[FRAME_CONTROL_FIELD] = type;
     frame_buffer_tx[FRAME_CONTROL_FIELD + 1] = 0;
     if(type == CONTROL_ACK) {
-        frame_buffer_tx[FRAME_CONTROL_FIELD + 1] |= sequence_number_counter << 2;
+        frame_buffer_tx[FRAME_CONTROL_FIELD + 1] |= sequence_bits & CONTROL_SEQUENCE_BITS;
     }
     if(CHECKSUM_MODE == ERROR_EVEN_PARITY) {
         frame_buffer_tx[FRAME_CONTROL_FIELD + 1] |= 1 << 4;
@@ -294,27 +383,38 @@ void receive_frame(uint8_t length) {
 
     uint8_t frame_length = byte_unstuff_frame(length);
     //print_int(frame_length);
-    received_packet_length += frame_length - 7;
 
     frame_receive_process_responses process_result = process_received_frame(frame_length);
 
-    if(process_result == ADDRESS_MISMATCH) {
-        //put_str("\nFrame not addressed to this node.");
+    if(process_result == ADDRESS_MISMATCH || process_result == FRAME_DISCARDED) {
+        //put_str("\nFrame not addressed to this node, or not part of the packet being received.");
         return;
-    } else if(process_result == FINAL_FRAME) {
-        memcpy(&packet_buffer_rx[received_packet_length - frame_length + 7], &frame_buffer_rx[FRAME_DATA_FIELD], frame_length - 7);
-        //put_str("\nThis is the final frame");
-        (*net_callback_ptr)(frame_buffer_rx[FRAME_ADDRESS_FIELD + 1], packet_buffer_rx, received_packet_length);
-        received_packet_length = 0;
-        sequence_number_counter = 0;
-    } else if(process_result == MORE_FRAMES_EXPECTED) {
-        memcpy(&packet_buffer_rx[received_packet_length - frame_length + 7], &frame_buffer_rx[FRAME_DATA_FIELD], frame_length - 7);
+    } else if(process_result == FINAL_FRAME || process_result == MORE_FRAMES_EXPECTED) {
+        // The frame's data has already been checked to fit in the packet buffer
+        memcpy(&packet_buffer_rx[received_packet_length], &frame_buffer_rx[FRAME_DATA_FIELD], frame_length - 7);
+        received_packet_length += frame_length - 7;
+        received_frame_time = time_now();
+        if(process_result == FINAL_FRAME) {
+            //put_str("\nThis is the final frame");
+            received_packet_time = phy_get_receive_time();
+            if(frame_buffer_rx[FRAME_ADDRESS_FIELD] != DLL_BROADCAST_ADDRESS) {
+                // Remembered before NET gets the packet, as sending from the callback reuses the frame buffers
+                completed_packet_source = frame_buffer_rx[FRAME_ADDRESS_FIELD + 1];
+                completed_packet_sequence_bits = frame_buffer_rx[FRAME_CONTROL_FIELD + 1] & CONTROL_SEQUENCE_BITS;
+                completed_packet_time = received_frame_time;
+            }
+            (*net_callback_ptr)(frame_buffer_rx[FRAME_ADDRESS_FIELD + 1], packet_buffer_rx, received_packet_length);
+            received_packet_length = 0;
+            sequence_number_counter = 0;
+        }
         //put_str("\nMore frames expected.");
     } else if(process_result == CONTROL_FRAME) {
         control_frame_types type = frame_buffer_rx[FRAME_CONTROL_FIELD];
         if(type == CONTROL_ACK) {
             //put_str("\nAck received.");
-            ack = 1;
+            if(frame_buffer_rx[FRAME_ADDRESS_FIELD + 1] == ack_address && (frame_buffer_rx[FRAME_CONTROL_FIELD + 1] & CONTROL_SEQUENCE_BITS) == ack_sequence_bits) {
+                ack = 1;
+            }
         } else if(type == CONTROL_RTC) {
             rtc = 1;
         } else if(type == CONTROL_CTC) {
@@ -380,8 +480,9 @@ uint8_t byte_unstuff_frame(uint8_t length) {
 //Needs length of frame to be passed in
 frame_receive_process_responses process_received_frame(uint8_t length) {
 
-    //Check node is intended recipient
-    if(frame_buffer_rx[FRAME_ADDRESS_FIELD] != NODE_HARDWARE_ADDRESS) {
+    //Check node is intended recipient (broadcast frames are received by every node)
+    uint8_t is_broadcast = frame_buffer_rx[FRAME_ADDRESS_FIELD] == DLL_BROADCAST_ADDRESS;
+    if(frame_buffer_rx[FRAME_ADDRESS_FIELD] != NODE_HARDWARE_ADDRESS && !is_broadcast) {
         //Frame is intended for other node, so is discarded
         //put_str("\nFrame is addressed to a different node, discarding.");
         uint8_t i;
@@ -447,19 +548,59 @@ frame_receive_process_responses process_received_frame(uint8_t length) {
     //put_str("\nFrame sequence number is ");
     //print_int(frame_sequence_number);
 
+    //A data frame too short to hold its header is dropped
+    if(length < 7) {
+        return FRAME_DISCARDED;
+    }
+
+    uint8_t source_address = frame_buffer_rx[FRAME_ADDRESS_FIELD + 1];
+    uint8_t sequence_bits = frame_buffer_rx[FRAME_CONTROL_FIELD + 1] & CONTROL_SEQUENCE_BITS;
+    uint8_t final_bit = (frame_buffer_rx[FRAME_CONTROL_FIELD + 1] & 1 << 3) >> 3; //Tests if End=1
+
+    //A final frame matching the last packet passed to NET was sent again because our ACK was lost, as the sender flips
+    //the packet bit for each new packet. It is ACKed again, but the packet must not be passed to NET a second time
+    if(!is_broadcast && final_bit && source_address == completed_packet_source && sequence_bits == completed_packet_sequence_bits
+            && time_delta_milliseconds(completed_packet_time, time_now()) <= REASSEMBLY_TIMEOUT_MS) {
+        uint8_t size = prepare_control_frame(source_address, CONTROL_ACK, sequence_bits);
+        transmit_frame(size);
+        return FRAME_DISCARDED;
+    }
+
+    //A frame from a different sender, or one arriving after the packet being received has gone stale, starts a new packet
+    if(source_address != received_packet_source || time_delta_milliseconds(received_frame_time, time_now()) > REASSEMBLY_TIMEOUT_MS) {
+        received_packet_length = 0;
+        sequence_number_counter = 0;
+        if(frame_sequence_number != 0) {
+            //Only a first frame can start a packet
+            return FRAME_DISCARDED;
+        }
+        received_packet_source = source_address;
+    }
+
+    //A data frame whose data would overflow the packet buffer is dropped along with the rest of the packet
+    //It isn't acknowledged, so the sender gives up on the packet
+    if(received_packet_length + length - 7 > BUFSIZE) {
+        received_packet_length = 0;
+        sequence_number_counter = 0;
+        return FRAME_DISCARDED;
+    }
+
+    //Broadcast frames are not acknowledged, as every receiving node would respond at once
+    if(!is_broadcast) {
+        uint8_t size = prepare_control_frame(source_address, CONTROL_ACK, sequence_bits);
+        transmit_frame(size);
+    }
+
     if(sequence_number_counter != frame_sequence_number) {
         //put_str("\nSequence number is not as expected!");
-    } else {
-        //put_str("\nSequence number correct!");
+        //The frame is a retransmission of one already received, sent because our ACK was lost. It has been acknowledged
+        //again, but its data must not be added to the packet a second time
+        return FRAME_DISCARDED;
     }
-
-    uint8_t size = prepare_control_frame(frame_buffer_rx[FRAME_ADDRESS_FIELD + 1], CONTROL_ACK);
-    transmit_frame(size);
+    //put_str("\nSequence number correct!");
 
     sequence_number_counter = !sequence_number_counter;
 
-    uint8_t final_bit = (frame_buffer_rx[FRAME_CONTROL_FIELD + 1] & 1 << 3) >> 3; //Tests if End=1
-
     if(final_bit) {
         return FINAL_FRAME;
     } else {
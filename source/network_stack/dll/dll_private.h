@@ -11,6 +11,22 @@
 #define FRAME_LENGTH_FIELD 0x05
 #define FRAME_DATA_FIELD 0x06 // Up to 0x1D (23)
 
+//Second Control Byte Bits
+#define CONTROL_PACKET_BIT (1 << 1) // Flipped for each packet sent to the same node
+#define CONTROL_SEQUENCE_BIT (1 << 2) // Flipped for each frame of a packet
+#define CONTROL_SEQUENCE_BITS (CONTROL_PACKET_BIT | CONTROL_SEQUENCE_BIT)
+//An ACK echoes both bits of the data frame it acknowledges
+
+#define ACK_TIMEOUT_MS 10
+#define MAX_RETRANSMISSIONS 3
+//A frame is retransmitted if no ACK is received within ACK_TIMEOUT_MS
+//After MAX_RETRANSMISSIONS failed retransmissions the node is reported as unreachable
+
+#define REASSEMBLY_TIMEOUT_MS ((MAX_RETRANSMISSIONS + 1) * ACK_TIMEOUT_MS)
+//A partly received packet is abandoned once no frame of it has arrived for REASSEMBLY_TIMEOUT_MS, by which time the
+//sender has given up on it
+//The final frame of a completed packet is also recognised as a retransmission for REASSEMBLY_TIMEOUT_MS
+
 #define BUFSIZE 128
 #define FRAMEBUFSIZE 59
 //Maximum frame size is 32 bytes, but need more to account for byte stuffing
@@ -38,6 +54,7 @@ typedef enum {
     FINAL_FRAME,
     CONTROL_FRAME,
     ADDRESS_MISMATCH,
+    FRAME_DISCARDED,
 } frame_receive_process_responses;
 
 typedef enum {
@@ -50,13 +67,16 @@ typedef enum {
 //FRAME CONSTRUCTION FUNCTIONS
 uint8_t byte_stuff_frame(uint8_t length);
 uint8_t byte_unstuff_frame(uint8_t length);
-uint8_t prepare_control_frame(uint8_t address, control_frame_types type);
+uint8_t prepare_control_frame(uint8_t address, control_frame_types type, uint8_t sequence_bits);
 
 //FLOW CONTROL FUNCTIONS
 uint8_t establish_connection(uint8_t address);
 uint8_t transmit_frame(uint8_t length);
 uint8_t mimic_transmit_frame(uint8_t length);
 
+uint8_t wait_for_ack();
+void report_delivery(uint8_t address, bool delivered, uint8_t retransmission_count);
+
 //RECEIVER FUNCTIONS
 void dll_check_for_transmission();
 void receive_frame(uint8_t length);
@@ -216,7 +216,7 @@ uint8_t byte_stuff_frame(uint8_t length) {
 uint8_t establish_connection(uint8_t address) {
     return 0;
     sequence_number_counter = 0;
-    uint8_t control_frame_stuffed_length = prepare_control_frame(address, CONTROL_RTC);
+    uint8_t control_frame_stuffed_length = prepare_control_frame(address, CONTROL_RTC, 0);
     put_str("\nTransmitting control frame: RTC");
     transmit_frame(control_frame_stuffed_length);
 
@@ -237,7 +237,7 @@ uint8_t establish_connection(uint8_t address) {
 // Pass the destination address, and a control frame type to the function
 // Does byte stuffing on frame
 // Returns length of frame
-uint8_t prepare_control_frame(uint8_t address, control_frame_types type) {
+uint8_t prepare_control_frame(uint8_t address, control_frame_types type, uint8_t sequence_bits) {
     // Setting first control byte
     frame_buffer_tx[FRAME_CONTROL_FIELD] = type;
     frame_buffer_tx[FRAME_CONTROL_FIELD + 1] = 0;
@@ -469,7 +469,7 @@ frame_receive_process_responses process_received_frame(uint8_t length) {
         //put_str("\nSequence number correct!");
     }
 
-    uint8_t size = prepare_control_frame(frame_buffer_rx[FRAME_ADDRESS_FIELD + 1], CONTROL_ACK);
+    uint8_t size = prepare_control_frame(frame_buffer_rx[FRAME_ADDRESS_FIELD + 1], CONTROL_ACK, 0);
     transmit_frame(size);
 
     sequence_number_counter = !sequence_number_counter;
@@ -1,5 +1,6 @@
 #include "../dll_private.h"
 #include "network_stack/phy.h"
+#include "time.h"
 #include "uart.h"
 #include <avr/interrupt.h>
 
@@ -7,6 +8,7 @@ void example_net_callback_function(uint8_t sender_address, uint8_t *data, uint8_
 
 int main(void) {
     phy_initialise();
+    time_initialise();
     sei();
     init_uart0();
     uint8_t x;
@@ -0,0 +1,249 @@
+#include "../dll_private.h"
+#include "network_stack/phy.h"
+#include "time.h"
+#include "uart.h"
+#include <stdbool.h>
+#include <string.h>
+
+// Emulates PHY and the millisecond timer, and checks how DLL copes with frames and ACKs that are sent more than once.
+// This node has the hardware address NODE_HARDWARE_ADDRESS, and the other nodes are 0x05 and 0x06. The emulated timer
+// moves on by a millisecond whenever DLL finds no frame waiting.
+//
+// Receiving:
+// - A single-frame packet from 0x05 is passed to NET and ACKed. When the same frame comes again 5 ms later, as if the
+//   ACK was lost, it is ACKed again but not passed to NET a second time.
+// - A single-frame packet from 0x06 with the same bits is passed to NET, as it comes from a different sender.
+// - The next single-frame packet from 0x05 has its packet bit flipped, so it is passed to NET, even though it has the
+//   same sequence number as the one before.
+// - The final frame of a two-frame packet from 0x05 is also only passed to NET once when it comes twice.
+//
+// Sending:
+// - A packet to 0x05 gets an ACK echoing the wrong packet bit, and an ACK from 0x06, neither of which acknowledge it.
+//   The frame is sent again and acknowledged, so the packet is delivered with one retransmission.
+// - A repeated ACK of that frame arrives before the next packet to 0x05 is sent. It must not acknowledge the next
+//   packet, which gets no ACK, so its delivery fails.
+// - The second frame of a two-frame packet gets a repeated ACK of the first frame, which doesn't acknowledge it, before
+//   its own ACK.
+
+#define SCRIPT_SIZE (8)
+
+typedef struct {
+    uint8_t after_frame; // The number of data frames sent before this ACK arrives
+    uint8_t source;
+    uint8_t sequence_bits;
+} scripted_ack;
+
+time current_time = 0;
+
+// The frames waiting to be received from PHY:
+uint8_t receive_queue[4][FRAMEBUFSIZE];
+uint8_t receive_queue_lengths[4];
+uint8_t receive_queue_count = 0;
+
+// The ACKs that the other nodes send while this node is sending:
+scripted_ack ack_script[SCRIPT_SIZE];
+uint8_t ack_script_count = 0;
+uint8_t data_frames_sent = 0;
+
+// Builds a stuffed frame, with even parity, into 'frame' and returns its length:
+uint8_t build_frame(uint8_t *frame, uint8_t source, uint8_t control_0, uint8_t control_1, const uint8_t *data, uint8_t length) {
+    uint8_t unstuffed[FRAMEBUFSIZE];
+    uint8_t unstuffed_length;
+    unstuffed[0] = control_0;
+    unstuffed[1] = control_1 | 1 << 4;
+    unstuffed[2] = NODE_HARDWARE_ADDRESS;
+    unstuffed[3] = source;
+    if(control_1 & 1) {
+        unstuffed[4] = length;
+        memcpy(&unstuffed[5], data, length);
+        uint16_t parity = checksum_parity(unstuffed, length + 5, 0);
+        unstuffed[5 + length] = parity >> 8;
+        unstuffed[6 + length] = parity & 0xFF;
+        unstuffed_length = length + 7;
+    } else {
+        uint16_t parity = checksum_parity(unstuffed, 4, 0);
+        unstuffed[4] = parity >> 8;
+        unstuffed[5] = parity & 0xFF;
+        unstuffed_length = 6;
+    }
+
+    uint8_t frame_length = 0;
+    frame[frame_length++] = FLAG_BYTE;
+    for(uint8_t i = 0; i < unstuffed_length; i++) {
+        if(unstuffed[i] == FLAG_BYTE || unstuffed[i] == ESCAPE_BYTE) {
+            frame[frame_length++] = ESCAPE_BYTE;
+        }
+        frame[frame_length++] = unstuffed[i];
+    }
+    frame[frame_length++] = FLAG_BYTE;
+    return frame_length;
+}
+
+void queue_frame(uint8_t source, uint8_t control_0, uint8_t control_1, const uint8_t *data, uint8_t length) {
+    receive_queue_lengths[receive_queue_count] = build_frame(receive_queue[receive_queue_count], source, control_0, control_1, data, length);
+    receive_queue_count++;
+}
+
+// Emulates a data frame from another node arriving, with the given sequence and packet bits:
+void receive_data_frame(uint8_t source, uint8_t sequence_bits, bool is_final, const uint8_t *data, uint8_t length) {
+    put_str("Receiving frame from ");
+    put_hex(source);
+    put_str(", bits ");
+    put_hex(sequence_bits | is_final << 3);
+    put_str("\n");
+    queue_frame(source, 0x00, 0x01 | sequence_bits | is_final << 3, data, length);
+    dll_update();
+}
+
+void add_ack(uint8_t after_frame, uint8_t source, uint8_t sequence_bits) {
+    ack_script[ack_script_count].after_frame = after_frame;
+    ack_script[ack_script_count].source = source;
+    ack_script[ack_script_count].sequence_bits = sequence_bits;
+    ack_script_count++;
+}
+
+void send_packet(uint8_t destination, const uint8_t *packet, uint8_t length) {
+    put_str("Sending packet to ");
+    put_hex(destination);
+    put_str("\n");
+    data_frames_sent = 0;
+    dll_send_response response = dll_send_buffer(packet, destination, length);
+    put_str("Send response: ");
+    put_hex(response);
+    put_str("\n");
+    ack_script_count = 0;
+}
+
+void net_callback(uint8_t sender_address, uint8_t *data, uint8_t length) {
+    put_str("NET got packet from ");
+    put_hex(sender_address);
+    put_str(": ");
+    for(uint8_t i = 0; i < length; i++) {
+        put_hex(data[i]);
+        put_str(" ");
+    }
+    put_str("\n");
+}
+
+void net_delivery_callback(uint8_t destination_address, bool is_delivered, uint8_t retransmission_count) {
+    put_str("Delivery to ");
+    put_hex(destination_address);
+    put_str(is_delivered ? ": delivered" : ": failed");
+    put_str(", retransmissions ");
+    put_hex(retransmission_count);
+    put_str("\n");
+}
+
+int main(void) {
+    init_uart0();
+    put_str("\n============================================================\n");
+    dll_set_callback(net_callback);
+    dll_set_delivery_callback(net_delivery_callback);
+
+    const uint8_t first_packet[] = { 0x11, 0x12, 0x13 };
+    const uint8_t second_packet[] = { 0x21, 0x22 };
+    uint8_t long_packet[30];
+    for(uint8_t i = 0; i < sizeof(long_packet); i++) {
+        long_packet[i] = 0x30 + i;
+    }
+
+    put_str("\n--- Receiving single-frame packets ---\n");
+    receive_data_frame(0x05, 0, true, first_packet, sizeof(first_packet));
+    current_time += 5;
+    receive_data_frame(0x05, 0, true, first_packet, sizeof(first_packet));
+    current_time += 5;
+    receive_data_frame(0x06, 0, true, first_packet, sizeof(first_packet));
+    current_time += 5;
+    receive_data_frame(0x05, CONTROL_PACKET_BIT, true, second_packet, sizeof(second_packet));
+
+    put_str("\n--- Receiving a two-frame packet ---\n");
+    current_time += 5;
+    receive_data_frame(0x05, 0, false, long_packet, 23);
+    current_time += 5;
+    receive_data_frame(0x05, CONTROL_SEQUENCE_BIT, true, &long_packet[23], 7);
+    current_time += 5;
+    receive_data_frame(0x05, CONTROL_SEQUENCE_BIT, true, &long_packet[23], 7);
+
+    put_str("\n--- Sending a packet which gets the wrong ACKs first ---\n");
+    current_time += 100;
+    add_ack(1, 0x05, CONTROL_PACKET_BIT);
+    add_ack(1, 0x06, 0);
+    add_ack(2, 0x05, 0);
+    send_packet(0x05, first_packet, sizeof(first_packet));
+
+    put_str("\n--- Sending a packet after a repeated ACK of the last one ---\n");
+    queue_frame(0x05, CONTROL_ACK, 0, NULL, 0);
+    dll_update();
+    send_packet(0x05, second_packet, sizeof(second_packet));
+
+    put_str("\n--- Sending a two-frame packet whose first ACK is repeated ---\n");
+    add_ack(1, 0x05, 0);
+    add_ack(2, 0x05, 0);
+    add_ack(3, 0x05, CONTROL_SEQUENCE_BIT);
+    send_packet(0x05, long_packet, sizeof(long_packet));
+
+    put_str("\nFinished.\n");
+}
+
+//************************** phy.h emulated implementation **************************//
+
+void phy_initialise() {
+}
+
+bool phy_transmit_frame(const uint8_t *data, uint8_t length) {
+    // Unstuffing isn't needed to read the control and address fields, which are never escaped in these frames:
+    if(data[2] & 1) {
+        data_frames_sent++;
+        put_str("Sent data frame to ");
+    } else {
+        put_str("Sent ACK to ");
+    }
+    put_hex(data[3]);
+    put_str(", bits ");
+    put_hex(data[2] & (CONTROL_SEQUENCE_BITS | 1 << 3));
+    put_str("\n");
+
+    if(data[2] & 1) {
+        for(uint8_t i = 0; i < ack_script_count; i++) {
+            if(ack_script[i].after_frame == data_frames_sent) {
+                queue_frame(ack_script[i].source, CONTROL_ACK, ack_script[i].sequence_bits, NULL, 0);
+            }
+        }
+    }
+    return true;
+}
+
+uint8_t phy_receive_frame(uint8_t *output_buffer, uint8_t max_length) {
+    if(receive_queue_count == 0) {
+        current_time++;
+        return 0;
+    }
+    uint8_t length = receive_queue_lengths[0];
+    memcpy(output_buffer, receive_queue[0], length);
+    receive_queue_count--;
+    memmove(receive_queue[0], receive_queue[1], sizeof(receive_queue[0]) * receive_queue_count);
+    memmove(receive_queue_lengths, &receive_queue_lengths[1], receive_queue_count);
+    return length;
+}
+
+uint8_t phy_get_bus_utilisation() {
+    return 0;
+}
+
+time phy_get_receive_time() {
+    return current_time;
+}
+
+time phy_get_transmit_time() {
+    return current_time;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
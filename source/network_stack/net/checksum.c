@@ -1,5 +1,54 @@
 #include "checksum.h"
 
+// The number of bytes that can be added to Fletcher-16's sums before they have to be reduced modulo 255, without the
+// second sum overflowing 16 bits.
+#define FLETCHER_16_BLOCK_SIZE (20)
+
+// The CRC-16 of each 4-bit value, for the reflected CCITT polynomial (0x8408). Working a nibble at a time keeps the table
+// small while needing only two lookups per byte.
+static const uint16_t crc_16_nibble_table[16] = {
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F,
+};
+
+static uint16_t generate_fletcher_16(const uint8_t *data, uint8_t length) {
+    uint16_t sum_1 = 0;
+    uint16_t sum_2 = 0;
+    while (length > 0) {
+        // Add up a block of bytes, only reducing the sums modulo 255 at the end of the block:
+        uint8_t block_length = (length < FLETCHER_16_BLOCK_SIZE) ? length : FLETCHER_16_BLOCK_SIZE;
+        length -= block_length;
+        while (block_length-- > 0) {
+            sum_1 += *data++;
+            sum_2 += sum_1;
+        }
+        sum_1 = (sum_1 & 0xFF) + (sum_1 >> 8);
+        sum_2 = (sum_2 & 0xFF) + (sum_2 >> 8);
+    }
+
+    // Finish reducing the sums (each is now at most 0x1FE):
+    sum_1 = (sum_1 & 0xFF) + (sum_1 >> 8);
+    sum_2 = (sum_2 & 0xFF) + (sum_2 >> 8);
+    if (sum_1 >= 255) {
+        sum_1 -= 255;
+    }
+    if (sum_2 >= 255) {
+        sum_2 -= 255;
+    }
+    return (sum_2 << 8) | sum_1;
+}
+
+static uint16_t generate_crc_16(const uint8_t *data, uint8_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t byte_i = 0; byte_i != length; byte_i++) {
+        // Shift the byte through the CRC a nibble at a time, low nibble first:
+        crc ^= data[byte_i];
+        crc = (crc >> 4) ^ crc_16_nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_16_nibble_table[crc & 0x0F];
+    }
+    return crc;
+}
+
 uint16_t net_generate_checksum(net_checksum_type checksum_type, uint8_t *data, uint8_t length) {
     switch (checksum_type) {
         case NET_CHECKSUM_EVEN_PARITY: {
@@ -20,6 +69,14 @@ uint16_t net_generate_checksum(net_checksum_type checksum_type, uint8_t *data, u
             return (uint16_t) parity_bit;
         } break;
 
+        case NET_CHECKSUM_FLETCHER_16: {
+            return generate_fletcher_16(data, length);
+        } break;
+
+        case NET_CHECKSUM_CRC_16: {
+            return generate_crc_16(data, length);
+        } break;
+
         case NET_CHECKSUM_NONE:
         default:
             // No checksum to generate. Checksum should be zero:
@@ -31,9 +88,11 @@ bool net_fix_checksum_errors(net_checksum_type checksum_type, uint16_t checksum,
     // Currently there are no checksum types that actually fix any errors, but there could be in the future.
 
     switch (checksum_type) {
-        case NET_CHECKSUM_EVEN_PARITY: {
+        case NET_CHECKSUM_EVEN_PARITY:
+        case NET_CHECKSUM_FLETCHER_16:
+        case NET_CHECKSUM_CRC_16: {
             // Generate checksum and compare against expected checksum:
-            uint16_t generated_checksum = net_generate_checksum(NET_CHECKSUM_EVEN_PARITY, data, data_length);
+            uint16_t generated_checksum = net_generate_checksum(checksum_type, data, data_length);
             return generated_checksum == checksum;
         } break;
 
@@ -6,14 +6,18 @@
 /**
  * The default checksum type that should be used on packets sent by this device.
  */
-#define NET_TX_CHECKSUM_TYPE (NET_CHECKSUM_EVEN_PARITY)
+#define NET_TX_CHECKSUM_TYPE (NET_CHECKSUM_FLETCHER_16)
 
 /**
- * The type of checksum generated on a network packet.
+ * The type of checksum generated on a network packet. Fletcher-16 is the cheapest to compute and catches any single
+ * error burst up to 8 bits long; CRC-16 (CCITT polynomial, reflected, initial value 0xFFFF) costs a little more but also
+ * catches every 2-bit error and any burst up to 16 bits long.
  */
 typedef enum {
     NET_CHECKSUM_NONE = 0b00,
     NET_CHECKSUM_EVEN_PARITY = 0b01,
+    NET_CHECKSUM_FLETCHER_16 = 0b10,
+    NET_CHECKSUM_CRC_16 = 0b11,
 } net_checksum_type;
 
 /**
@@ -1,7 +1,9 @@
 #include "network_stack/net.h"
 #include "network_stack/dll.h"
 #include "packets.h"
+#include "persist.h"
 #include "routing.h"
+#include "sync.h"
 
 // Note: Not all the functions declared in net.h are implemented in this file. The other functions are implemented in
 //       separate source files.
@@ -11,11 +13,17 @@
 
 void net_initialise() {
     dll_set_callback(net_handle_received_packet);
+    dll_set_delivery_callback(net_notify_delivery);
     net_initialise_routing();
+    net_initialise_sync();
 }
 
 void net_update() {
     net_update_routing();
+    net_update_pending();
+    net_update_forwarding();
+    net_persist_update();
+    net_update_sync();
 }
 
 net_address net_get_own_address() {
@@ -1,6 +1,9 @@
 #include "checksum.h"
 #include "packets.h"
+#include "pending.h"
+#include "queue.h"
 #include "routing.h"
+#include "sync.h"
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +13,12 @@ typedef enum {
     NET_LINK_STATE_PACKET = 0b0001,
     NET_PING_REQUEST_PACKET = 0b0010,
     NET_PING_RESPONSE_PACKET = 0b0011,
+    NET_LINK_STATE_DELTA_PACKET = 0b0100,
+    NET_DATABASE_SUMMARY_PACKET = 0b0101,
+    NET_LINK_STATE_REQUEST_PACKET = 0b0110,
+    NET_FORWARDING_TABLE_PACKET = 0b0111,
+    NET_AREA_SUMMARY_PACKET = 0b1000,
+    NET_TIME_SYNC_PACKET = 0b1001,
 } net_packet_type;
 
 enum generic_packet_fields {
@@ -17,6 +26,11 @@ enum generic_packet_fields {
     PACKET_FIELD_CONTROL_H = 1,
 };
 
+// The low control byte holds the packet's traffic class in its lowest two bits. In data packets, the next bit is set if
+// the checksum covers the payload as well as the header. The other bits are reserved (zero).
+#define CONTROL_L_TRAFFIC_CLASS_MASK (0x03)
+#define CONTROL_L_PAYLOAD_CHECKED_FLAG (0x04)
+
 enum data_packet_fields {
     DATA_PACKET_FIELD_CONTROL_L = 0,
     DATA_PACKET_FIELD_CONTROL_H = 1,
@@ -26,29 +40,239 @@ enum data_packet_fields {
     DATA_PACKET_FIELD_PAYLOAD_START = 5,
 };
 
+// Over a link whose far end supports it, a data packet is sent with a compact header instead. The control byte holds
+// the compact header flag, the checksum type, the payload checked flag and the traffic class, and the addresses byte
+// holds the source address in its high nibble and the destination address in its low nibble. The payload length is
+// left out, as it follows from the packet's length.
+enum compact_data_packet_fields {
+    COMPACT_DATA_PACKET_FIELD_CONTROL = 0,
+    COMPACT_DATA_PACKET_FIELD_ADDRESSES = 1,
+    COMPACT_DATA_PACKET_FIELD_PAYLOAD_START = 2,
+};
+
+// The compact header flag is the top bit of the first byte, which is reserved (zero) in the full format. Bits 5 and 6 of
+// the compact control byte are reserved (zero).
+#define COMPACT_CONTROL_FLAG (0x80)
+#define COMPACT_CONTROL_CHECKSUM_TYPE_SHIFT (3)
+#define COMPACT_CONTROL_CHECKSUM_TYPE_MASK (0x18)
+#define COMPACT_CONTROL_RESERVED_MASK (0x60)
+
+// The number of bytes saved by the compact header.
+#define COMPACT_HEADER_SAVING (DATA_PACKET_FIELD_PAYLOAD_START - COMPACT_DATA_PACKET_FIELD_PAYLOAD_START)
+
 enum link_state_packet_fields {
     LINK_STATE_PACKET_FIELD_CONTROL_L = 0,
     LINK_STATE_PACKET_FIELD_CONTROL_H = 1,
     LINK_STATE_PACKET_FIELD_SOURCE_ADDRESS = 2,
     LINK_STATE_PACKET_FIELD_SEQUENCE_NUMBER = 3,
-    LINK_STATE_PACKET_FIELD_NODE_COUNT = 4,
-    LINK_STATE_PACKET_FIELD_NODE_LIST_START = 5,
+    LINK_STATE_PACKET_FIELD_LINKS_L = 4,
+    LINK_STATE_PACKET_FIELD_LINKS_H = 5,
+    LINK_STATE_PACKET_FIELD_LINK_COSTS_START = 6,
 };
 
+enum link_state_delta_packet_fields {
+    LINK_STATE_DELTA_PACKET_FIELD_CONTROL_L = 0,
+    LINK_STATE_DELTA_PACKET_FIELD_CONTROL_H = 1,
+    LINK_STATE_DELTA_PACKET_FIELD_SOURCE_ADDRESS = 2,
+    LINK_STATE_DELTA_PACKET_FIELD_SEQUENCE_NUMBER = 3,
+    LINK_STATE_DELTA_PACKET_FIELD_BASE_SEQUENCE_NUMBER = 4,
+    LINK_STATE_DELTA_PACKET_FIELD_CHANGE_LIST_START = 5,
+};
+
+// A delta packet's change entry holds the linked node's address in the low nibble, and the link's new cost in the high
+// nibble (zero if the link was removed). The number of entries is given by the packet's length, so a delta packet with
+// one change is smaller than a full link state packet for any node with a link.
+#define LINK_STATE_DELTA_CHANGE_ADDRESS_MASK (0x0F)
+#define LINK_STATE_DELTA_CHANGE_COST_SHIFT (4)
+
 enum ping_request_packet_fields {
     PING_REQUEST_PACKET_FIELD_CONTROL_L = 0,
     PING_REQUEST_PACKET_FIELD_CONTROL_H = 1,
+    PING_REQUEST_PACKET_FIELD_SOURCE_ADDRESS = 2,
+    PING_REQUEST_PACKET_FIELD_FLAGS = 3,
+    PING_REQUEST_PACKET_FIELD_SEQUENCE_NUMBER = 4,
 };
 
+// Flag set in a ping request if the receiving node should send back a ping response.
+#define PING_REQUEST_FLAG_RESPONSE_REQUESTED (0x01)
+
+// Flag set in a ping request if the sending node is a stub router, which needs its neighbours to send it its routes.
+#define PING_REQUEST_FLAG_STUB (0x02)
+
+// Flag set in a ping request if the sending node can receive data packets with a compact header.
+#define PING_REQUEST_FLAG_COMPACT_HEADER (0x04)
+
 enum ping_response_packet_fields {
     PING_RESPONSE_PACKET_FIELD_CONTROL_L = 0,
     PING_RESPONSE_PACKET_FIELD_CONTROL_H = 1,
     PING_RESPONSE_PACKET_FIELD_SOURCE_ADDRESS = 2,
 };
 
+enum database_summary_packet_fields {
+    DATABASE_SUMMARY_PACKET_FIELD_CONTROL_L = 0,
+    DATABASE_SUMMARY_PACKET_FIELD_CONTROL_H = 1,
+    DATABASE_SUMMARY_PACKET_FIELD_SOURCE_ADDRESS = 2,
+    DATABASE_SUMMARY_PACKET_FIELD_SOURCES_L = 3,
+    DATABASE_SUMMARY_PACKET_FIELD_SOURCES_H = 4,
+    DATABASE_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBERS_START = 5,
+};
+
+enum link_state_request_packet_fields {
+    LINK_STATE_REQUEST_PACKET_FIELD_CONTROL_L = 0,
+    LINK_STATE_REQUEST_PACKET_FIELD_CONTROL_H = 1,
+    LINK_STATE_REQUEST_PACKET_FIELD_SOURCE_ADDRESS = 2,
+    LINK_STATE_REQUEST_PACKET_FIELD_SOURCES_L = 3,
+    LINK_STATE_REQUEST_PACKET_FIELD_SOURCES_H = 4,
+};
+
+enum forwarding_table_packet_fields {
+    FORWARDING_TABLE_PACKET_FIELD_CONTROL_L = 0,
+    FORWARDING_TABLE_PACKET_FIELD_CONTROL_H = 1,
+    FORWARDING_TABLE_PACKET_FIELD_SOURCE_ADDRESS = 2,
+    FORWARDING_TABLE_PACKET_FIELD_NEXT_HOPS_START = 3,
+};
+
+// A forwarding table packet holds the next hop of every destination address, packed two to a byte (lowest address in
+// the low nibble).
+#define FORWARDING_TABLE_NEXT_HOPS_SIZE ((NET_MAX_ADDRESS + 2) / 2)
+
+// An area summary packet holds a bitmap of the areas whose costs its source worked out from their link states, followed
+// by the cost of reaching every area, one byte each.
+enum area_summary_packet_fields {
+    AREA_SUMMARY_PACKET_FIELD_CONTROL_L = 0,
+    AREA_SUMMARY_PACKET_FIELD_CONTROL_H = 1,
+    AREA_SUMMARY_PACKET_FIELD_SOURCE_ADDRESS = 2,
+    AREA_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBER = 3,
+    AREA_SUMMARY_PACKET_FIELD_DIRECT_AREAS = 4,
+    AREA_SUMMARY_PACKET_FIELD_COSTS_START = 5,
+};
+
+// A time sync packet is broadcast to every neighbour, and carries the network time at which its source finished sending
+// its previous time sync packet, since that can only be captured once the packet has gone. The previous sequence number
+// is the same as the sequence number if there's no previous packet. The time is 4 bytes, lowest first.
+enum time_sync_packet_fields {
+    TIME_SYNC_PACKET_FIELD_CONTROL_L = 0,
+    TIME_SYNC_PACKET_FIELD_CONTROL_H = 1,
+    TIME_SYNC_PACKET_FIELD_SOURCE_ADDRESS = 2,
+    TIME_SYNC_PACKET_FIELD_ROOT_ADDRESS = 3,
+    TIME_SYNC_PACKET_FIELD_SEQUENCE_NUMBER = 4,
+    TIME_SYNC_PACKET_FIELD_PREVIOUS_SEQUENCE_NUMBER = 5,
+    TIME_SYNC_PACKET_FIELD_PREVIOUS_TIME_START = 6,
+};
+
+#define TIME_SYNC_PACKET_SIZE (12)
+
 // The callback to call when a network data packet is received.
 static net_receive_callback receive_callback = NULL;
 
+// The callback to call when a held data packet is finally sent or given up on.
+static net_send_callback send_callback = NULL;
+
+// The sequence number of the last link state packet sent out by this node.
+static uint8_t link_state_sequence_number = 0;
+
+// The sequence number and link costs of the last full link state packet sent out by this node. Delta packets describe
+// the changes since this packet.
+static uint8_t link_state_base_sequence_number = 0;
+static uint8_t link_state_base_link_costs[NET_MAX_ADDRESS + 1] = { 0 };
+
+// The sequence number of the last ping request sent out by this node.
+static uint8_t ping_request_sequence_number = 0;
+
+static dll_send_response send_data_packet_buffer(uint8_t *packet, dll_address next_hop, uint8_t packet_size) {
+    // Send the full header unless the next hop can receive the compact one:
+    if (net_is_compact_header_supported(next_hop) == false) {
+        return dll_send_buffer(packet, next_hop, packet_size);
+    }
+
+    // Keep the bytes which the compact header and checksum are written over, so that the packet can be put back the way
+    // it was (for a retry through a different next hop):
+    uint8_t checksum_offset = packet_size - 2;
+    uint8_t saved_header[COMPACT_DATA_PACKET_FIELD_PAYLOAD_START];
+    memcpy(saved_header, &packet[COMPACT_HEADER_SAVING], COMPACT_DATA_PACKET_FIELD_PAYLOAD_START);
+    uint8_t saved_checksum[2] = { packet[checksum_offset], packet[checksum_offset + 1] };
+
+    // Write the compact header just in front of the payload, so that the payload doesn't have to be moved:
+    net_checksum_type checksum_type = (packet[DATA_PACKET_FIELD_CONTROL_H] & 0x0C) >> 2;
+    uint8_t control = COMPACT_CONTROL_FLAG | (checksum_type << COMPACT_CONTROL_CHECKSUM_TYPE_SHIFT)
+        | (packet[DATA_PACKET_FIELD_CONTROL_L] & (CONTROL_L_PAYLOAD_CHECKED_FLAG | CONTROL_L_TRAFFIC_CLASS_MASK));
+    uint8_t addresses = (packet[DATA_PACKET_FIELD_SOURCE_ADDRESS] << 4) | packet[DATA_PACKET_FIELD_DESTINATION_ADDRESS];
+    uint8_t *compact_packet = &packet[COMPACT_HEADER_SAVING];
+    compact_packet[COMPACT_DATA_PACKET_FIELD_CONTROL] = control;
+    compact_packet[COMPACT_DATA_PACKET_FIELD_ADDRESSES] = addresses;
+
+    // Generate the checksum on the compact header (and the payload, if it's checked):
+    uint8_t checksum_length = (control & CONTROL_L_PAYLOAD_CHECKED_FLAG) ? (checksum_offset - COMPACT_HEADER_SAVING) : COMPACT_DATA_PACKET_FIELD_PAYLOAD_START;
+    uint16_t checksum = net_generate_checksum(checksum_type, compact_packet, checksum_length);
+    packet[checksum_offset] = checksum & 0x00FF;
+    packet[checksum_offset + 1] = (checksum & 0xFF00) >> 8;
+
+    dll_send_response response = dll_send_buffer(compact_packet, next_hop, packet_size - COMPACT_HEADER_SAVING);
+
+    // Put the full header back:
+    memcpy(&packet[COMPACT_HEADER_SAVING], saved_header, COMPACT_DATA_PACKET_FIELD_PAYLOAD_START);
+    packet[checksum_offset] = saved_checksum[0];
+    packet[checksum_offset + 1] = saved_checksum[1];
+    return response;
+}
+
+static bool expand_compact_data_packet(uint8_t *packet, uint8_t packet_length) {
+    // Check that the packet fits in the buffer once expanded, and that the reserved bits are clear:
+    uint8_t control = packet[COMPACT_DATA_PACKET_FIELD_CONTROL];
+    if (packet_length < COMPACT_DATA_PACKET_FIELD_PAYLOAD_START + 2 || packet_length > NET_QUEUE_MAX_PACKET_SIZE - COMPACT_HEADER_SAVING
+        || (control & COMPACT_CONTROL_RESERVED_MASK) != 0) {
+        return false;
+    }
+
+    // Check the compact packet's checksum before it's replaced:
+    net_checksum_type checksum_type = (control & COMPACT_CONTROL_CHECKSUM_TYPE_MASK) >> COMPACT_CONTROL_CHECKSUM_TYPE_SHIFT;
+    bool is_payload_checked = control & CONTROL_L_PAYLOAD_CHECKED_FLAG;
+    uint8_t checksum_offset = packet_length - 2;
+    uint16_t checksum = packet[checksum_offset] | (packet[checksum_offset + 1] << 8);
+    uint8_t checksumed_length = is_payload_checked ? checksum_offset : COMPACT_DATA_PACKET_FIELD_PAYLOAD_START;
+    if (net_fix_checksum_errors(checksum_type, checksum, packet, checksumed_length) == false) {
+        return false;
+    }
+
+    // Move the payload along to make room for the full header, and write the header:
+    uint8_t addresses = packet[COMPACT_DATA_PACKET_FIELD_ADDRESSES];
+    uint8_t payload_length = checksum_offset - COMPACT_DATA_PACKET_FIELD_PAYLOAD_START;
+    memmove(&packet[DATA_PACKET_FIELD_PAYLOAD_START], &packet[COMPACT_DATA_PACKET_FIELD_PAYLOAD_START], payload_length);
+    packet[DATA_PACKET_FIELD_CONTROL_L] = control & (CONTROL_L_PAYLOAD_CHECKED_FLAG | CONTROL_L_TRAFFIC_CLASS_MASK);
+    packet[DATA_PACKET_FIELD_CONTROL_H] = (NET_DATA_PACKET << 4) | (checksum_type << 2);
+    packet[DATA_PACKET_FIELD_SOURCE_ADDRESS] = addresses >> 4;
+    packet[DATA_PACKET_FIELD_DESTINATION_ADDRESS] = addresses & 0x0F;
+    packet[DATA_PACKET_FIELD_PAYLOAD_LENGTH] = payload_length;
+
+    // Generate the full packet's checksum, with the same type and coverage:
+    checksum_offset = DATA_PACKET_FIELD_PAYLOAD_START + payload_length;
+    checksum = net_generate_checksum(checksum_type, packet, is_payload_checked ? checksum_offset : DATA_PACKET_FIELD_PAYLOAD_START);
+    packet[checksum_offset] = checksum & 0x00FF;
+    packet[checksum_offset + 1] = (checksum & 0xFF00) >> 8;
+    return true;
+}
+
+static bool send_to_next_hop(uint8_t *packet, net_address source, net_address destination, uint8_t packet_size) {
+    dll_address next_hop = net_get_flow_next_hop(source, destination);
+    if (next_hop == NET_NEXT_HOP_NOT_RESOLVED) {
+        return false;
+    }
+
+    // Send the packet to the next hop:
+    dll_send_response response = send_data_packet_buffer(packet, next_hop, packet_size);
+    if (response == DLL_TRANSMISSION_SUCCESS) {
+        return true;
+    }
+
+    // The failed delivery makes the router switch to another equal-cost or loop-free alternate next hop (or to a new
+    // route), so try once more if the next hop has changed:
+    dll_address retry_next_hop = net_get_flow_next_hop(source, destination);
+    if (retry_next_hop != NET_NEXT_HOP_NOT_RESOLVED && retry_next_hop != next_hop) {
+        response = send_data_packet_buffer(packet, retry_next_hop, packet_size);
+    }
+    return response == DLL_TRANSMISSION_SUCCESS;
+}
+
 uint8_t *net_get_data_buffer() {
     // uint8_t *packet = dll_get_data_buffer();
     uint8_t *packet = dll_create_data_buffer(0);
@@ -64,15 +288,9 @@ uint8_t net_get_data_buffer_size() {
     return max_payload_size;
 }
 
-void net_send_data_packet(net_address destination, uint8_t data_length) {
-    if (data_length > net_get_data_buffer_size() || destination > NET_MAX_ADDRESS) {
-        return;
-    }
-
-    // Resolve the next hop:
-    uint8_t next_hop = net_get_next_hop(destination);
-    if (next_hop == NET_NEXT_HOP_NOT_RESOLVED) {
-        return;
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked) {
+    if (data_length > net_get_data_buffer_size() || destination > NET_MAX_ADDRESS || traffic_class > NET_TRAFFIC_CLASS_INTERACTIVE) {
+        return NET_SEND_INVALID;
     }
 
     // Get a pointer to DLL's data buffer:
@@ -85,14 +303,15 @@ void net_send_data_packet(net_address destination, uint8_t data_length) {
     uint8_t packet_size = header_size + data_length + checksum_size;
 
     // Write the packet's header:
-    packet[DATA_PACKET_FIELD_CONTROL_L] = 0;
+    packet[DATA_PACKET_FIELD_CONTROL_L] = traffic_class | (is_payload_checked ? CONTROL_L_PAYLOAD_CHECKED_FLAG : 0);
     packet[DATA_PACKET_FIELD_CONTROL_H] = (NET_DATA_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
     packet[DATA_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
     packet[DATA_PACKET_FIELD_DESTINATION_ADDRESS] = destination;
     packet[DATA_PACKET_FIELD_PAYLOAD_LENGTH] = data_length;
 
-    // Generate checksum on the header:
-    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, header_size);
+    // Generate checksum on the header, and on the payload if asked to:
+    uint8_t checksum_length = is_payload_checked ? (header_size + data_length) : header_size;
+    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_length);
 
     // Write checksum to the end of the packet:
     uint8_t checksum_field_offset_l = DATA_PACKET_FIELD_PAYLOAD_START + data_length;
@@ -100,67 +319,360 @@ void net_send_data_packet(net_address destination, uint8_t data_length) {
     packet[checksum_field_offset_l] = checksum & 0x00FF;
     packet[checksum_field_offset_h] = (checksum & 0xFF00) >> 8;
 
+    // If there's no route to the destination yet, hold the packet until there is. Any older packet held for the same
+    // destination is dropped, so let the user know that it won't be sent:
+    if (net_get_next_hop(destination) == NET_NEXT_HOP_NOT_RESOLVED) {
+        bool is_replaced;
+        bool is_held = net_pending_push(packet, packet_size, destination, &is_replaced);
+        if (is_replaced && send_callback != NULL) {
+            send_callback(destination, NET_SEND_NO_ROUTE);
+        }
+        return is_held ? NET_SEND_PENDING : NET_SEND_NO_ROUTE;
+    }
+
     // Send the packet to the next hop:
-    dll_send_packet(next_hop, packet_size);
+    bool is_delivered = send_to_next_hop(packet, net_get_own_address(), destination, packet_size);
+    return is_delivered ? NET_SEND_SUCCESS : NET_SEND_FAILED;
 }
 
-void net_send_link_state_packet() {
-    // Get a pointer to DLL's data buffer:
-    // uint8_t *packet = dll_get_data_buffer();
-    uint8_t *packet = dll_create_data_buffer(0);
+static uint16_t get_own_link_costs(uint8_t link_costs[NET_MAX_ADDRESS + 1]) {
+    // Get the cost of our link to every node, and return which nodes we're linked to - each bit corresponds to a
+    // network address:
+    uint16_t connected_addresses = 0;
+    net_address own_address = net_get_own_address();
+    for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
+        link_costs[node] = net_get_link_cost(own_address, node);
+        if (link_costs[node] != 0) {
+            connected_addresses |= ((uint16_t) 1 << node);
+        }
+    }
+    return connected_addresses;
+}
 
-    static uint8_t sequence_number = 0;
-    sequence_number++;
+static uint8_t get_link_state_packet_size(uint16_t connected_addresses) {
+    // The link bitmap is followed by a cost for every connected address, packed two to a byte:
+    uint8_t link_count = 0;
+    for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
+        if (connected_addresses & ((uint16_t) 1 << node)) {
+            link_count++;
+        }
+    }
+    return LINK_STATE_PACKET_FIELD_LINK_COSTS_START + (link_count + 1) / 2 + 2;
+}
 
-    // Write the packet's header:
-    packet[LINK_STATE_PACKET_FIELD_CONTROL_L] = 0;
-    packet[LINK_STATE_PACKET_FIELD_CONTROL_H] = (NET_LINK_STATE_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
-    packet[LINK_STATE_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
-    packet[LINK_STATE_PACKET_FIELD_SEQUENCE_NUMBER] = sequence_number;
+static void flood_link_state_packet(const uint8_t *packet, uint8_t packet_size, dll_address previous_hop) {
+    // Check whether there are any neighbouring nodes to send the packet to (other than the one that the packet came
+    // from, if any):
+    bool has_other_neighbours = false;
+    for (dll_address address = 0; address < DLL_BROADCAST_ADDRESS; address++) {
+        if (address != previous_hop && net_is_node_neighbour(address)) {
+            has_other_neighbours = true;
+            break;
+        }
+    }
+    if (has_other_neighbours == false) {
+        return;
+    }
 
-    uint8_t *node_list = &packet[LINK_STATE_PACKET_FIELD_NODE_LIST_START];
-    const uint8_t max_node_count = 121;
-    uint8_t node_count = 0;
+    // Every neighbour hears a broadcast, so send the packet once if it fits in a broadcast. The node that the packet
+    // came from hears it too, but ignores it because it has already seen the packet's sequence number:
+    if (packet_size <= DLL_MAX_BROADCAST_PACKET_LENGTH) {
+        dll_send_buffer(packet, DLL_BROADCAST_ADDRESS, packet_size);
+        return;
+    }
 
-    // Write all neighbouring nodes to the packet:
-    net_address own_address = net_get_own_address();
+    // Otherwise, send the packet to each neighbouring node in turn (except the one that the packet came from, if any):
+    for (dll_address address = 0; address < DLL_BROADCAST_ADDRESS; address++) {
+        if (address != previous_hop && net_is_node_neighbour(address)) {
+            dll_send_buffer(packet, address, packet_size);
+        }
+    }
+}
+
+static uint8_t write_link_state_packet(uint8_t *packet, net_address source, uint8_t sequence_number, const uint8_t link_costs[NET_MAX_ADDRESS + 1]) {
+    // Find which nodes the source is linked to - each bit corresponds to a network address:
+    uint16_t connected_addresses = 0;
     for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
-        if (node_count >= max_node_count) {
-            // Maximum payload size has been reached; don't add any more nodes to the list.
-            break;
+        if (link_costs[node] != 0) {
+            connected_addresses |= ((uint16_t) 1 << node);
         }
+    }
+    uint8_t packet_size = get_link_state_packet_size(connected_addresses);
+
+    // Write the packet's header and link bitmap:
+    packet[LINK_STATE_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
+    packet[LINK_STATE_PACKET_FIELD_CONTROL_H] = (NET_LINK_STATE_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[LINK_STATE_PACKET_FIELD_SOURCE_ADDRESS] = source;
+    packet[LINK_STATE_PACKET_FIELD_SEQUENCE_NUMBER] = sequence_number;
+    packet[LINK_STATE_PACKET_FIELD_LINKS_L] = connected_addresses & 0x00FF;
+    packet[LINK_STATE_PACKET_FIELD_LINKS_H] = (connected_addresses & 0xFF00) >> 8;
 
-        // If the node is linked, add it to the list:
-        bool is_linked = net_are_nodes_linked(own_address, node);
-        if (is_linked) {
-            node_list[node_count++] = node;
+    // Write the cost of each link in address order, two to a byte (low nibble first):
+    uint8_t *cost_list = &packet[LINK_STATE_PACKET_FIELD_LINK_COSTS_START];
+    uint8_t cost_index = 0;
+    for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
+        if (link_costs[node] != 0) {
+            if ((cost_index & 1) == 0) {
+                cost_list[cost_index / 2] = link_costs[node];
+            } else {
+                cost_list[cost_index / 2] |= link_costs[node] << 4;
+            }
+            cost_index++;
         }
     }
 
-    // Write the node count to the packet's header:
-    packet[LINK_STATE_PACKET_FIELD_NODE_COUNT] = node_count;
+    // Generate the checksum on the packet:
+    const uint8_t checksum_size = packet_size - 2;
+    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_size);
+
+    // Write checksum to the end of the packet:
+    packet[checksum_size] = checksum & 0x00FF;
+    packet[checksum_size + 1] = (checksum & 0xFF00) >> 8;
+
+    return packet_size;
+}
+
+static uint8_t write_link_state_delta_packet(uint8_t *packet, net_address source, uint8_t sequence_number, uint8_t base_sequence_number, const uint8_t base_link_costs[NET_MAX_ADDRESS + 1], const uint8_t link_costs[NET_MAX_ADDRESS + 1]) {
+    // Write the packet's header:
+    packet[LINK_STATE_DELTA_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
+    packet[LINK_STATE_DELTA_PACKET_FIELD_CONTROL_H] = (NET_LINK_STATE_DELTA_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[LINK_STATE_DELTA_PACKET_FIELD_SOURCE_ADDRESS] = source;
+    packet[LINK_STATE_DELTA_PACKET_FIELD_SEQUENCE_NUMBER] = sequence_number;
+    packet[LINK_STATE_DELTA_PACKET_FIELD_BASE_SEQUENCE_NUMBER] = base_sequence_number;
+
+    // Write an entry for every link that was added, removed or changed cost:
+    uint8_t *change_list = &packet[LINK_STATE_DELTA_PACKET_FIELD_CHANGE_LIST_START];
+    uint8_t change_count = 0;
+    for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
+        if (link_costs[node] != base_link_costs[node]) {
+            change_list[change_count++] = node | (link_costs[node] << LINK_STATE_DELTA_CHANGE_COST_SHIFT);
+        }
+    }
 
     // Generate the checksum on the packet:
-    const uint8_t checksum_size = LINK_STATE_PACKET_FIELD_NODE_LIST_START + node_count;
+    const uint8_t checksum_size = LINK_STATE_DELTA_PACKET_FIELD_CHANGE_LIST_START + change_count;
     uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_size);
 
     // Write checksum to the end of the packet:
-    uint8_t checksum_field_offset_l = LINK_STATE_PACKET_FIELD_NODE_LIST_START + node_count;
-    uint8_t checksum_field_offset_h = LINK_STATE_PACKET_FIELD_NODE_LIST_START + node_count + 1;
-    packet[checksum_field_offset_l] = checksum & 0x00FF;
-    packet[checksum_field_offset_h] = (checksum & 0xFF00) >> 8;
+    packet[checksum_size] = checksum & 0x00FF;
+    packet[checksum_size + 1] = (checksum & 0xFF00) >> 8;
+
+    return checksum_size + 2;
+}
+
+bool net_send_link_state_packet() {
+    // Get a pointer to DLL's data buffer:
+    // uint8_t *packet = dll_get_data_buffer();
+    uint8_t *packet = dll_create_data_buffer(0);
+
+    uint8_t sequence_number = link_state_sequence_number + 1;
+    uint8_t link_costs[NET_MAX_ADDRESS + 1];
+    get_own_link_costs(link_costs);
+    uint8_t packet_size = write_link_state_packet(packet, net_get_own_address(), sequence_number, link_costs);
 
-    // Send the packet to all neighbouring nodes:
-    uint8_t packet_size = LINK_STATE_PACKET_FIELD_NODE_LIST_START + node_count + 2;
-    for (dll_address address = 0; address < 0xFF; address++) {
-        if (net_is_node_neighbour(address)) {
-            dll_send_packet(address, packet_size);
+    // Queue the packet to be flooded, so that it doesn't hold up any higher class packets waiting to be forwarded:
+    if (net_queue_push(packet, packet_size, DLL_BROADCAST_ADDRESS, NET_TRAFFIC_CLASS_CONTROL) == false) {
+        return false;
+    }
+
+    // The packet has gone out, so it takes up its sequence number and becomes the base for any following delta packets:
+    link_state_sequence_number = sequence_number;
+    link_state_base_sequence_number = sequence_number;
+    memcpy(link_state_base_link_costs, link_costs, sizeof(link_costs));
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    uint8_t link_costs[NET_MAX_ADDRESS + 1];
+    uint16_t connected_addresses = get_own_link_costs(link_costs);
+
+    // Count the links which have been added, removed or changed cost since the last full link state packet:
+    uint8_t change_count = 0;
+    for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
+        if (link_costs[node] != link_state_base_link_costs[node]) {
+            change_count++;
         }
     }
+
+    // Only send a delta packet if it's smaller than a full link state packet:
+    uint8_t full_packet_size = get_link_state_packet_size(connected_addresses);
+    uint8_t delta_packet_size = LINK_STATE_DELTA_PACKET_FIELD_CHANGE_LIST_START + change_count + 2;
+    if (delta_packet_size >= full_packet_size) {
+        return net_send_link_state_packet();
+    }
+
+    // Get a pointer to DLL's data buffer:
+    uint8_t *packet = dll_create_data_buffer(0);
+
+    uint8_t sequence_number = link_state_sequence_number + 1;
+    write_link_state_delta_packet(packet, net_get_own_address(), sequence_number, link_state_base_sequence_number, link_state_base_link_costs, link_costs);
+
+    // Queue the packet to be flooded, so that it doesn't hold up any higher class packets waiting to be forwarded:
+    if (net_queue_push(packet, delta_packet_size, DLL_BROADCAST_ADDRESS, NET_TRAFFIC_CLASS_CONTROL) == false) {
+        return false;
+    }
+    link_state_sequence_number = sequence_number;
+    return true;
 }
 
-void net_send_ping_request_packet(dll_address node) {
-    const uint8_t packet_size = 4;
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    // Only move forwards, to a sequence number ahead of the last one sent out:
+    uint8_t sequence_number_difference = sequence_number - link_state_sequence_number;
+    if (sequence_number_difference == 0 || sequence_number_difference > 128) {
+        return false;
+    }
+    link_state_sequence_number = sequence_number;
+    return true;
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    uint8_t sequence_number;
+    uint8_t link_costs[NET_MAX_ADDRESS + 1];
+    uint8_t base_sequence_number;
+    uint8_t base_link_costs[NET_MAX_ADDRESS + 1];
+    if (net_get_link_state(source, &sequence_number, link_costs, &base_sequence_number, base_link_costs) == false) {
+        // There's nothing to send:
+        return true;
+    }
+
+    // Queue the full link state packet that the stored link state is based on:
+    uint8_t *packet = dll_create_data_buffer(0);
+    uint8_t packet_size = write_link_state_packet(packet, source, base_sequence_number, base_link_costs);
+    if (net_queue_push(packet, packet_size, DLL_BROADCAST_ADDRESS, NET_TRAFFIC_CLASS_CONTROL) == false) {
+        return false;
+    }
+
+    // Follow it with a delta packet carrying any changes since then. If there's no room for it, the whole link state is
+    // sent again later; the full packet is ignored as a repeat by the nodes which already have it:
+    if (sequence_number != base_sequence_number) {
+        packet_size = write_link_state_delta_packet(packet, source, sequence_number, base_sequence_number, base_link_costs, link_costs);
+        return net_queue_push(packet, packet_size, DLL_BROADCAST_ADDRESS, NET_TRAFFIC_CLASS_CONTROL);
+    }
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    // Get pointer to DLL data buffer:
+    uint8_t *packet = dll_create_data_buffer(0);
+
+    // Write the packet's header:
+    packet[DATABASE_SUMMARY_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
+    packet[DATABASE_SUMMARY_PACKET_FIELD_CONTROL_H] = (NET_DATABASE_SUMMARY_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
+
+    // Write the sequence number of every link state held (including our own), in address order:
+    uint16_t sources = 0;
+    uint8_t *sequence_numbers = &packet[DATABASE_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBERS_START];
+    uint8_t source_count = 0;
+    for (net_address source = 0x00; source != NET_MAX_ADDRESS + 1; source++) {
+        uint8_t sequence_number;
+        if (source == net_get_own_address()) {
+            sequence_number = link_state_sequence_number;
+        } else if (net_get_link_state_sequence_number(source, &sequence_number) == false) {
+            continue;
+        }
+        sources |= ((uint16_t) 1 << source);
+        sequence_numbers[source_count++] = sequence_number;
+    }
+    packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCES_L] = sources & 0x00FF;
+    packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCES_H] = (sources & 0xFF00) >> 8;
+
+    // Generate the checksum on the packet:
+    const uint8_t checksum_size = DATABASE_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBERS_START + source_count;
+    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_size);
+
+    // Write the checksum to the end of the packet:
+    packet[checksum_size] = checksum & 0x00FF;
+    packet[checksum_size + 1] = (checksum & 0xFF00) >> 8;
+
+    // Send the packet:
+    return dll_send_packet(node, checksum_size + 2) == DLL_TRANSMISSION_SUCCESS;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    const uint8_t packet_size = 7;
+
+    // Get pointer to DLL data buffer:
+    uint8_t *packet = dll_create_data_buffer(0);
+
+    // Write the packet's header:
+    packet[LINK_STATE_REQUEST_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
+    packet[LINK_STATE_REQUEST_PACKET_FIELD_CONTROL_H] = (NET_LINK_STATE_REQUEST_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[LINK_STATE_REQUEST_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
+    packet[LINK_STATE_REQUEST_PACKET_FIELD_SOURCES_L] = sources & 0x00FF;
+    packet[LINK_STATE_REQUEST_PACKET_FIELD_SOURCES_H] = (sources & 0xFF00) >> 8;
+
+    // Generate the checksum on the header:
+    const uint8_t checksum_size = 5;
+    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_size);
+
+    // Write the checksum to the end of the packet:
+    packet[packet_size - 2] = checksum & 0x00FF;
+    packet[packet_size - 1] = (checksum & 0xFF00) >> 8;
+
+    // Send the packet:
+    return dll_send_packet(node, packet_size) == DLL_TRANSMISSION_SUCCESS;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+    const uint8_t packet_size = FORWARDING_TABLE_PACKET_FIELD_NEXT_HOPS_START + FORWARDING_TABLE_NEXT_HOPS_SIZE + 2;
+
+    // Get pointer to DLL data buffer:
+    uint8_t *packet = dll_create_data_buffer(0);
+
+    // Write the packet's header:
+    packet[FORWARDING_TABLE_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
+    packet[FORWARDING_TABLE_PACKET_FIELD_CONTROL_H] = (NET_FORWARDING_TABLE_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[FORWARDING_TABLE_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
+
+    // Write the next hops, packed two to a byte:
+    uint8_t *packed_next_hops = &packet[FORWARDING_TABLE_PACKET_FIELD_NEXT_HOPS_START];
+    for (uint8_t byte_index = 0; byte_index < FORWARDING_TABLE_NEXT_HOPS_SIZE; byte_index++) {
+        packed_next_hops[byte_index] = (next_hops[byte_index * 2] & 0x0F) | ((next_hops[byte_index * 2 + 1] & 0x0F) << 4);
+    }
+
+    // Generate the checksum on the packet:
+    const uint8_t checksum_size = packet_size - 2;
+    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_size);
+
+    // Write the checksum to the end of the packet:
+    packet[packet_size - 2] = checksum & 0x00FF;
+    packet[packet_size - 1] = (checksum & 0xFF00) >> 8;
+
+    // Send the packet:
+    dll_send_packet(node, packet_size);
+}
+
+#ifdef NET_AREA_ROUTING
+bool net_send_area_summary_packet(net_address source, uint8_t sequence_number, uint8_t direct_areas, const uint8_t costs[]) {
+    const uint8_t packet_size = AREA_SUMMARY_PACKET_FIELD_COSTS_START + NET_AREA_COUNT + 2;
+
+    // Get pointer to DLL data buffer:
+    uint8_t *packet = dll_create_data_buffer(0);
+
+    // Write the packet's header and the cost of every area:
+    packet[AREA_SUMMARY_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
+    packet[AREA_SUMMARY_PACKET_FIELD_CONTROL_H] = (NET_AREA_SUMMARY_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[AREA_SUMMARY_PACKET_FIELD_SOURCE_ADDRESS] = source;
+    packet[AREA_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBER] = sequence_number;
+    packet[AREA_SUMMARY_PACKET_FIELD_DIRECT_AREAS] = direct_areas;
+    memcpy(&packet[AREA_SUMMARY_PACKET_FIELD_COSTS_START], costs, NET_AREA_COUNT);
+
+    // Generate the checksum on the packet:
+    const uint8_t checksum_size = packet_size - 2;
+    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_size);
+
+    // Write the checksum to the end of the packet:
+    packet[packet_size - 2] = checksum & 0x00FF;
+    packet[packet_size - 1] = (checksum & 0xFF00) >> 8;
+
+    // Queue the packet to be flooded, like a link state packet:
+    return net_queue_push(packet, packet_size, DLL_BROADCAST_ADDRESS, NET_TRAFFIC_CLASS_CONTROL);
+}
+#endif
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+    const uint8_t packet_size = 7;
     // if (ping_request_packet_size > dll_get_data_buffer_size()) {
     if (packet_size > 128) {
         return;
@@ -171,11 +683,15 @@ void net_send_ping_request_packet(dll_address node) {
     uint8_t *packet = dll_create_data_buffer(0);
 
     // Write the packet's header:
-    packet[PING_REQUEST_PACKET_FIELD_CONTROL_L] = 0;
+    packet[PING_REQUEST_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
     packet[PING_REQUEST_PACKET_FIELD_CONTROL_H] = (NET_PING_REQUEST_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[PING_REQUEST_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
+    packet[PING_REQUEST_PACKET_FIELD_FLAGS] = (is_response_requested ? PING_REQUEST_FLAG_RESPONSE_REQUESTED : 0)
+        | (net_is_stub_router() ? PING_REQUEST_FLAG_STUB : 0) | PING_REQUEST_FLAG_COMPACT_HEADER;
+    packet[PING_REQUEST_PACKET_FIELD_SEQUENCE_NUMBER] = ++ping_request_sequence_number;
 
     // Generate the checksum on the header:
-    const uint8_t checksum_size = 2;
+    const uint8_t checksum_size = 5;
     uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, checksum_size);
 
     // Write the checksum to the end of the packet:
@@ -198,7 +714,7 @@ void net_send_ping_response_packet(dll_address node) {
     uint8_t *packet = dll_create_data_buffer(0);
 
     // Write the packet's header:
-    packet[PING_RESPONSE_PACKET_FIELD_CONTROL_L] = 0;
+    packet[PING_RESPONSE_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
     packet[PING_RESPONSE_PACKET_FIELD_CONTROL_H] = (NET_PING_RESPONSE_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
     packet[PING_RESPONSE_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
 
@@ -214,6 +730,29 @@ void net_send_ping_response_packet(dll_address node) {
     dll_send_packet(node, packet_size);
 }
 
+bool net_send_time_sync_packet(net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time) {
+    uint8_t *packet = dll_create_data_buffer(TIME_SYNC_PACKET_SIZE);
+
+    // Write the packet's header:
+    packet[TIME_SYNC_PACKET_FIELD_CONTROL_L] = NET_TRAFFIC_CLASS_CONTROL;
+    packet[TIME_SYNC_PACKET_FIELD_CONTROL_H] = (NET_TIME_SYNC_PACKET << 4) | (NET_TX_CHECKSUM_TYPE << 2);
+    packet[TIME_SYNC_PACKET_FIELD_SOURCE_ADDRESS] = net_get_own_address();
+    packet[TIME_SYNC_PACKET_FIELD_ROOT_ADDRESS] = root;
+    packet[TIME_SYNC_PACKET_FIELD_SEQUENCE_NUMBER] = sequence_number;
+    packet[TIME_SYNC_PACKET_FIELD_PREVIOUS_SEQUENCE_NUMBER] = previous_sequence_number;
+    for (uint8_t byte_index = 0; byte_index < 4; byte_index++) {
+        packet[TIME_SYNC_PACKET_FIELD_PREVIOUS_TIME_START + byte_index] = ((uint32_t) previous_time >> (byte_index * 8)) & 0xFF;
+    }
+
+    // Generate the checksum on the whole packet:
+    uint16_t checksum = net_generate_checksum(NET_TX_CHECKSUM_TYPE, packet, TIME_SYNC_PACKET_SIZE - 2);
+    packet[TIME_SYNC_PACKET_SIZE - 2] = checksum & 0x00FF;
+    packet[TIME_SYNC_PACKET_SIZE - 1] = (checksum & 0xFF00) >> 8;
+
+    // Send the packet straight away, so that the caller can find out when it went:
+    return dll_send_packet(DLL_BROADCAST_ADDRESS, TIME_SYNC_PACKET_SIZE) == DLL_TRANSMISSION_SUCCESS;
+}
+
 static bool net_validate_packet(uint8_t *packet, uint8_t packet_length) {
     // Check that a packet has actually been received:
     if (packet == NULL || packet_length < 4) {
@@ -227,13 +766,21 @@ static bool net_validate_packet(uint8_t *packet, uint8_t packet_length) {
     // Get the checksum from the last two bytes:
     uint16_t checksum = packet[packet_length - 2] | (packet[packet_length - 1] << 8);
 
-    // Use the checksum to check and correct any errors in the packet:
-    uint8_t checksumed_length = (packet_type == NET_DATA_PACKET) ? DATA_PACKET_FIELD_PAYLOAD_START : (packet_length - 2);
+    // Use the checksum to check and correct any errors in the packet. A data packet's checksum only covers its header,
+    // unless the sender asked for the payload to be checked too:
+    bool is_payload_checked = (packet_type == NET_DATA_PACKET) && (packet[DATA_PACKET_FIELD_CONTROL_L] & CONTROL_L_PAYLOAD_CHECKED_FLAG);
+    uint8_t checksumed_length = (packet_type == NET_DATA_PACKET && is_payload_checked == false) ? DATA_PACKET_FIELD_PAYLOAD_START : (packet_length - 2);
     bool checksum_passed = net_fix_checksum_errors(checksum_type, checksum, packet, checksumed_length);
     if (checksum_passed == false) {
         return false;
     }
 
+    // Check that the traffic class is valid (which also means that the reserved control bits are clear):
+    uint8_t control_l = packet[PACKET_FIELD_CONTROL_L] & (is_payload_checked ? ~CONTROL_L_PAYLOAD_CHECKED_FLAG : 0xFF);
+    if (control_l > NET_TRAFFIC_CLASS_INTERACTIVE) {
+        return false;
+    }
+
     // Check that the packet's length is correct:
     switch (packet_type) {
         case NET_DATA_PACKET: {
@@ -245,15 +792,23 @@ static bool net_validate_packet(uint8_t *packet, uint8_t packet_length) {
         } break;
 
         case NET_LINK_STATE_PACKET: {
-            uint8_t node_count = packet[LINK_STATE_PACKET_FIELD_NODE_COUNT];
-            uint8_t expected_packet_length = LINK_STATE_PACKET_FIELD_NODE_LIST_START + node_count + 2;
+            uint16_t connected_addresses = packet[LINK_STATE_PACKET_FIELD_LINKS_L] | (packet[LINK_STATE_PACKET_FIELD_LINKS_H] << 8);
+            uint8_t expected_packet_length = get_link_state_packet_size(connected_addresses);
             if (packet_length != expected_packet_length) {
                 return false;
             }
         } break;
 
+        case NET_LINK_STATE_DELTA_PACKET: {
+            // There's at most one change for each address:
+            uint8_t min_packet_length = LINK_STATE_DELTA_PACKET_FIELD_CHANGE_LIST_START + 2;
+            if (packet_length < min_packet_length || packet_length > min_packet_length + NET_MAX_ADDRESS + 1) {
+                return false;
+            }
+        } break;
+
         case NET_PING_REQUEST_PACKET: {
-            uint8_t expected_packet_length = 4;
+            uint8_t expected_packet_length = 7;
             if (packet_length != expected_packet_length) {
                 return false;
             }
@@ -266,6 +821,49 @@ static bool net_validate_packet(uint8_t *packet, uint8_t packet_length) {
             }
         } break;
 
+        case NET_DATABASE_SUMMARY_PACKET: {
+            uint16_t sources = packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCES_L] | (packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCES_H] << 8);
+            uint8_t source_count = 0;
+            for (net_address source = 0x00; source != NET_MAX_ADDRESS + 1; source++) {
+                if (sources & ((uint16_t) 1 << source)) {
+                    source_count++;
+                }
+            }
+            uint8_t expected_packet_length = DATABASE_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBERS_START + source_count + 2;
+            if (packet_length != expected_packet_length) {
+                return false;
+            }
+        } break;
+
+        case NET_LINK_STATE_REQUEST_PACKET: {
+            uint8_t expected_packet_length = 7;
+            if (packet_length != expected_packet_length) {
+                return false;
+            }
+        } break;
+
+        case NET_FORWARDING_TABLE_PACKET: {
+            uint8_t expected_packet_length = FORWARDING_TABLE_PACKET_FIELD_NEXT_HOPS_START + FORWARDING_TABLE_NEXT_HOPS_SIZE + 2;
+            if (packet_length != expected_packet_length) {
+                return false;
+            }
+        } break;
+
+        case NET_TIME_SYNC_PACKET: {
+            if (packet_length != TIME_SYNC_PACKET_SIZE) {
+                return false;
+            }
+        } break;
+
+#ifdef NET_AREA_ROUTING
+        case NET_AREA_SUMMARY_PACKET: {
+            uint8_t expected_packet_length = AREA_SUMMARY_PACKET_FIELD_COSTS_START + NET_AREA_COUNT + 2;
+            if (packet_length != expected_packet_length) {
+                return false;
+            }
+        } break;
+#endif
+
         default: {
             return false;
         } break;
@@ -275,7 +873,24 @@ static bool net_validate_packet(uint8_t *packet, uint8_t packet_length) {
     return true;
 }
 
+static void queue_received_packet(uint8_t *packet, uint8_t packet_length, dll_address previous_hop, net_traffic_class traffic_class) {
+    // Queue the packet by taking over DLL's receive buffer, and give DLL one of the queue's free buffers in exchange,
+    // so that the packet isn't copied on its way through this node:
+    uint8_t *exchanged_buffer = net_queue_push_buffer(packet, packet_length, previous_hop, traffic_class);
+    if (exchanged_buffer != NULL) {
+        dll_replace_receive_buffer(exchanged_buffer);
+    }
+}
+
 void net_handle_received_packet(dll_address previous_hop, uint8_t *packet, uint8_t packet_length) {
+    // A data packet with a compact header is expanded to the full format first, so that it's handled like any other:
+    if (packet != NULL && packet_length > 0 && (packet[COMPACT_DATA_PACKET_FIELD_CONTROL] & COMPACT_CONTROL_FLAG)) {
+        if (expand_compact_data_packet(packet, packet_length) == false) {
+            return;
+        }
+        packet_length += COMPACT_HEADER_SAVING;
+    }
+
     // Make sure the packet is valid before continuing:
     bool is_packet_valid = net_validate_packet(packet, packet_length);
     if (is_packet_valid == false) {
@@ -293,15 +908,13 @@ void net_handle_received_packet(dll_address previous_hop, uint8_t *packet, uint8
 
                 if (packet_length <= 128) {
                 // if (packet_length <= dll_get_data_buffer_size()) {
-                    dll_address next_hop = net_get_next_hop(destination);
+                    net_address source = packet[DATA_PACKET_FIELD_SOURCE_ADDRESS];
+                    dll_address next_hop = net_get_flow_next_hop(source, destination);
 
-                    // Check that the next hop was actually resolved, and only send the packet if it was:
+                    // Check that the next hop was actually resolved, and only queue the packet if it was:
                     if (next_hop != NET_NEXT_HOP_NOT_RESOLVED) {
-                        // uint8_t *tx_packet = dll_get_data_buffer();
-                        uint8_t *tx_packet = dll_create_data_buffer(0);
-                        uint8_t *rx_packet = packet;
-                        memmove(tx_packet, rx_packet, packet_length);
-                        dll_send_packet(next_hop, packet_length);
+                        net_traffic_class traffic_class = packet[DATA_PACKET_FIELD_CONTROL_L] & CONTROL_L_TRAFFIC_CLASS_MASK;
+                        queue_received_packet(packet, packet_length, previous_hop, traffic_class);
                     }
                 }
             } else {
@@ -315,39 +928,64 @@ void net_handle_received_packet(dll_address previous_hop, uint8_t *packet, uint8
             }
         } break;
 
-        case NET_LINK_STATE_PACKET: {
-            net_address source = packet[LINK_STATE_PACKET_FIELD_SOURCE_ADDRESS];
-            uint8_t sequence_number = packet[LINK_STATE_PACKET_FIELD_SEQUENCE_NUMBER];
-            uint8_t node_count = packet[LINK_STATE_PACKET_FIELD_NODE_COUNT];
-            net_address *node_list = &packet[LINK_STATE_PACKET_FIELD_NODE_LIST_START];
+        case NET_LINK_STATE_PACKET:
+        case NET_LINK_STATE_DELTA_PACKET: {
+            bool is_valid;
+            uint8_t link_costs[NET_MAX_ADDRESS + 1] = { 0 };
+            if (packet_type == NET_LINK_STATE_PACKET) {
+                net_address source = packet[LINK_STATE_PACKET_FIELD_SOURCE_ADDRESS];
+                uint8_t sequence_number = packet[LINK_STATE_PACKET_FIELD_SEQUENCE_NUMBER];
+                uint16_t connected_addresses = packet[LINK_STATE_PACKET_FIELD_LINKS_L] | (packet[LINK_STATE_PACKET_FIELD_LINKS_H] << 8);
+                const uint8_t *cost_list = &packet[LINK_STATE_PACKET_FIELD_LINK_COSTS_START];
 
-            bool is_valid = net_notify_link_state_packet(source, sequence_number, node_list, node_count);
+                // Unpack the cost of each connected address:
+                uint8_t cost_index = 0;
+                for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
+                    if (connected_addresses & ((uint16_t) 1 << node)) {
+                        link_costs[node] = (cost_list[cost_index / 2] >> ((cost_index & 1) * 4)) & 0x0F;
+                        cost_index++;
+                    }
+                }
+
+                is_valid = net_notify_link_state_packet(previous_hop, source, sequence_number, link_costs);
+            } else {
+                net_address source = packet[LINK_STATE_DELTA_PACKET_FIELD_SOURCE_ADDRESS];
+                uint8_t sequence_number = packet[LINK_STATE_DELTA_PACKET_FIELD_SEQUENCE_NUMBER];
+                uint8_t base_sequence_number = packet[LINK_STATE_DELTA_PACKET_FIELD_BASE_SEQUENCE_NUMBER];
+                uint8_t change_count = packet_length - LINK_STATE_DELTA_PACKET_FIELD_CHANGE_LIST_START - 2;
+                const uint8_t *change_list = &packet[LINK_STATE_DELTA_PACKET_FIELD_CHANGE_LIST_START];
+
+                // Read the new cost of every changed link:
+                uint16_t changed_addresses = 0;
+                for (uint8_t change_index = 0; change_index < change_count; change_index++) {
+                    net_address address = change_list[change_index] & LINK_STATE_DELTA_CHANGE_ADDRESS_MASK;
+                    changed_addresses |= ((uint16_t) 1 << address);
+                    link_costs[address] = change_list[change_index] >> LINK_STATE_DELTA_CHANGE_COST_SHIFT;
+                }
+
+                is_valid = net_notify_link_state_delta_packet(previous_hop, source, sequence_number, base_sequence_number, changed_addresses, link_costs);
+            }
 
             if (is_valid == false) {
                 // This packet has already been received before; don't continue flooding the packet.
                 break;
             }
 
-            // Broadcast the packet to all neighbouring nodes to continue flooding the packet:
+            // Queue the packet to be sent on to all neighbouring nodes, to continue flooding the packet:
             if (packet_length <= 128) {
             // if (packet_length <= dll_get_data_buffer_size()) {
-                // uint8_t *tx_packet = dll_get_data_buffer();
-                uint8_t *tx_packet = dll_create_data_buffer(0);
-                uint8_t *rx_packet = packet;
-                memmove(tx_packet, rx_packet, packet_length);
-
-                // Send the packet to each connected neighbour (except the one that the packet came from):
-                for (dll_address address = 0; address < DLL_BROADCAST_ADDRESS; address++) {
-                    if (address != previous_hop && net_is_node_neighbour(address)) {
-                        dll_send_packet(address, packet_length);
-                    }
-                }
+                queue_received_packet(packet, packet_length, previous_hop, NET_TRAFFIC_CLASS_CONTROL);
             }
         } break;
 
         case NET_PING_REQUEST_PACKET: {
-            // Send back a ping response:
-            net_send_ping_response_packet(previous_hop);
+            // Pass on the information to the router, which sends back a ping response if needed:
+            net_address logical_address = packet[PING_REQUEST_PACKET_FIELD_SOURCE_ADDRESS];
+            uint8_t sequence_number = packet[PING_REQUEST_PACKET_FIELD_SEQUENCE_NUMBER];
+            bool is_response_requested = packet[PING_REQUEST_PACKET_FIELD_FLAGS] & PING_REQUEST_FLAG_RESPONSE_REQUESTED;
+            bool is_stub = packet[PING_REQUEST_PACKET_FIELD_FLAGS] & PING_REQUEST_FLAG_STUB;
+            bool is_compact_header_supported = packet[PING_REQUEST_PACKET_FIELD_FLAGS] & PING_REQUEST_FLAG_COMPACT_HEADER;
+            net_notify_ping_request(previous_hop, logical_address, sequence_number, is_response_requested, is_stub, is_compact_header_supported);
         } break;
 
         case NET_PING_RESPONSE_PACKET: {
@@ -357,6 +995,75 @@ void net_handle_received_packet(dll_address previous_hop, uint8_t *packet, uint8
             net_notify_ping_response(physical_address, logical_address);
         } break;
 
+        case NET_DATABASE_SUMMARY_PACKET: {
+            net_address logical_address = packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCE_ADDRESS];
+            uint16_t sources = packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCES_L] | (packet[DATABASE_SUMMARY_PACKET_FIELD_SOURCES_H] << 8);
+            const uint8_t *sequence_number_list = &packet[DATABASE_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBERS_START];
+
+            // Unpack the sequence number of each source in the summary:
+            uint8_t sequence_numbers[NET_MAX_ADDRESS + 1] = { 0 };
+            uint8_t source_index = 0;
+            for (net_address source = 0x00; source != NET_MAX_ADDRESS + 1; source++) {
+                if (sources & ((uint16_t) 1 << source)) {
+                    sequence_numbers[source] = sequence_number_list[source_index++];
+                }
+            }
+
+            // Pass on the information to the router, which requests any link states it's missing:
+            net_notify_database_summary(previous_hop, logical_address, sources, sequence_numbers);
+        } break;
+
+        case NET_LINK_STATE_REQUEST_PACKET: {
+            // Pass on the information to the router, which sends out the requested link states:
+            uint16_t sources = packet[LINK_STATE_REQUEST_PACKET_FIELD_SOURCES_L] | (packet[LINK_STATE_REQUEST_PACKET_FIELD_SOURCES_H] << 8);
+            net_notify_link_state_request(sources);
+        } break;
+
+        case NET_FORWARDING_TABLE_PACKET: {
+            net_address logical_address = packet[FORWARDING_TABLE_PACKET_FIELD_SOURCE_ADDRESS];
+            const uint8_t *packed_next_hops = &packet[FORWARDING_TABLE_PACKET_FIELD_NEXT_HOPS_START];
+
+            // Unpack the next hop of each destination:
+            uint8_t next_hops[NET_MAX_ADDRESS + 1];
+            for (net_address destination = 0x00; destination != NET_MAX_ADDRESS + 1; destination++) {
+                next_hops[destination] = (packed_next_hops[destination >> 1] >> ((destination & 1) * 4)) & 0x0F;
+            }
+
+            // Pass on the information to the router, which uses it if this node is a stub router:
+            net_notify_forwarding_table(previous_hop, logical_address, next_hops);
+        } break;
+
+        case NET_TIME_SYNC_PACKET: {
+            net_address source = packet[TIME_SYNC_PACKET_FIELD_SOURCE_ADDRESS];
+            net_address root = packet[TIME_SYNC_PACKET_FIELD_ROOT_ADDRESS];
+            uint8_t sequence_number = packet[TIME_SYNC_PACKET_FIELD_SEQUENCE_NUMBER];
+            uint8_t previous_sequence_number = packet[TIME_SYNC_PACKET_FIELD_PREVIOUS_SEQUENCE_NUMBER];
+            uint32_t previous_time = 0;
+            for (uint8_t byte_index = 0; byte_index < 4; byte_index++) {
+                previous_time |= (uint32_t) packet[TIME_SYNC_PACKET_FIELD_PREVIOUS_TIME_START + byte_index] << (byte_index * 8);
+            }
+
+            // Pass on the information to the clock synchronisation, along with when the packet arrived:
+            net_notify_time_sync(source, root, sequence_number, previous_sequence_number, (time) previous_time, dll_get_receive_time());
+        } break;
+
+#ifdef NET_AREA_ROUTING
+        case NET_AREA_SUMMARY_PACKET: {
+            net_address source = packet[AREA_SUMMARY_PACKET_FIELD_SOURCE_ADDRESS];
+            uint8_t sequence_number = packet[AREA_SUMMARY_PACKET_FIELD_SEQUENCE_NUMBER];
+            uint8_t direct_areas = packet[AREA_SUMMARY_PACKET_FIELD_DIRECT_AREAS];
+            const uint8_t *costs = &packet[AREA_SUMMARY_PACKET_FIELD_COSTS_START];
+            if (net_notify_area_summary(source, sequence_number, direct_areas, costs) == false) {
+                // This summary has already been received before, or is for areas we don't hold; don't continue flooding
+                // the packet.
+                break;
+            }
+
+            // Queue the packet to be sent on to all neighbouring nodes, to continue flooding the packet:
+            queue_received_packet(packet, packet_length, previous_hop, NET_TRAFFIC_CLASS_CONTROL);
+        } break;
+#endif
+
         default: {
             // Ignore the packet.
             // Nothing to do.
@@ -367,3 +1074,54 @@ void net_handle_received_packet(dll_address previous_hop, uint8_t *packet, uint8
 void net_set_receive_callback(net_receive_callback callback) {
     receive_callback = callback;
 }
+
+void net_set_send_callback(net_send_callback callback) {
+    send_callback = callback;
+}
+
+void net_update_pending() {
+    // Take each held packet which is ready out of the buffer, straight into DLL's buffer:
+    // uint8_t *packet = dll_get_data_buffer();
+    uint8_t *packet = dll_create_data_buffer(0);
+    uint8_t packet_length;
+    net_address destination;
+    bool is_expired;
+    while (net_pending_pop_ready(packet, &packet_length, &destination, &is_expired)) {
+        // Send the packet if a route was found:
+        net_send_status status = NET_SEND_NO_ROUTE;
+        if (is_expired == false) {
+            bool is_delivered = send_to_next_hop(packet, net_get_own_address(), destination, packet_length);
+            status = is_delivered ? NET_SEND_SUCCESS : NET_SEND_FAILED;
+        }
+
+        // Let the user know what happened to the packet:
+        if (send_callback != NULL) {
+            send_callback(destination, status);
+        }
+    }
+}
+
+void net_update_forwarding() {
+    // Take the next packet out of the queue (it's sent straight from the queue's buffer):
+    uint8_t packet_length;
+    dll_address previous_hop;
+    uint8_t *packet = net_queue_pop(&packet_length, &previous_hop);
+    if (packet == NULL) {
+        return;
+    }
+
+    // Only data and link state packets are forwarded:
+    net_packet_type packet_type = (packet[PACKET_FIELD_CONTROL_H] & 0xF0) >> 4;
+    if (packet_type == NET_DATA_PACKET) {
+        // Send the packet on to the next hop (which may have changed since the packet was queued):
+        net_address source = packet[DATA_PACKET_FIELD_SOURCE_ADDRESS];
+        net_address destination = packet[DATA_PACKET_FIELD_DESTINATION_ADDRESS];
+        send_to_next_hop(packet, source, destination, packet_length);
+    } else {
+        // Send the packet to each connected neighbour (except the one that the packet came from, if any):
+        flood_link_state_packet(packet, packet_length, previous_hop);
+    }
+
+    // Give the buffer back to the queue:
+    net_queue_release(packet);
+}
@@ -2,6 +2,8 @@
 
 #include "network_stack/dll.h"
 #include "network_stack/net.h"
+#include "time.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -18,22 +20,41 @@ uint8_t *net_get_data_buffer();
 uint8_t net_get_data_buffer_size();
 
 /**
- * @brief Sends a data packet, with whatever data is in the data buffer, to the given destination.
+ * @brief Sends a data packet, with whatever data is in the data buffer, to the given destination. If there's no route
+ *        to the destination yet, the packet is held until 'net_update_pending()' finds one.
  * @param destination: The logical address to send the packet to.
  * @param data_length: The number of bytes to send from the data buffer.
+ * @param traffic_class: The packet's traffic class.
+ * @param is_payload_checked: Whether the packet's checksum should cover its payload as well as its header. If it does,
+ *                            packets whose payload is corrupted on the way are dropped rather than delivered, at the cost
+ *                            of every node along the path checking the whole packet.
+ * @returns The result of sending the packet, or 'NET_SEND_PENDING' if it's being held.
  */
-void net_send_data_packet(net_address destination, uint8_t data_length);
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked);
 
 /**
- * @brief Sends out a new link state packet to the entire network, with information about this node's links.
+ * @brief Sends out a new link state packet to the entire network, with information about this node's links. The packet
+ *        carries the full set of links as a bitmap, and becomes the base for any following delta packets. The packet
+ *        is queued, and flooded by 'net_update_forwarding()'.
+ * @returns 'true' if the packet was queued; 'false' if the queue is full and it should be tried again later. The
+ *          sequence number and delta base only move on once the packet is queued.
  */
-void net_send_link_state_packet();
+bool net_send_link_state_packet();
+
+/**
+ * @brief Sends out a link state packet to the entire network after this node's links have changed. If it's smaller, a
+ *        delta packet is sent, which only carries the links added or removed since the last full link state packet.
+ *        Otherwise a full link state packet is sent.
+ * @returns 'true' if the packet was queued; 'false' if the queue is full and it should be tried again later.
+ */
+bool net_send_link_state_update_packet();
 
 /**
  * @brief Sends a ping request packet to a neighbouring node.
  * @param node: The node to send the ping request to.
+ * @param is_response_requested: Whether the receiving node should send back a ping response.
  */
-void net_send_ping_request_packet(dll_address node);
+void net_send_ping_request_packet(dll_address node, bool is_response_requested);
 
 /**
  * @brief Sends a ping response packet to a neighbouring node.
@@ -41,6 +62,78 @@ void net_send_ping_request_packet(dll_address node);
  */
 void net_send_ping_response_packet(dll_address node);
 
+/**
+ * @brief Sends a database summary packet to a neighbouring node, listing the sequence number of every link state held
+ *        by this node (including its own). The node replies with a link state request for any it's missing.
+ * @param node: The node to send the summary to.
+ * @returns 'true' if the packet was sent; 'false' otherwise.
+ */
+bool net_send_database_summary_packet(dll_address node);
+
+/**
+ * @brief Sends a link state request packet to a neighbouring node, asking it to send out the link states it holds for
+ *        the given sources.
+ * @param node: The node to send the request to.
+ * @param sources: The sources whose link states are requested - each bit corresponds to a network address.
+ * @returns 'true' if the packet was sent; 'false' otherwise.
+ */
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources);
+
+/**
+ * @brief Sends a forwarding table packet to a neighbouring stub router, which uses it in place of calculating its own
+ *        routes.
+ * @param node: The stub router to send the forwarding table to.
+ * @param next_hops: The logical address of the stub router's next hop to each destination, indexed by the destination's
+ *                   address. The stub router's own address means that the destination can't be reached.
+ */
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]);
+
+#ifdef NET_AREA_ROUTING
+/**
+ * @brief Sends out an area summary, on behalf of the node on the border between areas that it came from, to the areas
+ *        which that node borders. Nodes which already hold the summary drop the packet. The packet is queued, and
+ *        flooded by 'net_update_forwarding()'.
+ * @param source: The border node which the summary is from.
+ * @param sequence_number: The sequence number of the summary.
+ * @param direct_areas: The areas that the source holds the link states of - each bit corresponds to an area.
+ * @param costs: The cost of reaching each area from the source, indexed by the area.
+ * @returns 'true' if the packet was queued; 'false' if the queue is full and it should be tried again later.
+ */
+bool net_send_area_summary_packet(net_address source, uint8_t sequence_number, uint8_t direct_areas, const uint8_t costs[]);
+#endif
+
+/**
+ * @brief Sends out the link state held by the router for another node, as if this node were flooding the source's own
+ *        packets: the full link state packet it's based on, followed by a delta packet if it has changed since. Nodes
+ *        which already hold the link state drop the packets. The packets are queued, and flooded by
+ *        'net_update_forwarding()'.
+ * @param source: The node whose link state to send out.
+ * @returns 'true' if the link state was queued (or there's no valid link state to send); 'false' if the queue is full
+ *          and it should be tried again later.
+ */
+bool net_send_stored_link_state_packet(net_address source);
+
+/**
+ * @brief Moves this node's link state sequence number up to the given one, if it's ahead, so that the next link state
+ *        packet is sent with a higher sequence number. Used when another node still holds a link state packet that
+ *        this node sent out before it restarted, which would otherwise make it drop the node's new packets as old.
+ * @param sequence_number: The sequence number of the link state packet held by the other node.
+ * @returns 'true' if the sequence number was ahead and has been moved up; 'false' otherwise.
+ */
+bool net_advance_link_state_sequence_number(uint8_t sequence_number);
+
+/**
+ * @brief Broadcasts a time sync packet to every neighbouring node. The packet is sent straight away rather than queued,
+ *        so once this returns, 'dll_get_transmit_time()' gives the moment it finished being sent.
+ * @param root: The node whose clock is the network time.
+ * @param sequence_number: The root's sequence number which the packet passes on.
+ * @param previous_sequence_number: The sequence number of this node's previous time sync packet, or the same as
+ *                                  'sequence_number' if there isn't one.
+ * @param previous_time: The network time at which the previous time sync packet finished being sent.
+ * @returns 'true' if the packet was sent; 'false' otherwise.
+ */
+bool net_send_time_sync_packet(net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time);
+
 /**
  * @brief Handles a received network packet.
  * @param previous_hop: The node which the packet was directly received from.
@@ -49,6 +142,25 @@ void net_send_ping_response_packet(dll_address node);
  */
 void net_handle_received_packet(dll_address previous_hop, uint8_t *packet, uint8_t packet_length);
 
+/**
+ * @brief Sends the next packet waiting in the forwarding queue. Packets received for other nodes are queued rather than
+ *        sent from within 'net_handle_received_packet()', so that DLL can keep receiving while they're forwarded. The
+ *        queue also holds this node's own link state packets. Packets are sent in order of their traffic class.
+ */
+void net_update_forwarding();
+
+/**
+ * @brief Sends any held data packets whose destination now has a route, and gives up on any which have expired. The
+ *        send callback is called for each of them.
+ */
+void net_update_pending();
+
+/**
+ * @brief Sets the user function to be called when a held data packet is finally sent or given up on.
+ * @param callback: The function to be called. Set to 'NULL' to not use a callback (default).
+ */
+void net_set_send_callback(net_send_callback callback);
+
 /**
  * @brief Sets the user function to be called when a network data packet is received.
  * @param callback: The function to be called. Set to 'NULL' to not use a callback (default).
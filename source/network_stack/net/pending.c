@@ -0,0 +1,87 @@
+#include "pending.h"
+#include "routing.h"
+#include "time.h"
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+    uint8_t packet[NET_PENDING_MAX_PACKET_SIZE]; // A copy of the held packet
+    uint8_t packet_length; // The number of bytes in the packet
+    net_address destination; // The packet's destination address
+    time expiry_time; // The time at which the packet is given up on
+    uint8_t order; // The order in which the packet was added, used to keep packets in order
+    bool is_used; // Whether this slot holds a packet
+} net_pending_slot;
+
+// List of slots for held packets, each for a different destination. The slots aren't kept in any order.
+static net_pending_slot slots[NET_PENDING_SIZE] = { 0 };
+
+// The order number given to the next packet added to the buffer.
+static uint8_t next_order = 0;
+
+bool net_pending_push(const uint8_t *packet, uint8_t packet_length, net_address destination, bool *is_replaced) {
+    *is_replaced = false;
+    if (packet_length > NET_PENDING_MAX_PACKET_SIZE) {
+        return false;
+    }
+
+    // Only the newest packet to each destination is held, so that a user resending to a destination without a route
+    // doesn't take up every slot. Use the destination's slot if it has one, or a free slot otherwise:
+    net_pending_slot *destination_slot = NULL;
+    net_pending_slot *free_slot = NULL;
+    for (uint8_t slot_index = 0; slot_index < NET_PENDING_SIZE; slot_index++) {
+        net_pending_slot *slot = &slots[slot_index];
+        if (slot->is_used && slot->destination == destination) {
+            destination_slot = slot;
+            break;
+        }
+        if (slot->is_used == false && free_slot == NULL) {
+            free_slot = slot;
+        }
+    }
+    if (destination_slot != NULL) {
+        *is_replaced = true;
+        free_slot = destination_slot;
+    }
+    if (free_slot == NULL) {
+        return false;
+    }
+
+    // Copy the packet into the slot:
+    memcpy(free_slot->packet, packet, packet_length);
+    free_slot->packet_length = packet_length;
+    free_slot->destination = destination;
+    free_slot->expiry_time = time_add_seconds(time_now(), NET_PENDING_TIMEOUT_SECONDS);
+    free_slot->order = next_order++;
+    free_slot->is_used = true;
+    return true;
+}
+
+bool net_pending_pop_ready(uint8_t *packet, uint8_t *packet_length, net_address *destination, bool *is_expired) {
+    time now = time_now();
+
+    // Find the oldest packet which has a route to its destination or has expired:
+    net_pending_slot *ready_slot = NULL;
+    for (uint8_t slot_index = 0; slot_index < NET_PENDING_SIZE; slot_index++) {
+        net_pending_slot *slot = &slots[slot_index];
+        if (slot->is_used == false) {
+            continue;
+        }
+        bool is_ready = net_get_next_hop(slot->destination) != NET_NEXT_HOP_NOT_RESOLVED
+            || time_delta_milliseconds(slot->expiry_time, now) >= 0;
+        if (is_ready && (ready_slot == NULL || (int8_t) (slot->order - ready_slot->order) < 0)) {
+            ready_slot = slot;
+        }
+    }
+    if (ready_slot == NULL) {
+        return false;
+    }
+
+    // Copy the packet out of the slot and free it:
+    memcpy(packet, ready_slot->packet, ready_slot->packet_length);
+    *packet_length = ready_slot->packet_length;
+    *destination = ready_slot->destination;
+    *is_expired = net_get_next_hop(ready_slot->destination) == NET_NEXT_HOP_NOT_RESOLVED;
+    ready_slot->is_used = false;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "network_stack/net.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The number of data packets that can be held at once while waiting for a route to their destination. Only one packet
+ * is held for each destination.
+ */
+#ifndef NET_PENDING_SIZE
+#define NET_PENDING_SIZE (2)
+#endif
+
+/**
+ * The largest packet that can be held.
+ */
+#define NET_PENDING_MAX_PACKET_SIZE (128)
+
+/**
+ * How long a packet is held for before it's given up on, if a route to its destination isn't found.
+ */
+#define NET_PENDING_TIMEOUT_SECONDS (30)
+
+/**
+ * @brief Holds a copy of a data packet until a route to its destination is found, or until it expires. If a packet to
+ *        the same destination is already being held, it's replaced by the new one.
+ * @param packet: A pointer to the start of the packet.
+ * @param packet_length: The number of bytes in the packet.
+ * @param destination: The packet's destination address.
+ * @param is_replaced: Set to 'true' if an older packet to the destination was dropped to hold this one.
+ * @returns 'true' if the packet is being held; 'false' if there's no space left for it.
+ */
+bool net_pending_push(const uint8_t *packet, uint8_t packet_length, net_address destination, bool *is_replaced);
+
+/**
+ * @brief Takes the oldest held packet which is ready to be dealt with out of the buffer. A packet is ready once there's
+ *        a route to its destination, or once it has expired.
+ * @param packet: A pointer to the buffer to copy the packet into, which must be at least 'NET_PENDING_MAX_PACKET_SIZE'
+ *                bytes long.
+ * @param packet_length: Set to the number of bytes in the packet.
+ * @param destination: Set to the packet's destination address.
+ * @param is_expired: Set to 'true' if the packet expired without a route being found, or 'false' if it can be sent.
+ * @returns 'true' if a packet was taken out of the buffer; 'false' if no held packets are ready.
+ */
+bool net_pending_pop_ready(uint8_t *packet, uint8_t *packet_length, net_address *destination, bool *is_expired);
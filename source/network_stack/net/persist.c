@@ -0,0 +1,126 @@
+#include "persist.h"
+#include "checksum.h"
+#include "storage.h"
+#include <string.h>
+
+// The blocks are saved into a ring of slots at the start of the storage. Each slot holds a sequence number, which is
+// used to find the most recent block, the block's length, the block itself and a CRC over all of them.
+#define SLOT_START_ADDRESS ((uint16_t) 0)
+#define SLOT_COUNT (8)
+#define SLOT_SIZE (NET_PERSIST_MAX_DATA_SIZE + 4)
+
+typedef enum {
+    SEQUENCE_NUMBER = 0,
+    DATA_LENGTH = 1,
+    DATA_START = 2,
+} net_persist_slot_field;
+
+// A copy of the slot being written, or of the last one written or loaded.
+static uint8_t slot_buffer[SLOT_SIZE];
+
+// Whether 'slot_buffer' holds a complete copy of the most recent slot in storage.
+static bool is_slot_buffer_saved = false;
+
+// The storage address of the slot being written, and how much of it has been written.
+static uint16_t write_address = SLOT_START_ADDRESS;
+static uint8_t write_length = 0;
+static uint8_t write_index = 0;
+
+// The slot and sequence number to use for the next block saved.
+static uint8_t next_slot_index = 0;
+static uint8_t next_sequence_number = 0;
+
+static uint16_t get_slot_address(uint8_t slot_index) {
+    return SLOT_START_ADDRESS + (uint16_t) slot_index * SLOT_SIZE;
+}
+
+static bool read_slot(uint8_t slot_index) {
+    // Read the slot into the buffer, and check that its length and CRC are valid:
+    uint16_t address = get_slot_address(slot_index);
+    storage_read(address, slot_buffer, DATA_START);
+    uint8_t data_length = slot_buffer[DATA_LENGTH];
+    if (data_length > NET_PERSIST_MAX_DATA_SIZE) {
+        return false;
+    }
+    storage_read(address + DATA_START, &slot_buffer[DATA_START], data_length + 2);
+    uint16_t crc = slot_buffer[DATA_START + data_length] | ((uint16_t) slot_buffer[DATA_START + data_length + 1] << 8);
+    return crc == net_generate_checksum(NET_CHECKSUM_CRC_16, slot_buffer, DATA_START + data_length);
+}
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Find the valid slot with the newest sequence number. A slot that was being written when the power went off fails
+    // its CRC, so the slot before it is used instead:
+    bool is_found = false;
+    uint8_t newest_slot_index = 0;
+    uint8_t newest_sequence_number = 0;
+    for (uint8_t slot_index = 0; slot_index < SLOT_COUNT; slot_index++) {
+        if (read_slot(slot_index) == false) {
+            continue;
+        }
+        uint8_t sequence_number_difference = slot_buffer[SEQUENCE_NUMBER] - newest_sequence_number;
+        if (is_found == false || (sequence_number_difference != 0 && sequence_number_difference <= 128)) {
+            is_found = true;
+            newest_slot_index = slot_index;
+            newest_sequence_number = slot_buffer[SEQUENCE_NUMBER];
+        }
+    }
+    write_length = 0;
+    write_index = 0;
+    is_slot_buffer_saved = false;
+    if (is_found == false) {
+        next_slot_index = 0;
+        next_sequence_number = 0;
+        return false;
+    }
+
+    // Save the next block after the newest one:
+    next_slot_index = (newest_slot_index + 1) % SLOT_COUNT;
+    next_sequence_number = newest_sequence_number + 1;
+
+    // Keep a copy of the newest slot, so that the same block isn't saved again:
+    read_slot(newest_slot_index);
+    is_slot_buffer_saved = true;
+    if (slot_buffer[DATA_LENGTH] != data_length) {
+        return false;
+    }
+    memcpy(data, &slot_buffer[DATA_START], data_length);
+    return true;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    // Wait for the last block to be written:
+    if (write_index < write_length || data_length > NET_PERSIST_MAX_DATA_SIZE) {
+        return false;
+    }
+
+    // Don't wear out the storage writing the same block again:
+    if (is_slot_buffer_saved && slot_buffer[DATA_LENGTH] == data_length
+        && memcmp(&slot_buffer[DATA_START], data, data_length) == 0) {
+        return true;
+    }
+
+    // Fill in the slot and its CRC:
+    slot_buffer[SEQUENCE_NUMBER] = next_sequence_number++;
+    slot_buffer[DATA_LENGTH] = data_length;
+    memcpy(&slot_buffer[DATA_START], data, data_length);
+    uint16_t crc = net_generate_checksum(NET_CHECKSUM_CRC_16, slot_buffer, DATA_START + data_length);
+    slot_buffer[DATA_START + data_length] = crc & 0xFF;
+    slot_buffer[DATA_START + data_length + 1] = crc >> 8;
+
+    // Start writing it over the oldest slot:
+    write_address = get_slot_address(next_slot_index);
+    write_length = DATA_START + data_length + 2;
+    write_index = 0;
+    next_slot_index = (next_slot_index + 1) % SLOT_COUNT;
+    is_slot_buffer_saved = true;
+    return true;
+}
+
+void net_persist_update() {
+    // Each byte takes several milliseconds to write, so write them in the background rather than waiting for them.
+    // Bytes which haven't changed are skipped straight away:
+    while (write_index < write_length && storage_is_ready()) {
+        storage_write_byte(write_address + write_index, slot_buffer[write_index]);
+        write_index++;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The largest block of data that can be saved.
+ */
+#ifndef NET_PERSIST_MAX_DATA_SIZE
+#define NET_PERSIST_MAX_DATA_SIZE (156)
+#endif
+
+/**
+ * @brief Loads the most recently saved block of data from storage. This must be called before 'net_persist_save()', so
+ *        that new blocks are saved after the existing ones.
+ * @param data: A pointer to the buffer to copy the block into.
+ * @param data_length: The length of the block expected.
+ * @returns 'true' if a valid block with the expected length was found; 'false' otherwise.
+ */
+bool net_persist_load(void *data, uint8_t data_length);
+
+/**
+ * @brief Starts saving a block of data to storage, which is then written by 'net_persist_update()' a byte at a time.
+ *        Each block is saved into the next of several slots in turn, which spreads the wear across the storage and
+ *        keeps the previous block valid until the new one is completely written. A block which is the same as the last
+ *        one saved isn't written again.
+ * @param data: A pointer to the start of the block.
+ * @param data_length: The number of bytes in the block, up to 'NET_PERSIST_MAX_DATA_SIZE'.
+ * @returns 'true' if the block is being saved (or is already saved); 'false' if the last block is still being written
+ *          or the block is too long.
+ */
+bool net_persist_save(const void *data, uint8_t data_length);
+
+/**
+ * @brief Writes the next bytes of the block being saved, as long as the storage is ready for them.
+ */
+void net_persist_update();
@@ -0,0 +1,150 @@
+#include "queue.h"
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+    uint8_t *packet; // The buffer holding the queued packet
+    uint8_t packet_length; // The number of bytes in the packet
+    dll_address previous_hop; // The physical address of the node that the packet was received from
+    uint8_t priority; // The packet's priority, where larger numbers are higher priority
+    uint8_t order; // The order in which the packet was added, used to keep packets with the same priority in order
+    bool is_used; // Whether this slot holds a queued packet
+} net_queue_slot;
+
+// List of slots for queued packets. The slots aren't kept in any order.
+static net_queue_slot slots[NET_QUEUE_SIZE] = { 0 };
+
+// The queue's own packet buffers. Buffers are swapped with DLL's receive buffer, so once packets have been forwarded
+// the queue may own DLL's original buffer instead of one of these.
+static uint8_t buffers[NET_QUEUE_SIZE][NET_QUEUE_MAX_PACKET_SIZE];
+
+// The number of the queue's own buffers which haven't been used yet.
+static uint8_t new_buffer_count = NET_QUEUE_SIZE;
+
+// List of used buffers which have been given back, and aren't being used by a slot or by a packet taken out of the queue.
+static uint8_t *free_buffers[NET_QUEUE_SIZE];
+static uint8_t free_buffer_count = 0;
+
+// The order number given to the next packet added to the queue.
+static uint8_t next_order = 0;
+
+// Statistics about the queue, returned by 'net_get_queue_statistics()'.
+static net_queue_statistics statistics = { 0 };
+
+static bool is_slot_before(const net_queue_slot *slot_1, const net_queue_slot *slot_2) {
+    // Check whether slot 1 should be taken out of the queue before slot 2 (higher priority first, then oldest first):
+    if (slot_1->priority != slot_2->priority) {
+        return slot_1->priority > slot_2->priority;
+    }
+    return (int8_t) (slot_1->order - slot_2->order) < 0;
+}
+
+static net_queue_slot *claim_slot(uint8_t priority) {
+    // Find a free slot, and the slot which would be taken out of the queue last:
+    net_queue_slot *free_slot = NULL;
+    net_queue_slot *last_slot = NULL;
+    for (uint8_t slot_index = 0; slot_index < NET_QUEUE_SIZE; slot_index++) {
+        net_queue_slot *slot = &slots[slot_index];
+        if (slot->is_used == false) {
+            free_slot = slot;
+        } else if (last_slot == NULL || is_slot_before(last_slot, slot)) {
+            last_slot = slot;
+        }
+    }
+
+    // The queue is full if there's no free slot, or if every free buffer is taken by a packet that's being sent:
+    if (free_slot == NULL || free_buffer_count + new_buffer_count == 0) {
+        // Drop the new packet, unless it has a higher priority than the last queued packet:
+        statistics.dropped_count++;
+        if (last_slot == NULL || priority <= last_slot->priority) {
+            return NULL;
+        }
+        last_slot->is_used = false;
+        net_queue_release(last_slot->packet);
+        free_slot = last_slot;
+        statistics.depth--;
+    }
+
+    // Take a free buffer for the slot:
+    if (free_buffer_count != 0) {
+        free_slot->packet = free_buffers[--free_buffer_count];
+    } else {
+        free_slot->packet = buffers[--new_buffer_count];
+    }
+    return free_slot;
+}
+
+static void add_slot(net_queue_slot *slot, uint8_t packet_length, dll_address previous_hop, uint8_t priority) {
+    slot->packet_length = packet_length;
+    slot->previous_hop = previous_hop;
+    slot->priority = priority;
+    slot->order = next_order++;
+    slot->is_used = true;
+
+    // Update the statistics:
+    statistics.queued_count++;
+    statistics.depth++;
+    if (statistics.depth > statistics.max_depth) {
+        statistics.max_depth = statistics.depth;
+    }
+}
+
+bool net_queue_push(const uint8_t *packet, uint8_t packet_length, dll_address previous_hop, uint8_t priority) {
+    if (packet_length > NET_QUEUE_MAX_PACKET_SIZE) {
+        return false;
+    }
+    net_queue_slot *slot = claim_slot(priority);
+    if (slot == NULL) {
+        return false;
+    }
+
+    // Copy the packet into the slot's buffer:
+    memcpy(slot->packet, packet, packet_length);
+    add_slot(slot, packet_length, previous_hop, priority);
+    return true;
+}
+
+uint8_t *net_queue_push_buffer(uint8_t *packet, uint8_t packet_length, dll_address previous_hop, uint8_t priority) {
+    if (packet_length > NET_QUEUE_MAX_PACKET_SIZE) {
+        return NULL;
+    }
+    net_queue_slot *slot = claim_slot(priority);
+    if (slot == NULL) {
+        return NULL;
+    }
+
+    // Swap the slot's buffer for the one holding the packet:
+    uint8_t *exchanged_buffer = slot->packet;
+    slot->packet = packet;
+    add_slot(slot, packet_length, previous_hop, priority);
+    return exchanged_buffer;
+}
+
+uint8_t *net_queue_pop(uint8_t *packet_length, dll_address *previous_hop) {
+    // Find the slot which should be taken out of the queue first:
+    net_queue_slot *first_slot = NULL;
+    for (uint8_t slot_index = 0; slot_index < NET_QUEUE_SIZE; slot_index++) {
+        net_queue_slot *slot = &slots[slot_index];
+        if (slot->is_used && (first_slot == NULL || is_slot_before(slot, first_slot))) {
+            first_slot = slot;
+        }
+    }
+    if (first_slot == NULL) {
+        return NULL;
+    }
+
+    // Free the slot, handing its buffer over to the caller:
+    *packet_length = first_slot->packet_length;
+    *previous_hop = first_slot->previous_hop;
+    first_slot->is_used = false;
+    statistics.depth--;
+    return first_slot->packet;
+}
+
+void net_queue_release(uint8_t *packet) {
+    free_buffers[free_buffer_count++] = packet;
+}
+
+net_queue_statistics net_get_queue_statistics() {
+    return statistics;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "network_stack/dll.h"
+#include "network_stack/net.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The number of packets that can be waiting in the queue at once. The queue owns this many packet buffers, which are
+ * swapped with DLL's receive buffer when a received packet is queued, so that forwarded packets are never copied.
+ */
+#ifndef NET_QUEUE_SIZE
+#define NET_QUEUE_SIZE (3)
+#endif
+
+/**
+ * The largest packet that can be added to the queue, which is also the size of each of the queue's buffers.
+ */
+#define NET_QUEUE_MAX_PACKET_SIZE (128)
+
+/**
+ * @brief Adds a copy of a packet to the queue. Packets with a higher priority are taken out of the queue first, and
+ *        packets with the same priority are taken out in the order they were added. If the queue is full, the newest
+ *        packet with the lowest priority is dropped to make space for the new packet, unless the new packet's priority
+ *        is no higher, in which case the new packet is dropped instead.
+ * @param packet: A pointer to the start of the packet.
+ * @param packet_length: The number of bytes in the packet.
+ * @param previous_hop: The physical address of the node that the packet was received from.
+ * @param priority: The packet's priority, where larger numbers are higher priority.
+ * @returns 'true' if the packet was added to the queue; 'false' if it was dropped.
+ */
+bool net_queue_push(const uint8_t *packet, uint8_t packet_length, dll_address previous_hop, uint8_t priority);
+
+/**
+ * @brief Adds a packet to the queue without copying it, by taking over the buffer it's in. In exchange, one of the
+ *        queue's free buffers is handed back, which the caller then owns. Otherwise this is the same as
+ *        'net_queue_push()'.
+ * @param packet: A pointer to the start of the buffer holding the packet, which must be 'NET_QUEUE_MAX_PACKET_SIZE'
+ *                bytes long.
+ * @param packet_length: The number of bytes in the packet.
+ * @param previous_hop: The physical address of the node that the packet was received from.
+ * @param priority: The packet's priority, where larger numbers are higher priority.
+ * @returns A pointer to the buffer given in exchange, or 'NULL' if the packet was dropped (in which case the caller
+ *          keeps its buffer).
+ */
+uint8_t *net_queue_push_buffer(uint8_t *packet, uint8_t packet_length, dll_address previous_hop, uint8_t priority);
+
+/**
+ * @brief Takes the next packet out of the queue. The packet isn't copied, so the buffer it's in must be given back with
+ *        'net_queue_release()' once the caller is done with it.
+ * @param packet_length: Set to the number of bytes in the packet.
+ * @param previous_hop: Set to the physical address of the node that the packet was received from.
+ * @returns A pointer to the start of the packet, or 'NULL' if the queue is empty.
+ */
+uint8_t *net_queue_pop(uint8_t *packet_length, dll_address *previous_hop);
+
+/**
+ * @brief Gives a buffer returned by 'net_queue_pop()' back to the queue.
+ * @param packet: A pointer to the start of the buffer.
+ */
+void net_queue_release(uint8_t *packet);
@@ -1,299 +1,1858 @@
 #include "routing.h"
 #include "time.h"
 #include "packets.h"
+#include "persist.h"
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define NET_MAX_ADDRESS ((net_address) 15)
-#define LINK_STATE_SECONDS_TO_LIVE_START (60)
-#define NEIGHBOUR_LINK_SECONDS_TO_LIVE_START (60)
 
+// The number of consecutive packets which must fail to be delivered to a neighbour before the link is dropped.
+#define LINK_FAILURE_THRESHOLD (3)
+
+// Trickle interval limits for sending ping requests and refreshing our link state packet. The interval doubles (up to
+// the maximum) every time it elapses without any change to our links, and goes back to the minimum when they change.
+// A message is sent at most 1.5 maximum intervals apart, which must stay within the corresponding time to live.
+#define PING_INTERVAL_MIN_MILLISECONDS (1000)
+#define PING_INTERVAL_MAX_MILLISECONDS (16000)
+#define LINK_STATE_INTERVAL_MIN_MILLISECONDS (4000)
+#define LINK_STATE_INTERVAL_MAX_MILLISECONDS (1024000)
+
+// A link times out once about three maximum ping intervals pass without hearing from the neighbour, which covers one
+// lost ping request at the longest spacing. This bounds how long a broken link goes unnoticed when no data is sent
+// over it. Link states are refreshed far less often, so they live for two maximum intervals.
+#define NEIGHBOUR_LINK_SECONDS_TO_LIVE_START (3 * PING_INTERVAL_MAX_MILLISECONDS / 1000)
+#define LINK_STATE_SECONDS_TO_LIVE_START (2 * LINK_STATE_INTERVAL_MAX_MILLISECONDS / 1000)
+
+// When the node starts, a short burst of ping requests is sent straight away, so that neighbours are found (and their
+// link state databases are exchanged) without waiting for the ping timer. More than one request is sent in case some
+// are lost.
+#define BOOT_PING_COUNT (3)
+#define BOOT_PING_INTERVAL_MILLISECONDS (100)
+
+// Ping responses are delayed by a random amount up to this value, so that neighbours don't all respond at once.
+#define PING_RESPONSE_JITTER_MILLISECONDS (250)
+#ifndef PENDING_PING_RESPONSE_COUNT
+#define PENDING_PING_RESPONSE_COUNT (4)
+#endif
+
+// Delivery ratios are moving averages, which move 1/(2^DELIVERY_RATIO_SHIFT) of the way towards each new sample.
+#define DELIVERY_RATIO_SHIFT (4)
+#define DELIVERY_RATIO_MAX (255)
+
+// A gap in a neighbour's ping request sequence numbers larger than this is assumed to be the neighbour restarting,
+// rather than lost requests.
+#define PING_SEQUENCE_GAP_MAX (4)
+
+// Our advertised link costs only change once the measured cost has moved this far from them, so that small
+// fluctuations in link quality don't change the routes. A changed cost is normally carried by the next link state
+// refresh; only a large change is sent out straight away, and at most once per interval, as every link state update
+// adds traffic which itself affects the measured costs.
+#define LINK_COST_HYSTERESIS (2)
+#define LINK_COST_UPDATE_THRESHOLD (4)
+#define LINK_COST_UPDATE_INTERVAL_SECONDS (30)
+
+// Our own link state is sent out at most once per hold time, however often our links change, so that a flapping link
+// can't flood the network with link state packets; changes made in the meantime go out together in the next one. The
+// hold time doubles every time a link state is sent out soon after the last hold ended, and goes back to the minimum
+// once our links have been quiet for the maximum hold time.
+#define LINK_STATE_HOLD_MIN_MILLISECONDS (250)
+#define LINK_STATE_HOLD_MAX_MILLISECONDS (8000)
+
+// Every time a link goes down it gains a flap penalty, which decays exponentially, moving 1/(2^FLAP_PENALTY_DECAY_SHIFT)
+// of the way towards zero every second (halving roughly every 90 seconds). A link whose penalty reaches the suppress
+// threshold is left out of our link state, even while the neighbour can be heard, until its penalty has decayed below
+// the reuse threshold. This stops an unstable link from repeatedly changing the routes across the whole network.
+#define FLAP_PENALTY (1000)
+#define FLAP_PENALTY_MAX (8000)
+#define FLAP_PENALTY_SUPPRESS_THRESHOLD (2000)
+#define FLAP_PENALTY_REUSE_THRESHOLD (750)
+#define FLAP_PENALTY_DECAY_SHIFT (7)
+
+// Odd multipliers used to hash a flow's source and destination addresses onto one of several equal-cost next hops.
+#define FLOW_HASH_MULTIPLIER (0x9D)
+#define FLOW_HASH_ADDRESS_MULTIPLIER (0x3B)
+
+// The number of bytes needed to store a link cost for every address, packed two to a byte.
+#define PACKED_LINK_COSTS_SIZE ((NET_MAX_ADDRESS + 2) / 2)
+
+// A snapshot of the routing state is saved to storage when the neighbours or the links between nodes change, and
+// restored when the node starts, so that there are routes straight away rather than once the neighbours have been found
+// again. Changes in link cost alone don't make a snapshot due. The first snapshot can be saved once the network has had
+// time to settle after starting, and the following ones at most every half hour, so that even a network that keeps
+// changing takes decades to wear out the storage slots.
+#define SNAPSHOT_SETTLE_SECONDS (60)
+#define SNAPSHOT_INTERVAL_SECONDS (1800)
+
+// Restored links and link states are provisional: they time out quickly unless the neighbours confirm them or new link
+// state packets replace them.
+#define RESTORED_NEIGHBOUR_LINK_SECONDS_TO_LIVE (10)
+#define RESTORED_LINK_STATE_SECONDS_TO_LIVE (30)
+
+// A stub router only keeps track of the link state sequence numbers, so that it can recognise the link state packets it
+// has already flooded; it doesn't hold the link costs.
 typedef struct {
     uint8_t sequence_number; // The sequence number of the packet that carried this link state
-    uint8_t seconds_to_live; // The number of seconds left before this link state is invalid
-    uint16_t connected_addresses; // Which network addresses are connected to the node - each bit corresponds to a network address.
+    uint16_t seconds_to_live; // The number of seconds left before this link state is invalid
+    bool is_provisional; // Whether this link state was restored from a snapshot, rather than received since starting
+#ifndef NET_STUB_ROUTING
+    uint8_t link_costs[PACKED_LINK_COSTS_SIZE]; // The cost of the node's link to each network address, packed two to a byte (lowest address in the low nibble). A cost of zero means that the nodes aren't linked.
+    uint8_t base_sequence_number; // The sequence number of the last full link state packet, which deltas are based on
+    uint8_t base_link_costs[PACKED_LINK_COSTS_SIZE]; // The link costs carried by the last full link state packet
+    bool is_base_missing; // Whether a delta packet arrived without the full link state packet it's based on, which was lost on the way. The base sequence number is then the one still to be received.
+#endif
 } net_link_state_packet;
 
 typedef struct {
     dll_address physical_address; // The physical address of the linked node
     uint8_t seconds_to_live; // The number of seconds left before this link is invalid
+    uint8_t failure_count; // The number of consecutive packets which failed to be delivered over this link
+    uint8_t acknowledged_ratio; // Moving average of the frames sent to the node which were acknowledged (255 is all of them)
+    uint8_t ping_received_ratio; // Moving average of the ping requests sent by the node which were received (255 is all of them)
+    uint8_t ping_sequence_number; // The sequence number of the last ping request received from the node
+    bool is_database_summary_due; // Whether a database summary should be sent to the node, as the link has just come up or we've missed packets it passed on
+    uint16_t missing_link_states; // The sources whose link states should be requested from the node - each bit corresponds to a network address
+    bool is_provisional; // Whether this link was restored from a snapshot, and hasn't been confirmed by the node yet
+    uint16_t flap_penalty; // Penalty for the link going down, which decays over time
+    bool is_suppressed; // Whether the link is left out of our link state, as it has been going up and down
+    bool is_stub; // Whether the neighbour is a stub router, which relies on us to send it a forwarding table
+    bool is_compact_header_supported; // Whether the neighbour can receive data packets with a compact header
+#ifndef NET_STUB_ROUTING
+    bool is_forwarding_table_due; // Whether the neighbour's forwarding table should be recalculated and sent to it
+#endif
 } net_neighbour_link;
 
+typedef struct {
+    int32_t interval_milliseconds; // The length of the current interval
+    time interval_end; // The time at which the current interval ends
+    time fire_time; // The time within the current interval at which the message should be sent
+    bool is_fired; // Whether the message has already been sent in the current interval
+} net_trickle_timer;
+
+typedef struct {
+    dll_address physical_address; // The physical address of the node to respond to
+    time send_time; // The time at which the response should be sent
+    bool is_pending; // Whether this entry holds a response waiting to be sent
+} net_pending_ping_response;
+
+#ifndef NET_STUB_ROUTING
+typedef struct {
+    uint16_t neighbours; // The neighbours with live links - each bit corresponds to a network address
+    dll_address neighbour_physical_addresses[NET_MAX_ADDRESS + 1]; // The physical address of each neighbour, indexed by its network address
+    uint16_t link_states; // The nodes with valid link states, including our own - each bit corresponds to a network address
+    uint8_t link_costs[NET_MAX_ADDRESS + 1][PACKED_LINK_COSTS_SIZE]; // The packed link costs of each node's link state, indexed by its network address
+} net_routing_snapshot;
+
+_Static_assert(sizeof(net_routing_snapshot) <= NET_PERSIST_MAX_DATA_SIZE, "Routing snapshot is too large to be saved");
+#endif
+
+#ifdef NET_AREA_ROUTING
+// The link states of the areas that we hold, with a slot of 'LINK_STATE_SLOT_SIZE' entries for each area. Within a slot,
+// the link states are indexed by the low bits of the node's network address. Slots are taken by areas as they're held,
+// and given up when they stop being held.
+#define LINK_STATE_SLOT_SIZE (1 << NET_AREA_NODE_BITS)
+#define NO_AREA (0xFF)
+static uint8_t link_state_slot_areas[NET_MAX_HELD_AREAS];
+static net_link_state_packet link_state_packets[NET_MAX_HELD_AREAS * LINK_STATE_SLOT_SIZE] = { 0 };
+
+// Stands in for the link state of a node in an area without a slot. It's never valid, so it reads as a missing link state.
+static net_link_state_packet unheld_link_state = { 0 };
+#else
 // List of every node's link state packet. Indexed by the node's network address.
 static net_link_state_packet link_state_packets[NET_MAX_ADDRESS + 1] = { 0 };
+#endif
 
 // List of neighbouring links. Indexed by the node's network address.
 static net_neighbour_link neighbour_links[NET_MAX_ADDRESS + 1] = { 0 };
 
-// List of next hops corresponding to each destination node. Indexed by the destination node's network address.
-static dll_address next_hops[NET_MAX_ADDRESS + 1] = { 0 };
+// The cost of our own link to each network address, packed two to a byte, as sent out in our link state packets.
+static uint8_t own_link_costs[PACKED_LINK_COSTS_SIZE] = { 0 };
+
+#ifndef NET_STUB_ROUTING
+// List of the neighbours which are next hops on an equal-cost shortest path to each destination node - each bit
+// corresponds to a neighbour's network address. Indexed by the destination node's network address.
+static uint16_t next_hop_sets[NET_MAX_ADDRESS + 1] = { 0 };
+
+// List of loop-free alternate next hops, used if delivery to every next hop in 'next_hop_sets' starts failing. Indexed
+// by the destination node's network address.
+static dll_address alternate_next_hops[NET_MAX_ADDRESS + 1] = { 0 };
+#else
+// The logical address of the next hop to each destination, packed like link costs, as sent by a neighbour. Our own
+// address means that the destination can't be reached. Until a forwarding table arrives, every destination is sent to
+// any neighbour.
+static uint8_t forwarding_table[PACKED_LINK_COSTS_SIZE] = { 0 };
+static bool is_forwarding_table_valid = false;
+#endif
+
+#ifdef NET_AREA_ROUTING
+_Static_assert(NET_AREA_COUNT >= 1 && NET_AREA_COUNT <= 8, "Areas must fit in an 8-bit area bitmap");
+
+// A stub router only keeps track of the area summary sequence numbers, so that it can recognise the summaries it has
+// already flooded.
+typedef struct {
+    net_address source; // The address of the border node that sent out this summary
+    uint8_t sequence_number; // The sequence number of the packet that carried this summary
+    uint16_t seconds_to_live; // The number of seconds left before this summary is invalid, and the entry is free
+#ifndef NET_STUB_ROUTING
+    uint8_t direct_areas; // The areas that the node holds the link states of - each bit corresponds to an area
+    uint8_t costs[NET_AREA_COUNT]; // The cost of reaching each area from the node, indexed by the area
+#endif
+} net_area_summary;
+
+// List of the area summaries sent out by the border nodes of the areas that we hold. A border node may be in an area
+// that we don't hold, so the summaries are kept in any free entry rather than by area.
+static net_area_summary area_summaries[NET_MAX_AREA_SUMMARIES] = { 0 };
+
+#ifndef NET_STUB_ROUTING
+// Our own area summary, as last sent out, and its sequence number. It's only sent out while we're on the border between
+// areas, and once more when we stop being on it, so that the other nodes stop routing through us.
+static uint8_t own_area_summary_sequence_number = 0;
+static uint8_t own_area_summary_direct_areas = 0;
+static uint8_t own_area_summary_costs[NET_AREA_COUNT] = { 0 };
+
+// Flag to signal whether our area summary should be sent out.
+static bool is_area_summary_due = false;
+
+// The sources whose area summaries should be sent out again, for a new neighbour - each bit corresponds to a network
+// address.
+static uint16_t requested_area_summaries = 0;
+#endif
+#endif
 
 // Flag to signal whether the network graph has changed and the routes should be recalculated.
 static bool is_graph_changed = false;
 
+// Flag to signal whether this node's own links have changed and a link state update should be sent out.
+static bool is_own_link_state_changed = false;
+
+// Flag to signal whether only the cost of this node's own links has changed and a link state update should be sent out.
+static bool is_own_link_cost_changed = false;
+
+// The number of seconds left before a change in the cost of our own links can be sent out.
+static uint8_t link_cost_update_seconds_left = 0;
+
+// The current hold time for sending out our own link state, and the time at which it ends.
+static int32_t link_state_hold_milliseconds = LINK_STATE_HOLD_MIN_MILLISECONDS;
+static time link_state_hold_end;
+
+// Flag to signal whether our link state packet should be refreshed once the hold time ends.
+static bool is_link_state_refresh_due = false;
+
+// Timers for sending ping requests and refreshing our link state packet.
+static net_trickle_timer ping_timer;
+static net_trickle_timer link_state_timer;
+
+// Flag to signal whether the next ping request should ask neighbours to respond. This is only needed after our links
+// have changed, as in a stable network the ping requests themselves keep the links alive.
+static bool is_ping_response_requested = true;
+
+// List of ping responses waiting to be sent.
+static net_pending_ping_response pending_ping_responses[PENDING_PING_RESPONSE_COUNT] = { 0 };
+
+// The number of ping requests left to send in the burst sent when the node starts, and when to send the next one.
+static uint8_t boot_pings_left = 0;
+static time next_boot_ping_time;
+
+// The sources whose link states have been requested by neighbours and are still to be sent out - each bit corresponds
+// to a network address.
+static uint16_t requested_link_states = 0;
+
+#ifndef NET_STUB_ROUTING
+// Flag to signal whether the topology has changed since the last snapshot was saved, and the number of seconds left
+// before the next snapshot can be saved.
+static bool is_snapshot_due = false;
+static uint16_t snapshot_seconds_left = 0;
+
+// The topology that the last snapshot was taken from: the neighbours with live links, and the nodes linked to each node
+// that we hold a link state for - each bit corresponds to a network address.
+static uint16_t snapshot_neighbours = 0;
+static uint16_t snapshot_linked_nodes[NET_MAX_ADDRESS + 1];
+
+static bool update_snapshot_topology();
+static void restore_snapshot();
+#endif
+static void update_own_link_cost(net_address address);
+
+static int32_t random_milliseconds(int32_t max_milliseconds) {
+    // Scale a random byte to the range [0, max_milliseconds):
+    return (max_milliseconds * (rand() & 0xFF)) >> 8;
+}
+
+static uint8_t get_packed_link_cost(const uint8_t packed_link_costs[], net_address node) {
+    // Even addresses are stored in the low nibble and odd addresses in the high nibble:
+    return (packed_link_costs[node >> 1] >> ((node & 1) * 4)) & 0x0F;
+}
+
+static void set_packed_link_cost(uint8_t packed_link_costs[], net_address node, uint8_t cost) {
+    uint8_t shift = (node & 1) * 4;
+    packed_link_costs[node >> 1] = (packed_link_costs[node >> 1] & ~(0x0F << shift)) | ((cost & 0x0F) << shift);
+}
+
+#ifdef NET_AREA_ROUTING
+uint8_t net_get_area(net_address address) {
+    return address >> NET_AREA_NODE_BITS;
+}
+
+static uint8_t get_held_areas(net_address node) {
+    // A node holds the link states of its own area, and of every area that it has a link into:
+    uint8_t held_areas = 1 << net_get_area(node);
+    for (net_address linked_node = 0; linked_node <= NET_MAX_ADDRESS; linked_node++) {
+        if (net_are_nodes_linked(node, linked_node)) {
+            held_areas |= 1 << net_get_area(linked_node);
+        }
+    }
+    return held_areas;
+}
+
+static bool is_address_in_held_area(net_address address) {
+    return get_held_areas(net_get_own_address()) & (1 << net_get_area(address));
+}
+
+static net_link_state_packet *get_link_state(net_address node) {
+    uint8_t area = net_get_area(node);
+    for (uint8_t slot = 0; slot < NET_MAX_HELD_AREAS; slot++) {
+        if (link_state_slot_areas[slot] == area) {
+            return &link_state_packets[slot * LINK_STATE_SLOT_SIZE + (node & (LINK_STATE_SLOT_SIZE - 1))];
+        }
+    }
+
+    // The area has no slot. Anything written to the stand-in is thrown away the next time it's returned:
+    memset(&unheld_link_state, 0, sizeof(unheld_link_state));
+    return &unheld_link_state;
+}
+
+static net_link_state_packet *hold_link_state(net_address node) {
+    // Give the node's area a slot if it doesn't have one yet, as long as we hold the area and there's a free slot:
+    net_link_state_packet *link_state = get_link_state(node);
+    if (link_state != &unheld_link_state) {
+        return link_state;
+    }
+    if (is_address_in_held_area(node) == false) {
+        return NULL;
+    }
+    for (uint8_t slot = 0; slot < NET_MAX_HELD_AREAS; slot++) {
+        if (link_state_slot_areas[slot] == NO_AREA) {
+            link_state_slot_areas[slot] = net_get_area(node);
+            for (uint8_t index = 0; index < LINK_STATE_SLOT_SIZE; index++) {
+                link_state_packets[slot * LINK_STATE_SLOT_SIZE + index].seconds_to_live = 0;
+                link_state_packets[slot * LINK_STATE_SLOT_SIZE + index].is_provisional = false;
+            }
+            return get_link_state(node);
+        }
+    }
+    return NULL;
+}
+
+static net_area_summary *find_area_summary(net_address source) {
+    for (uint8_t index = 0; index < NET_MAX_AREA_SUMMARIES; index++) {
+        if (area_summaries[index].seconds_to_live > 0 && area_summaries[index].source == source) {
+            return &area_summaries[index];
+        }
+    }
+    return NULL;
+}
+#else
+static bool is_address_in_held_area(net_address address) {
+    // Without areas, every link state is held:
+    return true;
+}
+
+static net_link_state_packet *get_link_state(net_address node) {
+    return &link_state_packets[node];
+}
+
+static net_link_state_packet *hold_link_state(net_address node) {
+    return &link_state_packets[node];
+}
+#endif
+
+static void update_delivery_ratio(uint8_t *ratio, bool is_success) {
+    // Move the average a fraction of the way towards the new sample:
+    *ratio = *ratio - (*ratio >> DELIVERY_RATIO_SHIFT) + (is_success ? (DELIVERY_RATIO_MAX >> DELIVERY_RATIO_SHIFT) : 0);
+}
+
+static uint8_t calculate_link_cost(const net_neighbour_link *link) {
+    // A frame is only acknowledged if both the frame and its ACK get through, so the acknowledged ratio measures the
+    // link in both directions. Before any packets have been sent over the link, the ping requests give an estimate of
+    // the same thing, assuming the link is as good in both directions as it is towards us. Use the worse of the two:
+    uint8_t ping_round_trip_ratio = ((uint16_t) link->ping_received_ratio * link->ping_received_ratio) >> 8;
+    uint8_t delivery_ratio = link->acknowledged_ratio;
+    if (ping_round_trip_ratio < delivery_ratio) {
+        delivery_ratio = ping_round_trip_ratio;
+    }
+
+    // The expected transmission count is the inverse of the delivery ratio. Convert it to half transmissions, rounding
+    // to the nearest, and keep it within the range of costs:
+    if (delivery_ratio == 0) {
+        return NET_LINK_COST_MAX;
+    }
+    uint16_t cost = (2 * DELIVERY_RATIO_MAX + delivery_ratio / 2) / delivery_ratio;
+    if (cost > NET_LINK_COST_MAX) {
+        return NET_LINK_COST_MAX;
+    }
+    if (cost < NET_LINK_COST_MIN) {
+        return NET_LINK_COST_MIN;
+    }
+    return cost;
+}
+
+static void trickle_start_interval(net_trickle_timer *timer, time start, int32_t interval_milliseconds) {
+    // Pick a random time to send the message in the second half of the interval:
+    int32_t half_interval = interval_milliseconds / 2;
+    timer->interval_milliseconds = interval_milliseconds;
+    timer->interval_end = time_add_milliseconds(start, interval_milliseconds);
+    timer->fire_time = time_add_milliseconds(start, half_interval + random_milliseconds(half_interval));
+    timer->is_fired = false;
+}
+
+static void trickle_reset(net_trickle_timer *timer, int32_t min_interval_milliseconds) {
+    // If the timer is already at its minimum interval and is yet to fire, there's no need to restart it:
+    if (timer->interval_milliseconds == min_interval_milliseconds && timer->is_fired == false) {
+        return;
+    }
+    trickle_start_interval(timer, time_now(), min_interval_milliseconds);
+}
+
+static bool trickle_update(net_trickle_timer *timer, int32_t max_interval_milliseconds) {
+    time now = time_now();
+
+    // Check if it's time to send the message:
+    bool is_fire_time = false;
+    if (timer->is_fired == false && time_delta_milliseconds(timer->fire_time, now) >= 0) {
+        timer->is_fired = true;
+        is_fire_time = true;
+    }
+
+    // If the interval has elapsed, start a new one with double the length:
+    if (time_delta_milliseconds(timer->interval_end, now) >= 0) {
+        int32_t interval_milliseconds = timer->interval_milliseconds * 2;
+        if (interval_milliseconds > max_interval_milliseconds) {
+            interval_milliseconds = max_interval_milliseconds;
+        }
+        trickle_start_interval(timer, timer->interval_end, interval_milliseconds);
+    }
+
+    return is_fire_time;
+}
+
 void net_initialise_routing() {
-    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
-        // Invalidate all link state packets:
-        link_state_packets[node].seconds_to_live = 0;
+    // Invalidate all link state packets:
+    for (uint8_t index = 0; index < sizeof(link_state_packets) / sizeof(link_state_packets[0]); index++) {
+        link_state_packets[index].seconds_to_live = 0;
+        link_state_packets[index].is_provisional = false;
+#ifndef NET_STUB_ROUTING
+        link_state_packets[index].is_base_missing = false;
+#endif
+    }
+#ifdef NET_AREA_ROUTING
+    memset(link_state_slot_areas, NO_AREA, sizeof(link_state_slot_areas));
+#endif
 
-        // Invalidate all neighbouring links:
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        // Invalidate all neighbouring links, and assume they're perfect until measured otherwise:
         neighbour_links[node].seconds_to_live = 0;
+        neighbour_links[node].acknowledged_ratio = DELIVERY_RATIO_MAX;
+        neighbour_links[node].ping_received_ratio = DELIVERY_RATIO_MAX;
+        neighbour_links[node].is_database_summary_due = false;
+        neighbour_links[node].missing_link_states = 0;
+        neighbour_links[node].is_provisional = false;
+        neighbour_links[node].flap_penalty = 0;
+        neighbour_links[node].is_suppressed = false;
+        neighbour_links[node].is_stub = false;
+        neighbour_links[node].is_compact_header_supported = false;
 
+#ifndef NET_STUB_ROUTING
         // Set all routes to unresolved:
-        next_hops[node] = NET_NEXT_HOP_NOT_RESOLVED;
+        next_hop_sets[node] = 0;
+        alternate_next_hops[node] = NET_NEXT_HOP_NOT_RESOLVED;
+#endif
     }
+#ifdef NET_STUB_ROUTING
+    is_forwarding_table_valid = false;
+#endif
+#ifdef NET_AREA_ROUTING
+    for (uint8_t index = 0; index < NET_MAX_AREA_SUMMARIES; index++) {
+        area_summaries[index].seconds_to_live = 0;
+    }
+#ifndef NET_STUB_ROUTING
+    own_area_summary_direct_areas = 0;
+    is_area_summary_due = false;
+    requested_area_summaries = 0;
+#endif
+#endif
 
     // Remove all connections from our link state packet:
-    link_state_packets[net_get_own_address()].connected_addresses = 0;
+    memset(own_link_costs, 0, PACKED_LINK_COSTS_SIZE);
+    is_own_link_cost_changed = false;
+
+    // Seed the random number generator with our address, so that neighbours pick different random delays:
+    srand(net_get_own_address());
+
+    // Start pinging and sending link state packets at the minimum intervals:
+    time now = time_now();
+    trickle_start_interval(&ping_timer, now, PING_INTERVAL_MIN_MILLISECONDS);
+    trickle_start_interval(&link_state_timer, now, LINK_STATE_INTERVAL_MIN_MILLISECONDS);
+    link_state_hold_milliseconds = LINK_STATE_HOLD_MIN_MILLISECONDS;
+    link_state_hold_end = now;
+    is_link_state_refresh_due = false;
+    is_ping_response_requested = true;
+    for (uint8_t response_index = 0; response_index < PENDING_PING_RESPONSE_COUNT; response_index++) {
+        pending_ping_responses[response_index].is_pending = false;
+    }
+
+    // Look for neighbours straight away:
+    boot_pings_left = BOOT_PING_COUNT;
+    next_boot_ping_time = now;
+    requested_link_states = 0;
+
+#ifndef NET_STUB_ROUTING
+    // Pick up where we left off before restarting, but don't save a snapshot until the network has had time to settle:
+    is_snapshot_due = false;
+    snapshot_seconds_left = SNAPSHOT_SETTLE_SECONDS;
+    snapshot_neighbours = 0;
+    memset(snapshot_linked_nodes, 0, sizeof(snapshot_linked_nodes));
+    restore_snapshot();
+#endif
 }
 
-static void recalculate_routes() {
-    // Run Dijkstra's Algorithm to find the shortest path to all nodes in the network graph...
+static net_neighbour_link *find_neighbour_link(dll_address physical_address) {
+    // Search through the neighbouring links for a live link with the given physical address:
+    for (net_address logical_address = 0; logical_address <= NET_MAX_ADDRESS; logical_address++) {
+        net_neighbour_link *link = &neighbour_links[logical_address];
+        if (link->physical_address == physical_address && link->seconds_to_live > 0) {
+            return link;
+        }
+    }
+    return NULL;
+}
 
-    typedef struct {
-        uint8_t hop_count; // The number of hops between us and the destination node.
-        net_address previous_node; // The previous node before the destination node.
-        bool is_explored;
-    } net_route;
+#ifndef NET_STUB_ROUTING
+typedef struct {
+    uint8_t distance; // The total cost of the links between the root node and the destination node.
+    uint16_t first_hops; // The root node's neighbours which start an equal-cost shortest path to the destination node - each bit corresponds to a network address.
+    bool is_explored;
+} net_route;
 
-    net_route node_routes[NET_MAX_ADDRESS + 1];
-    const uint8_t hop_count_infinity = 255;
+#define DISTANCE_INFINITY (255)
+
+static bool is_stub_neighbour(net_address node) {
+    return neighbour_links[node].seconds_to_live > 0 && neighbour_links[node].is_stub;
+}
+
+static void find_shortest_paths(net_address root_node, net_route node_routes[]) {
+    // Run Dijkstra's Algorithm to find the shortest path from the root node to all nodes in the network graph...
 
     // Initialise all the routes:
     for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
         // Set the distance to infinity:
-        node_routes[node].hop_count = hop_count_infinity;
+        node_routes[node].distance = DISTANCE_INFINITY;
 
-        // Set the previous node to itself to signify that it hasn't been explored yet:
-        // node_routes[node].previous_node = node;
+        node_routes[node].first_hops = 0;
         node_routes[node].is_explored = false;
     }
-    node_routes[net_get_own_address()].hop_count = 0;
+    node_routes[root_node].distance = 0;
 
-    // Start with our own node:
-    net_address current_node = net_get_own_address();
-    uint8_t current_hop_count = 0;
+    // Start with the root node:
+    net_address current_node = root_node;
+    uint8_t current_distance = 0;
 
     do {
-        // For all the current node's connected nodes, update their shortest path:
+        // For all the current node's connected nodes, update their shortest path. Our stub neighbours don't pass on
+        // packets for other nodes, so paths can end at them but not go through them:
         node_routes[current_node].is_explored = true;
-        for (net_address connected_node = 0; connected_node <= NET_MAX_ADDRESS; connected_node++) {
+        bool is_transit = current_node == root_node || is_stub_neighbour(current_node) == false;
+        for (net_address connected_node = 0; is_transit && connected_node <= NET_MAX_ADDRESS; connected_node++) {
             // Check that that node is connected:
-            if (net_are_nodes_linked(current_node, connected_node)) {
-                // If this path is shorter than the node's current shortest path:
-                if (current_hop_count + 1 < node_routes[connected_node].hop_count) {
-                    // Update the shortest path:
-                    node_routes[connected_node].hop_count = current_hop_count + 1;
-                    node_routes[connected_node].previous_node = current_node;
+            uint8_t link_cost = net_get_link_cost(current_node, connected_node);
+            if (link_cost != 0) {
+                // Paths through the current node start with the same first hops as the current node's paths (or with
+                // the connected node itself, if the current node is the root):
+                uint16_t first_hops = (current_node == root_node) ? ((uint16_t) 1 << connected_node) : node_routes[current_node].first_hops;
+
+                if (current_distance + link_cost < node_routes[connected_node].distance) {
+                    // This path is shorter than the node's current shortest paths, so replace them:
+                    node_routes[connected_node].distance = current_distance + link_cost;
+                    node_routes[connected_node].first_hops = first_hops;
+                } else if (current_distance + link_cost == node_routes[connected_node].distance) {
+                    // This path is as short as the node's current shortest paths, so add its first hops to them:
+                    node_routes[connected_node].first_hops |= first_hops;
                 }
             }
         }
 
-        // Find the unexplored node with the smallest hop count to explore in the next iteration:
-        current_hop_count = hop_count_infinity;
+        // Find the unexplored node with the smallest distance to explore in the next iteration:
+        current_distance = DISTANCE_INFINITY;
         for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
             // Check that the node hasn't already been explored:
-            // if (node_routes[node].previous_node == node) {
             if (node_routes[node].is_explored == false) {
-                // Check if the hop count of this node is shorter:
-                if (node_routes[node].hop_count < current_hop_count) {
+                // Check if the distance to this node is shorter:
+                if (node_routes[node].distance < current_distance) {
                     // Keep track of the current shortest distance and the corresponding node:
-                    current_hop_count = node_routes[node].hop_count;
+                    current_distance = node_routes[node].distance;
                     current_node = node;
                 }
             }
         }
     }
     // Stop when all nodes have been explored:
-    while (current_hop_count != hop_count_infinity);
+    while (current_distance != DISTANCE_INFINITY);
+}
+
+static void recalculate_alternate_next_hops(const net_route node_routes[]) {
+    // Find a loop-free alternate (RFC 5286) for every destination: a neighbour, other than the next hop, whose own
+    // shortest path to the destination doesn't lead back through this node...
 
-    // Get the next hop for every destination address:
     net_address own_address = net_get_own_address();
-    for (net_address destination = 0; destination < NET_MAX_ADDRESS; destination++) {
-        // Check whether the destination node was explored and is not our own address:
-        if (destination != own_address && node_routes[destination].is_explored == true) {
-            net_address source = own_address;
-            net_address current_node = destination;
+    uint8_t alternate_distances[NET_MAX_ADDRESS + 1];
+    for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+        alternate_next_hops[destination] = NET_NEXT_HOP_NOT_RESOLVED;
+        alternate_distances[destination] = DISTANCE_INFINITY;
+    }
+
+    for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+        // Only consider live links to neighbours which pass on packets for other nodes:
+        if (neighbour == own_address || neighbour_links[neighbour].seconds_to_live == 0 || is_stub_neighbour(neighbour)
+            || net_are_nodes_linked(own_address, neighbour) == false) {
+            continue;
+        }
+
+        // Find the neighbour's shortest paths:
+        net_route neighbour_routes[NET_MAX_ADDRESS + 1];
+        find_shortest_paths(neighbour, neighbour_routes);
+        uint16_t neighbour_to_source = neighbour_routes[own_address].distance;
+        uint16_t source_to_neighbour = net_get_link_cost(own_address, neighbour);
+        dll_address physical_address = neighbour_links[neighbour].physical_address;
 
-            // Back-track from the destination node until we're one hop away from the source node:
-            while (node_routes[current_node].previous_node != source) {
-                current_node = node_routes[current_node].previous_node;
+        for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+            // Skip unreachable destinations and ones where this neighbour is already the next hop:
+            if (destination == own_address || node_routes[destination].is_explored == false
+                || neighbour_routes[destination].is_explored == false || (next_hop_sets[destination] & ((uint16_t) 1 << neighbour))
+                || is_address_in_held_area(destination) == false) {
+                continue;
             }
 
-            // Store the next hop:
-            dll_address next_hop = neighbour_links[current_node].physical_address;
-            next_hops[destination] = next_hop;
-        } else {
-            // The desination node was not explored so a route to it could not be resolved:
-            next_hops[destination] = NET_NEXT_HOP_NOT_RESOLVED;
+            // Check the loop-free condition, and keep the shortest alternate:
+            uint16_t neighbour_to_destination = neighbour_routes[destination].distance;
+            if (neighbour_to_destination < neighbour_to_source + node_routes[destination].distance
+                && source_to_neighbour + neighbour_to_destination < alternate_distances[destination]) {
+                alternate_distances[destination] = source_to_neighbour + neighbour_to_destination;
+                alternate_next_hops[destination] = physical_address;
+            }
         }
     }
 }
 
-void net_update_routing() {
-    static time last_time = TIME_ZERO;
-    uint8_t seconds_elapsed = time_delta_seconds(last_time, time_now());
-    last_time = time_add_seconds(last_time, seconds_elapsed);
-
-    // Check timeouts:
-    for (net_address address = 0; address <= NET_MAX_ADDRESS; address++) {
-        // Check if the address' link state packet has timed out:
-        if (link_state_packets[address].seconds_to_live > seconds_elapsed) {
-            // Decrement seconds to live:
-            link_state_packets[address].seconds_to_live -= seconds_elapsed;
-        } else if (link_state_packets[address].seconds_to_live > 0) {
-            // Link state packet has timed out:
-            link_state_packets[address].seconds_to_live = 0;
-
-            // Mark the network graph as changed:
-            is_graph_changed = true;
+#ifdef NET_AREA_ROUTING
+static uint8_t find_area_route(const net_route node_routes[], uint8_t held_areas, uint8_t area, uint16_t *first_hops) {
+    // Route towards the border node with the cheapest path into the area, going by the border nodes' summaries. Within
+    // the backbone, only costs which the border nodes worked out from link states are used, so that a route passed on
+    // between areas can't lead back into the area it came from:
+    bool is_backbone_held = held_areas & (1 << NET_BACKBONE_AREA);
+    uint16_t best_cost = NET_AREA_COST_UNREACHABLE;
+    *first_hops = 0;
+    for (uint8_t index = 0; index < NET_MAX_AREA_SUMMARIES; index++) {
+        net_area_summary *summary = &area_summaries[index];
+        net_address border = summary->source;
+        if (summary->seconds_to_live == 0 || node_routes[border].is_explored == false
+            || summary->costs[area] == NET_AREA_COST_UNREACHABLE
+            || (is_backbone_held && (summary->direct_areas & (1 << area)) == 0)) {
+            continue;
         }
 
-        // Check if the link to the address has timed out:
-        if (neighbour_links[address].seconds_to_live > seconds_elapsed) {
-            // Decrement seconds to live:
-            neighbour_links[address].seconds_to_live -= seconds_elapsed;
-        } else if (neighbour_links[address].seconds_to_live > 0) {
-            // The link has timed out:
-            neighbour_links[address].seconds_to_live = 0;
-
-            // Remove the link from the connected addresses:
-            link_state_packets[net_get_own_address()].connected_addresses &= ~((uint16_t) 1 << address);
+        uint16_t cost = node_routes[border].distance + summary->costs[area];
+        uint16_t border_first_hops = node_routes[border].first_hops;
+        if (cost < best_cost) {
+            best_cost = cost;
+            *first_hops = border_first_hops;
+        } else if (cost == best_cost) {
+            *first_hops |= border_first_hops;
+        }
+    }
+    return (best_cost >= NET_AREA_COST_UNREACHABLE) ? NET_AREA_COST_UNREACHABLE : best_cost;
+}
 
-            // Mark the network graph as changed:
-            is_graph_changed = true;
+static void drop_unheld_link_states() {
+    // Drop the link states and area summaries of areas that we've lost our last link into:
+    uint8_t held_areas = get_held_areas(net_get_own_address());
+    for (uint8_t slot = 0; slot < NET_MAX_HELD_AREAS; slot++) {
+        if (link_state_slot_areas[slot] != NO_AREA && (held_areas & (1 << link_state_slot_areas[slot])) == 0) {
+            link_state_slot_areas[slot] = NO_AREA;
+        }
+    }
+    for (uint8_t index = 0; index < NET_MAX_AREA_SUMMARIES; index++) {
+        if ((area_summaries[index].direct_areas & held_areas) == 0) {
+            area_summaries[index].seconds_to_live = 0;
         }
     }
+}
+
+static void recalculate_area_routes(const net_route node_routes[]) {
+    // Destinations in the areas that we hold are routed on their link states, so only the other areas are left:
+    net_address own_address = net_get_own_address();
+    uint8_t held_areas = get_held_areas(own_address);
+    uint8_t costs[NET_AREA_COUNT];
+    for (uint8_t area = 0; area < NET_AREA_COUNT; area++) {
+        if (held_areas & (1 << area)) {
+            // The cost of reaching an area that we hold is the distance to its furthest reachable node:
+            costs[area] = 0;
+            for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+                if (net_get_area(node) == area && node_routes[node].is_explored && node_routes[node].distance > costs[area]) {
+                    costs[area] = node_routes[node].distance;
+                }
+            }
+            continue;
+        }
 
-    // Every 10 seconds:
-    static uint8_t seconds_counter = 0;
-    seconds_counter += seconds_elapsed;
-    if (seconds_counter >= 10) {
-        seconds_counter -= 10;
+        // Every destination in another area shares the same route:
+        uint16_t first_hops;
+        costs[area] = find_area_route(node_routes, held_areas, area, &first_hops);
+        for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+            if (net_get_area(destination) == area) {
+                next_hop_sets[destination] = first_hops;
+            }
+        }
 
-        // If the network graph has changed, update the routes:
-        if (is_graph_changed == true) {
-            // is_graph_changed = false;
-            recalculate_routes();
+        // Routes learned from other border nodes' summaries are only passed on by border nodes in the backbone:
+        if ((held_areas & (1 << NET_BACKBONE_AREA)) == 0) {
+            costs[area] = NET_AREA_COST_UNREACHABLE;
         }
+    }
 
-        // Send out a ping request packet and a link state packet to all neighbouring nodes:
-        net_send_ping_request_packet(DLL_BROADCAST_ADDRESS);
-        net_send_link_state_packet();
+    // Send out our summary if it has changed while we're on the border between areas (held areas with more than one bit
+    // set), or if we've just stopped being on the border:
+    bool is_border = (held_areas & (held_areas - 1)) != 0;
+    bool was_border = (own_area_summary_direct_areas & (own_area_summary_direct_areas - 1)) != 0;
+    if ((is_border || was_border)
+        && (held_areas != own_area_summary_direct_areas || memcmp(costs, own_area_summary_costs, NET_AREA_COUNT) != 0)) {
+        own_area_summary_direct_areas = held_areas;
+        memcpy(own_area_summary_costs, costs, NET_AREA_COUNT);
+        is_area_summary_due = true;
     }
 }
 
-bool net_are_nodes_linked(net_address node_1, net_address node_2) {
-    // Make sure the addresses are within limits:
-    if (node_1 > NET_MAX_ADDRESS || node_2 > NET_MAX_ADDRESS) {
-        return false;
+static bool is_own_area_summary_border() {
+    return (own_area_summary_direct_areas & (own_area_summary_direct_areas - 1)) != 0;
+}
+#endif
+
+static void recalculate_routes() {
+    net_route node_routes[NET_MAX_ADDRESS + 1];
+    net_address own_address = net_get_own_address();
+#ifdef NET_AREA_ROUTING
+    drop_unheld_link_states();
+#endif
+    find_shortest_paths(own_address, node_routes);
+
+    // Get the set of next hops for every destination address:
+    for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+        // Check whether the destination node was explored and is not our own address:
+        if (destination != own_address && node_routes[destination].is_explored == true) {
+            next_hop_sets[destination] = node_routes[destination].first_hops;
+        } else {
+            // The desination node was not explored so a route to it could not be resolved:
+            next_hop_sets[destination] = 0;
+        }
     }
 
-    // Check if the link state has timed out (our own link state packet never times out):
-    if (link_state_packets[node_1].seconds_to_live == 0 && node_1 != net_get_own_address()) {
-        return false;
+#ifdef NET_AREA_ROUTING
+    recalculate_area_routes(node_routes);
+#endif
+    recalculate_alternate_next_hops(node_routes);
+
+    // The routes of our stub neighbours may have changed too:
+    for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+        if (neighbour_links[neighbour].is_stub) {
+            neighbour_links[neighbour].is_forwarding_table_due = true;
+        }
     }
 
-    // Read the relevant bit to check if the nodes are linked:
-    return link_state_packets[node_1].connected_addresses & (1 << node_2);
+    // Save the new routing state if the topology has changed:
+    if (update_snapshot_topology()) {
+        is_snapshot_due = true;
+    }
 }
 
-bool net_is_device_online(net_address address) {
-    // Make sure the address is within limits:
-    if (address > NET_MAX_ADDRESS) {
+static bool calculate_stub_forwarding_table(net_address stub, uint8_t packed_next_hops[]) {
+    // The stub router's routes can't be worked out until we hold its link state:
+    if (net_are_nodes_linked(stub, net_get_own_address()) == false) {
         return false;
     }
 
-    // Our own address is always online:
-    if (address == net_get_own_address()) {
-        return true;
+    // Find the stub router's shortest paths as it would, taking the first of any equal-cost next hops:
+    net_route stub_routes[NET_MAX_ADDRESS + 1];
+    find_shortest_paths(stub, stub_routes);
+#ifdef NET_AREA_ROUTING
+    uint8_t stub_held_areas = get_held_areas(stub);
+#endif
+    for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+        uint16_t first_hops = 0;
+        if (destination != stub && stub_routes[destination].is_explored) {
+            first_hops = stub_routes[destination].first_hops;
+        }
+#ifdef NET_AREA_ROUTING
+        // Destinations in areas that the stub router doesn't hold are routed through the border nodes, as we would:
+        if ((stub_held_areas & (1 << net_get_area(destination))) == 0) {
+            find_area_route(stub_routes, stub_held_areas, net_get_area(destination), &first_hops);
+        }
+#endif
+        net_address next_hop = stub;
+        for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+            if (first_hops & ((uint16_t) 1 << neighbour)) {
+                next_hop = neighbour;
+                break;
+            }
+        }
+        set_packed_link_cost(packed_next_hops, destination, next_hop);
     }
-
-    // If the link state packet for the given node hasn't timed out, assume the node is online:
-    bool is_online = link_state_packets[address].seconds_to_live > 0;
-    return is_online;
+    return true;
 }
 
-bool net_notify_link_state_packet(net_address source, uint8_t sequence_number, const net_address *node_list, uint8_t node_count) {
-    // Make sure the address is within limits and isn't our own address:
-    if (source > NET_MAX_ADDRESS || source == net_get_own_address()) {
-        return false;
+static uint16_t get_linked_nodes(const uint8_t packed_link_costs[]) {
+    uint16_t linked_nodes = 0;
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        if (get_packed_link_cost(packed_link_costs, node) != 0) {
+            linked_nodes |= ((uint16_t) 1 << node);
+        }
     }
+    return linked_nodes;
+}
 
-    // Check that the sequence number is valid:
-    if (link_state_packets[source].seconds_to_live != 0) {
-        uint8_t previous_sequence_number = link_state_packets[source].sequence_number;
-        uint8_t sequence_number_difference = sequence_number - previous_sequence_number;
-        if (sequence_number_difference == 0 || sequence_number_difference > 128) {
-            return false;
+static bool update_snapshot_topology() {
+    // Compare the live links and the links in every valid link state (including restored ones) with the topology of the
+    // last snapshot, ignoring their costs:
+    net_address own_address = net_get_own_address();
+    uint16_t neighbours = 0;
+    bool is_changed = false;
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        if (neighbour_links[node].seconds_to_live > 0) {
+            neighbours |= ((uint16_t) 1 << node);
+        }
+        uint16_t linked_nodes = 0;
+        if (node == own_address) {
+            linked_nodes = get_linked_nodes(own_link_costs);
+        } else if (get_link_state(node)->seconds_to_live > 0) {
+            linked_nodes = get_linked_nodes(get_link_state(node)->link_costs);
+        }
+        if (linked_nodes != snapshot_linked_nodes[node]) {
+            snapshot_linked_nodes[node] = linked_nodes;
+            is_changed = true;
         }
     }
+    if (neighbours != snapshot_neighbours) {
+        snapshot_neighbours = neighbours;
+        is_changed = true;
+    }
+    return is_changed;
+}
 
-    // Reset the seconds to live and update the sequence number:
-    link_state_packets[source].seconds_to_live = LINK_STATE_SECONDS_TO_LIVE_START;
-    link_state_packets[source].sequence_number = sequence_number;
-
-    // Set the bits for all the connected addresses:
-    uint16_t connected_addresses = 0;
-    for (uint8_t node_index = 0; node_index < node_count; node_index++) {
-        net_address address = node_list[node_index];
-        if (address <= NET_MAX_ADDRESS) {
-            connected_addresses |= ((uint16_t) 1 << address);
+static void save_snapshot() {
+    net_routing_snapshot snapshot = { 0 };
+    net_address own_address = net_get_own_address();
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        // Only save confirmed links and link states:
+        net_neighbour_link *link = &neighbour_links[node];
+        if (link->seconds_to_live > 0 && link->is_provisional == false) {
+            snapshot.neighbours |= ((uint16_t) 1 << node);
+            snapshot.neighbour_physical_addresses[node] = link->physical_address;
+        }
+        net_link_state_packet *link_state = get_link_state(node);
+        if (node == own_address) {
+            snapshot.link_states |= ((uint16_t) 1 << node);
+            memcpy(snapshot.link_costs[node], own_link_costs, PACKED_LINK_COSTS_SIZE);
+        } else if (link_state->seconds_to_live > 0 && link_state->is_provisional == false) {
+            snapshot.link_states |= ((uint16_t) 1 << node);
+            memcpy(snapshot.link_costs[node], link_state->link_costs, PACKED_LINK_COSTS_SIZE);
         }
     }
 
-    // Check if the connected addresses have changed:
-    if (connected_addresses != link_state_packets[source].connected_addresses) {
-        // Store the connected addresses:
-        link_state_packets[source].connected_addresses = connected_addresses;
+    // If the last snapshot is still being written, try again on the next update:
+    if (net_persist_save(&snapshot, sizeof(snapshot))) {
+        is_snapshot_due = false;
+        snapshot_seconds_left = SNAPSHOT_INTERVAL_SECONDS;
+    }
+}
 
-        // Mark the network graph as changed:
-        is_graph_changed = true;
+static void restore_snapshot() {
+    net_routing_snapshot snapshot;
+    if (net_persist_load(&snapshot, sizeof(snapshot)) == false) {
+        return;
     }
 
-    // The packet was valid:
-    return true;
-}
+    // Restore the links and link states as provisional:
+    net_address own_address = net_get_own_address();
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        if (node == own_address) {
+            continue;
+        }
+        if (snapshot.neighbours & ((uint16_t) 1 << node)) {
+            neighbour_links[node].physical_address = snapshot.neighbour_physical_addresses[node];
+            neighbour_links[node].seconds_to_live = RESTORED_NEIGHBOUR_LINK_SECONDS_TO_LIVE;
+            neighbour_links[node].is_provisional = true;
+            set_packed_link_cost(own_link_costs, node, get_packed_link_cost(snapshot.link_costs[own_address], node));
+        }
+    }
 
-dll_address net_get_next_hop(net_address destination) {
-    if (destination > NET_MAX_ADDRESS) {
-        return NET_NEXT_HOP_NOT_RESOLVED;
+    // The link states are restored once our own links are, which decide the areas that we hold:
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        net_link_state_packet *link_state = hold_link_state(node);
+        if (node == own_address || link_state == NULL || (snapshot.link_states & ((uint16_t) 1 << node)) == 0) {
+            continue;
+        }
+        memcpy(link_state->link_costs, snapshot.link_costs[node], PACKED_LINK_COSTS_SIZE);
+        link_state->seconds_to_live = RESTORED_LINK_STATE_SECONDS_TO_LIVE;
+        link_state->is_provisional = true;
     }
-    return next_hops[destination];
+
+    // The restored state is the topology of the snapshot, so there's nothing new to save yet:
+    update_snapshot_topology();
+    recalculate_routes();
+}
+#else
+static void recalculate_routes() {
+    // A stub router's routes are sent to it by its neighbours, so there's nothing to recalculate.
 }
+#endif
 
-void net_notify_ping_response(dll_address physical_address, net_address logical_address) {
-    // Make sure the address is within limits:
-    if (logical_address > NET_MAX_ADDRESS) {
-        return;
-    }
+static void remove_neighbour_link(net_address address) {
+    // A restored link that was never confirmed hasn't flapped:
+    bool is_flap = neighbour_links[address].is_provisional == false;
 
-    // Reset the time to live and update the physical address:
-    neighbour_links[logical_address].seconds_to_live = NEIGHBOUR_LINK_SECONDS_TO_LIVE_START;
-    neighbour_links[logical_address].physical_address = physical_address;
+    // Invalidate the link:
+    neighbour_links[address].seconds_to_live = 0;
+    neighbour_links[address].failure_count = 0;
+    neighbour_links[address].is_database_summary_due = false;
+    neighbour_links[address].missing_link_states = 0;
+    neighbour_links[address].is_provisional = false;
 
-    // Add the link to the connected addresses:
-    net_address own_address = net_get_own_address();
-    uint16_t connected_addresses = link_state_packets[own_address].connected_addresses | ((uint16_t) 1 << logical_address);
+    // Penalise the link for going down, and stop using it if it keeps doing so:
+    net_neighbour_link *link = &neighbour_links[address];
+    if (is_flap) {
+        link->flap_penalty = (link->flap_penalty > FLAP_PENALTY_MAX - FLAP_PENALTY) ? FLAP_PENALTY_MAX : link->flap_penalty + FLAP_PENALTY;
+        if (link->flap_penalty >= FLAP_PENALTY_SUPPRESS_THRESHOLD) {
+            link->is_suppressed = true;
+        }
+    }
 
-    // Check if the connected addresses are different to before:
-    if (connected_addresses != link_state_packets[own_address].connected_addresses) {
-        // Store the connected addresses:
-        link_state_packets[own_address].connected_addresses = connected_addresses;
+    // Remove the link from our link state (a suppressed link isn't in it):
+    if (get_packed_link_cost(own_link_costs, address) != 0) {
+        set_packed_link_cost(own_link_costs, address, 0);
 
-        // Mark the network graph as changed:
+        // Mark the network graph and our own links as changed:
         is_graph_changed = true;
+        is_own_link_state_changed = true;
     }
 }
 
-bool net_is_node_neighbour(dll_address physical_address) {
-    // Search through the neighbouring links:
-    for (net_address logical_address = 0; logical_address < NET_MAX_ADDRESS; logical_address++) {
-        // If the physical address matches the requested one, and the link hasn't timed out, return 'true':
-        if (neighbour_links[logical_address].physical_address == physical_address
-            && neighbour_links[logical_address].seconds_to_live > 0) {
-            return true;
+static void decay_flap_penalty(net_address address, uint8_t seconds_elapsed) {
+    net_neighbour_link *link = &neighbour_links[address];
+    for (uint8_t second = 0; second < seconds_elapsed && link->flap_penalty > 0; second++) {
+        link->flap_penalty -= (link->flap_penalty >> FLAP_PENALTY_DECAY_SHIFT) + 1;
+    }
+
+    // Once a suppressed link has been stable for long enough, add it back to our link state if it's still up:
+    if (link->is_suppressed && link->flap_penalty < FLAP_PENALTY_REUSE_THRESHOLD) {
+        link->is_suppressed = false;
+        if (link->seconds_to_live > 0) {
+            update_own_link_cost(address);
         }
     }
-    // Link wasn't found:
-    return false;
+}
+
+static bool is_link_state_held() {
+    return time_delta_milliseconds(link_state_hold_end, time_now()) < 0;
+}
+
+static void start_link_state_hold() {
+    // Back off further if the last hold ended recently, otherwise start again from the minimum:
+    time now = time_now();
+    if (time_delta_milliseconds(link_state_hold_end, now) < LINK_STATE_HOLD_MAX_MILLISECONDS) {
+        link_state_hold_milliseconds *= 2;
+        if (link_state_hold_milliseconds > LINK_STATE_HOLD_MAX_MILLISECONDS) {
+            link_state_hold_milliseconds = LINK_STATE_HOLD_MAX_MILLISECONDS;
+        }
+    } else {
+        link_state_hold_milliseconds = LINK_STATE_HOLD_MIN_MILLISECONDS;
+    }
+    link_state_hold_end = time_add_milliseconds(now, link_state_hold_milliseconds);
+}
+
+void net_update_routing() {
+    static time last_time = TIME_ZERO;
+    uint8_t seconds_elapsed = time_delta_seconds(last_time, time_now());
+    last_time = time_add_seconds(last_time, seconds_elapsed);
+
+    // Check timeouts:
+    for (net_address address = 0; address <= NET_MAX_ADDRESS; address++) {
+        // Check if the address' link state packet has timed out:
+        net_link_state_packet *link_state = get_link_state(address);
+        if (link_state->seconds_to_live > seconds_elapsed) {
+            // Decrement seconds to live:
+            link_state->seconds_to_live -= seconds_elapsed;
+        } else if (link_state->seconds_to_live > 0) {
+            // Link state packet has timed out:
+            link_state->seconds_to_live = 0;
+
+            // Mark the network graph as changed:
+            is_graph_changed = true;
+        }
+
+        // Check if the link to the address has timed out:
+        if (neighbour_links[address].seconds_to_live > seconds_elapsed) {
+            // Decrement seconds to live:
+            neighbour_links[address].seconds_to_live -= seconds_elapsed;
+        } else if (neighbour_links[address].seconds_to_live > 0) {
+            // The link has timed out:
+            remove_neighbour_link(address);
+        }
+
+        decay_flap_penalty(address, seconds_elapsed);
+    }
+
+#ifdef NET_AREA_ROUTING
+    // Check if any area summaries have timed out:
+    for (uint8_t index = 0; index < NET_MAX_AREA_SUMMARIES; index++) {
+        net_area_summary *summary = &area_summaries[index];
+        if (summary->seconds_to_live > seconds_elapsed) {
+            summary->seconds_to_live -= seconds_elapsed;
+        } else if (summary->seconds_to_live > 0) {
+            summary->seconds_to_live = 0;
+            is_graph_changed = true;
+        }
+    }
+#endif
+
+    // If our own links have changed, send out a link state update as soon as the hold time allows. Also go back to
+    // pinging and sending link state packets frequently until the network settles down again. If the queue is full, the
+    // update is tried again next time:
+    if (is_own_link_state_changed == true && is_link_state_held() == false && net_send_link_state_update_packet()) {
+        is_own_link_state_changed = false;
+        is_own_link_cost_changed = false;
+        start_link_state_hold();
+        trickle_reset(&link_state_timer, LINK_STATE_INTERVAL_MIN_MILLISECONDS);
+        trickle_reset(&ping_timer, PING_INTERVAL_MIN_MILLISECONDS);
+        is_ping_response_requested = true;
+    }
+
+    // If only the cost of our links has changed, send out a link state update without speeding up the timers, as long as
+    // the last one was long enough ago:
+    if (link_cost_update_seconds_left > seconds_elapsed) {
+        link_cost_update_seconds_left -= seconds_elapsed;
+    } else {
+        link_cost_update_seconds_left = 0;
+    }
+    if (is_own_link_cost_changed == true && link_cost_update_seconds_left == 0 && is_link_state_held() == false
+        && net_send_link_state_update_packet()) {
+        is_own_link_cost_changed = false;
+        link_cost_update_seconds_left = LINK_COST_UPDATE_INTERVAL_SECONDS;
+        start_link_state_hold();
+    }
+
+    // If the network graph has changed, update the routes:
+    if (is_graph_changed == true) {
+        is_graph_changed = false;
+        recalculate_routes();
+    }
+
+#ifndef NET_STUB_ROUTING
+    // Save a snapshot of the routing state if the topology has changed, as long as the last one was long enough ago. A
+    // snapshot that is the same as the last one saved isn't written again by 'net_persist_save()':
+    if (snapshot_seconds_left > seconds_elapsed) {
+        snapshot_seconds_left -= seconds_elapsed;
+    } else {
+        snapshot_seconds_left = 0;
+    }
+    if (is_snapshot_due == true && snapshot_seconds_left == 0) {
+        save_snapshot();
+    }
+#endif
+
+    // Send the burst of ping requests that finds our neighbours after starting, asking them all to respond:
+    if (boot_pings_left > 0 && time_delta_milliseconds(next_boot_ping_time, time_now()) >= 0) {
+        boot_pings_left--;
+        next_boot_ping_time = time_add_milliseconds(next_boot_ping_time, BOOT_PING_INTERVAL_MILLISECONDS);
+        net_send_ping_request_packet(DLL_BROADCAST_ADDRESS, true);
+    }
+
+    // Send out a ping request packet to all neighbouring nodes:
+    if (trickle_update(&ping_timer, PING_INTERVAL_MAX_MILLISECONDS)) {
+        net_send_ping_request_packet(DLL_BROADCAST_ADDRESS, is_ping_response_requested);
+        is_ping_response_requested = false;
+    }
+
+    // Refresh our full link state packet, so that it doesn't time out on the other nodes:
+    if (trickle_update(&link_state_timer, LINK_STATE_INTERVAL_MAX_MILLISECONDS)) {
+        is_link_state_refresh_due = true;
+    }
+    if (is_link_state_refresh_due == true && is_link_state_held() == false && net_send_link_state_packet()) {
+        is_link_state_refresh_due = false;
+        start_link_state_hold();
+#if defined(NET_AREA_ROUTING) && !defined(NET_STUB_ROUTING)
+        if (is_own_area_summary_border()) {
+            is_area_summary_due = true;
+        }
+#endif
+    }
+
+    // Send any ping responses which are due:
+    for (uint8_t response_index = 0; response_index < PENDING_PING_RESPONSE_COUNT; response_index++) {
+        net_pending_ping_response *response = &pending_ping_responses[response_index];
+        if (response->is_pending && time_delta_milliseconds(response->send_time, time_now()) >= 0) {
+            response->is_pending = false;
+            net_send_ping_response_packet(response->physical_address);
+        }
+    }
+
+    // Our own link state is sent as a refresh, once the hold time allows:
+    uint16_t own_bit = (uint16_t) 1 << net_get_own_address();
+    if (requested_link_states & own_bit) {
+        requested_link_states &= ~own_bit;
+        is_link_state_refresh_due = true;
+    }
+
+#ifndef NET_STUB_ROUTING
+    // Exchange link state databases with new neighbours, so that they don't have to wait for every node's next link
+    // state refresh to find their routes:
+    for (net_address address = 0; address <= NET_MAX_ADDRESS; address++) {
+        net_neighbour_link *link = &neighbour_links[address];
+        if (link->seconds_to_live == 0) {
+            continue;
+        }
+        // Both packets are sent again on the next update if the neighbour doesn't acknowledge them:
+        if (link->is_database_summary_due && net_send_database_summary_packet(link->physical_address)) {
+            link->is_database_summary_due = false;
+#ifdef NET_AREA_ROUTING
+            // Area summaries aren't listed in the database summary, so send them all out again for the new neighbour:
+            for (uint8_t index = 0; index < NET_MAX_AREA_SUMMARIES; index++) {
+                if (area_summaries[index].seconds_to_live > 0) {
+                    requested_area_summaries |= ((uint16_t) 1 << area_summaries[index].source);
+                }
+            }
+            if (is_own_area_summary_border()) {
+                is_area_summary_due = true;
+            }
+#endif
+        }
+        if (link->missing_link_states != 0 && net_send_link_state_request_packet(link->physical_address, link->missing_link_states)) {
+            link->missing_link_states = 0;
+        }
+    }
+
+    // Send out one of the link states requested by our neighbours. They're sent one at a time so that they don't fill up
+    // the forwarding queue; if it's full, try again on the next update:
+    for (net_address source = 0; source <= NET_MAX_ADDRESS; source++) {
+        if ((requested_link_states & ((uint16_t) 1 << source)) == 0) {
+            continue;
+        }
+        if (net_send_stored_link_state_packet(source)) {
+            requested_link_states &= ~((uint16_t) 1 << source);
+        }
+        break;
+    }
+
+#ifdef NET_AREA_ROUTING
+    // Send out our area summary if it has changed or is due to be refreshed:
+    if (is_area_summary_due) {
+        is_area_summary_due = false;
+        net_send_area_summary_packet(net_get_own_address(), ++own_area_summary_sequence_number, own_area_summary_direct_areas, own_area_summary_costs);
+    }
+
+    // Send out one of the stored area summaries for a new neighbour, one at a time like the link states:
+    for (net_address source = 0; source <= NET_MAX_ADDRESS; source++) {
+        if ((requested_area_summaries & ((uint16_t) 1 << source)) == 0) {
+            continue;
+        }
+        net_area_summary *summary = find_area_summary(source);
+        if (summary == NULL
+            || net_send_area_summary_packet(source, summary->sequence_number, summary->direct_areas, summary->costs)) {
+            requested_area_summaries &= ~((uint16_t) 1 << source);
+        }
+        break;
+    }
+#endif
+
+    // Stub routers don't calculate their own routes, so send each stub neighbour its forwarding table whenever the routes
+    // change. The last table sent isn't kept, to save memory, so it's sent even if the stub's own routes are the same:
+    for (net_address address = 0; address <= NET_MAX_ADDRESS; address++) {
+        net_neighbour_link *link = &neighbour_links[address];
+        if (link->seconds_to_live == 0 || link->is_stub == false || link->is_forwarding_table_due == false) {
+            continue;
+        }
+        uint8_t packed_next_hops[PACKED_LINK_COSTS_SIZE];
+        if (calculate_stub_forwarding_table(address, packed_next_hops) == false) {
+            continue;
+        }
+        link->is_forwarding_table_due = false;
+        uint8_t next_hops[NET_MAX_ADDRESS + 1];
+        for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+            next_hops[destination] = get_packed_link_cost(packed_next_hops, destination);
+        }
+        net_send_forwarding_table_packet(link->physical_address, next_hops);
+    }
+#endif
+}
+
+bool net_are_nodes_linked(net_address node_1, net_address node_2) {
+    return net_get_link_cost(node_1, node_2) != 0;
+}
+
+uint8_t net_get_link_cost(net_address node_1, net_address node_2) {
+    // Make sure the addresses are within limits:
+    if (node_1 > NET_MAX_ADDRESS || node_2 > NET_MAX_ADDRESS) {
+        return 0;
+    }
+
+    // Our own link state packet never times out:
+    if (node_1 == net_get_own_address()) {
+        return get_packed_link_cost(own_link_costs, node_2);
+    }
+
+#ifdef NET_STUB_ROUTING
+    // A stub router doesn't hold the other nodes' link costs:
+    return 0;
+#else
+    // Check if the link state has timed out:
+    const net_link_state_packet *link_state = get_link_state(node_1);
+    if (link_state->seconds_to_live == 0) {
+        return 0;
+    }
+
+    return get_packed_link_cost(link_state->link_costs, node_2);
+#endif
+}
+
+bool net_get_link_state_sequence_number(net_address source, uint8_t *sequence_number) {
+    // Make sure the address is within limits and that the link state hasn't timed out. Provisional link states may be
+    // out of date, so they aren't passed on to other nodes:
+    if (source > NET_MAX_ADDRESS || get_link_state(source)->seconds_to_live == 0 || get_link_state(source)->is_provisional) {
+        return false;
+    }
+#ifndef NET_STUB_ROUTING
+    // Neither is a link state that's missing its base packet. Leaving it out of our database summaries also gets it
+    // sent to us again by the neighbours that hold it:
+    if (get_link_state(source)->is_base_missing) {
+        return false;
+    }
+#endif
+
+    *sequence_number = get_link_state(source)->sequence_number;
+    return true;
+}
+
+bool net_get_link_state(net_address source, uint8_t *sequence_number, uint8_t link_costs[NET_MAX_ADDRESS + 1], uint8_t *base_sequence_number, uint8_t base_link_costs[NET_MAX_ADDRESS + 1]) {
+#ifdef NET_STUB_ROUTING
+    // A stub router doesn't hold the other nodes' link costs, so it has none to send on:
+    return false;
+#else
+    if (net_get_link_state_sequence_number(source, sequence_number) == false) {
+        return false;
+    }
+
+    // Unpack the current and base link costs:
+    const net_link_state_packet *link_state = get_link_state(source);
+    *base_sequence_number = link_state->base_sequence_number;
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        link_costs[node] = get_packed_link_cost(link_state->link_costs, node);
+        base_link_costs[node] = get_packed_link_cost(link_state->base_link_costs, node);
+    }
+    return true;
+#endif
+}
+
+bool net_is_device_online(net_address address) {
+    // Make sure the address is within limits:
+    if (address > NET_MAX_ADDRESS) {
+        return false;
+    }
+
+    // Our own address is always online:
+    if (address == net_get_own_address()) {
+        return true;
+    }
+
+#ifdef NET_STUB_ROUTING
+    // Neighbours are online while they're linked, and other nodes while our forwarding table has a route to them:
+    if (neighbour_links[address].seconds_to_live > 0 && net_are_nodes_linked(net_get_own_address(), address)) {
+        return true;
+    }
+    return is_forwarding_table_valid && get_packed_link_cost(forwarding_table, address) != net_get_own_address();
+#else
+    // If the link state packet for the given node hasn't timed out and there's a route to it, assume the node is online.
+    // Link states aren't held for nodes in other areas, so they're assumed to be online while their area can be reached:
+    bool is_online = (get_link_state(address)->seconds_to_live > 0 || is_address_in_held_area(address) == false)
+        && next_hop_sets[address] != 0;
+    return is_online;
+#endif
+}
+
+static bool is_link_state_sequence_number_new(net_address source, uint8_t sequence_number) {
+    // Any sequence number is accepted if there's no valid link state for the source, or if it's only provisional:
+    const net_link_state_packet *link_state = get_link_state(source);
+    if (link_state->seconds_to_live == 0 || link_state->is_provisional) {
+        return true;
+    }
+
+    // Otherwise the sequence number must be ahead of the previous one:
+    uint8_t previous_sequence_number = link_state->sequence_number;
+    uint8_t sequence_number_difference = sequence_number - previous_sequence_number;
+    return sequence_number_difference != 0 && sequence_number_difference <= 128;
+}
+
+#ifndef NET_STUB_ROUTING
+static bool is_link_state_sequence_number_skipped(net_address source, uint8_t sequence_number) {
+    // Every link state packet that a node sends out takes the next sequence number, so if the sequence number is more
+    // than one ahead of the link state we hold, the packets in between were missed:
+    uint8_t previous_sequence_number;
+    return net_get_link_state_sequence_number(source, &previous_sequence_number)
+        && (uint8_t) (sequence_number - previous_sequence_number) > 1;
+}
+
+static void handle_missed_link_state_packets(dll_address physical_address) {
+    // A packet was lost on the way to us, as its broadcast isn't acknowledged, so the network isn't settled yet. Go back
+    // to refreshing our link state frequently:
+    trickle_reset(&link_state_timer, LINK_STATE_INTERVAL_MIN_MILLISECONDS);
+
+    // Send the neighbour that passed the packet on our database summary, so that it sends out any other link states that
+    // we've missed from it:
+    for (net_address address = 0; address <= NET_MAX_ADDRESS; address++) {
+        if (neighbour_links[address].seconds_to_live > 0 && neighbour_links[address].physical_address == physical_address) {
+            neighbour_links[address].is_database_summary_due = true;
+            return;
+        }
+    }
+}
+
+static void update_link_state(net_link_state_packet *link_state, const uint8_t packed_link_costs[]) {
+    // Check if the links have changed:
+    if (memcmp(packed_link_costs, link_state->link_costs, PACKED_LINK_COSTS_SIZE) != 0) {
+        // Store the links:
+        memcpy(link_state->link_costs, packed_link_costs, PACKED_LINK_COSTS_SIZE);
+
+        // Mark the network graph as changed:
+        is_graph_changed = true;
+    }
+}
+#endif
+
+static void handle_own_link_state_packet(uint8_t sequence_number) {
+    // A link state packet from our own address which is newer than the last one we sent out must have been sent before
+    // we restarted. Send out a new one with a higher sequence number, so that other nodes replace the old one instead of
+    // dropping ours:
+    if (net_advance_link_state_sequence_number(sequence_number)) {
+        requested_link_states |= ((uint16_t) 1 << net_get_own_address());
+    }
+}
+
+bool net_notify_link_state_packet(dll_address physical_address, net_address source, uint8_t sequence_number, const uint8_t link_costs[NET_MAX_ADDRESS + 1]) {
+    // Make sure the address is within limits and isn't our own address:
+    if (source > NET_MAX_ADDRESS) {
+        return false;
+    }
+    if (source == net_get_own_address()) {
+        handle_own_link_state_packet(sequence_number);
+        return false;
+    }
+
+    // Link states from areas that we don't hold aren't kept or flooded on:
+    if (is_address_in_held_area(source) == false) {
+        return false;
+    }
+
+    // Check that there's room to hold the link state:
+    net_link_state_packet *link_state = hold_link_state(source);
+    if (link_state == NULL) {
+        return false;
+    }
+
+#ifndef NET_STUB_ROUTING
+    // Check that the sequence number is valid. The base packet that a delta was missing is accepted when it's sent again,
+    // even though it's older than the delta:
+    bool is_missing_base = link_state->seconds_to_live != 0 && link_state->is_base_missing
+        && sequence_number == link_state->base_sequence_number;
+    if (is_missing_base == false && is_link_state_sequence_number_new(source, sequence_number) == false) {
+        return false;
+    }
+    bool is_skipped = is_link_state_sequence_number_skipped(source, sequence_number);
+#else
+    // Check that the sequence number is valid:
+    if (is_link_state_sequence_number_new(source, sequence_number) == false) {
+        return false;
+    }
+#endif
+
+    // Reset the seconds to live and update the sequence number:
+    link_state->seconds_to_live = LINK_STATE_SECONDS_TO_LIVE_START;
+    link_state->sequence_number = sequence_number;
+    link_state->is_provisional = false;
+
+#ifndef NET_STUB_ROUTING
+    // This packet becomes the base for any following delta packets:
+    link_state->base_sequence_number = sequence_number;
+    link_state->is_base_missing = false;
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        set_packed_link_cost(link_state->base_link_costs, node, link_costs[node]);
+    }
+
+    update_link_state(link_state, link_state->base_link_costs);
+
+    if (is_skipped) {
+        handle_missed_link_state_packets(physical_address);
+    }
+#endif
+
+    // The packet was valid:
+    return true;
+}
+
+bool net_notify_link_state_delta_packet(dll_address physical_address, net_address source, uint8_t sequence_number, uint8_t base_sequence_number, uint16_t changed_addresses, const uint8_t link_costs[NET_MAX_ADDRESS + 1]) {
+    // Make sure the address is within limits and isn't our own address:
+    if (source > NET_MAX_ADDRESS) {
+        return false;
+    }
+    if (source == net_get_own_address()) {
+        handle_own_link_state_packet(sequence_number);
+        return false;
+    }
+
+    // Link states from areas that we don't hold aren't kept or flooded on:
+    if (is_address_in_held_area(source) == false) {
+        return false;
+    }
+
+    // Check that the sequence number is valid, and that there's room to hold the link state:
+    net_link_state_packet *link_state = hold_link_state(source);
+    if (link_state == NULL || is_link_state_sequence_number_new(source, sequence_number) == false) {
+        return false;
+    }
+#ifndef NET_STUB_ROUTING
+    bool is_skipped = is_link_state_sequence_number_skipped(source, sequence_number);
+#endif
+
+    // A provisional link state is out of date by now, and has no base to apply the delta to, so drop it:
+    if (link_state->is_provisional) {
+        link_state->seconds_to_live = 0;
+        link_state->is_provisional = false;
+        is_graph_changed = true;
+    }
+
+#ifdef NET_STUB_ROUTING
+    // A stub router only keeps track of the sequence number:
+    link_state->seconds_to_live = LINK_STATE_SECONDS_TO_LIVE_START;
+    link_state->sequence_number = sequence_number;
+#else
+    // Only apply the delta if we have the full link state packet it's based on. Otherwise just keep track of the sequence
+    // number and wait for the base packet, but still flood the packet so that other nodes receive it:
+    bool has_base = link_state->seconds_to_live != 0 && link_state->is_base_missing == false
+        && link_state->base_sequence_number == base_sequence_number;
+    link_state->sequence_number = sequence_number;
+    if (has_base) {
+        link_state->seconds_to_live = LINK_STATE_SECONDS_TO_LIVE_START;
+        uint8_t packed_link_costs[PACKED_LINK_COSTS_SIZE];
+        memcpy(packed_link_costs, link_state->base_link_costs, PACKED_LINK_COSTS_SIZE);
+        for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+            if (changed_addresses & ((uint16_t) 1 << node)) {
+                set_packed_link_cost(packed_link_costs, node, link_costs[node]);
+            }
+        }
+        update_link_state(link_state, packed_link_costs);
+    } else if (link_state->seconds_to_live != 0) {
+        // We hold an older link state, so the base packet was lost on the way to us. Keep routing on the old links until
+        // the base packet is sent to us again:
+        link_state->is_base_missing = true;
+        link_state->base_sequence_number = base_sequence_number;
+    }
+
+    if (is_skipped) {
+        handle_missed_link_state_packets(physical_address);
+    }
+#endif
+
+    // The packet was valid:
+    return true;
+}
+
+void net_notify_database_summary(dll_address physical_address, net_address logical_address, uint16_t sources, const uint8_t sequence_numbers[NET_MAX_ADDRESS + 1]) {
+    // Make sure the address is within limits:
+    if (logical_address > NET_MAX_ADDRESS) {
+        return;
+    }
+
+    // The neighbour may still hold a link state packet that we sent out before we restarted. If it doesn't hold ours at
+    // all, send it out to the neighbour:
+    net_address own_address = net_get_own_address();
+    if (sources & ((uint16_t) 1 << own_address)) {
+        handle_own_link_state_packet(sequence_numbers[own_address]);
+    } else {
+        requested_link_states |= ((uint16_t) 1 << own_address);
+    }
+
+#ifndef NET_STUB_ROUTING
+    // Compare the neighbour's other link states with ours:
+    uint16_t missing_link_states = 0;
+    uint8_t sequence_number;
+    uint8_t sequence_number_difference;
+    for (net_address source = 0; source <= NET_MAX_ADDRESS; source++) {
+        bool is_held_by_neighbour = sources & ((uint16_t) 1 << source);
+        if (source == own_address || is_address_in_held_area(source) == false) {
+            continue;
+        }
+        if (is_held_by_neighbour && is_link_state_sequence_number_new(source, sequence_numbers[source])) {
+            // The neighbour holds a newer link state than ours (or one we don't have at all), so request it:
+            missing_link_states |= ((uint16_t) 1 << source);
+        } else if (net_get_link_state_sequence_number(source, &sequence_number)) {
+            // We hold a newer link state than the neighbour (or one it doesn't have at all), so send it out without
+            // waiting for the neighbour to request it. This also covers a neighbour that has restarted without us
+            // noticing, which won't send us a summary of its own. A link state that both of us hold at the same sequence
+            // number isn't sent again:
+            sequence_number_difference = sequence_number - sequence_numbers[source];
+            if (is_held_by_neighbour == false || (sequence_number_difference != 0 && sequence_number_difference < 128)) {
+                requested_link_states |= ((uint16_t) 1 << source);
+            }
+        }
+    }
+
+    // Request the missing link states from the neighbour on the next update:
+    neighbour_links[logical_address].missing_link_states |= missing_link_states;
+#endif
+}
+
+void net_notify_link_state_request(uint16_t sources) {
+    // Add the requested sources to the ones still to be sent, which go out on the following updates:
+    requested_link_states |= sources;
+}
+
+#ifdef NET_AREA_ROUTING
+bool net_notify_area_summary(net_address source, uint8_t sequence_number, uint8_t direct_areas, const uint8_t costs[NET_AREA_COUNT]) {
+    // Make sure the address is within limits:
+    if (source > NET_MAX_ADDRESS) {
+        return false;
+    }
+
+    // A summary from our own address which is newer than the last one we sent out must have been sent before we
+    // restarted. Send out our summary again with a higher sequence number, if we're still on a border:
+    if (source == net_get_own_address()) {
+#ifndef NET_STUB_ROUTING
+        uint8_t sequence_number_difference = sequence_number - own_area_summary_sequence_number;
+        if (sequence_number_difference != 0 && sequence_number_difference <= 128) {
+            own_area_summary_sequence_number = sequence_number;
+            is_area_summary_due = is_own_area_summary_border();
+        }
+#endif
+        return false;
+    }
+
+    // Summaries are only kept and flooded on within the areas that the source borders:
+    if ((direct_areas & get_held_areas(net_get_own_address())) == 0) {
+        return false;
+    }
+
+    // Check that the sequence number is ahead of the previous one. A new source takes a free entry, and its summary is
+    // dropped if there isn't one:
+    net_area_summary *summary = find_area_summary(source);
+    if (summary == NULL) {
+        for (uint8_t index = 0; index < NET_MAX_AREA_SUMMARIES && summary == NULL; index++) {
+            if (area_summaries[index].seconds_to_live == 0) {
+                summary = &area_summaries[index];
+                summary->source = source;
+            }
+        }
+        if (summary == NULL) {
+            return false;
+        }
+    }
+    uint8_t sequence_number_difference = sequence_number - summary->sequence_number;
+    if (summary->seconds_to_live > 0 && (sequence_number_difference == 0 || sequence_number_difference > 128)) {
+        return false;
+    }
+#ifndef NET_STUB_ROUTING
+    // Check if the summary is new or has changed:
+    if (summary->seconds_to_live == 0 || summary->direct_areas != direct_areas || memcmp(summary->costs, costs, NET_AREA_COUNT) != 0) {
+        summary->direct_areas = direct_areas;
+        memcpy(summary->costs, costs, NET_AREA_COUNT);
+        is_graph_changed = true;
+    }
+#endif
+    summary->seconds_to_live = LINK_STATE_SECONDS_TO_LIVE_START;
+    summary->sequence_number = sequence_number;
+
+    // The summary was new:
+    return true;
+}
+#endif
+
+dll_address net_get_next_hop(net_address destination) {
+    return net_get_flow_next_hop(net_get_own_address(), destination);
+}
+
+#ifdef NET_STUB_ROUTING
+static bool is_live_neighbour(net_address address) {
+    return neighbour_links[address].seconds_to_live > 0 && net_are_nodes_linked(net_get_own_address(), address);
+}
+
+dll_address net_get_flow_next_hop(net_address source, net_address destination) {
+    net_address own_address = net_get_own_address();
+    if (source > NET_MAX_ADDRESS || destination > NET_MAX_ADDRESS || destination == own_address) {
+        return NET_NEXT_HOP_NOT_RESOLVED;
+    }
+
+    // Neighbours are sent to directly:
+    if (is_live_neighbour(destination)) {
+        return neighbour_links[destination].physical_address;
+    }
+
+    // Otherwise follow the forwarding table sent by our neighbours, as long as its next hop is still linked:
+    if (is_forwarding_table_valid) {
+        net_address next_hop = get_packed_link_cost(forwarding_table, destination);
+        if (next_hop == own_address) {
+            return NET_NEXT_HOP_NOT_RESOLVED;
+        }
+        if (is_live_neighbour(next_hop)) {
+            return neighbour_links[next_hop].physical_address;
+        }
+    }
+
+    // Packets passing through are dropped rather than sent to any neighbour, which could be the one they came from:
+    if (source != own_address) {
+        return NET_NEXT_HOP_NOT_RESOLVED;
+    }
+
+    // Until a forwarding table arrives, or if its next hop has gone down, send our own packets to any neighbour, which
+    // has a better idea of the routes than we do:
+    for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+        if (is_live_neighbour(neighbour)) {
+            return neighbour_links[neighbour].physical_address;
+        }
+    }
+    return NET_NEXT_HOP_NOT_RESOLVED;
+}
+
+void net_notify_forwarding_table(dll_address physical_address, net_address logical_address, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+    // Only accept forwarding tables from our neighbours:
+    if (logical_address > NET_MAX_ADDRESS || net_is_node_neighbour(physical_address) == false) {
+        return;
+    }
+
+    // Every neighbour works out the same routes for us from the same link states, so keep the latest table:
+    for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+        set_packed_link_cost(forwarding_table, destination, next_hops[destination]);
+    }
+    is_forwarding_table_valid = true;
+}
+
+bool net_is_stub_router() {
+    return true;
+}
+#else
+dll_address net_get_flow_next_hop(net_address source, net_address destination) {
+    if (source > NET_MAX_ADDRESS || destination > NET_MAX_ADDRESS) {
+        return NET_NEXT_HOP_NOT_RESOLVED;
+    }
+
+    // Count the next hops whose links haven't started failing:
+    uint16_t next_hop_set = next_hop_sets[destination];
+    uint8_t next_hop_count = 0;
+    for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+        if ((next_hop_set & ((uint16_t) 1 << neighbour)) && neighbour_links[neighbour].failure_count > 0) {
+            next_hop_set &= ~((uint16_t) 1 << neighbour);
+        }
+        if (next_hop_set & ((uint16_t) 1 << neighbour)) {
+            next_hop_count++;
+        }
+    }
+
+    // If packets to every next hop have started failing, switch to the loop-free alternate straight away rather than
+    // waiting for the links to be dropped (or stick with the failing next hops if there's no alternate):
+    if (next_hop_count == 0) {
+        if (alternate_next_hops[destination] != NET_NEXT_HOP_NOT_RESOLVED || next_hop_sets[destination] == 0) {
+            return alternate_next_hops[destination];
+        }
+        next_hop_set = next_hop_sets[destination];
+        for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+            if (next_hop_set & ((uint16_t) 1 << neighbour)) {
+                next_hop_count++;
+            }
+        }
+    }
+
+    // Hash the flow onto one of the next hops, so that every packet in the flow takes the same path and stays in order.
+    // Our own address is mixed in so that nodes along the path don't all make the same choice:
+    uint8_t flow_hash = (((source << 4) | destination) ^ (net_get_own_address() * FLOW_HASH_ADDRESS_MULTIPLIER)) * FLOW_HASH_MULTIPLIER;
+    uint8_t next_hop_index = ((uint16_t) flow_hash * next_hop_count) >> 8;
+    for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+        if (next_hop_set & ((uint16_t) 1 << neighbour)) {
+            if (next_hop_index == 0) {
+                return neighbour_links[neighbour].physical_address;
+            }
+            next_hop_index--;
+        }
+    }
+    return NET_NEXT_HOP_NOT_RESOLVED;
+}
+
+void net_notify_forwarding_table(dll_address physical_address, net_address logical_address, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+    // We calculate our own routes, so forwarding tables aren't needed.
+}
+
+bool net_is_stub_router() {
+    return false;
+}
+#endif
+
+static void update_own_link_cost(net_address address) {
+    uint8_t advertised_cost = get_packed_link_cost(own_link_costs, address);
+    uint8_t measured_cost = calculate_link_cost(&neighbour_links[address]);
+
+    if (advertised_cost == 0) {
+        // Leave the link out while it's suppressed for flapping:
+        if (neighbour_links[address].is_suppressed) {
+            return;
+        }
+
+        // The link is new; add it to our link state, and tell the neighbour which link states we hold:
+        set_packed_link_cost(own_link_costs, address, measured_cost);
+        neighbour_links[address].is_database_summary_due = true;
+
+        // Mark the network graph and our own links as changed:
+        is_graph_changed = true;
+        is_own_link_state_changed = true;
+    } else if (abs(measured_cost - advertised_cost) >= LINK_COST_HYSTERESIS) {
+        // The link's quality has changed enough to be worth advertising:
+        set_packed_link_cost(own_link_costs, address, measured_cost);
+        is_graph_changed = true;
+
+        // Only send out the new cost straight away if it's changed a lot:
+        if (abs(measured_cost - advertised_cost) >= LINK_COST_UPDATE_THRESHOLD) {
+            is_own_link_cost_changed = true;
+        }
+    }
+}
+
+static void refresh_neighbour_link(dll_address physical_address, net_address logical_address) {
+    // Reset the time to live and update the physical address:
+    neighbour_links[logical_address].seconds_to_live = NEIGHBOUR_LINK_SECONDS_TO_LIVE_START;
+    neighbour_links[logical_address].physical_address = physical_address;
+    neighbour_links[logical_address].failure_count = 0;
+
+    // A restored link is confirmed once we hear from the neighbour; exchange link state databases with it as for a new
+    // link, as either of us may have missed link states while we were off:
+    if (neighbour_links[logical_address].is_provisional) {
+        neighbour_links[logical_address].is_provisional = false;
+        neighbour_links[logical_address].is_database_summary_due = true;
+    }
+
+    // Add the link to our link state, or update its cost:
+    update_own_link_cost(logical_address);
+}
+
+void net_notify_ping_response(dll_address physical_address, net_address logical_address) {
+    // Make sure the address is within limits:
+    if (logical_address > NET_MAX_ADDRESS) {
+        return;
+    }
+
+    refresh_neighbour_link(physical_address, logical_address);
+}
+
+void net_notify_ping_request(dll_address physical_address, net_address logical_address, uint8_t sequence_number, bool is_response_requested, bool is_stub, bool is_compact_header_supported) {
+    // Make sure the address is within limits:
+    if (logical_address > NET_MAX_ADDRESS) {
+        return;
+    }
+
+    // Any ping requests skipped since the last one from this node were lost on the way:
+    net_neighbour_link *link = &neighbour_links[logical_address];
+    bool is_new_neighbour = !net_is_node_neighbour(physical_address) || link->is_provisional;
+    uint8_t lost_request_count = sequence_number - link->ping_sequence_number - 1;
+    if (is_new_neighbour == false && lost_request_count <= PING_SEQUENCE_GAP_MAX) {
+        for (uint8_t request_index = 0; request_index < lost_request_count; request_index++) {
+            update_delivery_ratio(&link->ping_received_ratio, false);
+        }
+    }
+    update_delivery_ratio(&link->ping_received_ratio, true);
+    link->ping_sequence_number = sequence_number;
+
+    // Receiving a ping request shows that the link to the sender is alive:
+    refresh_neighbour_link(physical_address, logical_address);
+
+#ifndef NET_STUB_ROUTING
+    // Send a stub neighbour its forwarding table when it first shows up, and again when it asks for responses, as its
+    // links have changed or it has restarted and lost its table. It doesn't send a database summary of its own, so
+    // send it ours in case it still has link state packets out from before a restart:
+    if (is_stub && (is_new_neighbour || is_response_requested || link->is_stub == false)) {
+        link->is_forwarding_table_due = true;
+        link->is_database_summary_due = true;
+    }
+
+    // Routes can't go through a stub neighbour, so they change when a neighbour becomes a stub router or stops being one:
+    if (is_stub != link->is_stub) {
+        is_graph_changed = true;
+    }
+#endif
+    link->is_stub = is_stub;
+    link->is_compact_header_supported = is_compact_header_supported;
+
+    // Only respond if asked to, or if the sender is new to us and may not know about us yet:
+    if (is_response_requested == false && is_new_neighbour == false) {
+        return;
+    }
+
+    // Schedule the response after a random delay, unless one is already scheduled for the same node:
+    net_pending_ping_response *free_response = NULL;
+    for (uint8_t response_index = 0; response_index < PENDING_PING_RESPONSE_COUNT; response_index++) {
+        net_pending_ping_response *response = &pending_ping_responses[response_index];
+        if (response->is_pending && response->physical_address == physical_address) {
+            return;
+        }
+        if (response->is_pending == false) {
+            free_response = response;
+        }
+    }
+    if (free_response == NULL) {
+        // No space to schedule the response. It's dropped rather than sent from here, which would hold up the receive
+        // path while DLL waits for its ACK. The sender still hears our own ping requests, which speed up when a new
+        // neighbour shows up:
+        return;
+    }
+    free_response->physical_address = physical_address;
+    free_response->send_time = time_add_milliseconds(time_now(), random_milliseconds(PING_RESPONSE_JITTER_MILLISECONDS));
+    free_response->is_pending = true;
+}
+
+void net_notify_delivery(dll_address physical_address, bool is_delivered, uint8_t retransmission_count) {
+    // Find the neighbouring link with the given physical address:
+    net_neighbour_link *link = find_neighbour_link(physical_address);
+    if (link == NULL) {
+        return;
+    }
+
+    // Every retransmission is a frame that wasn't acknowledged:
+    for (uint8_t frame_index = 0; frame_index < retransmission_count; frame_index++) {
+        update_delivery_ratio(&link->acknowledged_ratio, false);
+    }
+
+    if (is_delivered) {
+        // A delivered packet shows that the link is alive:
+        update_delivery_ratio(&link->acknowledged_ratio, true);
+        link->seconds_to_live = NEIGHBOUR_LINK_SECONDS_TO_LIVE_START;
+        link->failure_count = 0;
+        update_own_link_cost(link - neighbour_links);
+    } else if (++link->failure_count >= LINK_FAILURE_THRESHOLD) {
+        // Too many packets have failed in a row; drop the link and reroute around it straight away. The link state
+        // update is sent from 'net_update_routing()', as DLL's buffer may be in use at this point:
+        remove_neighbour_link(link - neighbour_links);
+        is_graph_changed = false;
+        recalculate_routes();
+    } else {
+        // The link is still up, but its cost may have gone up:
+        update_own_link_cost(link - neighbour_links);
+    }
+}
+
+bool net_is_compact_header_supported(dll_address physical_address) {
+    net_neighbour_link *link = find_neighbour_link(physical_address);
+    return link != NULL && link->is_compact_header_supported;
+}
+
+bool net_is_node_neighbour(dll_address physical_address) {
+    return find_neighbour_link(physical_address) != NULL;
 }
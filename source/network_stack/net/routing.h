@@ -9,13 +9,65 @@
 #define NET_NEXT_HOP_NOT_RESOLVED (DLL_BROADCAST_ADDRESS)
 
 /**
- * @brief Returns the physical address of the next node to send a packet to, given a destination logical address.
+ * The range of link costs. A link's cost is its expected transmission count (ETX) in units of half a transmission, so
+ * that a perfect link costs 'NET_LINK_COST_MIN'. A cost of zero means that the nodes aren't linked.
+ */
+#define NET_LINK_COST_MIN (2)
+#define NET_LINK_COST_MAX (15)
+
+#ifdef NET_AREA_ROUTING
+/**
+ * With area routing (built with 'NET_AREA_ROUTING' defined), the network is split into areas, such as the floors of a
+ * building. An area is made up of the addresses which share their high bits, leaving the lowest 'NET_AREA_NODE_BITS'
+ * bits to tell its nodes apart. Link states are only held and flooded within the areas that a node is in or has a link
+ * into; the nodes on the border between areas send out a summary of the cost of reaching each area instead. Routes
+ * between two other areas are only passed on through the backbone area, which every other area should border.
+ *
+ * The link state table only has room for 'NET_MAX_HELD_AREAS' areas, so its size depends on the size of an area rather
+ * than of the whole network. A node with links into more areas than that drops the link states of the areas it has no
+ * room for, and routes to them through the border nodes' summaries instead. Area summaries are kept in a table of
+ * 'NET_MAX_AREA_SUMMARIES' entries, enough by default for two border nodes between each area and the backbone, and a
+ * summary from a new border node is dropped while the table is full.
+ */
+#ifndef NET_AREA_NODE_BITS
+#define NET_AREA_NODE_BITS (2)
+#endif
+#define NET_AREA_COUNT ((NET_MAX_ADDRESS + 1) >> NET_AREA_NODE_BITS)
+#define NET_BACKBONE_AREA (0)
+
+#ifndef NET_MAX_HELD_AREAS
+#define NET_MAX_HELD_AREAS (2)
+#endif
+#ifndef NET_MAX_AREA_SUMMARIES
+#define NET_MAX_AREA_SUMMARIES (2 * NET_AREA_COUNT)
+#endif
+
+/**
+ * The cost in an area summary for an area which can't be reached.
+ */
+#define NET_AREA_COST_UNREACHABLE (255)
+#endif
+
+/**
+ * @brief Returns the physical address of the next node to send a packet to, given a destination logical address. This
+ *        is the next hop for packets sent from this node; see 'net_get_flow_next_hop()'.
  * @param destination: The intended final destination of a packet.
  * @returns The physical address of the next node to send the packet to. If the next hop can't be resolved
  *          'NET_NEXT_HOP_NOT_RESOLVED' is returned.
  */
 dll_address net_get_next_hop(net_address destination);
 
+/**
+ * @brief Returns the physical address of the next node to send a packet to, given the packet's source and destination
+ *        logical addresses. If there are several equal-cost paths to the destination, flows are spread across them,
+ *        but all packets with the same source and destination take the same next hop.
+ * @param source: The node that the packet was first sent from.
+ * @param destination: The intended final destination of a packet.
+ * @returns The physical address of the next node to send the packet to. If the next hop can't be resolved
+ *          'NET_NEXT_HOP_NOT_RESOLVED' is returned.
+ */
+dll_address net_get_flow_next_hop(net_address source, net_address destination);
+
 // TODO: Comment this function
 void net_initialise_routing();
 
@@ -32,14 +84,115 @@ void net_update_routing();
 void net_notify_ping_response(dll_address physical_address, net_address logical_address);
 
 /**
- * @brief Notifies the router that a link state packet was received.
+ * @brief Notifies the router whether a packet sent to a neighbouring node was delivered. Delivered packets keep the link
+ *        alive, and after several consecutive failures the link is dropped and the routes are
+ *        recalculated straight away. The retransmissions are used to measure the link's quality.
+ * @param physical_address: The physical address of the neighbouring node the packet was sent to.
+ * @param is_delivered: 'true' if the packet was acknowledged; 'false' if it couldn't be delivered.
+ * @param retransmission_count: The number of frames that had to be retransmitted.
+ */
+void net_notify_delivery(dll_address physical_address, bool is_delivered, uint8_t retransmission_count);
+
+/**
+ * @brief Notifies the router that a ping request was received from a node. This keeps the link to the node alive, and
+ *        schedules a ping response if one is needed. Gaps in the sequence numbers are used to measure the link's
+ *        quality.
+ * @param physical_address: The physical address of the node that sent the request.
+ * @param logical_address: The logical address of the node that sent the request.
+ * @param sequence_number: The request's sequence number, which the node increments for every request it sends.
+ * @param is_response_requested: Whether the node asked for a ping response.
+ * @param is_stub: Whether the node is a stub router, which relies on its neighbours to send it a forwarding table.
+ * @param is_compact_header_supported: Whether the node can receive data packets with a compact header.
+ */
+void net_notify_ping_request(dll_address physical_address, net_address logical_address, uint8_t sequence_number, bool is_response_requested, bool is_stub, bool is_compact_header_supported);
+
+/**
+ * @brief Notifies the router that a link state packet was received. If packets from the source were missed since the
+ *        last one received, the neighbour that passed this one on is sent a database summary, so that it sends out any
+ *        link states that we're missing.
+ * @param physical_address: The physical address of the neighbour that passed the packet on.
  * @param source: The node that sent out the link state packet.
  * @param sequence_number: The packet's sequence number.
- * @param node_list: A pointer to the first node in the packet's node list.
- * @param node_count: The number of nodes in the list.
+ * @param link_costs: The cost of the source node's link to each network address, indexed by the address. A cost of
+ *                    zero means that the nodes aren't linked.
  * @returns 'true' if the packet is valid (it hasn't been received already) and should be flooded; 'false' otherwise.
  */
-bool net_notify_link_state_packet(net_address source, uint8_t sequence_number, const net_address *node_list, uint8_t node_count);
+bool net_notify_link_state_packet(dll_address physical_address, net_address source, uint8_t sequence_number, const uint8_t link_costs[NET_MAX_ADDRESS + 1]);
+
+/**
+ * @brief Notifies the router that a link state delta packet was received. The delta is only applied if the last full
+ *        link state packet received from the source is the one that the delta is based on; otherwise the link state is
+ *        left out of our database summaries until the base packet is received. Missed packets are handled as for
+ *        'net_notify_link_state_packet()'.
+ * @param physical_address: The physical address of the neighbour that passed the packet on.
+ * @param source: The node that sent out the link state packet.
+ * @param sequence_number: The packet's sequence number.
+ * @param base_sequence_number: The sequence number of the full link state packet that the delta is based on.
+ * @param changed_addresses: The links which were added, removed or changed cost since the base packet - each bit
+ *                           corresponds to a network address.
+ * @param link_costs: The new cost of each changed link, indexed by the address. A cost of zero means that the link was
+ *                    removed. Entries for unchanged links are ignored.
+ * @returns 'true' if the packet is valid (it hasn't been received already) and should be flooded; 'false' otherwise.
+ */
+bool net_notify_link_state_delta_packet(dll_address physical_address, net_address source, uint8_t sequence_number, uint8_t base_sequence_number, uint16_t changed_addresses, const uint8_t link_costs[NET_MAX_ADDRESS + 1]);
+
+/**
+ * @brief Notifies the router that a database summary packet was received from a neighbouring node. Any link states
+ *        that the neighbour holds a newer version of are requested from it by 'net_update_routing()'.
+ * @param physical_address: The physical address of the node that sent the summary.
+ * @param logical_address: The logical address of the node that sent the summary.
+ * @param sources: The sources whose link states the node holds - each bit corresponds to a network address.
+ * @param sequence_numbers: The sequence number of each link state that the node holds, indexed by the source address.
+ */
+void net_notify_database_summary(dll_address physical_address, net_address logical_address, uint16_t sources, const uint8_t sequence_numbers[NET_MAX_ADDRESS + 1]);
+
+/**
+ * @brief Notifies the router that a link state request packet was received. The requested link states are sent out by
+ *        'net_update_routing()', one at a time.
+ * @param sources: The sources whose link states were requested - each bit corresponds to a network address.
+ */
+void net_notify_link_state_request(uint16_t sources);
+
+/**
+ * @brief Notifies the router that a forwarding table was received from a neighbouring node. Only stub routers use
+ *        forwarding tables; other routers ignore them.
+ * @param physical_address: The physical address of the node that sent the forwarding table.
+ * @param logical_address: The logical address of the node that sent the forwarding table.
+ * @param next_hops: The logical address of the next hop to each destination, indexed by the destination's address. This
+ *                   node's own address means that the destination can't be reached.
+ */
+void net_notify_forwarding_table(dll_address physical_address, net_address logical_address, const uint8_t next_hops[NET_MAX_ADDRESS + 1]);
+
+/**
+ * @brief Returns whether this node is a stub router. A stub router (built with 'NET_STUB_ROUTING' defined) doesn't
+ *        hold the network's link states or calculate its own routes, but uses the forwarding tables sent to it by its
+ *        neighbours.
+ * @returns 'true' if this node is a stub router; 'false' otherwise.
+ */
+bool net_is_stub_router();
+
+#ifdef NET_AREA_ROUTING
+/**
+ * @brief Returns the area that a network address belongs to.
+ * @param address: The network address.
+ * @returns The address' area, between 0 and 'NET_AREA_COUNT' - 1.
+ */
+uint8_t net_get_area(net_address address);
+
+/**
+ * @brief Notifies the router that an area summary packet was received. Summaries are only kept if their source borders
+ *        one of the areas that this node holds the link states of.
+ * @param source: The node that sent out the summary, which is on the border between areas.
+ * @param sequence_number: The sequence number of the summary packet.
+ * @param direct_areas: The areas that the source holds the link states of, whose costs it worked out from them - each
+ *                      bit corresponds to an area. The costs of other areas were worked out from the summaries of other
+ *                      border nodes, within the backbone.
+ * @param costs: The cost of reaching each area from the source, indexed by the area. 'NET_AREA_COST_UNREACHABLE' means
+ *               that the area can't be reached.
+ * @returns 'true' if the summary is new and should be flooded on; 'false' otherwise.
+ */
+bool net_notify_area_summary(net_address source, uint8_t sequence_number, uint8_t direct_areas, const uint8_t costs[NET_AREA_COUNT]);
+#endif
 
 /**
  * @brief Returns whether two nodes are directly linked.
@@ -49,6 +202,34 @@ bool net_notify_link_state_packet(net_address source, uint8_t sequence_number, c
  */
 bool net_are_nodes_linked(net_address node_1, net_address node_2);
 
+/**
+ * @brief Returns the cost of the link between two nodes, as advertised by the link's starting node.
+ * @param node_1: The link's starting node.
+ * @param node_2: The link's ending node.
+ * @returns The link's cost, between 'NET_LINK_COST_MIN' and 'NET_LINK_COST_MAX', or zero if the nodes aren't linked.
+ */
+uint8_t net_get_link_cost(net_address node_1, net_address node_2);
+
+/**
+ * @brief Gets the sequence number of the link state held for a node.
+ * @param source: The node whose link state to look up.
+ * @param sequence_number: Set to the sequence number of the last link state packet received from the node.
+ * @returns 'true' if a valid link state is held for the node; 'false' otherwise.
+ */
+bool net_get_link_state_sequence_number(net_address source, uint8_t *sequence_number);
+
+/**
+ * @brief Gets the link state held for a node, so that it can be sent on to a neighbour which is missing it.
+ * @param source: The node whose link state to look up.
+ * @param sequence_number: Set to the sequence number of the last link state packet received from the node.
+ * @param link_costs: Set to the cost of the node's link to each network address. A cost of zero means that the nodes
+ *                    aren't linked.
+ * @param base_sequence_number: Set to the sequence number of the last full link state packet received from the node.
+ * @param base_link_costs: Set to the link costs carried by the last full link state packet.
+ * @returns 'true' if a valid link state is held for the node; 'false' otherwise.
+ */
+bool net_get_link_state(net_address source, uint8_t *sequence_number, uint8_t link_costs[NET_MAX_ADDRESS + 1], uint8_t *base_sequence_number, uint8_t base_link_costs[NET_MAX_ADDRESS + 1]);
+
 /**
  * @brief Returns whether a given device is  known to be connected to the network.
  * @param address: The device's network address.
@@ -56,6 +237,14 @@ bool net_are_nodes_linked(net_address node_1, net_address node_2);
  */
 bool net_is_device_online(net_address address);
 
+/**
+ * @brief Returns whether a neighbouring node can receive data packets with a compact header, as announced in its ping
+ *        requests.
+ * @param node: The physical address of the node.
+ * @returns 'true' if the node is a neighbour which supports the compact header; 'false' otherwise.
+ */
+bool net_is_compact_header_supported(dll_address node);
+
 /**
  * @brief Returns whether a node is a neighbour to this node.
  * @param node: The physical address of the node.
@@ -0,0 +1,285 @@
+#include "sync.h"
+#include "network_stack/dll.h"
+#include "packets.h"
+#include <stdlib.h>
+
+// The root address before any time sync packet has been heard.
+#define NO_ROOT ((net_address) 0xFF)
+
+// If no new time sync packet from the root arrives for this long, this node takes over as the root, keeping the network
+// time running from its current estimate so that it doesn't jump. Rounds are lost more often the further a node is from
+// the root, and a node taking over while the root is still there unsettles every node after it, so this is long.
+#define ROOT_TIMEOUT_MILLISECONDS (16 * NET_SYNC_INTERVAL_MILLISECONDS)
+
+// Time sync packets are passed on after a random delay up to this value, so that neighbours don't all send at once. The
+// delay doesn't affect the accuracy, since each packet carries when the previous one was actually sent.
+#define FORWARD_JITTER_MILLISECONDS (50)
+
+// A sample further than this from the current estimate means that the network time has jumped (e.g. the root
+// restarted), so the older samples are thrown away.
+#define MAX_SAMPLE_ERROR_MILLISECONDS (100)
+
+// The drift is only worked out once there are enough samples for it to be more accurate than assuming none, since each
+// sample is only accurate to a millisecond. It's limited to what a clock crystal or resonator can plausibly be off by.
+#define MIN_DRIFT_SAMPLE_COUNT (4)
+#define MAX_DRIFT_PPM (5000)
+
+// A sample of this node's clock against the network time.
+typedef struct {
+    time local_time; // When the root's time sync packet arrived, by this node's clock
+    int32_t offset; // The network time minus the local time at that moment
+} sync_sample;
+
+// An action waiting for its network time.
+typedef struct {
+    time network_time;
+    net_action_callback callback; // 'NULL' if the entry isn't in use
+} scheduled_action;
+
+// The node whose clock is the network time, the newest sequence number it has sent out, and when that arrived:
+static net_address root_address = NO_ROOT;
+static uint8_t root_sequence_number = 0;
+static time root_heard_time = TIME_ZERO;
+
+// The sequence number and arrival time of the last time sync packet from each neighbour, to pair with the network time
+// in its next packet. Each bit in the sources says whether that neighbour's entry is valid:
+static uint8_t received_sequence_numbers[NET_MAX_ADDRESS + 1] = { 0 };
+static time received_times[NET_MAX_ADDRESS + 1] = { 0 };
+static uint16_t received_sources = 0;
+
+// The samples, oldest first starting after the newest, and the sequence number of the root's packet in the newest:
+static sync_sample samples[NET_SYNC_SAMPLE_COUNT];
+static uint8_t sample_count = 0;
+static uint8_t newest_sample_index = 0;
+static uint8_t sampled_sequence_number = 0;
+
+// The estimate of the network time: the local time, plus the offset at the reference time, plus the drift since then:
+static time reference_time = TIME_ZERO;
+static int32_t reference_offset = 0;
+static int32_t drift_ppm = 0;
+
+// When this node sends its next time sync packet, and the sequence number and network time of the last one it sent:
+static bool is_send_pending = false;
+static time send_time = TIME_ZERO;
+static bool has_sent = false;
+static uint8_t sent_sequence_number = 0;
+static time sent_network_time = TIME_ZERO;
+
+static scheduled_action scheduled_actions[NET_MAX_SCHEDULED_ACTIONS];
+
+static int32_t random_milliseconds(int32_t max_milliseconds) {
+    // Scale a random byte to the range [0, max_milliseconds):
+    return (max_milliseconds * (rand() & 0xFF)) >> 8;
+}
+
+static bool is_sequence_number_newer(uint8_t sequence_number, uint8_t other_sequence_number) {
+    // Sequence numbers wrap around, so a number is newer if it's less than half the sequence space ahead:
+    return (int8_t) (sequence_number - other_sequence_number) > 0;
+}
+
+static int32_t get_drift_milliseconds(int32_t elapsed_milliseconds) {
+    // Work in microseconds, splitting off the whole seconds so that a long time can't overflow. The result is rounded
+    // rather than truncated, since truncating biases the estimate the same way on every hop down from the root:
+    int32_t drift_microseconds = (elapsed_milliseconds / 1000) * drift_ppm + (elapsed_milliseconds % 1000) * drift_ppm / 1000;
+    return (drift_microseconds + ((drift_microseconds < 0) ? -500 : 500)) / 1000;
+}
+
+static time to_network_time(time local_time) {
+    int32_t elapsed_milliseconds = time_delta_milliseconds(reference_time, local_time);
+    return time_add_milliseconds(local_time, reference_offset + get_drift_milliseconds(elapsed_milliseconds));
+}
+
+static void clear_samples() {
+    sample_count = 0;
+    received_sources = 0;
+    has_sent = false;
+    is_send_pending = false;
+}
+
+static void become_root(time now) {
+    // Carry on from the current estimate, without the drift, so that the network time doesn't jump:
+    reference_offset = time_delta_milliseconds(now, to_network_time(now));
+    reference_time = now;
+    drift_ppm = 0;
+    root_address = net_get_own_address();
+    clear_samples();
+    send_time = now;
+}
+
+static void update_estimate() {
+    const sync_sample *newest = &samples[newest_sample_index];
+    uint8_t oldest_index = (newest_sample_index + NET_SYNC_SAMPLE_COUNT + 1 - sample_count) % NET_SYNC_SAMPLE_COUNT;
+
+    // Work out the drift from the average offset of the older half of the samples against the newer half, which evens
+    // out the error in each sample far better than using the oldest and newest alone. Times and offsets are taken
+    // relative to the newest sample, so that the sums stay small:
+    if (sample_count >= MIN_DRIFT_SAMPLE_COUNT) {
+        uint8_t half_count = sample_count / 2;
+        int32_t older_time_sum = 0, older_offset_sum = 0, newer_time_sum = 0, newer_offset_sum = 0;
+        for (uint8_t age_index = 0; age_index < half_count; age_index++) {
+            const sync_sample *older = &samples[(oldest_index + age_index) % NET_SYNC_SAMPLE_COUNT];
+            const sync_sample *newer = &samples[(oldest_index + sample_count - half_count + age_index) % NET_SYNC_SAMPLE_COUNT];
+            older_time_sum += time_delta_milliseconds(newest->local_time, older->local_time);
+            older_offset_sum += older->offset - newest->offset;
+            newer_time_sum += time_delta_milliseconds(newest->local_time, newer->local_time);
+            newer_offset_sum += newer->offset - newest->offset;
+        }
+        // Limit the change in offset so that it can't overflow, which is far beyond the drift limit anyway:
+        int32_t offset_change = newer_offset_sum - older_offset_sum;
+        if (offset_change > 2000) {
+            offset_change = 2000;
+        } else if (offset_change < -2000) {
+            offset_change = -2000;
+        }
+        drift_ppm = offset_change * 1000000 / (newer_time_sum - older_time_sum);
+        if (drift_ppm > MAX_DRIFT_PPM) {
+            drift_ppm = MAX_DRIFT_PPM;
+        } else if (drift_ppm < -MAX_DRIFT_PPM) {
+            drift_ppm = -MAX_DRIFT_PPM;
+        }
+    }
+
+    // Take the offset from the newest sample alone. Fitting it to every sample along the drift predicts ahead of the
+    // samples, which amplifies any wander in the estimate of the node the samples came from, hop after hop:
+    reference_time = newest->local_time;
+    reference_offset = newest->offset;
+}
+
+static void add_sample(time local_time, time network_time) {
+    // Throw away the older samples if the network time has jumped since them:
+    int32_t offset = time_delta_milliseconds(local_time, network_time);
+    if (sample_count > 0) {
+        int32_t error = offset - time_delta_milliseconds(local_time, to_network_time(local_time));
+        if (error > MAX_SAMPLE_ERROR_MILLISECONDS || error < -MAX_SAMPLE_ERROR_MILLISECONDS) {
+            sample_count = 0;
+            drift_ppm = 0;
+        }
+    }
+
+    newest_sample_index = (newest_sample_index + 1) % NET_SYNC_SAMPLE_COUNT;
+    samples[newest_sample_index].local_time = local_time;
+    samples[newest_sample_index].offset = offset;
+    if (sample_count < NET_SYNC_SAMPLE_COUNT) {
+        sample_count++;
+    }
+    update_estimate();
+}
+
+static void send_time_sync_packet(uint8_t sequence_number) {
+    // Send the network time of our previous packet, and note when this one went so it can be sent in the next:
+    uint8_t previous_sequence_number = has_sent ? sent_sequence_number : sequence_number;
+    has_sent = net_send_time_sync_packet(root_address, sequence_number, previous_sequence_number, sent_network_time);
+    if (has_sent) {
+        sent_sequence_number = sequence_number;
+        sent_network_time = to_network_time(dll_get_transmit_time());
+    }
+}
+
+static void update_scheduled_actions() {
+    time network_time = net_get_network_time();
+    for (uint8_t action_index = 0; action_index < NET_MAX_SCHEDULED_ACTIONS; action_index++) {
+        scheduled_action *action = &scheduled_actions[action_index];
+        if (action->callback != NULL && time_delta_milliseconds(action->network_time, network_time) >= 0) {
+            // Free the entry before calling the callback, so that the callback can schedule another action:
+            net_action_callback callback = action->callback;
+            action->callback = NULL;
+            callback(action->network_time);
+        }
+    }
+}
+
+void net_initialise_sync() {
+    root_address = NO_ROOT;
+    root_heard_time = time_now();
+    reference_time = root_heard_time;
+    reference_offset = 0;
+    drift_ppm = 0;
+    clear_samples();
+    for (uint8_t action_index = 0; action_index < NET_MAX_SCHEDULED_ACTIONS; action_index++) {
+        scheduled_actions[action_index].callback = NULL;
+    }
+}
+
+void net_update_sync() {
+    time now = time_now();
+    net_address own_address = net_get_own_address();
+
+    // Take over as the root if the root has gone quiet, or none has been heard since this node started:
+    if (root_address != own_address && time_delta_milliseconds(root_heard_time, now) >= ROOT_TIMEOUT_MILLISECONDS) {
+        become_root(now);
+    }
+
+    // The root starts a new round of time sync packets every interval, and every other synchronised node passes on each
+    // new round once:
+    if (root_address == own_address && time_delta_milliseconds(send_time, now) >= 0) {
+        send_time = time_add_milliseconds(send_time, NET_SYNC_INTERVAL_MILLISECONDS);
+        send_time_sync_packet(++root_sequence_number);
+    } else if (is_send_pending && time_delta_milliseconds(send_time, now) >= 0) {
+        is_send_pending = false;
+        send_time_sync_packet(root_sequence_number);
+    }
+
+    update_scheduled_actions();
+}
+
+void net_notify_time_sync(net_address source, net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time, time receive_time) {
+    net_address own_address = net_get_own_address();
+    if (source > NET_MAX_ADDRESS || root > NET_MAX_ADDRESS || source == own_address) {
+        return;
+    }
+
+    // Follow a root with a lower address than the current one, and ignore any other root. The root itself has nothing
+    // to learn from its own packets being passed on:
+    if (root_address == NO_ROOT || root < root_address) {
+        root_address = root;
+        root_sequence_number = sequence_number - 1;
+        clear_samples();
+    } else if (root != root_address || root == own_address) {
+        return;
+    }
+
+    // Pair the source's previous packet with when it arrived here. Every neighbour passes on the same round, so only the
+    // first pair for each round is used:
+    uint16_t source_bit = (uint16_t) 1 << source;
+    if (previous_sequence_number != sequence_number && (received_sources & source_bit) && received_sequence_numbers[source] == previous_sequence_number
+        && (sample_count == 0 || is_sequence_number_newer(previous_sequence_number, sampled_sequence_number))) {
+        add_sample(received_times[source], previous_time);
+        sampled_sequence_number = previous_sequence_number;
+    }
+    received_sources |= source_bit;
+    received_sequence_numbers[source] = sequence_number;
+    received_times[source] = receive_time;
+
+    // A new round shows that the root is still there, and is passed on once this node has its own estimate:
+    if (is_sequence_number_newer(sequence_number, root_sequence_number)) {
+        root_sequence_number = sequence_number;
+        root_heard_time = time_now();
+        if (sample_count > 0) {
+            is_send_pending = true;
+            send_time = time_add_milliseconds(root_heard_time, random_milliseconds(FORWARD_JITTER_MILLISECONDS));
+        }
+    }
+}
+
+bool net_is_time_synchronised() {
+    return root_address == net_get_own_address() || (root_address != NO_ROOT && sample_count > 0);
+}
+
+time net_get_network_time() {
+    return to_network_time(time_now());
+}
+
+bool net_schedule_action(time network_time, net_action_callback callback) {
+    if (callback == NULL) {
+        return false;
+    }
+    for (uint8_t action_index = 0; action_index < NET_MAX_SCHEDULED_ACTIONS; action_index++) {
+        scheduled_action *action = &scheduled_actions[action_index];
+        if (action->callback == NULL) {
+            action->network_time = network_time;
+            action->callback = callback;
+            return true;
+        }
+    }
+    return false;
+}
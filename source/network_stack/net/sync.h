@@ -0,0 +1,55 @@
+#pragma once
+
+#include "network_stack/net.h"
+#include "time.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * How often the root sends out a time sync packet, which every synchronised node passes on. Each packet gives every
+ * node one more sample of its clock against the network time.
+ */
+#ifndef NET_SYNC_INTERVAL_MILLISECONDS
+#define NET_SYNC_INTERVAL_MILLISECONDS (2000)
+#endif
+
+/**
+ * The number of samples that the estimate of this node's clock offset and drift is worked out from. Older samples are
+ * replaced by newer ones.
+ */
+#ifndef NET_SYNC_SAMPLE_COUNT
+#define NET_SYNC_SAMPLE_COUNT (8)
+#endif
+
+/**
+ * The number of actions that can be scheduled at once.
+ */
+#ifndef NET_MAX_SCHEDULED_ACTIONS
+#define NET_MAX_SCHEDULED_ACTIONS (4)
+#endif
+
+/**
+ * @brief Initialises the clock synchronisation. Until a time sync packet is heard, the network time is this node's own
+ *        clock.
+ */
+void net_initialise_sync();
+
+/**
+ * @brief Updates the clock synchronisation: sends out this node's time sync packets, takes over as the root if the
+ *        root hasn't been heard from for too long, and calls any scheduled actions which are due.
+ */
+void net_update_sync();
+
+/**
+ * @brief Handles a received time sync packet. The root with the lowest address wins, and packets for any other root are
+ *        ignored. The packet's previous time is paired with when this node received the source's previous packet, to
+ *        give a sample of this node's clock against the network time.
+ * @param source: The neighbour that sent the packet.
+ * @param root: The node whose clock is the network time.
+ * @param sequence_number: The root's sequence number which the packet passes on.
+ * @param previous_sequence_number: The sequence number of the source's previous packet, or the same as
+ *                                  'sequence_number' if there isn't one.
+ * @param previous_time: The network time at which the source's previous packet finished being sent.
+ * @param receive_time: The local time at which this packet finished being received.
+ */
+void net_notify_time_sync(net_address source, net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time, time receive_time);
@@ -0,0 +1,208 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This benchmark runs the router with area routing (built with 'NET_AREA_ROUTING' defined) as every node of a building
+ * with four floors of four addresses each, one floor to an area. The nodes on each floor form a chain, and 0x00 to 0x03
+ * on the ground floor (area 0, the backbone) are the building's riser: the first node of each of the other floors
+ * (0x04, 0x08 and 0x0C) is linked to 0x01, 0x02 and 0x03 respectively. Every node's physical (dll) address is its
+ * logical (net) address plus 0x10, and every link has the minimum cost.
+ *
+ * Each node is started with its neighbours, and given every other node's link state packet and the area summaries that
+ * the border nodes sent out when it was their turn. This is repeated three times, so that the backbone's border nodes
+ * pass on what they learned from each other's summaries. On the last round, each node prints how many link states it
+ * holds, how many link state packets and summaries it would flood on, and how many of the other 15 addresses it has a
+ * route to. In a flat build, every node holds and floods all 15 link states.
+ */
+
+#define ROUND_COUNT (3)
+#define FLOOR_SIZE (1 << NET_AREA_NODE_BITS)
+
+time current_time = TIME_ZERO;
+net_address own_address = 0x00;
+
+// The last summary sent out by each border node:
+bool is_summary_sent[NET_MAX_ADDRESS + 1];
+uint8_t summary_direct_areas[NET_MAX_ADDRESS + 1];
+uint8_t summary_costs[NET_MAX_ADDRESS + 1][NET_AREA_COUNT];
+
+bool are_nodes_adjacent(net_address node_1, net_address node_2) {
+    // Nodes next to each other on the same floor are linked:
+    if (net_get_area(node_1) == net_get_area(node_2) && (node_1 + 1 == node_2 || node_2 + 1 == node_1)) {
+        return true;
+    }
+
+    // The first node of each floor above the ground floor is linked to the riser node with its floor's number:
+    return (node_1 % FLOOR_SIZE == 0 && node_1 != 0 && node_2 == net_get_area(node_1))
+        || (node_2 % FLOOR_SIZE == 0 && node_2 != 0 && node_1 == net_get_area(node_2));
+}
+
+void run_node(net_address node, bool is_printed) {
+    own_address = node;
+    net_initialise_routing();
+    for (net_address neighbour = 0; neighbour <= NET_MAX_ADDRESS; neighbour++) {
+        if (are_nodes_adjacent(node, neighbour)) {
+            net_notify_ping_response(0x10 + neighbour, neighbour);
+        }
+    }
+    net_update_routing();
+
+    // Receive every other node's link state packet, and then every summary sent out so far:
+    uint8_t link_states_flooded = 0;
+    for (net_address source = 0; source <= NET_MAX_ADDRESS; source++) {
+        uint8_t link_costs[NET_MAX_ADDRESS + 1] = { 0 };
+        for (net_address linked_node = 0; linked_node <= NET_MAX_ADDRESS; linked_node++) {
+            if (are_nodes_adjacent(source, linked_node)) {
+                link_costs[linked_node] = NET_LINK_COST_MIN;
+            }
+        }
+        if (source != node && net_notify_link_state_packet(0x10 + source, source, 0x01, link_costs)) {
+            link_states_flooded++;
+        }
+    }
+    uint8_t summaries_flooded = 0;
+    for (net_address source = 0; source <= NET_MAX_ADDRESS; source++) {
+        if (source != node && is_summary_sent[source]
+            && net_notify_area_summary(source, 0x01, summary_direct_areas[source], summary_costs[source])) {
+            summaries_flooded++;
+        }
+    }
+
+    // Recalculate the routes, and send out our own summary if we're on a border:
+    net_update_routing();
+    net_update_routing();
+    if (is_printed == false) {
+        return;
+    }
+
+    uint8_t link_states_held = 0;
+    uint8_t destinations_reached = 0;
+    for (net_address address = 0; address <= NET_MAX_ADDRESS; address++) {
+        uint8_t sequence_number;
+        if (net_get_link_state_sequence_number(address, &sequence_number)) {
+            link_states_held++;
+        }
+        if (address != node && net_get_next_hop(address) != NET_NEXT_HOP_NOT_RESOLVED) {
+            destinations_reached++;
+        }
+    }
+    uart_put_string("  Node ");
+    uart_print_hex_8(node);
+    uart_put_string(" (area ");
+    uart_print_hex_8(net_get_area(node));
+    uart_put_string("): link states held ");
+    uart_print_hex_8(link_states_held);
+    uart_put_string(", flooded ");
+    uart_print_hex_8(link_states_flooded);
+    uart_put_string(", summaries flooded ");
+    uart_print_hex_8(summaries_flooded);
+    uart_put_string(", destinations reached ");
+    uart_print_hex_8(destinations_reached);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- Four floors of four ---\n\r");
+    for (uint8_t round = 0; round < ROUND_COUNT; round++) {
+        for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+            run_node(node, round == ROUND_COUNT - 1);
+        }
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use the node currently being run as our own address:
+    return own_address;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+bool net_send_area_summary_packet(net_address source, uint8_t sequence_number, uint8_t direct_areas, const uint8_t costs[]) {
+    // Keep our own summary for the nodes run after us. Stored summaries passed on for new neighbours are left out, as
+    // every node is given every summary anyway:
+    if (source == own_address) {
+        is_summary_sent[source] = true;
+        summary_direct_areas[source] = direct_areas;
+        for (uint8_t area = 0; area < NET_AREA_COUNT; area++) {
+            summary_costs[source][area] = costs[area];
+        }
+    }
+    return true;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
@@ -0,0 +1,226 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This test runs the router with area routing (built with 'NET_AREA_ROUTING' defined), with four areas of four
+ * addresses each, and emulates the following network graph:
+ *
+ *    area 0   :       area 1                  :   area 2
+ *             :                               :
+ *      01 . . 04 . . . 05 . . . 06 . . . 07 . . . 08
+ *     (11)   (14)     (15)     (16)     (17)     (18)
+ *             :       own                     :
+ *             :     address                   :
+ *
+ * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
+ * brackets correspond to the nodes' physical (dll) addresses in hex. This device is node 0x05, in area 1. Nodes 0x04 and
+ * 0x07 are on the border of area 1 with areas 0 (the backbone) and 2.
+ *
+ * Only the link states of area 1 should be kept. Destinations in area 0 should be routed through 0x04, and destinations
+ * in area 2 through 0x07, which has the cheaper path into it, going by the border nodes' summaries. Area 3 can't be
+ * reached.
+ *
+ * Later on, 0x09 in area 2 becomes a neighbour, which puts this device on the border of area 2. It should send out a
+ * summary of its own, and hold the link states of area 2 as well. When 0x0D in area 3 also becomes a neighbour, only two
+ * areas fit in the link state table, so the link state from 0x08 in area 2 should be kept while the one from 0x0E in
+ * area 3 is dropped. Once the links to 0x09 and 0x0D time out, it should send out a last summary without areas 2 and 3.
+ */
+
+time current_time = TIME_ZERO;
+
+const uint8_t link_costs_0x01[NET_MAX_ADDRESS + 1] = { [0x02] = 2, [0x04] = 2 };
+const uint8_t link_costs_0x04[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x05] = 2 };
+const uint8_t link_costs_0x06[NET_MAX_ADDRESS + 1] = { [0x05] = 2, [0x07] = 2 };
+const uint8_t link_costs_0x07[NET_MAX_ADDRESS + 1] = { [0x06] = 2, [0x08] = 2 };
+const uint8_t link_costs_0x08[NET_MAX_ADDRESS + 1] = { [0x07] = 2, [0x09] = 2 };
+const uint8_t link_costs_0x0E[NET_MAX_ADDRESS + 1] = { [0x0D] = 2, [0x0F] = 2 };
+
+// The summaries of the border nodes: 0x04 is in the backbone, so it also passes on the cost of reaching area 2 that it
+// learned from 0x07's summary. 0x0C only borders area 3.
+const uint8_t area_costs_0x04[NET_AREA_COUNT] = { 4, 6, 6, NET_AREA_COST_UNREACHABLE };
+const uint8_t area_costs_0x07[NET_AREA_COUNT] = { NET_AREA_COST_UNREACHABLE, 6, 2, NET_AREA_COST_UNREACHABLE };
+const uint8_t area_costs_0x0C[NET_AREA_COUNT] = { NET_AREA_COST_UNREACHABLE, NET_AREA_COST_UNREACHABLE, NET_AREA_COST_UNREACHABLE, 0 };
+
+void print_next_hops();
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    // Emulate discovering the neighbours:
+    net_initialise_routing();
+    net_notify_ping_response(0x14, 0x04);
+    net_notify_ping_response(0x16, 0x06);
+    net_update_routing();
+
+    // Emulate receiving the link states (expect the one from 0x01 in area 0 to be dropped rather than flooded):
+    uart_put_string("\n\r--- Receiving link state packets ---\n\r  Flooded: ");
+    uart_print_hex_8(net_notify_link_state_packet(0x14, 0x01, 0x01, link_costs_0x01));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_link_state_packet(0x14, 0x04, 0x01, link_costs_0x04));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_link_state_packet(0x16, 0x06, 0x01, link_costs_0x06));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_link_state_packet(0x16, 0x07, 0x01, link_costs_0x07));
+    uart_put_string("\n\r");
+    net_update_routing();
+    uart_put_string("\n\r--- Before receiving any area summaries ---\n\r");
+    print_next_hops();
+
+    // Emulate receiving the border nodes' summaries (expect the one from 0x0C, which doesn't border area 1, to be dropped,
+    // and the one from 0x04 to only be flooded once):
+    uart_put_string("\n\r--- Receiving area summaries ---\n\r  Flooded: ");
+    uart_print_hex_8(net_notify_area_summary(0x04, 0x01, 0x03, area_costs_0x04));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_area_summary(0x04, 0x01, 0x03, area_costs_0x04));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_area_summary(0x07, 0x01, 0x06, area_costs_0x07));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_area_summary(0x0C, 0x01, 0x08, area_costs_0x0C));
+    uart_put_string("\n\r");
+    net_update_routing();
+    uart_put_string("\n\r--- After receiving area summaries ---\n\r");
+    print_next_hops();
+
+    // Emulate 0x09 in area 2 becoming a neighbour, which puts us on the border of area 2:
+    uart_put_string("\n\r--- After 0x09 in area 2 becomes a neighbour ---\n\r");
+    net_notify_ping_response(0x19, 0x09);
+    net_update_routing();
+    print_next_hops();
+
+    // Emulate 0x0D in area 3 becoming a neighbour too, and receiving link states from areas 2 and 3 (expect the one from
+    // 0x0E to be dropped, as there's no room for a third area):
+    uart_put_string("\n\r--- After 0x0D in area 3 also becomes a neighbour ---\n\r");
+    net_notify_ping_response(0x1D, 0x0D);
+    net_update_routing();
+    uart_put_string("  Flooded: ");
+    uart_print_hex_8(net_notify_link_state_packet(0x19, 0x08, 0x01, link_costs_0x08));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_link_state_packet(0x1D, 0x0E, 0x01, link_costs_0x0E));
+    uart_put_string("\n\r");
+    net_update_routing();
+    print_next_hops();
+
+    // Keep the links to 0x04 and 0x06 alive, and let the links to 0x09 and 0x0D time out:
+    uart_put_string("\n\r--- After the links to 0x09 and 0x0D time out ---\n\r");
+    uint8_t ping_sequence_number = 0;
+    for (uint8_t second = 0; second < 65; second++) {
+        current_time = time_add_seconds(current_time, 1);
+        ping_sequence_number++;
+        net_notify_ping_request(0x14, 0x04, ping_sequence_number, false, false, true);
+        net_notify_ping_request(0x16, 0x06, ping_sequence_number, false, false, true);
+        net_update_routing();
+    }
+    print_next_hops();
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+void print_next_hops() {
+    // Print out the next hop of every destination:
+    uart_put_string("  Node Area Online Next hop\n\r");
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        uart_put_string("  ");
+        uart_print_hex_8(node);
+        uart_put_string("   ");
+        uart_print_hex_8(net_get_area(node));
+        uart_put_string("   ");
+        uart_print_hex_8(net_is_device_online(node));
+        uart_put_string("     ");
+        uart_print_hex_8(net_get_next_hop(node));
+        uart_put_string("\n\r");
+    }
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x05 as our own address:
+    return 0x05;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+bool net_send_area_summary_packet(net_address source, uint8_t sequence_number, uint8_t direct_areas, const uint8_t costs[]) {
+    uart_put_string("Send area summary packet of ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r  Direct areas: ");
+    uart_print_hex_8(direct_areas);
+    uart_put_string("\n\r  Costs:        ");
+    for (uint8_t area = 0; area < NET_AREA_COUNT; area++) {
+        uart_print_hex_8(costs[area]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+    return true;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
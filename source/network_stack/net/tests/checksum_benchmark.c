@@ -0,0 +1,159 @@
+#include "time.h"
+#include "uart.h"
+#include "../checksum.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This benchmark compares the cost and error detection of every checksum type.
+ *
+ * The cost is measured by generating the checksum on the same packet many times, for a packet the size of a single frame
+ * (23 bytes) and the largest packet (128 bytes), timing each case with the millisecond timer and printing the total time
+ * and the average number of CPU cycles per packet.
+ *
+ * The detection is measured by corrupting copies of random single-frame packets with each kind of error below, and
+ * counting the corrupted packets whose checksum still matches the original one, which would be delivered undetected:
+ * - A single flipped bit.
+ * - Two flipped bits anywhere in the packet.
+ * - A burst of flipped bits up to 16 bits long (the first and last bits of the burst are always flipped).
+ * - A single byte replaced by a random value.
+ */
+
+// The number of packets to time for each checksum type and packet size:
+#ifndef CHECKSUM_BENCHMARK_PACKET_COUNT
+#define CHECKSUM_BENCHMARK_PACKET_COUNT (10000)
+#endif
+
+// The number of corrupted packets to check for each checksum type and kind of error:
+#ifndef CHECKSUM_BENCHMARK_ERROR_COUNT
+#define CHECKSUM_BENCHMARK_ERROR_COUNT (20000)
+#endif
+
+#define SHORT_PACKET_LENGTH (23)
+#define LONG_PACKET_LENGTH (128)
+
+typedef enum {
+    ERROR_SINGLE_BIT,
+    ERROR_TWO_BITS,
+    ERROR_BURST,
+    ERROR_BYTE,
+} error_kind;
+
+const net_checksum_type checksum_types[] = { NET_CHECKSUM_EVEN_PARITY, NET_CHECKSUM_FLETCHER_16, NET_CHECKSUM_CRC_16 };
+const char *const checksum_names[] = { "Even parity", "Fletcher-16", "CRC-16     " };
+
+uint32_t random_state = 0x2545F491;
+uint8_t packet[LONG_PACKET_LENGTH];
+
+// Keeps the checksums, so that generating them can't be optimised away:
+volatile uint16_t checksum_sum = 0;
+
+uint32_t get_random() {
+    // 32-bit xorshift generator with a fixed seed, so that every run sees the same packets and errors:
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+void flip_bit(uint8_t *data, uint16_t bit) {
+    data[bit >> 3] ^= (uint8_t) (1 << (bit & 7));
+}
+
+void corrupt_packet(uint8_t *data, uint8_t length, error_kind kind) {
+    uint16_t bit_count = (uint16_t) length * 8;
+    switch (kind) {
+        case ERROR_SINGLE_BIT:
+            flip_bit(data, get_random() % bit_count);
+            break;
+
+        case ERROR_TWO_BITS: {
+            uint16_t first_bit = get_random() % bit_count;
+            uint16_t second_bit = (first_bit + 1 + get_random() % (bit_count - 1)) % bit_count;
+            flip_bit(data, first_bit);
+            flip_bit(data, second_bit);
+        } break;
+
+        case ERROR_BURST: {
+            uint8_t burst_length = 2 + get_random() % 15;
+            uint16_t first_bit = get_random() % (bit_count - burst_length + 1);
+            flip_bit(data, first_bit);
+            for (uint8_t bit = 1; bit < burst_length - 1; bit++) {
+                if (get_random() & 1) {
+                    flip_bit(data, first_bit + bit);
+                }
+            }
+            flip_bit(data, first_bit + burst_length - 1);
+        } break;
+
+        case ERROR_BYTE: {
+            uint8_t index = get_random() % length;
+            data[index] ^= 1 + get_random() % 255;
+        } break;
+    }
+}
+
+void time_checksum(const char *name, net_checksum_type checksum_type, uint8_t length) {
+    time start = time_now();
+    for (uint32_t i = 0; i < CHECKSUM_BENCHMARK_PACKET_COUNT; i++) {
+        checksum_sum += net_generate_checksum(checksum_type, packet, length);
+    }
+    int32_t milliseconds = time_delta_milliseconds(start, time_now());
+
+    uart_put_string("  ");
+    uart_put_string(name);
+    uart_put_string(", ");
+    uart_print_hex_8(length);
+    uart_put_string(" bytes: ");
+    uart_print_hex_16(milliseconds);
+    uart_put_string(" ms, ");
+    uart_print_hex_16(milliseconds * (F_CPU / 1000) / CHECKSUM_BENCHMARK_PACKET_COUNT);
+    uart_put_string(" cycles per packet\n\r");
+}
+
+uint16_t count_undetected_errors(net_checksum_type checksum_type, error_kind kind) {
+    uint16_t undetected_count = 0;
+    uint8_t corrupted_packet[SHORT_PACKET_LENGTH];
+    for (uint32_t i = 0; i < CHECKSUM_BENCHMARK_ERROR_COUNT; i++) {
+        for (uint8_t index = 0; index < SHORT_PACKET_LENGTH; index++) {
+            packet[index] = get_random();
+            corrupted_packet[index] = packet[index];
+        }
+        uint16_t checksum = net_generate_checksum(checksum_type, packet, SHORT_PACKET_LENGTH);
+        corrupt_packet(corrupted_packet, SHORT_PACKET_LENGTH, kind);
+        if (net_generate_checksum(checksum_type, corrupted_packet, SHORT_PACKET_LENGTH) == checksum) {
+            undetected_count++;
+        }
+    }
+    return undetected_count;
+}
+
+int main() {
+    uart_initialise();
+    time_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- Cost ---\n\r");
+    for (uint8_t index = 0; index < LONG_PACKET_LENGTH; index++) {
+        packet[index] = get_random();
+    }
+    for (uint8_t type_index = 0; type_index < sizeof(checksum_types) / sizeof(checksum_types[0]); type_index++) {
+        time_checksum(checksum_names[type_index], checksum_types[type_index], SHORT_PACKET_LENGTH);
+        time_checksum(checksum_names[type_index], checksum_types[type_index], LONG_PACKET_LENGTH);
+    }
+
+    uart_put_string("\n\r--- Undetected errors out of ");
+    uart_print_hex_16(CHECKSUM_BENCHMARK_ERROR_COUNT);
+    uart_put_string(" ---\n\r              1 bit 2 bits Burst Byte\n\r");
+    for (uint8_t type_index = 0; type_index < sizeof(checksum_types) / sizeof(checksum_types[0]); type_index++) {
+        uart_put_string("  ");
+        uart_put_string(checksum_names[type_index]);
+        for (error_kind kind = ERROR_SINGLE_BIT; kind <= ERROR_BYTE; kind++) {
+            uart_put_string(" ");
+            uart_print_hex_16(count_undetected_errors(checksum_types[type_index], kind));
+        }
+        uart_put_string("\n\r");
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
@@ -56,6 +56,49 @@ int main() {
         0
     );
 
+    // Fletcher-16 test vectors ("abcde", "abcdef" and "abcdefgh"):
+    test_checksum(
+        (uint8_t[]) { 'a', 'b', 'c', 'd', 'e' }, 5,
+        NET_CHECKSUM_FLETCHER_16,
+        0xC8F0
+    );
+
+    test_checksum(
+        (uint8_t[]) { 'a', 'b', 'c', 'd', 'e', 'f' }, 6,
+        NET_CHECKSUM_FLETCHER_16,
+        0x2057
+    );
+
+    test_checksum(
+        (uint8_t[]) { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h' }, 8,
+        NET_CHECKSUM_FLETCHER_16,
+        0x0627
+    );
+
+    // Fletcher-16 on more data than fits in one block of sums, where every byte is 0xFF (both sums are 0 modulo 255):
+    uint8_t long_data[40];
+    for (uint8_t i = 0; i < sizeof(long_data); i++) {
+        long_data[i] = 0xFF;
+    }
+    test_checksum(
+        long_data, sizeof(long_data),
+        NET_CHECKSUM_FLETCHER_16,
+        0x0000
+    );
+
+    // CRC-16 test vector ("123456789"):
+    test_checksum(
+        (uint8_t[]) { '1', '2', '3', '4', '5', '6', '7', '8', '9' }, 9,
+        NET_CHECKSUM_CRC_16,
+        0x6F91
+    );
+
+    test_checksum(
+        (uint8_t[]) { 0x00 }, 1,
+        NET_CHECKSUM_CRC_16,
+        0x0F87
+    );
+
     // ############################################################################################
 
     uart_put_string("\n\rFinished.\n\r\n\r");
@@ -86,6 +129,12 @@ void test_checksum(uint8_t *data, uint8_t data_length, net_checksum_type checksu
         case NET_CHECKSUM_EVEN_PARITY: {
             uart_put_string("Even parity");
         } break;
+        case NET_CHECKSUM_FLETCHER_16: {
+            uart_put_string("Fletcher-16");
+        } break;
+        case NET_CHECKSUM_CRC_16: {
+            uart_put_string("CRC-16");
+        } break;
     }
 
     // Print the expected and calcualted checksums:
@@ -0,0 +1,295 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include "../persist.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This benchmark measures the control traffic of the network layer's routing on a 4x4 grid of 16 nodes, where each node
+ * is linked to the nodes next to it:
+ *
+ *    00 . 01 . 02 . 03
+ *    .    .    .    .
+ *    04 . 05 . 06 . 07
+ *    .    .    .    .
+ *    08 . 09 . 0A . 0B
+ *    .    .    .    .
+ *    0C . 0D . 0E . 0F
+ *
+ * Every node's physical (dll) address is its logical (net) address plus 0x10, and no frames are lost.
+ *
+ * Each node is run in turn for two hours with the router, and its neighbours are emulated on the same schedule as the
+ * node: they send a ping request whenever it does, and every other node sends out its link state whenever it does. The
+ * ping requests, ping responses and link state packets that the node sends in the second hour are counted. Every node
+ * floods each link state packet on once with a single broadcast, so each one the network sends out takes one
+ * transmission per node.
+ *
+ * This is compared with the original routing, worked out from its packet layout: every 10 seconds each node sent a
+ * 4-byte ping request broadcast, which every neighbour answered with a 5-byte ping response, and a link state packet
+ * listing its neighbours one byte each, sent to each neighbour in turn. Each node sent a link state packet on to every
+ * neighbour except the one it came from.
+ *
+ * The bytes per minute over the whole network are printed for each, including DLL's framing and the ACKs of unicast
+ * frames. Time synchronisation packets aren't counted.
+ */
+
+#define GRID_SIZE (4)
+#define NODE_COUNT (GRID_SIZE * GRID_SIZE)
+#define WARM_UP_SECONDS (3600)
+#define MEASURED_SECONDS (3600)
+#define STEP_MILLISECONDS (100)
+
+// Each frame costs DLL's framing on top of the packet, and each ACK a control frame:
+#define DLL_FRAME_OVERHEAD (9)
+#define DLL_ACK_FRAME_LENGTH (7)
+
+// The sizes of the network layer packets:
+#define PING_REQUEST_PACKET_LENGTH (7)
+#define PING_RESPONSE_PACKET_LENGTH (5)
+#define LINK_STATE_PACKET_HEADER_LENGTH (6)
+#define CHECKSUM_LENGTH (2)
+
+// The original packets and schedule:
+#define ORIGINAL_INTERVAL_SECONDS (10)
+#define ORIGINAL_PING_REQUEST_PACKET_LENGTH (4)
+#define ORIGINAL_PING_RESPONSE_PACKET_LENGTH (5)
+#define ORIGINAL_LINK_STATE_PACKET_HEADER_LENGTH (5)
+
+typedef enum {
+    TRAFFIC_PING,
+    TRAFFIC_LINK_STATE,
+    TRAFFIC_COUNT
+} traffic_type;
+
+time current_time = TIME_ZERO;
+net_address own_address = 0x00;
+bool is_counting = false;
+uint32_t bus_bytes[TRAFFIC_COUNT];
+
+// What the emulated neighbours do after the node's next update:
+bool is_ping_round_due = false;
+bool is_ping_response_round_due = false;
+bool is_link_state_round_due = false;
+uint8_t neighbour_ping_sequence_numbers[NODE_COUNT];
+uint8_t link_state_sequence_numbers[NODE_COUNT];
+
+bool are_nodes_adjacent(net_address node_1, net_address node_2) {
+    uint8_t row_1 = node_1 / GRID_SIZE;
+    uint8_t column_1 = node_1 % GRID_SIZE;
+    uint8_t row_2 = node_2 / GRID_SIZE;
+    uint8_t column_2 = node_2 % GRID_SIZE;
+    return (row_1 == row_2 && (column_1 + 1 == column_2 || column_2 + 1 == column_1))
+        || (column_1 == column_2 && (row_1 + 1 == row_2 || row_2 + 1 == row_1));
+}
+
+uint8_t count_neighbours(net_address node) {
+    uint8_t neighbour_count = 0;
+    for (net_address neighbour = 0; neighbour < NODE_COUNT; neighbour++) {
+        if (are_nodes_adjacent(node, neighbour)) {
+            neighbour_count++;
+        }
+    }
+    return neighbour_count;
+}
+
+uint8_t get_link_state_packet_length(net_address node) {
+    // The link bitmap is followed by a cost for every link, two to a byte:
+    return LINK_STATE_PACKET_HEADER_LENGTH + (count_neighbours(node) + 1) / 2 + CHECKSUM_LENGTH;
+}
+
+void count_bytes(traffic_type traffic, uint32_t length) {
+    if (is_counting) {
+        bus_bytes[traffic] += length;
+    }
+}
+
+void send_link_states(net_address node) {
+    // Every other node sends out its link state:
+    for (net_address source = 0; source < NODE_COUNT; source++) {
+        uint8_t link_costs[NET_MAX_ADDRESS + 1] = { 0 };
+        for (net_address linked_node = 0; linked_node < NODE_COUNT; linked_node++) {
+            if (are_nodes_adjacent(source, linked_node)) {
+                link_costs[linked_node] = NET_LINK_COST_MIN;
+            }
+        }
+        if (source != node) {
+            net_notify_link_state_packet(0x10 + source, source, ++link_state_sequence_numbers[source], link_costs);
+        }
+    }
+}
+
+void emulate_neighbours(net_address node) {
+    for (net_address neighbour = 0; neighbour < NODE_COUNT; neighbour++) {
+        if (are_nodes_adjacent(node, neighbour) == false) {
+            continue;
+        }
+        if (is_ping_response_round_due) {
+            net_notify_ping_response(0x10 + neighbour, neighbour);
+        }
+        if (is_ping_round_due) {
+            net_notify_ping_request(0x10 + neighbour, neighbour, ++neighbour_ping_sequence_numbers[neighbour], false, false, true);
+        }
+    }
+    if (is_link_state_round_due) {
+        send_link_states(node);
+    }
+    is_ping_round_due = false;
+    is_ping_response_round_due = false;
+    is_link_state_round_due = false;
+}
+
+void run_node(net_address node) {
+    own_address = node;
+    current_time = TIME_ZERO;
+    is_counting = false;
+    for (net_address address = 0; address < NODE_COUNT; address++) {
+        neighbour_ping_sequence_numbers[address] = 0;
+        link_state_sequence_numbers[address] = 0;
+    }
+    net_initialise_routing();
+    send_link_states(node);
+
+    for (uint32_t step = 0; step < (uint32_t) (WARM_UP_SECONDS + MEASURED_SECONDS) * 1000 / STEP_MILLISECONDS; step++) {
+        if (step == (uint32_t) WARM_UP_SECONDS * 1000 / STEP_MILLISECONDS) {
+            is_counting = true;
+        }
+        current_time = time_add_milliseconds(current_time, STEP_MILLISECONDS);
+        net_update_routing();
+        emulate_neighbours(node);
+    }
+}
+
+void print_bytes_per_minute(const char *name, uint32_t ping_bytes, uint32_t link_state_bytes) {
+    uint32_t minutes = MEASURED_SECONDS / 60;
+    uart_put_string(name);
+    uart_put_string("ping ");
+    uart_print_hex_16(ping_bytes / minutes);
+    uart_put_string(", link state ");
+    uart_print_hex_16(link_state_bytes / minutes);
+    uart_put_string(", total ");
+    uart_print_hex_16((ping_bytes + link_state_bytes) / minutes);
+    uart_put_string(" bytes per minute\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- 4x4 grid ---\n\r");
+
+    // Work out the original routing's traffic over the measured time:
+    uint32_t original_ping_bytes = 0;
+    uint32_t original_link_state_bytes = 0;
+    for (net_address node = 0; node < NODE_COUNT; node++) {
+        uint8_t neighbour_count = count_neighbours(node);
+        original_ping_bytes += ORIGINAL_PING_REQUEST_PACKET_LENGTH + DLL_FRAME_OVERHEAD;
+        original_ping_bytes += neighbour_count * (ORIGINAL_PING_RESPONSE_PACKET_LENGTH + DLL_FRAME_OVERHEAD + DLL_ACK_FRAME_LENGTH);
+
+        uint8_t link_state_packet_length = ORIGINAL_LINK_STATE_PACKET_HEADER_LENGTH + neighbour_count + CHECKSUM_LENGTH;
+        uint16_t transmission_count = neighbour_count;
+        for (net_address other_node = 0; other_node < NODE_COUNT; other_node++) {
+            if (other_node != node) {
+                transmission_count += count_neighbours(other_node) - 1;
+            }
+        }
+        original_link_state_bytes += transmission_count * (link_state_packet_length + DLL_FRAME_OVERHEAD + DLL_ACK_FRAME_LENGTH);
+    }
+    original_ping_bytes *= MEASURED_SECONDS / ORIGINAL_INTERVAL_SECONDS;
+    original_link_state_bytes *= MEASURED_SECONDS / ORIGINAL_INTERVAL_SECONDS;
+    print_bytes_per_minute("  Original: ", original_ping_bytes, original_link_state_bytes);
+
+    // Run each node with the router, and count what it sends:
+    for (net_address node = 0; node < NODE_COUNT; node++) {
+        run_node(node);
+    }
+    print_bytes_per_minute("  Router:   ", bus_bytes[TRAFFIC_PING], bus_bytes[TRAFFIC_LINK_STATE]);
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use the node currently being run as our own address:
+    return own_address;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+    // The neighbours send their own ping requests on the same schedule, and respond if asked to:
+    count_bytes(TRAFFIC_PING, PING_REQUEST_PACKET_LENGTH + DLL_FRAME_OVERHEAD);
+    is_ping_round_due = true;
+    is_ping_response_round_due |= is_response_requested;
+}
+
+void net_send_ping_response_packet(dll_address node) {
+    count_bytes(TRAFFIC_PING, PING_RESPONSE_PACKET_LENGTH + DLL_FRAME_OVERHEAD + DLL_ACK_FRAME_LENGTH);
+}
+
+bool net_send_link_state_packet() {
+    // The packet is flooded with one broadcast from every node. The other nodes refresh their link states on the same
+    // schedule:
+    count_bytes(TRAFFIC_LINK_STATE, (uint32_t) NODE_COUNT * (get_link_state_packet_length(own_address) + DLL_FRAME_OVERHEAD));
+    is_link_state_round_due = true;
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return net_send_link_state_packet();
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Start without a saved routing snapshot:
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
@@ -0,0 +1,196 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include "../persist.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This benchmark measures how long a scene change takes to leave a controller in the corner of a 4x4 grid, with and
+ * without spreading flows across equal-cost next hops:
+ *
+ *    00 . 01 . 02 . 03
+ *    .    .    .    .
+ *    04 . 05 . 06 . 07
+ *    .    .    .    .
+ *    08 . 09 . 0A . 0B
+ *    .    .    .    .
+ *    0C . 0D . 0E . 0F
+ *
+ * This device is the controller 0x00. Every node's physical (dll) address is its logical (net) address plus 0x10, and
+ * every link has the minimum cost and is its own bus. The controller sends a burst of packets to every node two or more
+ * hops away, which all leave through 0x01 or 0x04, so those two links limit how quickly the scene change gets out. The
+ * burst takes as long as the busier of the two links needs to carry its packets, each split into frames which are
+ * acknowledged one by one.
+ *
+ * With a single path, every destination takes the lowest of its equal-cost next hops, as the router did before it kept
+ * them all. With ECMP, each destination's flow takes the next hop the router hashes it onto. For both, the number of
+ * packets sent through each neighbour and the time the burst takes are printed.
+ */
+
+#define GRID_WIDTH (4)
+#define BURST_PACKET_COUNT (32)
+#define BURST_PAYLOAD_LENGTH (40)
+
+// Wire cost of a packet: a 5 byte header and 2 byte checksum around the payload, split into frames of up to 23 bytes
+// with 9 bytes of framing each, and a 8 byte ACK for every frame. Every byte takes 9 bits on a 100 kHz bus.
+#define PACKET_LENGTH (5 + BURST_PAYLOAD_LENGTH + 2)
+#define PACKET_FRAME_COUNT ((PACKET_LENGTH + 22) / 23)
+#define PACKET_WIRE_BYTES (PACKET_LENGTH + PACKET_FRAME_COUNT * (9 + 8))
+#define PACKET_WIRE_MICROSECONDS (PACKET_WIRE_BYTES * 9 * 10)
+
+time current_time = TIME_ZERO;
+
+uint8_t get_hop_count(net_address node) {
+    return node % GRID_WIDTH + node / GRID_WIDTH;
+}
+
+bool are_nodes_adjacent(net_address node_1, net_address node_2) {
+    uint8_t column_1 = node_1 % GRID_WIDTH, row_1 = node_1 / GRID_WIDTH;
+    uint8_t column_2 = node_2 % GRID_WIDTH, row_2 = node_2 / GRID_WIDTH;
+    return (column_1 == column_2 && (row_1 + 1 == row_2 || row_2 + 1 == row_1))
+        || (row_1 == row_2 && (column_1 + 1 == column_2 || column_2 + 1 == column_1));
+}
+
+dll_address get_single_path_next_hop(net_address destination) {
+    // The lowest of the equal-cost next hops, found among the next hops of flows from every source:
+    dll_address lowest_next_hop = NET_NEXT_HOP_NOT_RESOLVED;
+    for (net_address source = 0; source <= NET_MAX_ADDRESS; source++) {
+        dll_address next_hop = net_get_flow_next_hop(source, destination);
+        if (next_hop < lowest_next_hop) {
+            lowest_next_hop = next_hop;
+        }
+    }
+    return lowest_next_hop;
+}
+
+void run_burst(bool is_multipath) {
+    uint16_t packets_through_0x01 = 0;
+    uint16_t packets_through_0x04 = 0;
+    for (net_address destination = 0; destination <= NET_MAX_ADDRESS; destination++) {
+        if (get_hop_count(destination) < 2) {
+            continue;
+        }
+        dll_address next_hop = is_multipath ? net_get_next_hop(destination) : get_single_path_next_hop(destination);
+        if (next_hop == 0x11) {
+            packets_through_0x01 += BURST_PACKET_COUNT;
+        } else if (next_hop == 0x14) {
+            packets_through_0x04 += BURST_PACKET_COUNT;
+        }
+    }
+
+    uint16_t busiest_packet_count = packets_through_0x01 > packets_through_0x04 ? packets_through_0x01 : packets_through_0x04;
+    uart_put_string(is_multipath ? "  ECMP:        " : "  Single path: ");
+    uart_put_string("through 01 ");
+    uart_print_hex_16(packets_through_0x01);
+    uart_put_string(", through 04 ");
+    uart_print_hex_16(packets_through_0x04);
+    uart_put_string(", burst time ");
+    uart_print_hex_16((uint32_t) busiest_packet_count * PACKET_WIRE_MICROSECONDS / 1000);
+    uart_put_string(" ms\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    // Emulate discovering the neighbours and receiving every other node's link state packet:
+    net_initialise_routing();
+    net_notify_ping_response(0x11, 0x01);
+    net_notify_ping_response(0x14, 0x04);
+    for (net_address source = 1; source <= NET_MAX_ADDRESS; source++) {
+        uint8_t link_costs[NET_MAX_ADDRESS + 1] = { 0 };
+        for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+            if (are_nodes_adjacent(source, node)) {
+                link_costs[node] = NET_LINK_COST_MIN;
+            }
+        }
+        net_notify_link_state_packet(0x11, source, 0, link_costs);
+    }
+    net_update_routing();
+
+    uart_put_string("\n\r--- Scene change burst ---\n\r");
+    run_burst(false);
+    run_burst(true);
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x00 as our own address:
+    return 0x00;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+// The router's own control packets aren't needed in this benchmark, so they aren't sent anywhere.
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Start without a saved routing snapshot:
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
@@ -0,0 +1,163 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include "../persist.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This test emulates the following network graph:
+ *
+ *          02 .  . 03
+ *        .(12)    (13).
+ *      .                .
+ *    01 .  .  .  .  .  . 04
+ *   (11)                (14)
+ *   own
+ *  address
+ *
+ * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
+ * brackets correspond to the nodes' physical (dll) addresses in hex. This device is the node on the very left with
+ * logical address 0x01.
+ *
+ * All links have the minimum cost, so there are two equal-cost paths to 03: through 02 and through 04. Flows to 03 should
+ * be split between them depending on their source, always giving the same next hop for the same flow, while flows to 02
+ * and 04 have a single next hop.
+ *
+ * Then a packet to 0x02 fails to be delivered. Until a packet gets through to it again, every flow to 03 should go
+ * through 04.
+ *
+ * Finally 0x04 announces that it's a stub router. It doesn't pass on packets for other nodes, so every flow to 03 should
+ * go through 02, while 04 is still sent to directly.
+ */
+
+time current_time = TIME_ZERO;
+
+const uint8_t link_costs_0x02[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x03] = 2 };
+const uint8_t link_costs_0x03[NET_MAX_ADDRESS + 1] = { [0x02] = 2, [0x04] = 2 };
+const uint8_t link_costs_0x04[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x03] = 2 };
+
+void print_flow_next_hops() {
+    // Print out the next hop of the flow from every source to each of the other nodes:
+    uart_put_string("Flow next hops:\n\r  Source To 02 To 03 To 04\n\r");
+    for (net_address source = 0; source <= NET_MAX_ADDRESS; source++) {
+        uart_put_string("  ");
+        uart_print_hex_8(source);
+        for (net_address destination = 0x02; destination <= 0x04; destination++) {
+            uart_put_string("     ");
+            uart_print_hex_8(net_get_flow_next_hop(source, destination));
+        }
+        uart_put_string("\n\r");
+    }
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    // Emulate discovering the neighbours and receiving every other node's link state packet:
+    net_initialise_routing();
+    net_notify_ping_response(0x12, 0x02);
+    net_notify_ping_response(0x14, 0x04);
+    net_notify_link_state_packet(0x12, 0x02, 0, link_costs_0x02);
+    net_notify_link_state_packet(0x12, 0x03, 0, link_costs_0x03);
+    net_notify_link_state_packet(0x14, 0x04, 0, link_costs_0x04);
+    net_update_routing();
+
+    uart_put_string("\n\r--- Equal-cost next hops ---\n\r");
+    print_flow_next_hops();
+
+    uart_put_string("\n\r--- Packet to 02 failed ---\n\r");
+    net_notify_delivery(0x12, false, 3);
+    print_flow_next_hops();
+
+    uart_put_string("\n\r--- Packet to 02 delivered ---\n\r");
+    net_notify_delivery(0x12, true, 0);
+    print_flow_next_hops();
+
+    uart_put_string("\n\r--- 04 announced as a stub router ---\n\r");
+    net_notify_ping_request(0x14, 0x04, 1, false, true, true);
+    net_update_routing();
+    print_flow_next_hops();
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+// The router's own control packets aren't needed in this test, so they aren't sent anywhere.
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Start without a saved routing snapshot:
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
@@ -0,0 +1,255 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include "../persist.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This benchmark compares routing on measured link quality (ETX) with routing on hop count, over the following network
+ * graph, where the direct link between 0x01 and 0x03 is lossy and the links through 0x02 are clean:
+ *
+ *          02
+ *        .(12).
+ *      .        .
+ *    01 ~ ~ ~ ~ 03
+ *   (11)        (13)
+ *   own
+ *  address
+ *
+ * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
+ * brackets correspond to the nodes' physical (dll) addresses in hex. This device is the node on the left with logical
+ * address 0x01.
+ *
+ * The benchmark emulates the neighbours' ping requests and link state packets, losing each frame on a link with the
+ * link's loss rate, and sends a data packet to 0x03 every 100 milliseconds. Each hop is emulated like DLL: a frame is
+ * retransmitted up to 3 times until both it and its ACK get through, and the outcome of the first hop is passed back to
+ * the router. With ETX the router picks the next hop from its measured link costs; with hop count the packet always
+ * takes the direct link, as the shorter path. For each loss rate of the direct link, the number of data packets sent
+ * and delivered to 0x03, and the number of data frame transmissions over every hop, are printed for both.
+ */
+
+// The number of data packets to send for each loss rate and routing metric, after the link costs have settled:
+#ifndef ETX_BENCHMARK_PACKET_COUNT
+#define ETX_BENCHMARK_PACKET_COUNT (5000)
+#endif
+
+#define CLEAN_LINK_LOSS_PERCENT (2)
+#define MAX_RETRANSMISSIONS (3)
+
+const uint8_t lossy_link_loss_percents[] = { 10, 30, 50 };
+
+time current_time = TIME_ZERO;
+uint32_t random_state = 0x2545F491;
+
+uint8_t lossy_link_loss_percent = 0;
+uint8_t ping_sequence_number_0x12 = 0;
+uint8_t ping_sequence_number_0x13 = 0;
+uint8_t sequence_number_0x02 = 0;
+uint8_t sequence_number_0x03 = 0;
+
+uint16_t packets_sent = 0;
+uint16_t packets_delivered = 0;
+uint16_t frame_transmissions = 0;
+
+bool is_frame_received(uint8_t loss_percent) {
+    // 32-bit xorshift generator with a fixed seed, so that every run sees the same losses:
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return (random_state % 100) >= loss_percent;
+}
+
+uint8_t get_link_loss_percent(net_address node_1, net_address node_2) {
+    if ((node_1 == 0x01 && node_2 == 0x03) || (node_1 == 0x03 && node_2 == 0x01)) {
+        return lossy_link_loss_percent;
+    }
+    return CLEAN_LINK_LOSS_PERCENT;
+}
+
+bool send_over_hop(net_address from, net_address to, uint8_t *retransmission_count) {
+    // Emulate DLL sending a single-frame packet, retransmitting it until both the frame and its ACK get through:
+    uint8_t loss_percent = get_link_loss_percent(from, to);
+    for (uint8_t transmission = 0; transmission <= MAX_RETRANSMISSIONS; transmission++) {
+        frame_transmissions++;
+        *retransmission_count = transmission;
+        if (is_frame_received(loss_percent) && is_frame_received(loss_percent)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t get_expected_link_cost(uint8_t loss_percent) {
+    // The cost a node measures for a link is twice the expected number of transmissions over it, counting the ACK:
+    uint16_t delivery_percent = (uint16_t) (100 - loss_percent) * (100 - loss_percent) / 100;
+    uint16_t cost = (200 + delivery_percent / 2) / delivery_percent;
+    return cost > NET_LINK_COST_MAX ? NET_LINK_COST_MAX : cost;
+}
+
+void emulate_neighbours() {
+    // Every second, the neighbours send a ping request, and every 30 seconds a link state packet:
+    int32_t milliseconds = time_delta_milliseconds(TIME_ZERO, current_time);
+    if (milliseconds % 1000 == 0) {
+        ping_sequence_number_0x12++;
+        if (is_frame_received(get_link_loss_percent(0x02, 0x01))) {
+            net_notify_ping_request(0x12, 0x02, ping_sequence_number_0x12, false, false, true);
+        }
+        ping_sequence_number_0x13++;
+        if (is_frame_received(get_link_loss_percent(0x03, 0x01))) {
+            net_notify_ping_request(0x13, 0x03, ping_sequence_number_0x13, false, false, true);
+        }
+    }
+    if (milliseconds % 30000 == 0) {
+        uint8_t link_costs_0x02[NET_MAX_ADDRESS + 1] = { [0x01] = get_expected_link_cost(CLEAN_LINK_LOSS_PERCENT), [0x03] = get_expected_link_cost(CLEAN_LINK_LOSS_PERCENT) };
+        uint8_t link_costs_0x03[NET_MAX_ADDRESS + 1] = { [0x01] = get_expected_link_cost(lossy_link_loss_percent), [0x02] = get_expected_link_cost(CLEAN_LINK_LOSS_PERCENT) };
+        net_notify_link_state_packet(0x12, 0x02, ++sequence_number_0x02, link_costs_0x02);
+        net_notify_link_state_packet(0x13, 0x03, ++sequence_number_0x03, link_costs_0x03);
+    }
+}
+
+void send_data_packet(bool is_hop_count_routing) {
+    // Hop count routing always takes the direct link, while ETX routing asks the router:
+    dll_address next_hop = is_hop_count_routing ? 0x13 : net_get_next_hop(0x03);
+    if (next_hop == DLL_BROADCAST_ADDRESS) {
+        return;
+    }
+    net_address next_hop_address = next_hop == 0x12 ? 0x02 : 0x03;
+
+    // Pass the outcome of the first hop back to the router, as DLL would:
+    packets_sent++;
+    uint8_t retransmission_count;
+    bool is_delivered = send_over_hop(0x01, next_hop_address, &retransmission_count);
+    net_notify_delivery(next_hop, is_delivered, retransmission_count);
+    if (is_delivered && next_hop_address == 0x02) {
+        is_delivered = send_over_hop(0x02, 0x03, &retransmission_count);
+    }
+    if (is_delivered) {
+        packets_delivered++;
+    }
+}
+
+void run_scenario(bool is_hop_count_routing) {
+    ping_sequence_number_0x12 = 0;
+    ping_sequence_number_0x13 = 0;
+    net_initialise_routing();
+
+    // Let the link costs settle for a minute, sending data packets the whole time, then start counting:
+    for (uint32_t step = 0; step < 600 + (uint32_t) ETX_BENCHMARK_PACKET_COUNT; step++) {
+        if (step == 600) {
+            packets_sent = 0;
+            packets_delivered = 0;
+            frame_transmissions = 0;
+        }
+        current_time = time_add_milliseconds(current_time, 100);
+        emulate_neighbours();
+        net_update_routing();
+        send_data_packet(is_hop_count_routing);
+    }
+
+    uart_put_string(is_hop_count_routing ? "  Hop count: " : "  ETX:       ");
+    uart_put_string("next hop ");
+    uart_print_hex_8(is_hop_count_routing ? 0x13 : net_get_next_hop(0x03));
+    uart_put_string(", sent ");
+    uart_print_hex_16(packets_sent);
+    uart_put_string(", delivered ");
+    uart_print_hex_16(packets_delivered);
+    uart_put_string(", frame transmissions ");
+    uart_print_hex_16(frame_transmissions);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    for (uint8_t index = 0; index < sizeof(lossy_link_loss_percents); index++) {
+        lossy_link_loss_percent = lossy_link_loss_percents[index];
+        uart_put_string("\n\r--- Direct link loss (percent): ");
+        uart_print_hex_8(lossy_link_loss_percent);
+        uart_put_string(" ---\n\r");
+        run_scenario(false);
+        run_scenario(true);
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+// The router's own control packets aren't needed by the emulated neighbours, so they aren't sent anywhere.
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Start without a saved routing snapshot:
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
@@ -0,0 +1,189 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This test emulates the following network graph, where the link between 0x01 and 0x03 is marginal and keeps going up
+ * and down:
+ *
+ *          02
+ *        .(12).
+ *      .        .
+ *    01 ~ ~ ~ ~ 03
+ *   (11)        (13)
+ *   own
+ *  address
+ *
+ * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
+ * brackets correspond to the nodes' physical (dll) addresses in hex. This device is the node on the left with logical
+ * address 0x01. A data packet is sent to 0x03 every 100 milliseconds.
+ *
+ * For the first 20 minutes, the link to 0x03 is marginal: only one in every 65 of its ping requests gets through, and no
+ * data packets do. Each ping request that gets through brings the link up, and it goes down again when it times out. For
+ * the next 10 minutes the link is good. Every minute, the number of times the link was added to or removed from our
+ * link state, the number of link state packets sent out and the next hop to 0x03 are printed. After a few flaps the link
+ * should be suppressed, staying out of our link state (with 0x03 reached through 0x02) until it has been stable for a
+ * while.
+ */
+
+time current_time = TIME_ZERO;
+
+uint8_t ping_sequence_number_0x12 = 0;
+uint8_t ping_sequence_number_0x13 = 0;
+uint8_t sequence_number_0x02 = 0;
+uint8_t sequence_number_0x03 = 0;
+
+const uint8_t link_costs_0x02[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x03] = 2 };
+const uint8_t link_costs_0x03[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x02] = 2 };
+
+uint16_t link_state_packets_sent = 0;
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    // Emulate discovering the neighbours and receiving their link state packets:
+    net_initialise_routing();
+    net_notify_ping_response(0x12, 0x02);
+    net_notify_ping_response(0x13, 0x03);
+    net_notify_link_state_packet(0x12, 0x02, sequence_number_0x02++, link_costs_0x02);
+    net_notify_link_state_packet(0x13, 0x03, sequence_number_0x03++, link_costs_0x03);
+    net_update_routing();
+
+    uart_put_string("Minute Link changes LSPs sent Next hop to 03\n\r");
+    uint8_t link_change_count = 0;
+    bool is_link_in_link_state = net_are_nodes_linked(0x01, 0x03);
+    link_state_packets_sent = 0;
+    for (uint16_t tick = 1; tick <= 30 * 600; tick++) {
+        current_time = time_add_milliseconds(current_time, 100);
+        uint16_t second = tick / 10;
+        bool is_link_good = second >= 20 * 60;
+
+        // Emulate the neighbours' periodic ping requests and link state packets:
+        if (tick % 10 == 0) {
+            net_notify_ping_request(0x12, 0x02, ++ping_sequence_number_0x12, false, false, true);
+            ping_sequence_number_0x13++;
+            if (is_link_good || second % 65 == 0) {
+                net_notify_ping_request(0x13, 0x03, ping_sequence_number_0x13, false, false, true);
+            }
+        }
+        if (tick % 600 == 0) {
+            net_notify_link_state_packet(0x12, 0x02, sequence_number_0x02++, link_costs_0x02);
+            net_notify_link_state_packet(0x13, 0x03, sequence_number_0x03++, link_costs_0x03);
+        }
+
+        net_update_routing();
+
+        // Send a data packet to 0x03, which only gets through the direct link while it's good:
+        dll_address next_hop = net_get_next_hop(0x03);
+        if (next_hop == 0x13) {
+            net_notify_delivery(0x13, is_link_good, is_link_good ? 0 : 3);
+        } else if (next_hop == 0x12) {
+            net_notify_delivery(0x12, true, 0);
+        }
+
+        // Count the times the link is added to or removed from our link state:
+        if (net_are_nodes_linked(0x01, 0x03) != is_link_in_link_state) {
+            is_link_in_link_state = !is_link_in_link_state;
+            link_change_count++;
+        }
+
+        // Every minute, print out the counts:
+        if (tick % 600 == 0) {
+            uart_put_string("  ");
+            uart_print_hex_8(tick / 600);
+            uart_put_string("   ");
+            uart_print_hex_8(link_change_count);
+            uart_put_string("           ");
+            uart_print_hex_8(link_state_packets_sent);
+            uart_put_string("        ");
+            uart_print_hex_8(net_get_next_hop(0x03));
+            uart_put_string("\n\r");
+            link_change_count = 0;
+            link_state_packets_sent = 0;
+        }
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    link_state_packets_sent++;
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    link_state_packets_sent++;
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Start without a saved routing snapshot:
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
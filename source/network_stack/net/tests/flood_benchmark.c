@@ -0,0 +1,377 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include "../persist.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This benchmark measures the bus bytes spent at one hop of a link state flood over lossy links, in the following
+ * network graph:
+ *
+ *                   02 (12)
+ *                 .
+ *    08 . . 00 . 01 . . 03 (13)
+ *   (18)   (10) (11)
+ *               own   .
+ *              address  04 (14)
+ *
+ * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
+ * brackets correspond to the nodes' physical (dll) addresses in hex. This device is the node with logical address 0x01.
+ *
+ * Every 30 seconds, 0x08 changes the cost of one of its links and sends out its link state, as a full link state packet
+ * every fourth time and as a delta packet otherwise. 0x00 floods it on to this device, which floods it on to 0x02, 0x03
+ * and 0x04. Every frame is lost with the given loss rate, and unicast frames are retransmitted up to 3 times like DLL
+ * does, until both the frame and its ACK get through. When this device sends a database summary to 0x00, 0x00 sends out
+ * the link state it holds for 0x08 again if the summary shows that this device's is older or missing, as the router
+ * does. Ping requests aren't lost, so that the links stay up.
+ *
+ * The flood is run with broadcast frames, which is how link state packets that fit in one broadcast are flooded, and
+ * with a unicast frame to each neighbour, which is how larger ones are flooded. For each loss rate, the bus bytes
+ * (including DLL's framing and ACKs) per link state sent out by 0x08 are printed, split into the flood itself, the
+ * database summaries and link states sent again to make up for lost packets, and this device's own link state packets.
+ * The number of seconds for which this device held an out of date cost for 0x08's links is printed too.
+ */
+
+// The number of link states sent out by 0x08 for each loss rate and flooding method, after the links have come up:
+#ifndef FLOOD_BENCHMARK_UPDATE_COUNT
+#define FLOOD_BENCHMARK_UPDATE_COUNT (200)
+#endif
+
+#define UPDATE_INTERVAL_SECONDS (30)
+#define FULL_PACKET_INTERVAL (4)
+#define WARM_UP_SECONDS (60)
+#define MAX_RETRANSMISSIONS (3)
+
+// Each frame costs DLL's framing on top of the packet, and each ACK a control frame:
+#define DLL_FRAME_OVERHEAD (9)
+#define DLL_ACK_FRAME_LENGTH (7)
+
+// The sizes of the network layer packets sent in the benchmark:
+#define LINK_STATE_PACKET_HEADER_LENGTH (6)
+#define LINK_STATE_DELTA_PACKET_HEADER_LENGTH (5)
+#define DATABASE_SUMMARY_PACKET_HEADER_LENGTH (5)
+#define LINK_STATE_REQUEST_PACKET_LENGTH (7)
+#define CHECKSUM_LENGTH (2)
+
+#define SOURCE_ADDRESS (0x08)
+#define UPSTREAM_PHYSICAL_ADDRESS (0x10)
+#define DOWNSTREAM_NEIGHBOUR_COUNT (3)
+
+const uint8_t loss_percents[] = { 0, 5, 10, 20 };
+
+typedef enum {
+    TRAFFIC_FLOOD,
+    TRAFFIC_REPAIR,
+    TRAFFIC_OWN_LINK_STATE,
+    TRAFFIC_COUNT
+} traffic_type;
+
+time current_time = TIME_ZERO;
+uint32_t random_state = 0x2545F491;
+
+uint8_t loss_percent = 0;
+bool is_broadcast = true;
+uint8_t ping_sequence_number = 0;
+bool is_counting = false;
+traffic_type current_traffic = TRAFFIC_FLOOD;
+uint32_t bus_bytes[TRAFFIC_COUNT];
+uint16_t stale_seconds = 0;
+
+// The link state of 0x08, as held by 0x00:
+uint8_t source_sequence_number = 0;
+uint8_t source_base_sequence_number = 0;
+uint8_t source_link_costs[NET_MAX_ADDRESS + 1];
+uint8_t source_base_link_costs[NET_MAX_ADDRESS + 1];
+
+bool is_frame_received() {
+    // 32-bit xorshift generator with a fixed seed, so that every run sees the same losses:
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return (random_state % 100) >= loss_percent;
+}
+
+void count_bytes(uint16_t length) {
+    if (is_counting) {
+        bus_bytes[current_traffic] += length;
+    }
+}
+
+bool send_unicast(uint8_t packet_length, bool *is_received) {
+    // Emulate DLL sending a single-frame packet, retransmitting it until both it and its ACK get through. Returns whether
+    // the ACK got through, while the receiver has the packet if any of the frames got through:
+    *is_received = false;
+    for (uint8_t transmission = 0; transmission <= MAX_RETRANSMISSIONS; transmission++) {
+        count_bytes(packet_length + DLL_FRAME_OVERHEAD);
+        if (is_frame_received()) {
+            *is_received = true;
+            count_bytes(DLL_ACK_FRAME_LENGTH);
+            if (is_frame_received()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void flood_to_neighbours(uint8_t packet_length, uint8_t neighbour_count) {
+    // The packet is either broadcast once, or sent to each neighbour in turn:
+    if (is_broadcast) {
+        count_bytes(packet_length + DLL_FRAME_OVERHEAD);
+        return;
+    }
+    bool is_received;
+    for (uint8_t neighbour = 0; neighbour < neighbour_count; neighbour++) {
+        send_unicast(packet_length, &is_received);
+    }
+}
+
+void send_source_packet(bool is_delta) {
+    // Work out the packet's size:
+    uint8_t packet_length;
+    uint16_t changed_addresses = 0;
+    if (is_delta) {
+        uint8_t change_count = 0;
+        for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+            if (source_link_costs[node] != source_base_link_costs[node]) {
+                changed_addresses |= ((uint16_t) 1 << node);
+                change_count++;
+            }
+        }
+        packet_length = LINK_STATE_DELTA_PACKET_HEADER_LENGTH + change_count + CHECKSUM_LENGTH;
+    } else {
+        packet_length = LINK_STATE_PACKET_HEADER_LENGTH + 1 + CHECKSUM_LENGTH;
+    }
+
+    // 0x00 sends the packet to this device:
+    bool is_received;
+    if (is_broadcast) {
+        count_bytes(packet_length + DLL_FRAME_OVERHEAD);
+        is_received = is_frame_received();
+    } else {
+        send_unicast(packet_length, &is_received);
+    }
+    if (is_received == false) {
+        return;
+    }
+
+    // Flood the packet on if it's new to this device:
+    bool is_valid;
+    if (is_delta) {
+        is_valid = net_notify_link_state_delta_packet(UPSTREAM_PHYSICAL_ADDRESS, SOURCE_ADDRESS, source_sequence_number, source_base_sequence_number, changed_addresses, source_link_costs);
+    } else {
+        is_valid = net_notify_link_state_packet(UPSTREAM_PHYSICAL_ADDRESS, SOURCE_ADDRESS, source_base_sequence_number, source_base_link_costs);
+    }
+    if (is_valid) {
+        flood_to_neighbours(packet_length, DOWNSTREAM_NEIGHBOUR_COUNT);
+    }
+}
+
+void send_stored_source_link_state() {
+    // 0x00 sends out the full link state packet that its link state is based on, followed by a delta if needed:
+    traffic_type previous_traffic = current_traffic;
+    current_traffic = TRAFFIC_REPAIR;
+    send_source_packet(false);
+    if (source_sequence_number != source_base_sequence_number) {
+        send_source_packet(true);
+    }
+    current_traffic = previous_traffic;
+}
+
+void update_source(uint16_t update) {
+    // Change the cost of the link to 0x09, and send out the link state:
+    source_link_costs[0x09] = NET_LINK_COST_MIN + (update % 5);
+    source_sequence_number++;
+    if (update % FULL_PACKET_INTERVAL == 0) {
+        source_base_sequence_number = source_sequence_number;
+        for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+            source_base_link_costs[node] = source_link_costs[node];
+        }
+        send_source_packet(false);
+    } else {
+        send_source_packet(true);
+    }
+}
+
+void emulate_neighbours() {
+    ping_sequence_number++;
+    for (net_address neighbour = 0x00; neighbour <= 0x04; neighbour++) {
+        if (neighbour != net_get_own_address()) {
+            net_notify_ping_request(0x10 + neighbour, neighbour, ping_sequence_number, false, false, true);
+        }
+    }
+}
+
+void run_scenario() {
+    random_state = 0x2545F491;
+    ping_sequence_number = 0;
+    is_counting = false;
+    for (uint8_t index = 0; index < TRAFFIC_COUNT; index++) {
+        bus_bytes[index] = 0;
+    }
+    stale_seconds = 0;
+    source_sequence_number = 0;
+    source_base_sequence_number = 0;
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        source_link_costs[node] = 0;
+    }
+    source_link_costs[0x00] = NET_LINK_COST_MIN;
+    source_link_costs[0x09] = NET_LINK_COST_MIN;
+    net_initialise_routing();
+
+    // Let the links come up, then start counting:
+    uint16_t update = 0;
+    for (uint32_t second = 0; second < WARM_UP_SECONDS + (uint32_t) FLOOD_BENCHMARK_UPDATE_COUNT * UPDATE_INTERVAL_SECONDS; second++) {
+        if (second == WARM_UP_SECONDS) {
+            is_counting = true;
+        }
+        current_time = time_add_seconds(current_time, 1);
+        emulate_neighbours();
+        if (second % UPDATE_INTERVAL_SECONDS == 0) {
+            update_source(update++);
+        }
+        net_update_routing();
+        if (is_counting && net_get_link_cost(SOURCE_ADDRESS, 0x09) != source_link_costs[0x09]) {
+            stale_seconds++;
+        }
+    }
+
+    uart_put_string(is_broadcast ? "  Broadcast: " : "  Unicast:   ");
+    uart_put_string("bytes per update ");
+    uart_print_hex_16((bus_bytes[TRAFFIC_FLOOD] + bus_bytes[TRAFFIC_REPAIR] + bus_bytes[TRAFFIC_OWN_LINK_STATE]) / FLOOD_BENCHMARK_UPDATE_COUNT);
+    uart_put_string(" (flood ");
+    uart_print_hex_16(bus_bytes[TRAFFIC_FLOOD] / FLOOD_BENCHMARK_UPDATE_COUNT);
+    uart_put_string(", repairs ");
+    uart_print_hex_16(bus_bytes[TRAFFIC_REPAIR] / FLOOD_BENCHMARK_UPDATE_COUNT);
+    uart_put_string(", own link state ");
+    uart_print_hex_16(bus_bytes[TRAFFIC_OWN_LINK_STATE] / FLOOD_BENCHMARK_UPDATE_COUNT);
+    uart_put_string("), stale seconds ");
+    uart_print_hex_16(stale_seconds);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    for (uint8_t index = 0; index < sizeof(loss_percents); index++) {
+        loss_percent = loss_percents[index];
+        uart_put_string("\n\r--- Frame loss (percent): ");
+        uart_print_hex_8(loss_percent);
+        uart_put_string(" ---\n\r");
+        is_broadcast = true;
+        run_scenario();
+        is_broadcast = false;
+        run_scenario();
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    // Our own link state packet lists our four links, and is flooded to all of them:
+    traffic_type previous_traffic = current_traffic;
+    current_traffic = TRAFFIC_OWN_LINK_STATE;
+    flood_to_neighbours(LINK_STATE_PACKET_HEADER_LENGTH + 2 + CHECKSUM_LENGTH, DOWNSTREAM_NEIGHBOUR_COUNT + 1);
+    current_traffic = previous_traffic;
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return net_send_link_state_packet();
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    // The summary lists our own link state and 0x08's, if we hold it:
+    uint8_t sequence_number;
+    bool is_source_held = net_get_link_state_sequence_number(SOURCE_ADDRESS, &sequence_number);
+    traffic_type previous_traffic = current_traffic;
+    current_traffic = TRAFFIC_REPAIR;
+    bool is_received;
+    bool is_acknowledged = send_unicast(DATABASE_SUMMARY_PACKET_HEADER_LENGTH + 1 + is_source_held + CHECKSUM_LENGTH, &is_received);
+    current_traffic = previous_traffic;
+
+    // 0x00 sends out its link state for 0x08 if ours is older or missing:
+    uint8_t sequence_number_difference = source_sequence_number - sequence_number;
+    if (is_received && node == UPSTREAM_PHYSICAL_ADDRESS && source_sequence_number != 0
+        && (is_source_held == false || (sequence_number_difference != 0 && sequence_number_difference < 128))) {
+        send_stored_source_link_state();
+    }
+    return is_acknowledged;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    traffic_type previous_traffic = current_traffic;
+    current_traffic = TRAFFIC_REPAIR;
+    bool is_received;
+    bool is_acknowledged = send_unicast(LINK_STATE_REQUEST_PACKET_LENGTH, &is_received);
+    current_traffic = previous_traffic;
+
+    if (is_received && node == UPSTREAM_PHYSICAL_ADDRESS && (sources & ((uint16_t) 1 << SOURCE_ADDRESS))) {
+        send_stored_source_link_state();
+    }
+    return is_acknowledged;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    // None of the emulated neighbours ask for link states:
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Start without a saved routing snapshot:
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
@@ -1,10 +1,14 @@
 #include "network_stack/dll.h"
 #include "network_stack/net.h"
 #include "../packets.h"
+#include "../queue.h"
 #include "../routing.h"
+#include "../sync.h"
+#include "time.h"
 #include "uart.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 
 void data_packet_receive_callback(net_address source, uint8_t *payload, uint8_t length) {
@@ -18,6 +22,28 @@ void data_packet_receive_callback(net_address source, uint8_t *payload, uint8_t
     uart_put_string("\n\r");
 }
 
+void send_result_callback(net_address destination, net_send_status status) {
+    uart_put_string("Held data packet finished:\n\r  Destination: ");
+    uart_print_hex_8(destination);
+    uart_put_string("\n\r  Status:      ");
+    uart_print_hex_8(status);
+    uart_put_string("\n\r");
+}
+
+void print_send_status(net_send_status status) {
+    uart_put_string("Send status: ");
+    uart_print_hex_8(status);
+    uart_put_string("\n\r");
+}
+
+void emulate_dll_receive(dll_address previous_hop, const uint8_t *packet, uint8_t packet_length);
+
+// The emulated current time, whether the emulated router has routes to 0x09, 0x0B and 0x0C, and whether our link to
+// 0x07 is up:
+time current_time = TIME_ZERO;
+bool is_route_resolved = false;
+bool is_link_0x07_up = true;
+
 int main() {
     uart_initialise();
     uart_put_string("\n\r============================================================\n\r");
@@ -32,115 +58,384 @@ int main() {
     for (uint8_t i = 0; i < data_length; i++) {
         buffer[i] = i;
     }
-    net_send_data_packet(destination, data_length);
+    print_send_status(net_send_data_packet(destination, data_length, NET_TRAFFIC_CLASS_BULK, false));
+
+    // Write and send a data packet whose checksum covers the payload:
+    uart_put_string("\n\r--- Sending data packet with payload checked ---\n\r");
+    buffer = net_get_data_buffer();
+    for (uint8_t i = 0; i < data_length; i++) {
+        buffer[i] = i;
+    }
+    print_send_status(net_send_data_packet(destination, data_length, NET_TRAFFIC_CLASS_BULK, true));
+
+    // Write and send a short data packet through a next hop which supports the compact header:
+    uart_put_string("\n\r--- Sending data packet with compact header ---\n\r");
+    buffer = net_get_data_buffer();
+    buffer[0] = 0xC1;
+    buffer[1] = 0xC2;
+    buffer[2] = 0xC3;
+    print_send_status(net_send_data_packet(0x0A, 3, NET_TRAFFIC_CLASS_INTERACTIVE, false));
+
+    // Write and send a short data packet whose checksum covers the payload, with the compact header:
+    uart_put_string("\n\r--- Sending data packet with compact header and payload checked ---\n\r");
+    buffer = net_get_data_buffer();
+    buffer[0] = 0xC1;
+    buffer[1] = 0xC2;
+    buffer[2] = 0xC3;
+    print_send_status(net_send_data_packet(0x0A, 3, NET_TRAFFIC_CLASS_INTERACTIVE, true));
+
+    // Send data packets to destinations without a route (expect the second packet to 0x09 to replace the first, and the
+    // packet to 0x0C to be refused as both slots are taken), then find the routes:
+    uart_put_string("\n\r--- Sending data packets to destinations without route ---\n\r");
+    net_set_send_callback(send_result_callback);
+    buffer = net_get_data_buffer();
+    buffer[0] = 0xA1;
+    print_send_status(net_send_data_packet(0x09, 1, NET_TRAFFIC_CLASS_INTERACTIVE, false));
+    buffer = net_get_data_buffer();
+    buffer[0] = 0xA2;
+    print_send_status(net_send_data_packet(0x09, 1, NET_TRAFFIC_CLASS_INTERACTIVE, false));
+    buffer = net_get_data_buffer();
+    buffer[0] = 0xB1;
+    print_send_status(net_send_data_packet(0x0B, 1, NET_TRAFFIC_CLASS_INTERACTIVE, false));
+    buffer = net_get_data_buffer();
+    buffer[0] = 0xC1;
+    print_send_status(net_send_data_packet(0x0C, 1, NET_TRAFFIC_CLASS_INTERACTIVE, false));
+    net_update_pending();
+    uart_put_string("Routes found:\n\r");
+    is_route_resolved = true;
+    net_update_pending();
+
+    // Send a data packet to a destination without a route, which is never found (expect it to expire):
+    uart_put_string("\n\r--- Sending data packet to destination without route which is never found ---\n\r");
+    is_route_resolved = false;
+    print_send_status(net_send_data_packet(0x09, 1, NET_TRAFFIC_CLASS_INTERACTIVE, false));
+    current_time = time_add_seconds(current_time, 29);
+    net_update_pending();
+    uart_put_string("Timed out:\n\r");
+    current_time = time_add_seconds(current_time, 1);
+    net_update_pending();
 
     // Broadcast a ping request packet:
     uart_put_string("\n\r--- Broadcasting ping_request packet ---\n\r");
-    net_send_ping_request_packet(DLL_BROADCAST_ADDRESS);
+    net_send_ping_request_packet(DLL_BROADCAST_ADDRESS, true);
 
     // Send a ping response packet:
     uart_put_string("\n\r--- Sending ping response packet ---\n\r");
     dll_address neighbouring_node = 0x12;
     net_send_ping_response_packet(neighbouring_node);
 
+    // Broadcast a time sync packet, for root 0x00's round 5, carrying when our packet for round 4 went:
+    uart_put_string("\n\r--- Broadcasting time sync packet ---\n\r");
+    print_send_status(net_send_time_sync_packet(0x00, 0x05, 0x04, 0x12345678) ? NET_SEND_SUCCESS : NET_SEND_FAILED);
+
     // Send a link state packet:
     uart_put_string("\n\r--- Flooding link state packet ---\n\r");
     net_send_link_state_packet();
+    net_update_forwarding();
+
+    // Send a link state update packet (nothing has changed since the full packet, so expect an empty delta packet):
+    uart_put_string("\n\r--- Flooding link state update packet ---\n\r");
+    net_send_link_state_update_packet();
+    net_update_forwarding();
+
+    // Send a link state update packet after the link to 0x07 goes down (expect a delta packet with one change, 2 bytes
+    // smaller than the full packet):
+    uart_put_string("\n\r--- Flooding link state update packet after a link goes down ---\n\r");
+    is_link_0x07_up = false;
+    net_send_link_state_update_packet();
+    net_update_forwarding();
+    is_link_0x07_up = true;
+
+    // Fill the queue with link state packets, then send another one (expect it to be refused without taking up a
+    // sequence number, so that the packet sent once the queue has emptied follows on from the last one queued):
+    uart_put_string("\n\r--- Flooding link state packet with the queue full ---\n\r");
+    for (uint8_t i = 0; i < NET_QUEUE_SIZE; i++) {
+        net_send_link_state_packet();
+    }
+    print_send_status(net_send_link_state_packet() ? NET_SEND_SUCCESS : NET_SEND_FAILED);
+    for (uint8_t i = 0; i < NET_QUEUE_SIZE; i++) {
+        net_update_forwarding();
+    }
+    print_send_status(net_send_link_state_packet() ? NET_SEND_SUCCESS : NET_SEND_FAILED);
+    net_update_forwarding();
+
+    // Send a database summary packet (expect our own link state and the ones held for 0x02 and 0x03):
+    uart_put_string("\n\r--- Sending database summary packet ---\n\r");
+    net_send_database_summary_packet(neighbouring_node);
+
+    // Send a link state request packet for the link states of 0x02 and 0x03:
+    uart_put_string("\n\r--- Sending link state request packet ---\n\r");
+    net_send_link_state_request_packet(neighbouring_node, 0x000C);
+
+    // Send a forwarding table packet to a stub router (next hop 0x01 to 0x01 and 0x03, 0x02 unreachable, every other
+    // destination through 0x04):
+    uart_put_string("\n\r--- Sending forwarding table packet ---\n\r");
+    uint8_t next_hops[NET_MAX_ADDRESS + 1];
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        next_hops[node] = 0x04;
+    }
+    next_hops[0x01] = 0x01;
+    next_hops[0x02] = 0x02;
+    next_hops[0x03] = 0x01;
+    net_send_forwarding_table_packet(neighbouring_node, next_hops);
+
+    // Send out the link state held for 0x02 (expect its base packet followed by a delta packet adding the link to 0x04):
+    uart_put_string("\n\r--- Flooding stored link state packet ---\n\r");
+    net_send_stored_link_state_packet(0x02);
+    net_update_forwarding();
+    net_update_forwarding();
 
 
     uart_put_string("--------------------------- RX tests -----------------------\n\r");
 
     net_set_receive_callback(data_packet_receive_callback);
 
+    // Packets to be forwarded are queued when they're received, so send any queued packet after receiving each one.
+
     // Receive data packet destined to our address:
     uart_put_string("\n\r--- Receiving data packet to our address ---\n\r");
     uint8_t data_packet_1[] = { 0x00, 0x04, 0x07, 0x01, 0x05, 0x00, 0x01, 0x02, 0x03, 0x04, 0x01, 0x00 };
-    net_handle_received_packet(0x12, data_packet_1, sizeof(data_packet_1));
+    emulate_dll_receive(0x12, data_packet_1, sizeof(data_packet_1));
+    net_update_forwarding();
 
     // Receive data packet destined to our address with parity error:
     uart_put_string("\n\r--- Receiving data packet to our address with parity error ---\n\r");
     uint8_t data_packet_2[] = { 0x00, 0x04, 0x07, 0x01, 0x05, 0x00, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00 };
-    net_handle_received_packet(0x12, data_packet_2, sizeof(data_packet_2));
+    emulate_dll_receive(0x12, data_packet_2, sizeof(data_packet_2));
+    net_update_forwarding();
 
     // Receive data packet destined to our address with length error:
     uart_put_string("\n\r--- Receiving data packet to our address with length error ---\n\r");
     uint8_t data_packet_3[] = { 0x00, 0x04, 0x07, 0x01, 0x07, 0x00, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00 };
-    net_handle_received_packet(0x12, data_packet_3, sizeof(data_packet_3));
+    emulate_dll_receive(0x12, data_packet_3, sizeof(data_packet_3));
+    net_update_forwarding();
+
+    // Receive data packet destined to our address with its payload checked by a Fletcher-16 checksum:
+    uart_put_string("\n\r--- Receiving data packet to our address with payload checked by Fletcher-16 ---\n\r");
+    uint8_t data_packet_10[] = { 0x04, 0x08, 0x07, 0x01, 0x03, 0xAA, 0xBB, 0xCC, 0x4A, 0xD7 };
+    emulate_dll_receive(0x12, data_packet_10, sizeof(data_packet_10));
+    net_update_forwarding();
+
+    // Receive data packet destined to our address with its payload checked by a CRC-16 checksum:
+    uart_put_string("\n\r--- Receiving data packet to our address with payload checked by CRC-16 ---\n\r");
+    uint8_t data_packet_11[] = { 0x04, 0x0C, 0x07, 0x01, 0x03, 0xAA, 0xBB, 0xCC, 0x9B, 0x47 };
+    emulate_dll_receive(0x12, data_packet_11, sizeof(data_packet_11));
+    net_update_forwarding();
+
+    // Receive data packet destined to our address with its payload checked, and an error in the payload:
+    uart_put_string("\n\r--- Receiving data packet to our address with payload checked and payload error ---\n\r");
+    uint8_t data_packet_12[] = { 0x04, 0x08, 0x07, 0x01, 0x03, 0xAA, 0xBA, 0xCC, 0x4A, 0xD7 };
+    emulate_dll_receive(0x12, data_packet_12, sizeof(data_packet_12));
+    net_update_forwarding();
 
     // Receve data packet destined to different address:
     uart_put_string("\n\r--- Receiving data packet to different address ---\n\r");
     uint8_t data_packet_4[] = { 0x00, 0x04, 0x07, 0x03, 0x05, 0x00, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00 };
-    net_handle_received_packet(0x12, data_packet_4, sizeof(data_packet_4));
+    emulate_dll_receive(0x12, data_packet_4, sizeof(data_packet_4));
+    net_update_forwarding();
 
     // Receve data packet destined to different address with parity error:
     uart_put_string("\n\r--- Receiving data packet to different address with parity error ---\n\r");
     uint8_t data_packet_5[] = { 0x00, 0x04, 0x07, 0x03, 0x05, 0x00, 0x01, 0x02, 0x03, 0x04, 0x01, 0x00 };
-    net_handle_received_packet(0x12, data_packet_5, sizeof(data_packet_5));
+    emulate_dll_receive(0x12, data_packet_5, sizeof(data_packet_5));
+    net_update_forwarding();
 
     // Receve data packet destined to different address with length error:
     uart_put_string("\n\r--- Receiving data packet to different address with length error ---\n\r");
     uint8_t data_packet_6[] = { 0x00, 0x04, 0x07, 0x03, 0x07, 0x00, 0x01, 0x02, 0x03, 0x04, 0x01, 0x00 };
-    net_handle_received_packet(0x12, data_packet_6, sizeof(data_packet_6));
+    emulate_dll_receive(0x12, data_packet_6, sizeof(data_packet_6));
+    net_update_forwarding();
+
+    // Receive a bulk data packet and then an interactive data packet destined to different address, before sending
+    // either of them (expect the interactive packet to be sent first):
+    uart_put_string("\n\r--- Receiving bulk and interactive data packets to different address ---\n\r");
+    uint8_t data_packet_7[] = { 0x00, 0x04, 0x07, 0x03, 0x05, 0x00, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00 };
+    uint8_t data_packet_8[] = { 0x02, 0x04, 0x07, 0x03, 0x05, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x01, 0x00 };
+    emulate_dll_receive(0x12, data_packet_7, sizeof(data_packet_7));
+    emulate_dll_receive(0x12, data_packet_8, sizeof(data_packet_8));
+    net_update_forwarding();
+    net_update_forwarding();
+
+    // Receive data packet destined to different address with an invalid traffic class:
+    uart_put_string("\n\r--- Receiving data packet to different address with invalid traffic class ---\n\r");
+    uint8_t data_packet_9[] = { 0x03, 0x04, 0x07, 0x03, 0x05, 0x00, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00 };
+    emulate_dll_receive(0x12, data_packet_9, sizeof(data_packet_9));
+    net_update_forwarding();
+
+    // Receive data packet with a compact header destined to our address:
+    uart_put_string("\n\r--- Receiving compact data packet to our address ---\n\r");
+    uint8_t compact_data_packet_1[] = { 0x88, 0x71, 0xAA, 0xBB, 0xCC, 0x00, 0x00 };
+    emulate_dll_receive(0x12, compact_data_packet_1, sizeof(compact_data_packet_1));
+    net_update_forwarding();
+
+    // Receive data packet with a compact header destined to our address, with its payload checked by Fletcher-16:
+    uart_put_string("\n\r--- Receiving compact data packet to our address with payload checked ---\n\r");
+    uint8_t compact_data_packet_2[] = { 0x94, 0x71, 0xAA, 0xBB, 0xCC, 0x39, 0xF0 };
+    emulate_dll_receive(0x12, compact_data_packet_2, sizeof(compact_data_packet_2));
+    net_update_forwarding();
+
+    // Receive data packet with a compact header destined to our address with parity error:
+    uart_put_string("\n\r--- Receiving compact data packet to our address with parity error ---\n\r");
+    uint8_t compact_data_packet_3[] = { 0x88, 0x71, 0xAA, 0xBB, 0xCC, 0x01, 0x00 };
+    emulate_dll_receive(0x12, compact_data_packet_3, sizeof(compact_data_packet_3));
+    net_update_forwarding();
+
+    // Receive data packet with a compact header and reserved bits set (expect it to be dropped):
+    uart_put_string("\n\r--- Receiving compact data packet with reserved bits set ---\n\r");
+    uint8_t compact_data_packet_4[] = { 0xC8, 0x71, 0xAA, 0xBB, 0xCC, 0x01, 0x00 };
+    emulate_dll_receive(0x12, compact_data_packet_4, sizeof(compact_data_packet_4));
+    net_update_forwarding();
+
+    // Receive data packet with a compact header destined to a different address, through a next hop without compact
+    // header support (expect it to be forwarded with the full header):
+    uart_put_string("\n\r--- Receiving compact data packet to different address ---\n\r");
+    uint8_t compact_data_packet_5[] = { 0x88, 0x73, 0xAA, 0xBB, 0xCC, 0x01, 0x00 };
+    emulate_dll_receive(0x12, compact_data_packet_5, sizeof(compact_data_packet_5));
+    net_update_forwarding();
+
+    // Receive data packet with a compact header destined to a different address, through a next hop with compact header
+    // support (expect it to be forwarded with the compact header):
+    uart_put_string("\n\r--- Receiving compact data packet to different address through compact next hop ---\n\r");
+    uint8_t compact_data_packet_6[] = { 0x8A, 0x7A, 0xAA, 0xBB, 0xCC, 0x00, 0x00 };
+    emulate_dll_receive(0x12, compact_data_packet_6, sizeof(compact_data_packet_6));
+    net_update_forwarding();
 
     // Receive ping request:
     uart_put_string("\n\r--- Receiving ping request packet ---\n\r");
-    uint8_t ping_request_packet_1[] = { 0x00, 0x24, 0x00, 0x00 };
-    net_handle_received_packet(0x12, ping_request_packet_1, sizeof(ping_request_packet_1));
+    uint8_t ping_request_packet_1[] = { 0x01, 0x24, 0x04, 0x01, 0x05, 0x01, 0x00 };
+    emulate_dll_receive(0x12, ping_request_packet_1, sizeof(ping_request_packet_1));
+    net_update_forwarding();
 
     // Receive ping request with parity error:
     uart_put_string("\n\r--- Receiving ping request packet with parity error ---\n\r");
-    uint8_t ping_request_packet_2[] = { 0x00, 0x24, 0x01, 0x00 };
-    net_handle_received_packet(0x12, ping_request_packet_2, sizeof(ping_request_packet_2));
+    uint8_t ping_request_packet_2[] = { 0x01, 0x24, 0x04, 0x01, 0x05, 0x00, 0x00 };
+    emulate_dll_receive(0x12, ping_request_packet_2, sizeof(ping_request_packet_2));
+    net_update_forwarding();
 
     // Receive ping request with length error:
     uart_put_string("\n\r--- Receiving ping request packet with length error ---\n\r");
-    uint8_t ping_request_packet_3[] = { 0x00, 0x24, 0x00, 0x00, 0x00 };
-    net_handle_received_packet(0x12, ping_request_packet_3, sizeof(ping_request_packet_3));
+    uint8_t ping_request_packet_3[] = { 0x01, 0x24, 0x04, 0x01, 0x05, 0x00, 0x01, 0x00 };
+    emulate_dll_receive(0x12, ping_request_packet_3, sizeof(ping_request_packet_3));
+    net_update_forwarding();
 
     // Receive ping response:
     uart_put_string("\n\r--- Receiving ping response packet ---\n\r");
-    uint8_t ping_response_packet_1[] = { 0x00, 0x34, 0x04, 0x00, 0x00 };
-    net_handle_received_packet(0x14, ping_response_packet_1, sizeof(ping_response_packet_1));
+    uint8_t ping_response_packet_1[] = { 0x01, 0x34, 0x04, 0x01, 0x00 };
+    emulate_dll_receive(0x14, ping_response_packet_1, sizeof(ping_response_packet_1));
+    net_update_forwarding();
 
     // Receive ping response with parity error:
     uart_put_string("\n\r--- Receiving ping response packet with parity error ---\n\r");
-    uint8_t ping_response_packet_2[] = { 0x00, 0x34, 0x04, 0x01, 0x00 };
-    net_handle_received_packet(0x14, ping_response_packet_2, sizeof(ping_response_packet_2));
+    uint8_t ping_response_packet_2[] = { 0x01, 0x34, 0x04, 0x00, 0x00 };
+    emulate_dll_receive(0x14, ping_response_packet_2, sizeof(ping_response_packet_2));
+    net_update_forwarding();
 
     // Receive ping response with length error:
     uart_put_string("\n\r--- Receiving ping response packet with length error ---\n\r");
-    uint8_t ping_response_packet_3[] = { 0x00, 0x34, 0x04, 0x00, 0x00, 0x00 };
-    net_handle_received_packet(0x14, ping_response_packet_3, sizeof(ping_response_packet_3));
+    uint8_t ping_response_packet_3[] = { 0x01, 0x34, 0x04, 0x00, 0x01, 0x00 };
+    emulate_dll_receive(0x14, ping_response_packet_3, sizeof(ping_response_packet_3));
+    net_update_forwarding();
 
-    // Receive link state packet from different address:
+    // Receive link state packet from different address (links to 0x01, 0x02 and 0x03 with costs 2, 3 and 2):
     uart_put_string("\n\r--- Receiving link state packet from different address ---\n\r");
-    uint8_t link_state_packet_1[] = { 0x00, 0x14, 0x02, 0x00, 0x03, 0x01, 0x02, 0x03, 0x01, 0x00 };
-    net_handle_received_packet(0x12, link_state_packet_1, sizeof(link_state_packet_1));
+    uint8_t link_state_packet_1[] = { 0x01, 0x14, 0x02, 0x00, 0x0E, 0x00, 0x32, 0x02, 0x01, 0x00 };
+    emulate_dll_receive(0x12, link_state_packet_1, sizeof(link_state_packet_1));
+    net_update_forwarding();
 
     // Receive link state packet from different address with parity error:
     uart_put_string("\n\r--- Receiving link state packet from different address with parity error ---\n\r");
-    uint8_t link_state_packet_2[] = { 0x00, 0x14, 0x02, 0x00, 0x03, 0x01, 0x02, 0x03, 0x00, 0x00 };
-    net_handle_received_packet(0x12, link_state_packet_2, sizeof(link_state_packet_2));
+    uint8_t link_state_packet_2[] = { 0x01, 0x14, 0x02, 0x00, 0x0E, 0x00, 0x32, 0x02, 0x00, 0x00 };
+    emulate_dll_receive(0x12, link_state_packet_2, sizeof(link_state_packet_2));
+    net_update_forwarding();
 
     // Receive link state packet from different address with length error:
     uart_put_string("\n\r--- Receiving link state packet from different address with length error ---\n\r");
-    uint8_t link_state_packet_3[] = { 0x00, 0x14, 0x02, 0x00, 0x05, 0x01, 0x02, 0x03, 0x01, 0x00 };
-    net_handle_received_packet(0x12, link_state_packet_3, sizeof(link_state_packet_3));
+    uint8_t link_state_packet_3[] = { 0x01, 0x14, 0x02, 0x00, 0x0E, 0x00, 0x32, 0x02, 0x00, 0x01, 0x00 };
+    emulate_dll_receive(0x12, link_state_packet_3, sizeof(link_state_packet_3));
+    net_update_forwarding();
 
     // Receive link state packet from our address:
     uart_put_string("\n\r--- Receiving link state packet from our address ---\n\r");
-    uint8_t link_state_packet_4[] = { 0x00, 0x14, 0x01, 0x00, 0x03, 0x01, 0x02, 0x03, 0x01, 0x00 };
-    net_handle_received_packet(0x12, link_state_packet_4, sizeof(link_state_packet_4));
+    uint8_t link_state_packet_4[] = { 0x01, 0x14, 0x01, 0x00, 0x0E, 0x00, 0x32, 0x02, 0x01, 0x00 };
+    emulate_dll_receive(0x12, link_state_packet_4, sizeof(link_state_packet_4));
+    net_update_forwarding();
 
     // Receive link state packet from our address with parity error:
     uart_put_string("\n\r--- Receiving link state packet from our address with parity error ---\n\r");
-    uint8_t link_state_packet_5[] = { 0x00, 0x14, 0x01, 0x00, 0x03, 0x01, 0x02, 0x03, 0x00, 0x00 };
-    net_handle_received_packet(0x12, link_state_packet_5, sizeof(link_state_packet_5));
+    uint8_t link_state_packet_5[] = { 0x01, 0x14, 0x01, 0x00, 0x0E, 0x00, 0x32, 0x02, 0x00, 0x00 };
+    emulate_dll_receive(0x12, link_state_packet_5, sizeof(link_state_packet_5));
+    net_update_forwarding();
 
     // Receive link state packet from our address with length error:
     uart_put_string("\n\r--- Receiving link state packet from our address with length error ---\n\r");
-    uint8_t link_state_packet_6[] = { 0x00, 0x14, 0x01, 0x00, 0x05, 0x01, 0x02, 0x03, 0x01, 0x00 };
-    net_handle_received_packet(0x12, link_state_packet_6, sizeof(link_state_packet_6));
+    uint8_t link_state_packet_6[] = { 0x01, 0x14, 0x01, 0x00, 0x0E, 0x00, 0x32, 0x02, 0x00, 0x01, 0x00 };
+    emulate_dll_receive(0x12, link_state_packet_6, sizeof(link_state_packet_6));
+    net_update_forwarding();
+
+    // Receive link state delta packet from different address (adds a link to 0x04 with cost 3 and removes the link to 0x01):
+    uart_put_string("\n\r--- Receiving link state delta packet from different address ---\n\r");
+    uint8_t link_state_delta_packet_1[] = { 0x01, 0x44, 0x02, 0x01, 0x00, 0x34, 0x01, 0x01, 0x00 };
+    emulate_dll_receive(0x12, link_state_delta_packet_1, sizeof(link_state_delta_packet_1));
+    net_update_forwarding();
+
+    // Receive database summary from 0x02 (holding the link states of 0x01 and 0x02 with sequence numbers 3 and 9):
+    uart_put_string("\n\r--- Receiving database summary packet ---\n\r");
+    uint8_t database_summary_packet_1[] = { 0x01, 0x54, 0x02, 0x06, 0x00, 0x03, 0x09, 0x01, 0x00 };
+    emulate_dll_receive(0x12, database_summary_packet_1, sizeof(database_summary_packet_1));
+    net_update_forwarding();
+
+    // Receive database summary with length error:
+    uart_put_string("\n\r--- Receiving database summary packet with length error ---\n\r");
+    uint8_t database_summary_packet_2[] = { 0x01, 0x54, 0x02, 0x07, 0x00, 0x03, 0x09, 0x01, 0x00 };
+    emulate_dll_receive(0x12, database_summary_packet_2, sizeof(database_summary_packet_2));
+    net_update_forwarding();
+
+    // Receive link state request for the link states of 0x02 and 0x03:
+    uart_put_string("\n\r--- Receiving link state request packet ---\n\r");
+    uint8_t link_state_request_packet_1[] = { 0x01, 0x64, 0x02, 0x0C, 0x00, 0x01, 0x00 };
+    emulate_dll_receive(0x12, link_state_request_packet_1, sizeof(link_state_request_packet_1));
+    net_update_forwarding();
+
+    // Receive link state request with parity error:
+    uart_put_string("\n\r--- Receiving link state request packet with parity error ---\n\r");
+    uint8_t link_state_request_packet_2[] = { 0x01, 0x64, 0x02, 0x0C, 0x00, 0x00, 0x00 };
+    emulate_dll_receive(0x12, link_state_request_packet_2, sizeof(link_state_request_packet_2));
+    net_update_forwarding();
+
+    // Receive ping request from a stub router:
+    uart_put_string("\n\r--- Receiving ping request packet from stub router ---\n\r");
+    uint8_t ping_request_packet_4[] = { 0x01, 0x24, 0x04, 0x03, 0x05, 0x00, 0x00 };
+    emulate_dll_receive(0x12, ping_request_packet_4, sizeof(ping_request_packet_4));
+    net_update_forwarding();
+
+    // Receive forwarding table (next hop 0x02 to every destination, except 0x03 through 0x04):
+    uart_put_string("\n\r--- Receiving forwarding table packet ---\n\r");
+    uint8_t forwarding_table_packet_1[] = { 0x01, 0x74, 0x02, 0x22, 0x42, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x00, 0x00 };
+    emulate_dll_receive(0x12, forwarding_table_packet_1, sizeof(forwarding_table_packet_1));
+    net_update_forwarding();
+
+    // Receive forwarding table with length error:
+    uart_put_string("\n\r--- Receiving forwarding table packet with length error ---\n\r");
+    uint8_t forwarding_table_packet_2[] = { 0x01, 0x74, 0x02, 0x22, 0x42, 0x22, 0x22, 0x22, 0x22, 0x22, 0x00, 0x00 };
+    emulate_dll_receive(0x12, forwarding_table_packet_2, sizeof(forwarding_table_packet_2));
+    net_update_forwarding();
+
+    // Receive link state delta packet from different address with length error:
+    uart_put_string("\n\r--- Receiving link state delta packet from different address with length error ---\n\r");
+    uint8_t link_state_delta_packet_2[] = { 0x01, 0x44, 0x02, 0x01, 0x00, 0x00 };
+    emulate_dll_receive(0x12, link_state_delta_packet_2, sizeof(link_state_delta_packet_2));
+    net_update_forwarding();
+
+    // Receive time sync packet from 0x02 for root 0x00's round 7, carrying when its packet for round 6 went:
+    uart_put_string("\n\r--- Receiving time sync packet ---\n\r");
+    current_time = time_add_seconds(current_time, 4);
+    uint8_t time_sync_packet_1[] = { 0x01, 0x90, 0x02, 0x00, 0x07, 0x06, 0x78, 0x56, 0x34, 0x12, 0x00, 0x00 };
+    emulate_dll_receive(0x12, time_sync_packet_1, sizeof(time_sync_packet_1));
+
+    // Receive time sync packet with length error:
+    uart_put_string("\n\r--- Receiving time sync packet with length error ---\n\r");
+    uint8_t time_sync_packet_2[] = { 0x01, 0x90, 0x02, 0x00, 0x07, 0x06, 0x78, 0x56, 0x34, 0x00, 0x00 };
+    emulate_dll_receive(0x12, time_sync_packet_2, sizeof(time_sync_packet_2));
 }
 
 //*************************** dll.h emulated implementation *************************//
@@ -156,33 +451,93 @@ uint8_t *dll_create_data_buffer(uint8_t net_packet_length) {
 }
 
 dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_length) {
+    return dll_send_buffer(dll_tx_buffer, destination_address, packet_length);
+}
+
+dll_send_response dll_send_buffer(const uint8_t *packet, dll_address destination_address, uint8_t packet_length) {
     // Print out the packet's physical destination and payload contents:
     uart_put_string("Sending DLL packet:\n\r  Next hop: ");
     uart_print_hex_8(destination_address);
     uart_put_string("\n\r  Payload:  ");
     for (uint8_t i = 0; i < packet_length; i++) {
-        uart_print_hex_8(dll_tx_buffer[i]);
+        uart_print_hex_8(packet[i]);
         uart_put_byte(' ');
     }
+    if (packet < dll_tx_buffer || packet >= dll_tx_buffer + sizeof(dll_tx_buffer)) {
+        uart_put_string("\n\r  (sent from a NET buffer)");
+    }
     uart_put_string("\n\r");
     return DLL_TRANSMISSION_SUCCESS;
 }
 
+uint8_t dll_rx_buffer_storage[128];
+uint8_t *dll_rx_buffer = dll_rx_buffer_storage;
+
+void dll_replace_receive_buffer(uint8_t *buffer) {
+    dll_rx_buffer = buffer;
+}
+
+time dll_get_receive_time() {
+    // Every packet is received at the emulated current time:
+    return current_time;
+}
+
+void emulate_dll_receive(dll_address previous_hop, const uint8_t *packet, uint8_t packet_length) {
+    // Reassemble the packet into DLL's receive buffer (which NET may take over), and pass it on to NET:
+    memcpy(dll_rx_buffer, packet, packet_length);
+    net_handle_received_packet(previous_hop, dll_rx_buffer, packet_length);
+}
+
+//**************************** sync.h emulated implementation ***************************//
+
+void net_notify_time_sync(net_address source, net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time, time receive_time) {
+    uart_put_string("Time sync received:\n\r  Source:   ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r  Root:     ");
+    uart_print_hex_8(root);
+    uart_put_string("\n\r  Sequence: ");
+    uart_print_hex_8(sequence_number);
+    uart_put_string(" (previous ");
+    uart_print_hex_8(previous_sequence_number);
+    uart_put_string(" sent at ");
+    uart_print_hex_16((uint32_t) previous_time >> 16);
+    uart_print_hex_16(previous_time);
+    uart_put_string(")\n\r  Received: ");
+    uart_print_hex_16(receive_time);
+    uart_put_string("\n\r");
+}
+
 //*************************** routing.h emulated implementation *************************//
 
 dll_address net_get_next_hop(net_address destination) {
-    // Just return a static address for emulation purposes.
-    return 0x50;
+    return net_get_flow_next_hop(net_get_own_address(), destination);
 }
 
-bool net_are_nodes_linked(net_address node_1, net_address node_2) {
+dll_address net_get_flow_next_hop(net_address source, net_address destination) {
+    // Just return a static address for emulation purposes (unless there's no route yet):
+    if ((destination == 0x09 || destination == 0x0B || destination == 0x0C) && is_route_resolved == false) {
+        return NET_NEXT_HOP_NOT_RESOLVED;
+    }
+    return (destination == 0x0A) ? 0x51 : 0x50;
+}
+
+uint8_t net_get_link_cost(net_address node_1, net_address node_2) {
     if (node_1 != net_get_own_address() || node_2 > NET_MAX_ADDRESS) {
-        return false;
+        return 0;
+    }
+
+    // Emulate that our node is linked to nodes with the following logical addresses and link costs:
+    switch (node_2) {
+        case 0x02: return 2;
+        case 0x03: return 3;
+        case 0x07: return is_link_0x07_up ? 6 : 0;
+        default: return 0;
     }
+}
 
-    // Emulate that our node is linked to nodes with the following logical addresses:
-    bool is_linked = (node_2 == 0x02 || node_2 == 0x03 || node_2 == 0x07);
-    return is_linked;
+bool net_is_compact_header_supported(dll_address node) {
+    // Emulate that only the next hop towards 0x0A supports the compact header:
+    return node == 0x51;
 }
 
 bool net_is_node_neighbour(dll_address node) {
@@ -199,29 +554,155 @@ void net_notify_ping_response(dll_address physical_address, net_address logical_
     uart_put_string("\n\r");
 }
 
-bool net_notify_link_state_packet(net_address source, uint8_t sequence_number, const net_address *node_list, uint8_t node_count) {
+void net_notify_ping_request(dll_address physical_address, net_address logical_address, uint8_t sequence_number, bool is_response_requested, bool is_stub, bool is_compact_header_supported) {
+    uart_put_string("Ping request received:\n\r  Physical address: ");
+    uart_print_hex_8(physical_address);
+    uart_put_string("\n\r  Logical address:  ");
+    uart_print_hex_8(logical_address);
+    uart_put_string("\n\r  Sequence number:  ");
+    uart_print_hex_8(sequence_number);
+    uart_put_string("\n\r  Response requested: ");
+    uart_print_hex_8(is_response_requested);
+    uart_put_string("\n\r  Stub router:        ");
+    uart_print_hex_8(is_stub);
+    uart_put_string("\n\r  Compact header:     ");
+    uart_print_hex_8(is_compact_header_supported);
+    uart_put_string("\n\r");
+
+    // Respond straight away for emulation purposes:
+    if (is_response_requested) {
+        net_send_ping_response_packet(physical_address);
+    }
+}
+
+bool net_notify_link_state_packet(dll_address physical_address, net_address source, uint8_t sequence_number, const uint8_t link_costs[NET_MAX_ADDRESS + 1]) {
+    bool is_valid = (source != net_get_own_address());
+    if (is_valid == false) {
+        return false;
+    }
+
+    uart_put_string("Link state packet received:\n\r  Previous hop:    ");
+    uart_print_hex_8(physical_address);
+    uart_put_string("\n\r  Source address:  ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r  Sequence number: ");
+    uart_print_hex_8(sequence_number);
+    uart_put_string("\n\r  Link costs:      ");
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        uart_print_hex_8(link_costs[node]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+
+    return true;
+}
+
+bool net_notify_link_state_delta_packet(dll_address physical_address, net_address source, uint8_t sequence_number, uint8_t base_sequence_number, uint16_t changed_addresses, const uint8_t link_costs[NET_MAX_ADDRESS + 1]) {
     bool is_valid = (source != net_get_own_address());
     if (is_valid == false) {
         return false;
     }
 
-    uart_put_string("Link state packet received:\n\r  Source address:  ");
+    uart_put_string("Link state delta packet received:\n\r  Previous hop:    ");
+    uart_print_hex_8(physical_address);
+    uart_put_string("\n\r  Source address:  ");
     uart_print_hex_8(source);
     uart_put_string("\n\r  Sequence number: ");
     uart_print_hex_8(sequence_number);
-    uart_put_string("\n\r  Nodes:           ");
-    for (uint8_t i = 0; i < node_count; i++) {
-        uart_print_hex_8(node_list[i]);
-        uart_put_string(", ");
+    uart_put_string("\n\r  Base sequence:   ");
+    uart_print_hex_8(base_sequence_number);
+    uart_put_string("\n\r  Changed nodes:   ");
+    uart_print_hex_16(changed_addresses);
+    uart_put_string("\n\r  Link costs:      ");
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        uart_print_hex_8(link_costs[node]);
+        uart_put_byte(' ');
     }
     uart_put_string("\n\r");
 
     return true;
 }
 
+void net_notify_database_summary(dll_address physical_address, net_address logical_address, uint16_t sources, const uint8_t sequence_numbers[NET_MAX_ADDRESS + 1]) {
+    uart_put_string("Database summary received:\n\r  Physical address: ");
+    uart_print_hex_8(physical_address);
+    uart_put_string("\n\r  Logical address:  ");
+    uart_print_hex_8(logical_address);
+    uart_put_string("\n\r  Sources:          ");
+    uart_print_hex_16(sources);
+    uart_put_string("\n\r  Sequence numbers: ");
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        uart_print_hex_8(sequence_numbers[node]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+void net_notify_link_state_request(uint16_t sources) {
+    uart_put_string("Link state request received:\n\r  Sources: ");
+    uart_print_hex_16(sources);
+    uart_put_string("\n\r");
+}
+
+void net_notify_forwarding_table(dll_address physical_address, net_address logical_address, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+    uart_put_string("Forwarding table received:\n\r  Physical address: ");
+    uart_print_hex_8(physical_address);
+    uart_put_string("\n\r  Logical address:  ");
+    uart_print_hex_8(logical_address);
+    uart_put_string("\n\r  Next hops:        ");
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        uart_print_hex_8(next_hops[node]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+bool net_is_stub_router() {
+    return false;
+}
+
+bool net_get_link_state_sequence_number(net_address source, uint8_t *sequence_number) {
+    // Emulate that we hold link states for the following nodes:
+    switch (source) {
+        case 0x02: *sequence_number = 0x06; return true;
+        case 0x03: *sequence_number = 0x11; return true;
+        default: return false;
+    }
+}
+
+bool net_get_link_state(net_address source, uint8_t *sequence_number, uint8_t link_costs[NET_MAX_ADDRESS + 1], uint8_t *base_sequence_number, uint8_t base_link_costs[NET_MAX_ADDRESS + 1]) {
+    if (source != 0x02) {
+        return false;
+    }
+
+    // Emulate that 0x02 sent a full link state packet with links to 0x01 and 0x03, followed by a delta adding a link to
+    // 0x04:
+    *sequence_number = 0x06;
+    *base_sequence_number = 0x05;
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        base_link_costs[node] = (node == 0x01 || node == 0x03) ? 2 : 0;
+        link_costs[node] = (node == 0x04) ? 3 : base_link_costs[node];
+    }
+    return true;
+}
+
 //*************************** net.h emulated implementation *************************//
 
 net_address net_get_own_address() {
     // Use 0x01 as our own address:
     return 0x01;
 }
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
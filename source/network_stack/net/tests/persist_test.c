@@ -0,0 +1,192 @@
+#include "storage.h"
+#include "../persist.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// The size of the emulated storage, which only needs to cover the persist module's slots:
+#define EMULATED_STORAGE_SIZE (1280)
+
+// The emulated storage, and the number of bytes that can be written to it before it stops being ready (emulating the
+// power going off partway through a save):
+uint8_t storage[EMULATED_STORAGE_SIZE];
+uint16_t write_budget = 0;
+
+// The number of bytes actually written, and the range of addresses they were written to, since the last save was
+// started:
+uint16_t written_byte_count = 0;
+uint16_t first_written_address = 0;
+uint16_t last_written_address = 0;
+
+void test_load(bool expected_result, uint8_t expected_block_id);
+void test_save(uint8_t block_id, bool is_write_expected);
+void test_interrupted_save(uint8_t block_id, uint16_t written_byte_count);
+void test_corrupted_block();
+void test_wear_levelling();
+void save_block(uint8_t block_id, uint16_t budget);
+void print_result(bool is_passed);
+
+int main() {
+    uart_initialise();
+
+    // Wait until the user has pressed ENTER:
+    int rx_byte = 0;
+    do {
+        rx_byte = uart_get_byte_nonblocking();
+    }
+    while (rx_byte != '\n' && rx_byte != '\r');
+
+    uart_put_string("Starting test.\n\r\n\r");
+
+    // Start with erased storage:
+    memset(storage, 0xFF, sizeof(storage));
+
+    // ############################################################################################
+    // Carry out the tests...
+
+    // Nothing has been saved yet:
+    test_load(false, 0);
+
+    // A saved block is loaded back after a restart:
+    test_save(0x01, true);
+    test_load(true, 0x01);
+
+    // Saving the same block again doesn't write anything:
+    test_save(0x01, false);
+
+    // The newest block is loaded:
+    test_save(0x02, true);
+    test_save(0x03, true);
+    test_load(true, 0x03);
+
+    // A save that's cut off partway through leaves the previous block in place:
+    test_interrupted_save(0x04, 3);
+    test_load(true, 0x03);
+
+    // So does a block that gets corrupted:
+    test_save(0x05, true);
+    test_corrupted_block();
+    test_load(true, 0x03);
+
+    // Blocks are saved into each slot in turn:
+    test_wear_levelling();
+
+    // ############################################################################################
+
+    uart_put_string("\n\rFinished.\n\r\n\r");
+}
+
+void test_load(bool expected_result, uint8_t expected_block_id) {
+    uint8_t block[4] = { 0 };
+    bool result = net_persist_load(block, sizeof(block));
+
+    uart_put_string("\n\rLoad block");
+    if (expected_result) {
+        uart_put_string(" (expecting ");
+        uart_print_hex_8(expected_block_id);
+        uart_put_string(")");
+        print_result(result && block[0] == expected_block_id && block[3] == expected_block_id);
+    } else {
+        uart_put_string(" (expecting nothing saved)");
+        print_result(result == false);
+    }
+}
+
+void test_save(uint8_t block_id, bool is_write_expected) {
+    save_block(block_id, EMULATED_STORAGE_SIZE);
+
+    uart_put_string("\n\rSave block ");
+    uart_print_hex_8(block_id);
+    uart_put_string(is_write_expected ? " (expecting it to be written)" : " (expecting nothing to be written)");
+    uart_put_string("\n\r  Bytes written: ");
+    uart_print_hex_16(written_byte_count);
+    print_result((written_byte_count > 0) == is_write_expected);
+}
+
+void test_interrupted_save(uint8_t block_id, uint16_t written_byte_count) {
+    save_block(block_id, written_byte_count);
+
+    uart_put_string("\n\rSave block ");
+    uart_print_hex_8(block_id);
+    uart_put_string(", cut off after ");
+    uart_print_hex_16(written_byte_count);
+    uart_put_string(" bytes\n\r");
+}
+
+void test_corrupted_block() {
+    // Flip a bit in the block that was just saved:
+    storage[last_written_address] ^= 0x01;
+    uart_put_string("\n\rCorrupt the last block saved\n\r");
+}
+
+void test_wear_levelling() {
+    // Save enough blocks to go around all the slots, and check that none of the first eight blocks are written over each
+    // other, while the ninth block reuses the first block's slot:
+    uart_put_string("\n\rSave 9 blocks\n\r  Addresses written:");
+    uint16_t first_addresses[9];
+    uint16_t last_addresses[9];
+    for (uint8_t block_index = 0; block_index < 9; block_index++) {
+        save_block(0x10 + block_index, EMULATED_STORAGE_SIZE);
+        first_addresses[block_index] = first_written_address;
+        last_addresses[block_index] = last_written_address;
+        uart_put_string("\n\r    ");
+        uart_print_hex_16(first_written_address);
+        uart_put_string(" to ");
+        uart_print_hex_16(last_written_address);
+    }
+
+    bool is_passed = first_addresses[8] <= last_addresses[0] && last_addresses[8] >= first_addresses[0];
+    for (uint8_t block_index = 0; block_index < 8; block_index++) {
+        for (uint8_t other_index = 0; other_index < block_index; other_index++) {
+            is_passed = is_passed && (first_addresses[block_index] > last_addresses[other_index]
+                || last_addresses[block_index] < first_addresses[other_index]);
+        }
+    }
+    print_result(is_passed);
+}
+
+void save_block(uint8_t block_id, uint16_t budget) {
+    // Start from a fresh load, as after a restart:
+    uint8_t block[4];
+    net_persist_load(block, sizeof(block));
+
+    // Save a block whose bytes identify it, and let it be written:
+    memset(block, block_id, sizeof(block));
+    written_byte_count = 0;
+    write_budget = budget;
+    net_persist_save(block, sizeof(block));
+    for (uint16_t update_index = 0; update_index < EMULATED_STORAGE_SIZE; update_index++) {
+        net_persist_update();
+    }
+}
+
+void print_result(bool is_passed) {
+    uart_put_string("\n\r  Test result: ");
+    uart_put_string(is_passed ? "PASS" : "FAIL");
+    uart_put_string("\n\r");
+}
+
+//************************* storage.h emulated implementation ***********************//
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    memcpy(data, &storage[address], data_length);
+}
+
+bool storage_is_ready() {
+    return write_budget > 0;
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+    // Like EEPROM, only write the byte if it has changed:
+    if (address >= EMULATED_STORAGE_SIZE || storage[address] == value) {
+        return;
+    }
+    if (written_byte_count == 0) {
+        first_written_address = address;
+    }
+    last_written_address = address;
+    storage[address] = value;
+    written_byte_count++;
+    write_budget--;
+}
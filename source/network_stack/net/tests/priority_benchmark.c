@@ -0,0 +1,244 @@
+#include "network_stack/net.h"
+#include "../queue.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * This benchmark measures how long a light switch command takes to cross a 3x3 grid of nodes on one shared bus while
+ * the network is flooding link state packets, with and without traffic classes in the forwarding queue.
+ *
+ * Each command is a 4 byte payload which travels 4 hops, and the node at each hop is run in turn with the forwarding
+ * queue, so that the time each command leaves one hop is the time it arrives at the next. A node takes the next packet
+ * out of its queue as soon as it's done with the last one, and holds it until it has sent it, like DLL does. On average
+ * each of the 9 nodes floods a link state packet every flood interval: every node hears each of them, queues it to
+ * send on, and the other 8 nodes send it on too. A stream of 40 byte bulk data packets passes through every hop every
+ * 50 milliseconds, and is sent over 3 more hops by other nodes. Each frame takes 90 microseconds a byte, including
+ * DLL's framing, and whenever the bus is free the next frame is picked at random from the nodes waiting to send one.
+ *
+ * Without traffic classes, link state packets go ahead of all data packets, and commands wait behind bulk data. With
+ * them, commands go ahead of link state packets, which go ahead of bulk data. For each flood interval, the bus load
+ * and the mean, 95th percentile and largest latency in milliseconds of 400 commands are printed, along with the number
+ * of commands lost because a queue was full.
+ */
+
+// The number of commands to send for each case:
+#ifndef PRIORITY_BENCHMARK_COMMAND_COUNT
+#define PRIORITY_BENCHMARK_COMMAND_COUNT (400)
+#endif
+
+#define TICK_MICROSECONDS (100)
+#define TICKS_PER_MILLISECOND (1000 / TICK_MICROSECONDS)
+#define BYTE_TIME_MICROSECONDS (90)
+#define DLL_FRAME_OVERHEAD (9)
+
+#define NODE_COUNT (9)
+#define HOP_COUNT (4)
+#define LINK_STATE_PACKET_LENGTH (10)
+#define BULK_PACKET_LENGTH (47)
+#define BULK_INTERVAL_MILLISECONDS (50)
+#define BULK_OTHER_HOP_COUNT (3)
+#define COMMAND_PACKET_LENGTH (11)
+#define COMMAND_INTERVAL_MIN_MILLISECONDS (500)
+#define COMMAND_INTERVAL_RANGE_MILLISECONDS (500)
+#define COMMAND_LOST (UINT32_MAX)
+
+// The first byte of each queued packet says what it is. Commands carry their index in the next two bytes:
+typedef enum {
+    PACKET_KIND_BULK,
+    PACKET_KIND_LINK_STATE,
+    PACKET_KIND_COMMAND,
+} packet_kind;
+
+typedef struct {
+    uint8_t bulk;
+    uint8_t link_state;
+    uint8_t command;
+} queue_priorities;
+
+// The original forwarding queue put link state packets ahead of data, and the traffic classes put commands first:
+const queue_priorities original_priorities = { 0, 1, 0 };
+const queue_priorities class_priorities = { NET_TRAFFIC_CLASS_BULK, NET_TRAFFIC_CLASS_CONTROL, NET_TRAFFIC_CLASS_INTERACTIVE };
+
+const uint16_t flood_interval_milliseconds[] = { 2000, 1000, 500 };
+
+uint32_t random_state = 0x2545F491;
+
+// The time each command was sent, and then the time it left each hop in turn:
+uint32_t command_ticks[PRIORITY_BENCHMARK_COMMAND_COUNT];
+
+uint32_t busy_ticks = 0;
+uint32_t total_ticks = 0;
+
+uint32_t get_random() {
+    // 32-bit xorshift generator with a fixed seed, so that every run sees the same traffic:
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+uint16_t get_frame_ticks(uint8_t packet_length) {
+    uint32_t microseconds = (uint32_t) (packet_length + DLL_FRAME_OVERHEAD) * BYTE_TIME_MICROSECONDS;
+    return (microseconds + TICK_MICROSECONDS - 1) / TICK_MICROSECONDS;
+}
+
+void push_packet(packet_kind kind, uint8_t packet_length, uint8_t priority, uint16_t command_index) {
+    uint8_t packet[BULK_PACKET_LENGTH] = { kind, command_index & 0xFF, command_index >> 8 };
+    if (net_queue_push(packet, packet_length, DLL_BROADCAST_ADDRESS, priority) == false && kind == PACKET_KIND_COMMAND) {
+        command_ticks[command_index] = COMMAND_LOST;
+    }
+}
+
+void run_hop(uint16_t flood_interval, const queue_priorities *priorities) {
+    uint32_t end_tick = 0;
+    for (uint16_t index = 0; index < PRIORITY_BENCHMARK_COMMAND_COUNT; index++) {
+        if (command_ticks[index] != COMMAND_LOST && command_ticks[index] > end_tick) {
+            end_tick = command_ticks[index];
+        }
+    }
+    end_tick += 1000 * TICKS_PER_MILLISECOND;
+
+    // A link state flood starts in each tick with this chance, in millionths:
+    uint32_t flood_chance = (uint32_t) NODE_COUNT * 1000000 / ((uint32_t) flood_interval * TICKS_PER_MILLISECOND);
+
+    uint16_t next_command = 0;
+    uint16_t other_link_state_frames = 0;
+    uint16_t other_bulk_frames = 0;
+    uint32_t bus_free_tick = 0;
+    bool is_sending = false;
+    uint8_t *held_packet = NULL;
+    uint8_t held_packet_length = 0;
+    for (uint32_t tick = 0; tick < end_tick; tick++) {
+        // Queue the packets arriving at this node, and count the frames the other nodes have to send:
+        if (get_random() % 1000000 < flood_chance) {
+            push_packet(PACKET_KIND_LINK_STATE, LINK_STATE_PACKET_LENGTH, priorities->link_state, 0);
+            other_link_state_frames += NODE_COUNT - 1;
+        }
+        if (tick % (BULK_INTERVAL_MILLISECONDS * TICKS_PER_MILLISECOND) == 0) {
+            push_packet(PACKET_KIND_BULK, BULK_PACKET_LENGTH, priorities->bulk, 0);
+            other_bulk_frames += BULK_OTHER_HOP_COUNT;
+        }
+        while (next_command < PRIORITY_BENCHMARK_COMMAND_COUNT
+            && (command_ticks[next_command] == COMMAND_LOST || command_ticks[next_command] <= tick)) {
+            if (command_ticks[next_command] != COMMAND_LOST) {
+                push_packet(PACKET_KIND_COMMAND, COMMAND_PACKET_LENGTH, priorities->command, next_command);
+            }
+            next_command++;
+        }
+
+        // Finish sending our frame, and note when a command has left:
+        if (tick < bus_free_tick) {
+            busy_ticks++;
+            continue;
+        }
+        if (is_sending) {
+            if (held_packet[0] == PACKET_KIND_COMMAND) {
+                command_ticks[held_packet[1] | (held_packet[2] << 8)] = tick;
+            }
+            net_queue_release(held_packet);
+            held_packet = NULL;
+            is_sending = false;
+        }
+
+        // Take the next packet out of the queue, and pick who sends next:
+        dll_address previous_hop;
+        if (held_packet == NULL) {
+            held_packet = net_queue_pop(&held_packet_length, &previous_hop);
+        }
+        uint16_t waiting_count = other_link_state_frames + other_bulk_frames + (held_packet != NULL);
+        if (waiting_count == 0) {
+            continue;
+        }
+        uint16_t sender = get_random() % waiting_count;
+        if (held_packet != NULL && sender-- == 0) {
+            bus_free_tick = tick + get_frame_ticks(held_packet_length);
+            is_sending = true;
+        } else if (sender < other_link_state_frames) {
+            bus_free_tick = tick + get_frame_ticks(LINK_STATE_PACKET_LENGTH);
+            other_link_state_frames--;
+        } else {
+            bus_free_tick = tick + get_frame_ticks(BULK_PACKET_LENGTH);
+            other_bulk_frames--;
+        }
+        busy_ticks++;
+    }
+    total_ticks += end_tick;
+
+    // Empty the queue for the next hop:
+    if (held_packet != NULL) {
+        net_queue_release(held_packet);
+    }
+    dll_address previous_hop;
+    while ((held_packet = net_queue_pop(&held_packet_length, &previous_hop)) != NULL) {
+        net_queue_release(held_packet);
+    }
+}
+
+void run_case(uint16_t flood_interval, const queue_priorities *priorities) {
+    random_state = 0x2545F491;
+    busy_ticks = 0;
+    total_ticks = 0;
+
+    // Send the commands at random intervals:
+    uint32_t sent_ticks[PRIORITY_BENCHMARK_COMMAND_COUNT];
+    uint32_t tick = 0;
+    for (uint16_t index = 0; index < PRIORITY_BENCHMARK_COMMAND_COUNT; index++) {
+        tick += (COMMAND_INTERVAL_MIN_MILLISECONDS + get_random() % COMMAND_INTERVAL_RANGE_MILLISECONDS) * TICKS_PER_MILLISECOND;
+        sent_ticks[index] = tick;
+        command_ticks[index] = tick;
+    }
+    for (uint8_t hop = 0; hop < HOP_COUNT; hop++) {
+        run_hop(flood_interval, priorities);
+    }
+
+    // Sort the latencies of the commands that arrived, to find the 95th percentile:
+    uint16_t latencies[PRIORITY_BENCHMARK_COMMAND_COUNT];
+    uint16_t arrived_count = 0;
+    uint32_t latency_total = 0;
+    for (uint16_t index = 0; index < PRIORITY_BENCHMARK_COMMAND_COUNT; index++) {
+        if (command_ticks[index] == COMMAND_LOST) {
+            continue;
+        }
+        uint16_t latency = (command_ticks[index] - sent_ticks[index]) / TICKS_PER_MILLISECOND;
+        uint16_t position = arrived_count++;
+        while (position > 0 && latencies[position - 1] > latency) {
+            latencies[position] = latencies[position - 1];
+            position--;
+        }
+        latencies[position] = latency;
+        latency_total += latency;
+    }
+
+    uart_put_string(", bus load percent ");
+    uart_print_hex_8(busy_ticks * 100 / total_ticks);
+    uart_put_string(", latency mean ");
+    uart_print_hex_16(arrived_count == 0 ? 0 : latency_total / arrived_count);
+    uart_put_string(", p95 ");
+    uart_print_hex_16(arrived_count == 0 ? 0 : latencies[(arrived_count * 95 - 1) / 100]);
+    uart_put_string(", max ");
+    uart_print_hex_16(arrived_count == 0 ? 0 : latencies[arrived_count - 1]);
+    uart_put_string(", lost ");
+    uart_print_hex_16(PRIORITY_BENCHMARK_COMMAND_COUNT - arrived_count);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- Commands over 4 hops during link state floods ---\n\r");
+    for (uint8_t index = 0; index < sizeof(flood_interval_milliseconds) / sizeof(flood_interval_milliseconds[0]); index++) {
+        uart_put_string("  Flood interval ");
+        uart_print_hex_16(flood_interval_milliseconds[index]);
+        uart_put_string(" without classes");
+        run_case(flood_interval_milliseconds[index], &original_priorities);
+        uart_put_string("  Flood interval ");
+        uart_print_hex_16(flood_interval_milliseconds[index]);
+        uart_put_string(" with classes   ");
+        run_case(flood_interval_milliseconds[index], &class_priorities);
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
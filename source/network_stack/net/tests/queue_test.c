@@ -0,0 +1,145 @@
+#include "network_stack/net.h"
+#include "../queue.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+void test_push(uint8_t packet_id, uint8_t priority, bool expected_result);
+void test_pop(bool expected_result, uint8_t expected_packet_id);
+void test_push_buffer(uint8_t packet_id, uint8_t priority);
+void test_statistics(uint8_t expected_depth, uint8_t expected_max_depth, uint16_t expected_queued_count, uint16_t expected_dropped_count);
+void print_result(bool is_passed);
+
+int main() {
+    uart_initialise();
+
+    // Wait until the user has pressed ENTER:
+    int rx_byte = 0;
+    do {
+        rx_byte = uart_get_byte_nonblocking();
+    }
+    while (rx_byte != '\n' && rx_byte != '\r');
+
+    uart_put_string("Starting test.\n\r\n\r");
+
+    // ############################################################################################
+    // Carry out the tests...
+
+    // An empty queue has nothing to take out:
+    test_pop(false, 0);
+
+    // Packets with the same priority come out in order, after any higher priority packets:
+    test_push(0x01, 0, true);
+    test_push(0x02, 0, true);
+    test_push(0x03, 0, true);
+    test_push(0x04, 1, true);
+    test_pop(true, 0x04);
+    test_pop(true, 0x01);
+    test_pop(true, 0x02);
+    test_pop(true, 0x03);
+    test_pop(false, 0);
+    test_statistics(0, 4, 4, 0);
+
+    // A full queue drops new packets with the same priority:
+    test_push(0x05, 0, true);
+    test_push(0x06, 0, true);
+    test_push(0x07, 0, true);
+    test_push(0x08, 0, true);
+    test_push(0x09, 0, false);
+    test_statistics(4, 4, 8, 1);
+
+    // ...but makes space for a higher priority packet by dropping the newest packet with the lowest priority:
+    test_push(0x0A, 1, true);
+    test_statistics(4, 4, 9, 2);
+    test_pop(true, 0x0A);
+    test_pop(true, 0x05);
+    test_pop(true, 0x06);
+    test_pop(true, 0x07);
+    test_pop(false, 0);
+    test_statistics(0, 4, 9, 2);
+
+    // A packet queued by swapping buffers comes out in the same buffer, without being copied:
+    test_push_buffer(0x0B, 2);
+    test_statistics(0, 4, 10, 2);
+
+    // ############################################################################################
+
+    uart_put_string("\n\rFinished.\n\r\n\r");
+}
+
+void test_push(uint8_t packet_id, uint8_t priority, bool expected_result) {
+    // Queue a packet whose first byte identifies it, as if received from a node with the same physical address:
+    uint8_t packet[] = { packet_id, 0x00, 0x00, 0x00 };
+    bool result = net_queue_push(packet, sizeof(packet), packet_id, priority);
+
+    uart_put_string("\n\rPush packet ");
+    uart_print_hex_8(packet_id);
+    uart_put_string(" with priority ");
+    uart_print_hex_8(priority);
+    print_result(result == expected_result);
+}
+
+void test_pop(bool expected_result, uint8_t expected_packet_id) {
+    uint8_t packet_length = 0;
+    dll_address previous_hop = 0;
+    uint8_t *packet = net_queue_pop(&packet_length, &previous_hop);
+    bool result = (packet != NULL);
+
+    uart_put_string("\n\rPop packet");
+    if (expected_result) {
+        uart_put_string(" (expecting ");
+        uart_print_hex_8(expected_packet_id);
+        uart_put_string(")");
+        print_result(result && packet_length == 4 && packet[0] == expected_packet_id && previous_hop == expected_packet_id);
+        if (result) {
+            net_queue_release(packet);
+        }
+    } else {
+        uart_put_string(" (expecting an empty queue)");
+        print_result(result == false);
+    }
+}
+
+void test_push_buffer(uint8_t packet_id, uint8_t priority) {
+    // Queue a packet held in a buffer like DLL's receive buffer:
+    static uint8_t receive_buffer[NET_QUEUE_MAX_PACKET_SIZE];
+    receive_buffer[0] = packet_id;
+    uint8_t *exchanged_buffer = net_queue_push_buffer(receive_buffer, 4, packet_id, priority);
+
+    uart_put_string("\n\rPush packet ");
+    uart_print_hex_8(packet_id);
+    uart_put_string(" by swapping buffers");
+    print_result(exchanged_buffer != NULL && exchanged_buffer != receive_buffer);
+
+    // Take the packet out, and check that it's still in the original buffer:
+    uint8_t packet_length = 0;
+    dll_address previous_hop = 0;
+    uint8_t *packet = net_queue_pop(&packet_length, &previous_hop);
+    uart_put_string("\n\rPop packet from the original buffer");
+    print_result(packet == receive_buffer && packet_length == 4 && packet[0] == packet_id && previous_hop == packet_id);
+    if (packet != NULL) {
+        net_queue_release(packet);
+    }
+}
+
+void test_statistics(uint8_t expected_depth, uint8_t expected_max_depth, uint16_t expected_queued_count, uint16_t expected_dropped_count) {
+    net_queue_statistics statistics = net_get_queue_statistics();
+
+    uart_put_string("\n\rStatistics:\n\r  Depth:         ");
+    uart_print_hex_8(statistics.depth);
+    uart_put_string("\n\r  Max depth:     ");
+    uart_print_hex_8(statistics.max_depth);
+    uart_put_string("\n\r  Queued count:  ");
+    uart_print_hex_16(statistics.queued_count);
+    uart_put_string("\n\r  Dropped count: ");
+    uart_print_hex_16(statistics.dropped_count);
+    print_result(statistics.depth == expected_depth && statistics.max_depth == expected_max_depth
+        && statistics.queued_count == expected_queued_count && statistics.dropped_count == expected_dropped_count);
+}
+
+void print_result(bool is_passed) {
+    uart_put_string("\n\r  Test result: ");
+    uart_put_string(is_passed ? "PASS" : "FAIL");
+    uart_put_string("\n\r");
+}
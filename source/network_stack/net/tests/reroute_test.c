@@ -0,0 +1,213 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../packets.h"
+#include "../routing.h"
+#include "../persist.h"
+#include "../sync.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * This test emulates the following network graph, and measures how long it takes for this device to reroute packets
+ * destined to node 0x03 after the link between 0x01 and 0x02 is cut:
+ *
+ *          02 .  . 03
+ *        .(12)    (13).
+ *      .                .
+ *    01                  04
+ *   (11)                (14)
+ *   own  .            .
+ *  address .        .
+ *            .    .
+ *              05
+ *             (15)
+ *
+ * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
+ * brackets correspond to the nodes' physical (dll) addresses in hex. This device is the node on the very left with
+ * logical address 0x01. A data packet is sent to 0x03 every 100 milliseconds. The scenario is run twice: once with
+ * DLL's delivery feedback passed on to the router, and once without, where only the neighbour link timeout is left to
+ * detect the failure. With delivery feedback, the first failed packet should be resent through the loop-free alternate
+ * next hop 0x05, so no data packets should be lost.
+ */
+
+time current_time = TIME_ZERO;
+
+bool is_link_0x12_cut = false;
+bool is_delivery_feedback_enabled = true;
+
+uint8_t ping_sequence_number_0x12 = 0;
+uint8_t ping_sequence_number_0x15 = 0;
+
+const uint8_t link_costs_0x02[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x03] = 2 };
+const uint8_t link_costs_0x03[NET_MAX_ADDRESS + 1] = { [0x02] = 2, [0x04] = 2 };
+const uint8_t link_costs_0x04[NET_MAX_ADDRESS + 1] = { [0x03] = 2, [0x05] = 2 };
+const uint8_t link_costs_0x05[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x04] = 2 };
+
+uint16_t packets_sent = 0;
+uint16_t packets_delivered = 0;
+
+void run_scenario();
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- Link cut with DLL delivery feedback ---\n\r");
+    is_delivery_feedback_enabled = true;
+    run_scenario();
+
+    uart_put_string("\n\r--- Link cut without DLL delivery feedback ---\n\r");
+    is_delivery_feedback_enabled = false;
+    run_scenario();
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+void run_scenario() {
+    is_link_0x12_cut = false;
+    packets_sent = 0;
+    packets_delivered = 0;
+
+    // Emulate discovering the neighbours and receiving every other node's link state packet:
+    net_initialise_routing();
+    net_notify_ping_response(0x12, 0x02);
+    net_notify_ping_response(0x15, 0x05);
+    net_notify_link_state_packet(0x12, 0x02, 0, link_costs_0x02);
+    net_notify_link_state_packet(0x12, 0x03, 0, link_costs_0x03);
+    net_notify_link_state_packet(0x15, 0x04, 0, link_costs_0x04);
+    net_notify_link_state_packet(0x15, 0x05, 0, link_costs_0x05);
+    net_update_routing();
+
+    // Cut the link after 5 seconds, then run until the route to 0x03 goes through 0x05 (or give up after 2 minutes):
+    time cut_time = time_add_seconds(current_time, 5);
+    time end_time = time_add_seconds(cut_time, 120);
+    while (time_delta_milliseconds(current_time, end_time) > 0) {
+        current_time = time_add_milliseconds(current_time, 100);
+        if (is_link_0x12_cut == false && time_delta_milliseconds(cut_time, current_time) >= 0) {
+            is_link_0x12_cut = true;
+            packets_sent = 0;
+            packets_delivered = 0;
+        }
+
+        // Emulate the neighbours' periodic ping requests (the cut link no longer carries them):
+        if (time_delta_milliseconds(TIME_ZERO, current_time) % 1000 == 0) {
+            net_notify_ping_request(0x15, 0x05, ++ping_sequence_number_0x15, false, false, true);
+            if (is_link_0x12_cut == false) {
+                net_notify_ping_request(0x12, 0x02, ++ping_sequence_number_0x12, false, false, true);
+            }
+        }
+
+        net_update_routing();
+        net_update_forwarding();
+
+        if (is_link_0x12_cut && net_get_next_hop(0x03) == 0x15) {
+            break;
+        }
+
+        // Send a data packet to 0x03:
+        net_send_data_packet(0x03, 2, NET_TRAFFIC_CLASS_BULK, false);
+        packets_sent++;
+    }
+
+    uart_put_string("Time to reroute (x100 ms): ");
+    uart_print_hex_16(time_delta_milliseconds(cut_time, current_time) / 100);
+    uart_put_string("\n\rPackets sent after cut: ");
+    uart_print_hex_16(packets_sent);
+    uart_put_string("\n\rPackets lost after cut: ");
+    uart_print_hex_16(packets_sent - packets_delivered);
+    uart_put_string("\n\r");
+}
+
+//*************************** dll.h emulated implementation *************************//
+
+uint8_t dll_tx_buffer[128];
+
+uint8_t *dll_create_data_buffer(uint8_t net_packet_length) {
+    if (net_packet_length <= 128) {
+        return dll_tx_buffer;
+    } else {
+        return NULL;
+    }
+}
+
+dll_send_response dll_send_packet(uint8_t destination_address, uint8_t packet_length) {
+    return dll_send_buffer(dll_tx_buffer, destination_address, packet_length);
+}
+
+dll_send_response dll_send_buffer(const uint8_t *packet, dll_address destination_address, uint8_t packet_length) {
+    // Emulate the cut link failing to deliver any packets, after the first transmission and 3 retransmissions:
+    if (destination_address == 0x12 && is_link_0x12_cut) {
+        if (is_delivery_feedback_enabled) {
+            net_notify_delivery(destination_address, false, 4);
+        }
+        return DLL_NODE_UNREACHABLE;
+    }
+
+    if (is_delivery_feedback_enabled && destination_address != DLL_BROADCAST_ADDRESS) {
+        net_notify_delivery(destination_address, true, 0);
+    }
+
+    // Count the data packets which made it to a next hop:
+    uint8_t packet_type = (packet[1] & 0xF0) >> 4;
+    if (packet_type == 0 && is_link_0x12_cut) {
+        packets_delivered++;
+    }
+    return DLL_TRANSMISSION_SUCCESS;
+}
+
+void dll_replace_receive_buffer(uint8_t *buffer) {
+    // No packets are received in this test, so there's nothing to do.
+}
+
+time dll_get_receive_time() {
+    return current_time;
+}
+
+//**************************** sync.h emulated implementation ***************************//
+
+void net_notify_time_sync(net_address source, net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time, time receive_time) {
+    // No time sync packets are received in this test, so there's nothing to do.
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    // Start without a saved routing snapshot:
+    return false;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    return true;
+}
@@ -3,9 +3,11 @@
 #include "time.h"
 #include "uart.h"
 #include "../routing.h"
+#include "../persist.h"
 #include <util/delay.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 /**
  * This test emulates the following network graph:
@@ -24,6 +26,15 @@
  * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
  * brackets correspond to the nodes' physical (dll) addresses in hex. This device is the node on the very left with
  * logical address 0x01.
+ *
+ * All links have the minimum cost, except for the lossy link between 03 and 04, so the route to 03 should go through 02
+ * rather than 04.
+ *
+ * Partway through, 0x05 announces that it's a stub router. It should be sent a forwarding table, worked out from its
+ * link state, with 0x01 as its next hop to 0x02 and 0x03, and 0x04 as its next hop to 0x04.
+ *
+ * Later on, the device is restarted. The routes should be available again straight away, restored from the
+ * snapshot of the routing state saved before the restart.
  */
 
 time current_time = TIME_ZERO;
@@ -38,16 +49,24 @@ uint8_t sequence_number_0x03 = 0;
 uint8_t sequence_number_0x04 = 0;
 uint8_t sequence_number_0x05 = 0;
 
-const uint8_t node_list_0x02[] = { 0x03, 0x01 };
-const uint8_t node_list_0x03[] = { 0x02, 0x04 };
-const uint8_t node_list_0x04[] = { 0x03, 0x01, 0x05 };
-const uint8_t node_list_0x05[] = { 0x01, 0x04 };
+const uint8_t link_costs_0x02[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x03] = 2 };
+const uint8_t link_costs_0x03[NET_MAX_ADDRESS + 1] = { [0x02] = 2, [0x04] = 12 };
+const uint8_t link_costs_0x04[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x03] = 12, [0x05] = 2 };
+const uint8_t link_costs_0x05[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x04] = 2 };
+
+// The emulated storage for the routing snapshot:
+uint8_t saved_snapshot[NET_PERSIST_MAX_DATA_SIZE];
+uint8_t saved_snapshot_length = 0;
+
+void print_next_hops();
 
 int main() {
     uart_initialise();
     uart_put_string("\n\r============================================================\n\r");
     uint8_t second_counter_100 = 0;
     uint8_t second_counter_10 = 0;
+    bool is_restarted = false;
+    bool is_stub_announced = false;
 
     net_initialise_routing();
 
@@ -77,43 +96,48 @@ int main() {
             second_counter_100 = 0;
         }
 
+        // Emulate a ping request from 0x05 as a stub router once, which should be sent a forwarding table:
+        if (is_stub_announced == false && second_counter_100 == 90) {
+            is_stub_announced = true;
+            uart_put_string("Emulating ping request from stub router 0x05\n\r");
+            net_notify_ping_request(0x15, 0x05, 1, true, true, true);
+        }
+
+        // Emulate a restart once, and check that the routes are restored straight away:
+        if (is_restarted == false && second_counter_100 == 95) {
+            is_restarted = true;
+            uart_put_string("Emulating restart\n\r");
+            net_initialise_routing();
+            print_next_hops();
+        }
+
         // Every 10 seconds, offset 0 seconds:
         if (second_counter_10 == 0) {
-            // Print out the next hop of every destination:
-            uart_put_string("Next hops:\n\r  Node Online Next hop \n\r");
-            for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
-                uart_put_string("  ");
-                uart_print_hex_8(node);
-                uart_put_string("   ");
-                uart_print_hex_8(net_is_device_online(node));
-                uart_put_string("     ");
-                uart_print_hex_8(net_get_next_hop(node));
-                uart_put_string("\n\r");
-            }
+            print_next_hops();
         }
 
         // Every 10 seconds, offset 3 seconds:
         if (second_counter_10 == 3) {
             // Emulate receiving a link state packet from node 0x02:
-            net_notify_link_state_packet(0x02, sequence_number_0x02++, node_list_0x02, sizeof(node_list_0x02));
+            net_notify_link_state_packet(0x12, 0x02, sequence_number_0x02++, link_costs_0x02);
             uart_put_string("Emulating link state packet from 0x02\n\r");
         }
 
         // Every 10 seconds, offset 5 seconds:
         if (second_counter_10 == 5) {
             // Emulate receiving a link state packet from node 0x05:
-            net_notify_link_state_packet(0x05, sequence_number_0x05++, node_list_0x05, sizeof(node_list_0x05));
+            net_notify_link_state_packet(0x15, 0x05, sequence_number_0x05++, link_costs_0x05);
             uart_put_string("Emulating link state packet from 0x05\n\r");
 
             // Emulate receiving a link state packet from node 0x04:
-            net_notify_link_state_packet(0x04, sequence_number_0x04++, node_list_0x04, sizeof(node_list_0x04));
+            net_notify_link_state_packet(0x14, 0x04, sequence_number_0x04++, link_costs_0x04);
             uart_put_string("Emulating link state packet from 0x04\n\r");
         }
 
         // Every 10 seconds, offset 3 seconds:
         if (second_counter_10 == 8) {
             // Emulate receiving a link state packet from node 0x03:
-            net_notify_link_state_packet(0x03, sequence_number_0x03++, node_list_0x03, sizeof(node_list_0x03));
+            net_notify_link_state_packet(0x12, 0x03, sequence_number_0x03++, link_costs_0x03);
             uart_put_string("Emulating link state packet from 0x03\n\r");
         }
 
@@ -123,6 +147,20 @@ int main() {
     }
 }
 
+void print_next_hops() {
+    // Print out the next hop of every destination:
+    uart_put_string("Next hops:\n\r  Node Online Next hop \n\r");
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        uart_put_string("  ");
+        uart_print_hex_8(node);
+        uart_put_string("   ");
+        uart_print_hex_8(net_is_device_online(node));
+        uart_put_string("     ");
+        uart_print_hex_8(net_get_next_hop(node));
+        uart_put_string("\n\r");
+    }
+}
+
 //*************************** net.h emulated implementation *************************//
 
 net_address net_get_own_address() {
@@ -136,19 +174,28 @@ time time_now() {
     return current_time;
 }
 
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
 int32_t time_delta_seconds(time start, time end) {
     return (end - start) / 1000;
 }
 
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
 time time_add_seconds(time t, int32_t seconds) {
     return t + seconds * 1000;
 }
 
 //************************* packets.h emulated implementation ***********************//
 
-void net_send_ping_request_packet(dll_address node) {
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
     uart_put_string("Send ping request packet to physical address ");
     uart_print_hex_8(node);
+    uart_put_string(is_response_requested ? " (response requested)" : "");
     uart_put_string("\n\r");
 
     // Set flags to emulate responses from the neighbouring nodes:
@@ -163,17 +210,99 @@ void net_send_ping_request_packet(dll_address node) {
     }
 }
 
-void net_send_link_state_packet() {
+void net_send_ping_response_packet(dll_address node) {
+    uart_put_string("Send ping response packet to physical address ");
+    uart_print_hex_8(node);
+    uart_put_string("\n\r");
+}
+
+bool net_send_link_state_packet() {
     uart_put_string("Send link state packet:\n\r  Linked nodes: ");
 
     net_address own_address = net_get_own_address();
     for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
-        // If the node is linked, add it to the list:
-        bool is_linked = net_are_nodes_linked(own_address, node);
-        if (is_linked) {
+        // If the node is linked, add it and the link's cost to the list:
+        uint8_t link_cost = net_get_link_cost(own_address, node);
+        if (link_cost != 0) {
             uart_print_hex_8(node);
-            uart_put_string(", ");
+            uart_put_string(" (cost ");
+            uart_print_hex_8(link_cost);
+            uart_put_string("), ");
         }
     }
     uart_put_string("\n\r");
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    uart_put_string("Send link state update packet:\n\r  Linked nodes: ");
+
+    net_address own_address = net_get_own_address();
+    for (net_address node = 0x00; node != NET_MAX_ADDRESS + 1; node++) {
+        // If the node is linked, add it and the link's cost to the list:
+        uint8_t link_cost = net_get_link_cost(own_address, node);
+        if (link_cost != 0) {
+            uart_print_hex_8(node);
+            uart_put_string(" (cost ");
+            uart_print_hex_8(link_cost);
+            uart_put_string("), ");
+        }
+    }
+    uart_put_string("\n\r");
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    uart_put_string("Send database summary packet to physical address ");
+    uart_print_hex_8(node);
+    uart_put_string("\n\r");
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    uart_put_string("Send link state request packet to physical address ");
+    uart_print_hex_8(node);
+    uart_put_string(" for sources ");
+    uart_print_hex_16(sources);
+    uart_put_string("\n\r");
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+    uart_put_string("Send forwarding table packet to physical address ");
+    uart_print_hex_8(node);
+    uart_put_string("\n\r  Next hops: ");
+    for (net_address destination = 0x00; destination != NET_MAX_ADDRESS + 1; destination++) {
+        uart_print_hex_8(next_hops[destination]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    uart_put_string("Send stored link state packet of ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r");
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
+
+//************************* persist.h emulated implementation ***********************//
+
+bool net_persist_load(void *data, uint8_t data_length) {
+    if (saved_snapshot_length != data_length) {
+        return false;
+    }
+    memcpy(data, saved_snapshot, data_length);
+    return true;
+}
+
+bool net_persist_save(const void *data, uint8_t data_length) {
+    uart_put_string("Save routing snapshot\n\r");
+    memcpy(saved_snapshot, data, data_length);
+    saved_snapshot_length = data_length;
+    return true;
 }
@@ -0,0 +1,184 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../routing.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This test runs the router as a stub router (built with 'NET_STUB_ROUTING' defined), and emulates the following
+ * network graph:
+ *
+ *          02 .  . 04 .  . 05
+ *        .(12)    (14)    (15)
+ *      .
+ *    01
+ *   (11) .
+ *   own    .
+ *  address   03
+ *           (13)
+ *
+ * The node numbers outside the brackets correspond to the nodes' logical (net) addresses in hex. The node numbers in
+ * brackets correspond to the nodes' physical (dll) addresses in hex. This device is the node on the left with logical
+ * address 0x01. Node 0x06 is offline.
+ *
+ * Before any forwarding table is received, every destination other than the neighbours should be sent to the first
+ * neighbour (0x12). Once 0x02 sends a forwarding table, its next hops should be used, and 0x06 should be unreachable. When
+ * the link to 0x02 times out, destinations routed through it should fall back to the remaining neighbour (0x13).
+ *
+ * Packets passing through from 0x03 should only ever follow the forwarding table (or go straight to a neighbour), and be
+ * dropped rather than fall back to a neighbour which could send them straight back.
+ */
+
+time current_time = TIME_ZERO;
+
+const uint8_t link_costs_0x02[NET_MAX_ADDRESS + 1] = { [0x01] = 2, [0x04] = 2 };
+
+void print_next_hops();
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+    uart_put_string("Stub router: ");
+    uart_print_hex_8(net_is_stub_router());
+    uart_put_string("\n\r");
+
+    // Emulate discovering the neighbours:
+    net_initialise_routing();
+    net_notify_ping_response(0x12, 0x02);
+    net_notify_ping_response(0x13, 0x03);
+    net_update_routing();
+    uart_put_string("\n\r--- Before receiving a forwarding table ---\n\r");
+    print_next_hops();
+
+    // Emulate receiving a forwarding table from a node which isn't a neighbour (expect it to be ignored):
+    uint8_t next_hops[NET_MAX_ADDRESS + 1];
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        next_hops[node] = 0x03;
+    }
+    net_notify_forwarding_table(0x14, 0x04, next_hops);
+    uart_put_string("\n\r--- After receiving a forwarding table from a node which isn't a neighbour ---\n\r");
+    print_next_hops();
+
+    // Emulate receiving a forwarding table from 0x02, with 0x04 and 0x05 reached through 0x02 and every other node
+    // unreachable:
+    for (net_address node = 0; node <= NET_MAX_ADDRESS; node++) {
+        next_hops[node] = 0x01;
+    }
+    next_hops[0x02] = 0x02;
+    next_hops[0x03] = 0x03;
+    next_hops[0x04] = 0x02;
+    next_hops[0x05] = 0x02;
+    net_notify_forwarding_table(0x12, 0x02, next_hops);
+    uart_put_string("\n\r--- After receiving a forwarding table from 0x02 ---\n\r");
+    print_next_hops();
+
+    // Emulate receiving the same link state packet twice (expect only the first to be flooded):
+    uart_put_string("\n\r--- Receiving a link state packet twice ---\n\r  Flooded: ");
+    uart_print_hex_8(net_notify_link_state_packet(0x12, 0x02, 0x07, link_costs_0x02));
+    uart_put_string(" ");
+    uart_print_hex_8(net_notify_link_state_packet(0x12, 0x02, 0x07, link_costs_0x02));
+    uart_put_string("\n\r");
+
+    // Keep the link to 0x03 alive, and let the link to 0x02 time out:
+    uint8_t ping_sequence_number_0x13 = 0;
+    for (uint8_t second = 0; second < 65; second++) {
+        current_time = time_add_seconds(current_time, 1);
+        net_notify_ping_request(0x13, 0x03, ++ping_sequence_number_0x13, false, false, true);
+        net_update_routing();
+    }
+    uart_put_string("\n\r--- After the link to 0x02 times out ---\n\r");
+    print_next_hops();
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+void print_next_hops() {
+    // Print out the next hop of a few destinations:
+    uart_put_string("  Node Online Next hop From 03\n\r");
+    for (net_address node = 0x01; node <= 0x06; node++) {
+        uart_put_string("  ");
+        uart_print_hex_8(node);
+        uart_put_string("   ");
+        uart_print_hex_8(net_is_device_online(node));
+        uart_put_string("     ");
+        uart_print_hex_8(net_get_next_hop(node));
+        uart_put_string("       ");
+        uart_print_hex_8(net_get_flow_next_hop(0x03, node));
+        uart_put_string("\n\r");
+    }
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+void net_send_ping_request_packet(dll_address node, bool is_response_requested) {
+}
+
+void net_send_ping_response_packet(dll_address node) {
+}
+
+bool net_send_link_state_packet() {
+    return true;
+}
+
+bool net_send_link_state_update_packet() {
+    return true;
+}
+
+bool net_send_database_summary_packet(dll_address node) {
+    uart_put_string("Send database summary packet to physical address ");
+    uart_print_hex_8(node);
+    uart_put_string("\n\r");
+    return true;
+}
+
+bool net_send_link_state_request_packet(dll_address node, uint16_t sources) {
+    uart_put_string("Send link state request packet to physical address ");
+    uart_print_hex_8(node);
+    uart_put_string("\n\r");
+    return true;
+}
+
+void net_send_forwarding_table_packet(dll_address node, const uint8_t next_hops[NET_MAX_ADDRESS + 1]) {
+}
+
+bool net_send_stored_link_state_packet(net_address source) {
+    uart_put_string("Send stored link state packet of ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r");
+    return true;
+}
+
+bool net_advance_link_state_sequence_number(uint8_t sequence_number) {
+    return false;
+}
@@ -0,0 +1,298 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../packets.h"
+#include "../sync.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This benchmark measures how closely the clock synchronisation keeps the network time along a line of 16 nodes:
+ *
+ *    00 ---- 01 ---- 02 ---- ... ---- 0F
+ *   root
+ *
+ * Every node's clock started a random time of up to 5 seconds before the benchmark, and runs fast or slow by a random
+ * drift up to a given number of ppm. 0x00 has the lowest address, so it takes over as the root once the root timeout
+ * passes, and every other node follows it through the node before it.
+ *
+ * Each node is run in turn with the clock synchronisation, from 0x00 down the line, and is given the time sync packets
+ * that the node before it sent when it was run, each lost with a given chance. A packet finishes being sent and
+ * received at the same moment, and is handled a millisecond later. The packets passed on by the node after it always
+ * arrive after the ones from the node before, so they would never give a sample and are left out.
+ *
+ * From 200 to 500 seconds, each node's network time is compared with the root's every 100 milliseconds, and the mean
+ * and largest error in milliseconds are printed for each node. Every node also schedules an action every 10 seconds at
+ * the same network time, and the largest spread in milliseconds between the first and last node to call each action
+ * is printed.
+ */
+
+#define NODE_COUNT (NET_MAX_ADDRESS + 1)
+#define MAX_BOOT_MILLISECONDS (5000)
+#define MEASURE_START_MILLISECONDS ((int32_t) 200000)
+#define MEASURE_END_MILLISECONDS ((int32_t) 500000)
+#define MEASURE_INTERVAL_MILLISECONDS (100)
+#define ACTION_INTERVAL_MILLISECONDS (10000)
+#define ACTION_COUNT ((MEASURE_END_MILLISECONDS - MEASURE_START_MILLISECONDS) / ACTION_INTERVAL_MILLISECONDS - 1)
+#define MAX_LOGGED_PACKETS (MEASURE_END_MILLISECONDS / NET_SYNC_INTERVAL_MILLISECONDS + 32)
+
+typedef struct {
+    int32_t send_time; // When the packet was sent, by the benchmark's clock
+    net_address root;
+    uint8_t sequence_number;
+    uint8_t previous_sequence_number;
+    time previous_time;
+} logged_packet;
+
+typedef struct {
+    uint16_t max_drift_ppm;
+    uint8_t loss_percent;
+} sync_case;
+
+const sync_case cases[] = {
+    { 100, 0 },
+    { 2000, 0 },
+    { 100, 10 },
+};
+
+uint32_t random_state = 0x2545F491;
+
+// The node being run, its clock, and the benchmark's own clock which every node's clock is worked out from:
+net_address own_address = 0x00;
+int32_t boot_milliseconds[NODE_COUNT];
+int32_t drift_ppm[NODE_COUNT];
+int32_t true_time = 0;
+time current_time = TIME_ZERO;
+
+// The packets sent by the node before the one being run, and by the node being run:
+logged_packet received_packets[MAX_LOGGED_PACKETS];
+uint16_t received_packet_count = 0;
+logged_packet sent_packets[MAX_LOGGED_PACKETS];
+uint16_t sent_packet_count = 0;
+
+// The root's network time is its own clock plus this offset, once it has taken over:
+int32_t root_offset = 0;
+
+// The earliest and latest time that each action was called by any node:
+int32_t action_first_times[ACTION_COUNT];
+int32_t action_last_times[ACTION_COUNT];
+time first_action_network_time = TIME_ZERO;
+
+uint32_t get_random() {
+    // 32-bit xorshift generator with a fixed seed, so that every run sees the same clocks and losses:
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+time get_local_time(net_address node, int32_t at_time) {
+    // Split off the whole seconds so that the drift can't overflow:
+    int32_t elapsed = at_time + boot_milliseconds[node];
+    return elapsed + (elapsed / 1000) * drift_ppm[node] / 1000 + (elapsed % 1000) * drift_ppm[node] / 1000000;
+}
+
+time get_root_network_time(int32_t at_time) {
+    return time_add_milliseconds(get_local_time(0x00, at_time), root_offset);
+}
+
+void print_signed(int32_t value) {
+    if (value < 0) {
+        uart_put_byte('-');
+        value = -value;
+    } else {
+        uart_put_byte('+');
+    }
+    uart_print_hex_16(value);
+}
+
+void note_action_time(uint8_t action_index) {
+    if (true_time < action_first_times[action_index]) {
+        action_first_times[action_index] = true_time;
+    }
+    if (true_time > action_last_times[action_index]) {
+        action_last_times[action_index] = true_time;
+    }
+}
+
+void record_action(time network_time) {
+    // Note when the action was called, and schedule the next one:
+    uint8_t action_index = time_delta_milliseconds(first_action_network_time, network_time) / ACTION_INTERVAL_MILLISECONDS;
+    note_action_time(action_index);
+    if (action_index + 1 < ACTION_COUNT) {
+        net_schedule_action(time_add_milliseconds(network_time, ACTION_INTERVAL_MILLISECONDS), record_action);
+    }
+}
+
+void run_node(net_address node, uint8_t loss_percent) {
+    own_address = node;
+    sent_packet_count = 0;
+    uint16_t next_packet = 0;
+    uint32_t error_total = 0;
+    uint16_t error_count = 0;
+    int32_t error_max = 0;
+
+    true_time = 0;
+    current_time = get_local_time(node, true_time);
+    net_initialise_sync();
+    for (true_time = 1; true_time < MEASURE_END_MILLISECONDS; true_time++) {
+        current_time = get_local_time(node, true_time);
+
+        // Receive the packets from the node before, a millisecond after they finished being sent:
+        while (next_packet < received_packet_count && received_packets[next_packet].send_time < true_time) {
+            const logged_packet *packet = &received_packets[next_packet++];
+            if (get_random() % 100 >= loss_percent) {
+                net_notify_time_sync(node - 1, packet->root, packet->sequence_number, packet->previous_sequence_number, packet->previous_time,
+                    get_local_time(node, packet->send_time));
+            }
+        }
+        net_update_sync();
+
+        if (node != 0x00 && true_time == MEASURE_START_MILLISECONDS) {
+            net_schedule_action(first_action_network_time, record_action);
+        }
+        if (node != 0x00 && true_time >= MEASURE_START_MILLISECONDS && true_time % MEASURE_INTERVAL_MILLISECONDS == 0) {
+            int32_t error = time_delta_milliseconds(get_root_network_time(true_time), net_get_network_time());
+            if (error < 0) {
+                error = -error;
+            }
+            error_total += error;
+            error_count++;
+            if (error > error_max) {
+                error_max = error;
+            }
+        }
+    }
+
+    if (node == 0x00) {
+        // The root's network time is now its own clock plus a fixed offset. The first action is set for a whole number
+        // of action intervals after the measurement starts:
+        root_offset = time_delta_milliseconds(current_time, net_get_network_time());
+        time start_network_time = get_root_network_time(MEASURE_START_MILLISECONDS);
+        first_action_network_time = time_add_milliseconds(start_network_time, ACTION_INTERVAL_MILLISECONDS - start_network_time % ACTION_INTERVAL_MILLISECONDS);
+
+        // The root calls each action as soon as its network time reaches it:
+        uint8_t action_index = 0;
+        for (true_time = MEASURE_START_MILLISECONDS; true_time < MEASURE_END_MILLISECONDS && action_index < ACTION_COUNT; true_time++) {
+            time action_time = time_add_milliseconds(first_action_network_time, (int32_t) action_index * ACTION_INTERVAL_MILLISECONDS);
+            if (time_delta_milliseconds(action_time, get_root_network_time(true_time)) >= 0) {
+                note_action_time(action_index++);
+            }
+        }
+    } else {
+        uart_put_string("  Node ");
+        uart_print_hex_8(node);
+        uart_put_string(": drift ");
+        print_signed(drift_ppm[node]);
+        uart_put_string(" ppm, error mean ");
+        uart_print_hex_16(error_total / error_count);
+        uart_put_string(", max ");
+        uart_print_hex_16(error_max);
+        uart_put_string(" ms\n\r");
+    }
+
+    // The next node receives the packets this node sent:
+    for (uint16_t index = 0; index < sent_packet_count; index++) {
+        received_packets[index] = sent_packets[index];
+    }
+    received_packet_count = sent_packet_count;
+}
+
+void run_case(const sync_case *sync_case) {
+    uart_put_string("\n\r--- Line of 16, drift up to ");
+    uart_print_hex_16(sync_case->max_drift_ppm);
+    uart_put_string(" ppm, loss ");
+    uart_print_hex_8(sync_case->loss_percent);
+    uart_put_string("% ---\n\r");
+
+    random_state = 0x2545F491;
+    for (net_address node = 0; node < NODE_COUNT; node++) {
+        boot_milliseconds[node] = get_random() % MAX_BOOT_MILLISECONDS;
+        drift_ppm[node] = (int32_t) (get_random() % (2 * sync_case->max_drift_ppm + 1)) - sync_case->max_drift_ppm;
+    }
+    for (uint8_t action_index = 0; action_index < ACTION_COUNT; action_index++) {
+        action_first_times[action_index] = INT32_MAX;
+        action_last_times[action_index] = INT32_MIN;
+    }
+    received_packet_count = 0;
+
+    // The root is run first, so that the others can be compared with it:
+    for (net_address node = 0; node < NODE_COUNT; node++) {
+        run_node(node, sync_case->loss_percent);
+    }
+
+    int32_t spread_max = 0;
+    for (uint8_t action_index = 0; action_index < ACTION_COUNT; action_index++) {
+        int32_t spread = action_last_times[action_index] - action_first_times[action_index];
+        if (spread > spread_max) {
+            spread_max = spread;
+        }
+    }
+    uart_put_string("  Action spread max ");
+    uart_print_hex_16(spread_max);
+    uart_put_string(" ms\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    for (uint8_t index = 0; index < sizeof(cases) / sizeof(cases[0]); index++) {
+        run_case(&cases[index]);
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+bool net_send_time_sync_packet(net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time) {
+    // Keep the packet for the next node down the line:
+    if (sent_packet_count == MAX_LOGGED_PACKETS) {
+        return false;
+    }
+    logged_packet *packet = &sent_packets[sent_packet_count++];
+    packet->send_time = true_time;
+    packet->root = root;
+    packet->sequence_number = sequence_number;
+    packet->previous_sequence_number = previous_sequence_number;
+    packet->previous_time = previous_time;
+    return true;
+}
+
+//*************************** dll.h emulated implementation *************************//
+
+time dll_get_transmit_time() {
+    // Every packet finishes being sent at the current time:
+    return current_time;
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use the node currently being run as our own address:
+    return own_address;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
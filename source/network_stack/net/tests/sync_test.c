@@ -0,0 +1,193 @@
+#include "network_stack/net.h"
+#include "network_stack/dll.h"
+#include "time.h"
+#include "uart.h"
+#include "../packets.h"
+#include "../sync.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * This test emulates the following network graph:
+ *
+ *    00 ---- 02 ---- 01 ---- 03
+ *   root           own
+ *                address
+ *
+ * This device is the node with address 0x01. Our clock runs 1000 ppm (1 millisecond a second) slower than the clock of
+ * 0x00, and started 5 seconds later.
+ *
+ * For the first 34 seconds no time sync packet is heard, so after the root timeout we should take over as the root and
+ * start sending our own rounds. Then 0x02 starts passing on the rounds of 0x00, which has a lower address, so we should
+ * follow it instead. Each packet from 0x02 carries the network time at which its previous packet was sent, which is
+ * paired with when that packet arrived here. Once we have a sample we should pass on each new round after a short
+ * random delay, and after a few samples the error against the clock of 0x00 should settle to a millisecond or two,
+ * with the drift worked out close to 1000 ppm. A round passed on for 0x03, which has a higher address, should be
+ * ignored.
+ *
+ * Actions are then scheduled at network times, and should each be called within a millisecond of that time by the
+ * clock of 0x00. Only 'NET_MAX_SCHEDULED_ACTIONS' can be waiting at once, but an action's entry is free again by the
+ * time it's called.
+ *
+ * Finally 0x02 goes quiet, and we should take over as the root again, carrying on from our estimate without a jump.
+ */
+
+time current_time = TIME_ZERO;
+
+// The time the last packet from 0x02 arrived, and its sequence number:
+time previous_receive_time_0x02 = TIME_ZERO;
+uint8_t sequence_number_0x02 = 0x40;
+
+time root_network_time(time local_time) {
+    // The clock of 0x00, which is the network time once we follow it:
+    return local_time + 5000 + local_time / 1000;
+}
+
+void print_signed(int32_t value) {
+    if (value < 0) {
+        uart_put_byte('-');
+        value = -value;
+    } else {
+        uart_put_byte('+');
+    }
+    uart_print_hex_16(value);
+}
+
+void print_error() {
+    uart_put_string("  Synchronised: ");
+    uart_print_hex_8(net_is_time_synchronised());
+    uart_put_string(", error against 00: ");
+    print_signed(net_get_network_time() - root_network_time(current_time));
+    uart_put_string(" ms\n\r");
+}
+
+void run_milliseconds(int32_t milliseconds) {
+    for (int32_t i = 0; i < milliseconds; i++) {
+        current_time++;
+        net_update_sync();
+    }
+}
+
+void receive_round_from_0x02(net_address root) {
+    // 0x02 sent its previous packet at the moment it arrived here, so that's the network time it carries:
+    uint8_t previous_sequence_number = sequence_number_0x02++;
+    net_notify_time_sync(0x02, root, sequence_number_0x02, previous_sequence_number, root_network_time(previous_receive_time_0x02), current_time);
+    previous_receive_time_0x02 = current_time;
+}
+
+void print_action(time network_time) {
+    uart_put_string("Action called: scheduled ");
+    uart_print_hex_16((uint32_t) network_time >> 16);
+    uart_print_hex_16(network_time);
+    uart_put_string(", error against 00: ");
+    print_signed(root_network_time(current_time) - network_time);
+    uart_put_string(" ms\n\r");
+}
+
+void reschedule_action(time network_time) {
+    print_action(network_time);
+    uart_put_string("Rescheduling 1 second later: ");
+    uart_print_hex_8(net_schedule_action(time_add_seconds(network_time, 1), print_action));
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+    net_initialise_sync();
+
+    uart_put_string("\n\r--- Starting without a root ---\n\r");
+    print_error();
+    run_milliseconds(17 * NET_SYNC_INTERVAL_MILLISECONDS);
+    print_error();
+
+    uart_put_string("\n\r--- Following root 00 through 02 ---\n\r");
+    previous_receive_time_0x02 = current_time;
+    receive_round_from_0x02(0x00);
+    for (uint8_t round = 0; round < 20; round++) {
+        run_milliseconds(NET_SYNC_INTERVAL_MILLISECONDS);
+        receive_round_from_0x02(0x00);
+        print_error();
+    }
+
+    uart_put_string("\n\r--- Ignoring a round for root 03 ---\n\r");
+    net_notify_time_sync(0x03, 0x03, 0x10, 0x0F, root_network_time(current_time), current_time);
+    run_milliseconds(100);
+    print_error();
+
+    uart_put_string("\n\r--- Scheduling actions ---\n\r");
+    time action_time = time_add_seconds(net_get_network_time(), 2);
+    uart_put_string("Scheduled: ");
+    uart_print_hex_8(net_schedule_action(action_time, print_action));
+    uart_print_hex_8(net_schedule_action(time_add_milliseconds(action_time, 500), print_action));
+    uart_print_hex_8(net_schedule_action(time_add_milliseconds(action_time, 1000), reschedule_action));
+    uart_print_hex_8(net_schedule_action(time_add_milliseconds(action_time, 3000), print_action));
+    uart_print_hex_8(net_schedule_action(time_add_milliseconds(action_time, 3000), print_action));
+    uart_put_string("\n\r");
+    for (uint8_t round = 0; round < 2; round++) {
+        run_milliseconds(NET_SYNC_INTERVAL_MILLISECONDS);
+        receive_round_from_0x02(0x00);
+    }
+    print_error();
+
+    uart_put_string("\n\r--- Root going quiet ---\n\r");
+    run_milliseconds(16 * NET_SYNC_INTERVAL_MILLISECONDS + 100);
+    print_error();
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//************************* packets.h emulated implementation ***********************//
+
+bool net_send_time_sync_packet(net_address root, uint8_t sequence_number, uint8_t previous_sequence_number, time previous_time) {
+    uart_put_string("Sending time sync packet at ");
+    uart_print_hex_16((uint32_t) current_time >> 16);
+    uart_print_hex_16(current_time);
+    uart_put_string(":\n\r  Root:     ");
+    uart_print_hex_8(root);
+    uart_put_string("\n\r  Sequence: ");
+    uart_print_hex_8(sequence_number);
+    uart_put_string(" (previous ");
+    uart_print_hex_8(previous_sequence_number);
+    uart_put_string(" sent at ");
+    uart_print_hex_16((uint32_t) previous_time >> 16);
+    uart_print_hex_16(previous_time);
+    uart_put_string(")\n\r");
+    return true;
+}
+
+//*************************** dll.h emulated implementation *************************//
+
+time dll_get_transmit_time() {
+    // Every packet is sent at the emulated current time:
+    return current_time;
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
@@ -1,6 +1,8 @@
 #include "network_stack/phy.h"
+#include "time.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -16,6 +18,22 @@ static uint8_t rx_buffer[PHY_MAX_RX_FRAME_SIZE];
 static volatile uint8_t rx_length;
 static volatile bool rx_complete;
 
+// The times at which the last frames ended, captured at their STOP conditions. The receive time is copied along with
+// the frame, since another frame can end before the next one is read:
+static volatile time rx_stop_time;
+static volatile time tx_stop_time;
+static time rx_frame_time;
+
+// The bus utilisation estimate is worked out from the number of bytes seen on the bus in each sample period. Every frame
+// is sent to the general call address, so every device sees every byte. Each byte takes up 9 bit times (8 data bits and
+// an acknowledge bit) at 100 kHz:
+#define UTILISATION_SAMPLE_MILLISECONDS (100)
+#define BYTE_TIME_MICROSECONDS (90)
+
+static volatile uint16_t bus_byte_count;
+static time utilisation_sample_time;
+static uint16_t bus_utilisation; // In 64ths of a percent, so that small steps of the estimate aren't lost to rounding
+
 void phy_initialise() {
     cli();
 
@@ -32,6 +50,10 @@ void phy_initialise() {
     // Enable pullup resistors:
     PORTC |= (1 << PC1) | (1 << PC0);
 
+    bus_byte_count = 0;
+    utilisation_sample_time = time_now();
+    bus_utilisation = 0;
+
     sei();
 }
 
@@ -64,6 +86,7 @@ uint8_t phy_receive_frame(uint8_t *output_buffer, uint8_t max_length) {
         sei();
 
         rx_complete = false;
+        rx_frame_time = rx_stop_time;
         uint8_t count = (rx_length < max_length) ? rx_length : max_length;
         if (output_buffer != NULL) {
             memcpy(output_buffer, rx_buffer, count);
@@ -81,6 +104,42 @@ uint8_t phy_receive_frame(uint8_t *output_buffer, uint8_t max_length) {
     return copied_length;
 }
 
+time phy_get_receive_time() {
+    return rx_frame_time;
+}
+
+time phy_get_transmit_time() {
+    time transmit_time;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        transmit_time = tx_stop_time;
+    }
+    return transmit_time;
+}
+
+uint8_t phy_get_bus_utilisation() {
+    time now = time_now();
+    int32_t elapsed_time = time_delta_milliseconds(utilisation_sample_time, now);
+    if (elapsed_time < UTILISATION_SAMPLE_MILLISECONDS) {
+        return (bus_utilisation + 32) >> 6;
+    }
+
+    uint16_t byte_count;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        byte_count = bus_byte_count;
+        bus_byte_count = 0;
+    }
+    utilisation_sample_time = now;
+
+    // Work out the percentage of the sample period that the bytes took up, and move the estimate a quarter of the way
+    // towards it:
+    int32_t sample = (int32_t) byte_count * BYTE_TIME_MICROSECONDS / (elapsed_time * 10);
+    if (sample > 100) {
+        sample = 100;
+    }
+    bus_utilisation += ((int32_t) sample * 64 - bus_utilisation) / 4;
+    return (bus_utilisation + 32) >> 6;
+}
+
 ISR(TWI_vect) {
     uint8_t twi_status = TWSR & 0xF8;
 
@@ -104,6 +163,8 @@ ISR(TWI_vect) {
         case 0x20:
         case 0x28:
         case 0x30: {
+            bus_byte_count++;
+
             if (tx_remaining != 0) {
                 // Set up next byte to transmit:
                 TWDR = *tx_next_byte;
@@ -115,6 +176,7 @@ ISR(TWI_vect) {
             } else {
                 // Set the STOP bit and clear the interrupt flag:
                 TWCR |= (1 << TWSTO) | (1 << TWINT);
+                tx_stop_time = time_now();
 
                 // Signal transmit complete:
                 tx_complete = true;
@@ -140,6 +202,8 @@ ISR(TWI_vect) {
         // Own SLA+W received, or general call address received:
         case 0x60:
         case 0x70: {
+            bus_byte_count++;
+
             // Reset RX length:
             rx_length = 0;
             rx_complete = false;
@@ -154,6 +218,7 @@ ISR(TWI_vect) {
         case 0x88:
         case 0x98: {
             uint8_t data_byte = TWDR;
+            bus_byte_count++;
 
             if (rx_length < sizeof(rx_buffer)) {
                 rx_buffer[rx_length] = data_byte;
@@ -167,6 +232,7 @@ ISR(TWI_vect) {
         // STOP condition received:
         case 0xA0: {
             // Signal RX completed:
+            rx_stop_time = time_now();
             rx_complete = true;
 
             // Clear interrupt flag:
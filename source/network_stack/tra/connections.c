@@ -0,0 +1,311 @@
+#include "connections.h"
+#include "storage.h"
+#include <stddef.h>
+#include <string.h>
+
+// The number of times this device has started is kept in storage, after the network layer's routing snapshots. Only the
+// bytes that change are written, so the low byte is written once per start.
+#define BOOT_COUNT_STORAGE_ADDRESS (STORAGE_SIZE - 2)
+
+// The first stream and sequence number of each connection are taken from a seed, whose low 4 bits are the stream and
+// next 8 bits the sequence number. The seed is moved on by a different amount at each start and for each connection
+// opened, so that after a restart a peer is unlikely to mistake the new payloads for ones from before the restart, no
+// matter how long the device has been running.
+#define STREAM_SEED_BOOT_STEP (0x0A5)
+#define STREAM_SEED_CONNECTION_STEP (0x011)
+
+// Table of connections. The entries aren't kept in any order.
+static tra_connection connections[TRA_MAX_CONNECTIONS];
+
+// Lists of slots for sent and received payloads, shared between all connections. The slots aren't kept in any order.
+static tra_send_slot send_slots[TRA_SEND_SLOT_COUNT];
+static tra_receive_slot receive_slots[TRA_RECEIVE_SLOT_COUNT];
+
+// The seed for the first stream and sequence number of the next connection opened.
+static uint16_t stream_seed = 0;
+
+tra_connection *tra_get_connection(uint8_t connection_index) {
+    return &connections[connection_index];
+}
+
+tra_send_slot *tra_get_send_slot(uint8_t slot_index) {
+    return &send_slots[slot_index];
+}
+
+void tra_initialise_connections() {
+    memset(connections, 0, sizeof(connections));
+    memset(send_slots, 0, sizeof(send_slots));
+    memset(receive_slots, 0, sizeof(receive_slots));
+
+    // Count this start, and seed the streams from it:
+    uint8_t boot_count_bytes[2];
+    storage_read(BOOT_COUNT_STORAGE_ADDRESS, boot_count_bytes, sizeof(boot_count_bytes));
+    uint16_t boot_count = (boot_count_bytes[0] | (boot_count_bytes[1] << 8)) + 1;
+    storage_write_byte(BOOT_COUNT_STORAGE_ADDRESS, boot_count & 0x00FF);
+    storage_write_byte(BOOT_COUNT_STORAGE_ADDRESS + 1, (boot_count & 0xFF00) >> 8);
+    stream_seed = boot_count * STREAM_SEED_BOOT_STEP;
+}
+
+uint8_t tra_find_connection(net_address peer) {
+    for (uint8_t connection_index = 0; connection_index < TRA_MAX_CONNECTIONS; connection_index++) {
+        if (connections[connection_index].is_used && connections[connection_index].peer == peer) {
+            return connection_index;
+        }
+    }
+    return TRA_MAX_CONNECTIONS;
+}
+
+uint8_t tra_open_connection(net_address peer) {
+    uint8_t connection_index = tra_find_connection(peer);
+    if (connection_index != TRA_MAX_CONNECTIONS) {
+        return connection_index;
+    }
+
+    // Find a free entry, or else the entry which has been idle the longest and has nothing waiting to be acknowledged or
+    // partway through a message. An entry which still owes its peer an acknowledgement or a reset is kept until it's
+    // sent, otherwise the peer retransmits to a connection that no longer exists and has to start a new stream:
+    time now = time_now();
+    uint8_t free_index = TRA_MAX_CONNECTIONS;
+    int32_t longest_idle_time = -1;
+    for (connection_index = 0; connection_index < TRA_MAX_CONNECTIONS; connection_index++) {
+        tra_connection *connection = &connections[connection_index];
+        if (connection->is_used == false) {
+            free_index = connection_index;
+            break;
+        }
+        int32_t idle_time = time_delta_milliseconds(connection->last_activity_time, now);
+        if (connection->send_next == connection->send_base && connection->message_source == NULL && connection->is_receiving_message == false
+            && connection->is_acknowledgement_pending == false && connection->is_reset_pending == false && idle_time > longest_idle_time) {
+            free_index = connection_index;
+            longest_idle_time = idle_time;
+        }
+    }
+    if (free_index == TRA_MAX_CONNECTIONS) {
+        return TRA_MAX_CONNECTIONS;
+    }
+    tra_close_connection(free_index);
+
+    // Take the first stream and sequence number from the seed:
+    tra_connection *connection = &connections[free_index];
+    connection->peer = peer;
+    connection->is_used = true;
+    connection->last_activity_time = now;
+    connection->send_stream = stream_seed & 0x0F;
+    connection->send_base = (uint8_t) (stream_seed >> 4);
+    stream_seed += STREAM_SEED_CONNECTION_STEP;
+    connection->send_next = connection->send_base;
+    connection->peer_window = 1;
+    connection->retransmission_timeout = TRA_INITIAL_RETRANSMISSION_TIMEOUT_MILLISECONDS;
+    connection->congestion_window = TRA_INITIAL_CONGESTION_WINDOW << 3;
+    connection->slow_start_threshold = TRA_MAX_WINDOW << 3;
+    return free_index;
+}
+
+void tra_close_connection(uint8_t connection_index) {
+    for (uint8_t slot_index = 0; slot_index < TRA_SEND_SLOT_COUNT; slot_index++) {
+        if (send_slots[slot_index].connection_index == connection_index) {
+            send_slots[slot_index].is_used = false;
+        }
+    }
+    tra_drop_receive_slots(connection_index);
+    memset(&connections[connection_index], 0, sizeof(tra_connection));
+}
+
+bool tra_restart_send_stream(uint8_t connection_index) {
+    tra_connection *connection = &connections[connection_index];
+
+    // Go through the held payloads in order, dropping the chunks of any message whose first chunk isn't held any more.
+    // The rest are numbered on from the oldest, and marked as never sent. A slot is only ever renumbered to the sequence
+    // number being looked up or an earlier one, so it can't be found again by a later lookup:
+    bool is_message_dropped = false;
+    bool is_message_start_held = false;
+    uint8_t sequence_number = connection->send_base;
+    for (uint8_t old_sequence_number = connection->send_base; old_sequence_number != connection->send_next; old_sequence_number++) {
+        tra_send_slot *slot = tra_find_send_slot(connection_index, old_sequence_number);
+        if (slot->is_message_chunk == false || slot->is_message_start) {
+            is_message_start_held = slot->is_message_chunk;
+        } else if (is_message_start_held == false) {
+            slot->is_used = false;
+            is_message_dropped = true;
+            continue;
+        }
+        slot->sequence_number = sequence_number++;
+        slot->transmission_count = 0;
+        slot->is_selectively_acknowledged = false;
+        slot->is_retransmission_due = false;
+        slot->is_fast_retransmitted = false;
+    }
+    connection->send_next = sequence_number;
+
+    // Stop reading the message being sent if its first chunk has already been acknowledged:
+    if (connection->message_source != NULL && connection->message_offset > 0 && is_message_start_held == false) {
+        connection->message_source = NULL;
+        is_message_dropped = true;
+    }
+
+    connection->send_stream = (connection->send_stream + 1) & 0x0F;
+    connection->peer_window = 1;
+    connection->is_send_synchronised = false;
+
+    // The peer may have restarted somewhere else in the network, so the shortest round trip time is measured again:
+    connection->min_round_trip_time = 0;
+    return is_message_dropped;
+}
+
+tra_send_slot *tra_find_send_slot(uint8_t connection_index, uint8_t sequence_number) {
+    for (uint8_t slot_index = 0; slot_index < TRA_SEND_SLOT_COUNT; slot_index++) {
+        tra_send_slot *slot = &send_slots[slot_index];
+        if (slot->is_used && slot->connection_index == connection_index && slot->sequence_number == sequence_number) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+tra_send_slot *tra_find_free_send_slot() {
+    for (uint8_t slot_index = 0; slot_index < TRA_SEND_SLOT_COUNT; slot_index++) {
+        if (send_slots[slot_index].is_used == false) {
+            return &send_slots[slot_index];
+        }
+    }
+    return NULL;
+}
+
+tra_receive_slot *tra_find_receive_slot(uint8_t connection_index, uint8_t sequence_number) {
+    for (uint8_t slot_index = 0; slot_index < TRA_RECEIVE_SLOT_COUNT; slot_index++) {
+        tra_receive_slot *slot = &receive_slots[slot_index];
+        if (slot->is_used && slot->connection_index == connection_index && slot->sequence_number == sequence_number) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+tra_receive_slot *tra_find_free_receive_slot() {
+    for (uint8_t slot_index = 0; slot_index < TRA_RECEIVE_SLOT_COUNT; slot_index++) {
+        if (receive_slots[slot_index].is_used == false) {
+            return &receive_slots[slot_index];
+        }
+    }
+    return NULL;
+}
+
+void tra_drop_receive_slots(uint8_t connection_index) {
+    for (uint8_t slot_index = 0; slot_index < TRA_RECEIVE_SLOT_COUNT; slot_index++) {
+        if (receive_slots[slot_index].connection_index == connection_index) {
+            receive_slots[slot_index].is_used = false;
+        }
+    }
+}
+
+uint8_t tra_get_receive_window() {
+    uint8_t window = 1;
+    for (uint8_t slot_index = 0; slot_index < TRA_RECEIVE_SLOT_COUNT; slot_index++) {
+        if (receive_slots[slot_index].is_used == false && window < TRA_MAX_WINDOW) {
+            window++;
+        }
+    }
+    return window;
+}
+
+void tra_add_round_trip_time(uint8_t connection_index, int32_t round_trip_time) {
+    tra_connection *connection = &connections[connection_index];
+    if (round_trip_time < 1) {
+        round_trip_time = 1;
+    }
+    if (round_trip_time > TRA_MAX_RETRANSMISSION_TIMEOUT_MILLISECONDS) {
+        round_trip_time = TRA_MAX_RETRANSMISSION_TIMEOUT_MILLISECONDS;
+    }
+    time now = time_now();
+    if (connection->min_round_trip_time == 0 || round_trip_time < connection->min_round_trip_time
+        || time_delta_seconds(connection->min_round_trip_time_time, now) >= TRA_MIN_ROUND_TRIP_TIME_WINDOW_SECONDS) {
+        connection->min_round_trip_time = round_trip_time;
+        connection->min_round_trip_time_time = now;
+    }
+
+    // Keep the estimate the way Jacobson's algorithm does: the smoothed round trip time is scaled by 8 and moves 1/8 of
+    // the way towards each measurement, and the variance is scaled by 4 and moves 1/4 of the way towards each
+    // measurement's difference from the smoothed round trip time:
+    if (connection->smoothed_round_trip_time == 0) {
+        connection->smoothed_round_trip_time = round_trip_time << 3;
+        connection->round_trip_time_variance = round_trip_time << 1;
+    } else {
+        int32_t difference = round_trip_time - (connection->smoothed_round_trip_time >> 3);
+        connection->smoothed_round_trip_time += difference;
+        if (difference < 0) {
+            difference = -difference;
+        }
+        connection->round_trip_time_variance += difference - (connection->round_trip_time_variance >> 2);
+    }
+    tra_reset_retransmission_timeout(connection_index);
+}
+
+void tra_reset_retransmission_timeout(uint8_t connection_index) {
+    tra_connection *connection = &connections[connection_index];
+    if (connection->smoothed_round_trip_time == 0) {
+        connection->retransmission_timeout = TRA_INITIAL_RETRANSMISSION_TIMEOUT_MILLISECONDS;
+        return;
+    }
+
+    // The timeout is the smoothed round trip time plus four times its variance:
+    uint16_t timeout = (connection->smoothed_round_trip_time >> 3) + connection->round_trip_time_variance;
+    if (timeout < TRA_MIN_RETRANSMISSION_TIMEOUT_MILLISECONDS) {
+        timeout = TRA_MIN_RETRANSMISSION_TIMEOUT_MILLISECONDS;
+    }
+    if (timeout > TRA_MAX_RETRANSMISSION_TIMEOUT_MILLISECONDS) {
+        timeout = TRA_MAX_RETRANSMISSION_TIMEOUT_MILLISECONDS;
+    }
+    connection->retransmission_timeout = timeout;
+}
+
+void tra_grow_congestion_window(uint8_t connection_index, uint8_t acknowledged_count, int32_t round_trip_time) {
+    tra_connection *connection = &connections[connection_index];
+
+    // The recovery ends once every payload which was in flight when the window was shrunk has been acknowledged:
+    if (connection->is_recovering) {
+        if ((uint8_t) (connection->send_base - connection->recovery_sequence_number) < 0x80) {
+            connection->is_recovering = false;
+        }
+        return;
+    }
+    if (round_trip_time != 0 && round_trip_time > (int32_t) connection->min_round_trip_time * TRA_QUEUEING_ROUND_TRIP_TIME_FACTOR) {
+        return;
+    }
+
+    // The window is kept in eighths of a payload, so that it can grow by a fraction of a payload at a time:
+    for (uint8_t i = 0; i < acknowledged_count; i++) {
+        if (connection->congestion_window < connection->slow_start_threshold) {
+            connection->congestion_window += 1 << 3;
+        } else {
+            connection->congestion_window += (1 << 6) / connection->congestion_window;
+        }
+    }
+    if (connection->congestion_window > TRA_MAX_WINDOW << 3) {
+        connection->congestion_window = TRA_MAX_WINDOW << 3;
+    }
+}
+
+void tra_shrink_congestion_window(uint8_t connection_index, bool is_timeout) {
+    tra_connection *connection = &connections[connection_index];
+    if (connection->is_recovering && is_timeout == false) {
+        return;
+    }
+
+    // Halve the window, but not below one payload:
+    connection->slow_start_threshold = connection->congestion_window >> 1;
+    if (connection->slow_start_threshold < 1 << 3) {
+        connection->slow_start_threshold = 1 << 3;
+    }
+    connection->congestion_window = is_timeout ? 1 << 3 : connection->slow_start_threshold;
+    connection->is_recovering = true;
+    connection->recovery_sequence_number = connection->send_next;
+
+    // A timeout can mean the route to the peer has changed, so the shortest round trip time is measured again:
+    if (is_timeout) {
+        connection->min_round_trip_time = 0;
+    }
+}
+
+uint8_t tra_get_congestion_window(uint8_t connection_index) {
+    return connections[connection_index].congestion_window >> 3;
+}
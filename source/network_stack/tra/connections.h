@@ -0,0 +1,293 @@
+#pragma once
+
+#include "network_stack/tra.h"
+#include "time.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The number of devices that connections can be held with at once. A connection carries payloads in both directions.
+ */
+#ifndef TRA_MAX_CONNECTIONS
+#define TRA_MAX_CONNECTIONS (3)
+#endif
+
+/**
+ * The largest number of payloads that can be sent to a destination without being acknowledged. Can't be more than 8,
+ * since a selective acknowledgement covers the 8 segments after the next expected one.
+ */
+#ifndef TRA_MAX_WINDOW
+#define TRA_MAX_WINDOW (4)
+#endif
+
+/**
+ * The number of sent payloads that can be held at once, shared between all connections, until they're acknowledged.
+ */
+#ifndef TRA_SEND_SLOT_COUNT
+#define TRA_SEND_SLOT_COUNT (2)
+#endif
+
+/**
+ * The number of payloads which arrived out of order that can be held at once, shared between all connections, until the
+ * payloads before them arrive.
+ */
+#ifndef TRA_RECEIVE_SLOT_COUNT
+#define TRA_RECEIVE_SLOT_COUNT (2)
+#endif
+
+/**
+ * The retransmission timeout used before any round trip times have been measured, and its limits.
+ */
+#define TRA_INITIAL_RETRANSMISSION_TIMEOUT_MILLISECONDS (1000)
+#define TRA_MIN_RETRANSMISSION_TIMEOUT_MILLISECONDS (200)
+#define TRA_MAX_RETRANSMISSION_TIMEOUT_MILLISECONDS (8000)
+
+/**
+ * The number of retransmission timeouts in a row after which a destination is given up on. With the timeout doubling
+ * each time, this gives up after about 30 seconds, around when the network layer gives up on finding a route.
+ */
+#define TRA_MAX_RETRANSMISSIONS (8)
+
+/**
+ * The congestion window that a connection starts with, in payloads.
+ */
+#define TRA_INITIAL_CONGESTION_WINDOW (1)
+
+/**
+ * How much a round trip time has to grow beyond the shortest one measured before it's taken as a sign of frames queueing
+ * for the bus, as a multiple of the shortest one.
+ */
+#define TRA_QUEUEING_ROUND_TRIP_TIME_FACTOR (2)
+
+/**
+ * How long the shortest round trip time measured on a connection is kept before the next measurement replaces it, even
+ * a longer one, so that it follows the route to the peer when that gets longer.
+ */
+#define TRA_MIN_ROUND_TRIP_TIME_WINDOW_SECONDS (10)
+
+/**
+ * With 'TRA_BUS_PACING' defined, new payloads on a connection are spaced out by a random time averaging its round trip
+ * time divided by its congestion window, scaled by 'u / (100 - u)' for a bus utilisation of 'u' percent, so that they're
+ * hardly spaced out on an idle bus. The utilisation is capped at this percentage, which caps the scaling at 9.
+ */
+#define TRA_MAX_PACING_UTILISATION (90)
+
+/**
+ * How long a connection has to be idle before it's closed.
+ */
+#define TRA_CONNECTION_TIMEOUT_SECONDS (120)
+
+/**
+ * The state of a connection with another device.
+ */
+typedef struct {
+    net_address peer; // The other device's address
+    bool is_used; // Whether this entry holds a connection
+    time last_activity_time; // The last time a segment was sent to or received from the peer
+
+    // Sending side:
+    uint8_t send_base; // The sequence number of the oldest unacknowledged payload
+    uint8_t send_next; // The sequence number given to the next queued payload
+    uint8_t peer_window; // The number of payloads from 'send_base' onwards that the peer has space for
+    uint8_t send_stream; // Identifies the payloads sent since the sequence numbers were last (re)started, from 0 to 15
+    bool is_send_synchronised; // Whether the peer has acknowledged a payload since the sequence numbers were (re)started
+    uint16_t smoothed_round_trip_time; // In eighths of a millisecond, or 0 if no round trip time has been measured
+    uint16_t round_trip_time_variance; // In quarters of a millisecond
+    uint16_t retransmission_timeout; // In milliseconds
+    uint8_t timeout_count; // The number of retransmission timeouts in a row without the peer acknowledging anything
+    uint8_t congestion_window; // The number of payloads that can be in flight without congesting the bus, in eighths
+    uint8_t slow_start_threshold; // The congestion window below which it grows by a payload per acknowledged payload
+    uint16_t min_round_trip_time; // The shortest recent round trip time in milliseconds, or 0 if none was measured
+    time min_round_trip_time_time; // When 'min_round_trip_time' was measured
+    bool is_recovering; // Whether the congestion window was shrunk for payloads which are still in flight
+    uint8_t recovery_sequence_number; // The sequence number which ends the recovery once it's acknowledged
+#ifdef TRA_BUS_PACING
+    time next_send_time; // The earliest time that the next new payload can be sent
+#endif
+    tra_message_source message_source; // Reads the message being sent, or 'NULL' if no message is being sent
+    uint16_t message_length; // The number of bytes in the message being sent
+    uint16_t message_offset; // The number of bytes of the message being sent which have been read
+    net_traffic_class message_traffic_class; // The traffic class to send the message with
+    tra_port message_port; // The port to send the message on
+
+    // Receiving side:
+    uint8_t receive_stream; // Identifies the peer's payloads since it last (re)started its sequence numbers
+    uint8_t receive_next; // The sequence number of the next payload to be delivered
+    bool is_receive_synchronised; // Whether the peer's sequence numbers are known
+    uint8_t unacknowledged_receive_count; // The number of payloads received since the last acknowledgement was sent
+    bool is_acknowledgement_pending; // Whether an acknowledgement needs to be sent
+    time acknowledgement_due_time; // The time by which the pending acknowledgement should be sent
+    bool is_receiving_message; // Whether a message is partway through being received
+    uint16_t receive_message_length; // The number of bytes in the message being received
+    uint16_t receive_message_offset; // The number of bytes of the message being received which have been delivered
+    tra_port receive_message_port; // The port that the message being received is on
+    bool is_reset_pending; // Whether the peer needs to be told to restart its sequence numbers
+    uint8_t reset_stream; // The stream of the peer's payloads that couldn't be delivered
+} tra_connection;
+
+/**
+ * A sent payload which is held until it's acknowledged.
+ */
+typedef struct {
+    uint8_t payload[TRA_MAX_PAYLOAD_LENGTH]; // A copy of the payload
+    uint8_t length; // The number of bytes in the payload
+    uint8_t connection_index; // The connection that the payload is sent on
+    uint8_t sequence_number; // The payload's sequence number
+    tra_port port; // The port to send the payload on
+    net_traffic_class traffic_class; // The traffic class to send the payload with
+    bool is_message_chunk; // Whether the payload is a chunk of a message
+    bool is_message_start; // Whether the payload is the first chunk of a message, which starts with the message's length
+    time sent_time; // The last time the payload was sent
+    uint8_t transmission_count; // The number of times the payload has been sent, or 0 if it hasn't been sent yet
+    bool is_selectively_acknowledged; // Whether the peer has reported receiving the payload out of order
+    bool is_retransmission_due; // Whether the payload should be retransmitted at the next update
+    bool is_fast_retransmitted; // Whether the payload has already been retransmitted because later payloads overtook it
+    bool is_used; // Whether this slot holds a payload
+} tra_send_slot;
+
+/**
+ * A received payload which is held until the payloads before it arrive.
+ */
+typedef struct {
+    uint8_t payload[TRA_MAX_PAYLOAD_LENGTH]; // A copy of the payload
+    uint8_t length; // The number of bytes in the payload
+    uint8_t connection_index; // The connection that the payload was received on
+    uint8_t sequence_number; // The payload's sequence number
+    tra_port port; // The port that the payload was received on
+    bool is_message_chunk; // Whether the payload is a chunk of a message
+    bool is_used; // Whether this slot holds a payload
+} tra_receive_slot;
+
+/**
+ * @brief Returns a connection table entry.
+ * @param connection_index: The entry's index, less than 'TRA_MAX_CONNECTIONS'.
+ * @returns A pointer to the entry.
+ */
+tra_connection *tra_get_connection(uint8_t connection_index);
+
+/**
+ * @brief Returns a send slot.
+ * @param slot_index: The slot's index, less than 'TRA_SEND_SLOT_COUNT'.
+ * @returns A pointer to the slot.
+ */
+tra_send_slot *tra_get_send_slot(uint8_t slot_index);
+
+/**
+ * @brief Clears every connection and slot.
+ */
+void tra_initialise_connections();
+
+/**
+ * @brief Finds the connection with a peer.
+ * @param peer: The peer's address.
+ * @returns The connection's index, or 'TRA_MAX_CONNECTIONS' if there isn't one.
+ */
+uint8_t tra_find_connection(net_address peer);
+
+/**
+ * @brief Finds the connection with a peer, or opens a new one if there isn't one. If every entry is in use, the
+ *        connection which has been idle the longest without any payloads waiting to be acknowledged or messages partway
+ *        through is replaced.
+ * @param peer: The peer's address.
+ * @returns The connection's index, or 'TRA_MAX_CONNECTIONS' if no entry could be freed.
+ */
+uint8_t tra_open_connection(net_address peer);
+
+/**
+ * @brief Closes a connection, dropping any payloads held on it.
+ * @param connection_index: The connection's index.
+ */
+void tra_close_connection(uint8_t connection_index);
+
+/**
+ * @brief Restarts the sequence numbers of the payloads waiting to be acknowledged on a connection as a new stream, so
+ *        that they're sent again as if they had never been sent. The peer drops any message it's partway through
+ *        receiving when the new stream starts, so the rest of a message whose first chunk has already been acknowledged
+ *        is dropped, and stops being sent. The shortest round trip time is cleared, as the peer may have moved.
+ * @param connection_index: The connection's index.
+ * @returns 'true' if a message partway through being sent was dropped; 'false' otherwise.
+ */
+bool tra_restart_send_stream(uint8_t connection_index);
+
+/**
+ * @brief Finds the held payload with a given sequence number on a connection.
+ * @param connection_index: The connection's index.
+ * @param sequence_number: The payload's sequence number.
+ * @returns A pointer to the payload's slot, or 'NULL' if it isn't held.
+ */
+tra_send_slot *tra_find_send_slot(uint8_t connection_index, uint8_t sequence_number);
+
+/**
+ * @brief Finds a free send slot.
+ * @returns A pointer to the slot, or 'NULL' if every slot is in use.
+ */
+tra_send_slot *tra_find_free_send_slot();
+
+/**
+ * @brief Finds the held out of order payload with a given sequence number on a connection.
+ * @param connection_index: The connection's index.
+ * @param sequence_number: The payload's sequence number.
+ * @returns A pointer to the payload's slot, or 'NULL' if it isn't held.
+ */
+tra_receive_slot *tra_find_receive_slot(uint8_t connection_index, uint8_t sequence_number);
+
+/**
+ * @brief Finds a free receive slot.
+ * @returns A pointer to the slot, or 'NULL' if every slot is in use.
+ */
+tra_receive_slot *tra_find_free_receive_slot();
+
+/**
+ * @brief Drops every held out of order payload on a connection.
+ * @param connection_index: The connection's index.
+ */
+void tra_drop_receive_slots(uint8_t connection_index);
+
+/**
+ * @brief Works out the window to advertise to peers: the next payload in order can always be delivered straight away,
+ *        and every free receive slot can hold one more payload that arrives out of order.
+ * @returns The number of payloads, between 1 and 'TRA_MAX_WINDOW'.
+ */
+uint8_t tra_get_receive_window();
+
+/**
+ * @brief Updates a connection's round trip time estimate with a new measurement, and recalculates its retransmission
+ *        timeout from it. The measurement replaces the shortest round trip time if it's shorter, or if the shortest one
+ *        is older than 'TRA_MIN_ROUND_TRIP_TIME_WINDOW_SECONDS'.
+ * @param connection_index: The connection's index.
+ * @param round_trip_time: The measured round trip time in milliseconds.
+ */
+void tra_add_round_trip_time(uint8_t connection_index, int32_t round_trip_time);
+
+/**
+ * @brief Recalculates a connection's retransmission timeout from its round trip time estimate, undoing any backoff.
+ * @param connection_index: The connection's index.
+ */
+void tra_reset_retransmission_timeout(uint8_t connection_index);
+
+/**
+ * @brief Grows a connection's congestion window after payloads are acknowledged: by a payload per acknowledged payload
+ *        below the slow start threshold, and by a payload per window of acknowledged payloads above it. The window
+ *        doesn't grow until the payloads in flight at the last loss have been acknowledged, or while the round trip time
+ *        shows frames queueing for the bus.
+ * @param connection_index: The connection's index.
+ * @param acknowledged_count: The number of payloads acknowledged.
+ * @param round_trip_time: The round trip time measured from the acknowledgement in milliseconds, or 0 if none was.
+ */
+void tra_grow_congestion_window(uint8_t connection_index, uint8_t acknowledged_count, int32_t round_trip_time);
+
+/**
+ * @brief Halves a connection's congestion window after a payload is lost, or shrinks it to a single payload after a
+ *        retransmission timeout. The window is only shrunk once for the payloads in flight when the loss is detected.
+ *        A retransmission timeout also clears the shortest round trip time, in case the route to the peer has changed.
+ * @param connection_index: The connection's index.
+ * @param is_timeout: Whether the loss was detected by a retransmission timeout.
+ */
+void tra_shrink_congestion_window(uint8_t connection_index, bool is_timeout);
+
+/**
+ * @brief Returns the number of payloads that can be in flight on a connection, from its congestion window.
+ * @param connection_index: The connection's index.
+ * @returns The number of payloads, between 1 and 'TRA_MAX_WINDOW'.
+ */
+uint8_t tra_get_congestion_window(uint8_t connection_index);
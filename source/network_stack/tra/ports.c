@@ -0,0 +1,32 @@
+#include "ports.h"
+#include <stddef.h>
+
+// Table of registered ports, in the order they were registered. Applications register a handful of ports, so searching
+// the table is quicker than indexing a table of every possible port would be worth in RAM.
+static tra_port_entry ports[TRA_MAX_PORTS];
+static uint8_t port_count = 0;
+
+void tra_initialise_ports() {
+    port_count = 0;
+}
+
+bool tra_add_port(tra_port port, tra_delivery delivery, tra_receive_callback receive_callback, tra_message_callback message_callback) {
+    if (port_count == TRA_MAX_PORTS || tra_find_port(port) != NULL) {
+        return false;
+    }
+    tra_port_entry *entry = &ports[port_count++];
+    entry->port = port;
+    entry->delivery = delivery;
+    entry->receive_callback = receive_callback;
+    entry->message_callback = message_callback;
+    return true;
+}
+
+const tra_port_entry *tra_find_port(tra_port port) {
+    for (uint8_t port_index = 0; port_index < port_count; port_index++) {
+        if (ports[port_index].port == port) {
+            return &ports[port_index];
+        }
+    }
+    return NULL;
+}
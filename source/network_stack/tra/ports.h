@@ -0,0 +1,44 @@
+#pragma once
+
+#include "network_stack/tra.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The number of ports that can be registered at once.
+ */
+#ifndef TRA_MAX_PORTS
+#define TRA_MAX_PORTS (4)
+#endif
+
+/**
+ * A registered port.
+ */
+typedef struct {
+    tra_port port; // The port number
+    tra_delivery delivery; // How payloads on the port are delivered
+    tra_receive_callback receive_callback; // Called with each payload received on the port, or 'NULL'
+    tra_message_callback message_callback; // Called with each chunk of a message received on the port, or 'NULL'
+} tra_port_entry;
+
+/**
+ * @brief Clears every registered port.
+ */
+void tra_initialise_ports();
+
+/**
+ * @brief Adds a port to the table of registered ports.
+ * @param port: The port number.
+ * @param delivery: How payloads on the port are delivered.
+ * @param receive_callback: The port's receive callback, or 'NULL'.
+ * @param message_callback: The port's message callback, or 'NULL'.
+ * @returns 'true' if the port was added, or 'false' if it's already in the table or the table is full.
+ */
+bool tra_add_port(tra_port port, tra_delivery delivery, tra_receive_callback receive_callback, tra_message_callback message_callback);
+
+/**
+ * @brief Finds a registered port.
+ * @param port: The port number.
+ * @returns A pointer to the port's entry, or 'NULL' if it isn't registered.
+ */
+const tra_port_entry *tra_find_port(tra_port port);
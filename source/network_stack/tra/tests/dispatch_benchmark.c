@@ -0,0 +1,124 @@
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "storage.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * This benchmark measures how long the transport layer takes to pass a received packet to its port's callback. It
+ * emulates the network layer and feeds the same packet to the transport layer many times, timing each case with the
+ * millisecond timer and printing the total time and the average number of CPU cycles per packet:
+ * - Calling the callback straight from the network layer's receive callback, as a baseline.
+ * - A datagram on the first and on the last of 8 registered unreliable ports.
+ * - A reliable payload in order on the first and on the last of 8 registered reliable ports.
+ */
+
+// The number of packets to time in each case:
+#ifndef DISPATCH_BENCHMARK_PACKET_COUNT
+#define DISPATCH_BENCHMARK_PACKET_COUNT (10000)
+#endif
+
+// The emulated network layer's receive callback and data buffer:
+net_receive_callback emulated_receive_callback = NULL;
+uint8_t net_data_buffer[121];
+
+// Touches the payload, so that the callback can't be optimised away:
+volatile uint8_t payload_sum = 0;
+
+void handle_payload(net_address source, uint8_t *payload, uint8_t length) {
+    payload_sum += payload[length - 1];
+}
+
+void print_result(const char *name, time start) {
+    int32_t milliseconds = time_delta_milliseconds(start, time_now());
+    uart_put_string(name);
+    uart_put_string(": ");
+    uart_print_hex_16(milliseconds);
+    uart_put_string(" ms, ");
+    uart_print_hex_16(milliseconds * (F_CPU / 1000) / DISPATCH_BENCHMARK_PACKET_COUNT);
+    uart_put_string(" cycles per packet\n\r");
+}
+
+void time_datagrams(const char *name, uint8_t port) {
+    uint8_t packet[34] = { 0x00, port };
+    time start = time_now();
+    for (uint32_t i = 0; i < DISPATCH_BENCHMARK_PACKET_COUNT; i++) {
+        emulated_receive_callback(0x02, packet, sizeof(packet));
+    }
+    print_result(name, start);
+}
+
+void time_reliable_payloads(const char *name, net_address source, uint8_t port) {
+    // Synchronise with the source's stream, then send it payloads in order:
+    uint8_t packet[35] = { 0x05, 0x00, port };
+    emulated_receive_callback(source, packet, sizeof(packet));
+    packet[0] = 0x01;
+    time start = time_now();
+    for (uint32_t i = 0; i < DISPATCH_BENCHMARK_PACKET_COUNT; i++) {
+        packet[1]++;
+        emulated_receive_callback(source, packet, sizeof(packet));
+    }
+    print_result(name, start);
+}
+
+int main() {
+    uart_initialise();
+    time_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+    tra_initialise();
+    for (uint8_t port = 0x10; port < 0x14; port++) {
+        tra_register_port(port, TRA_DELIVERY_UNRELIABLE, handle_payload, NULL);
+        tra_register_port(port + 0x10, TRA_DELIVERY_RELIABLE, handle_payload, NULL);
+    }
+
+    uint8_t payload[32] = { 0 };
+    time start = time_now();
+    for (uint32_t i = 0; i < DISPATCH_BENCHMARK_PACKET_COUNT; i++) {
+        handle_payload(0x02, payload, sizeof(payload));
+    }
+    print_result("Direct callback", start);
+    time_datagrams("Datagram, first port", 0x10);
+    time_datagrams("Datagram, last port", 0x13);
+    time_reliable_payloads("Reliable, first port", 0x03, 0x20);
+    time_reliable_payloads("Reliable, last port", 0x04, 0x23);
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+void net_set_receive_callback(net_receive_callback callback) {
+    emulated_receive_callback = callback;
+}
+
+uint8_t *net_get_data_buffer() {
+    return net_data_buffer;
+}
+
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked) {
+    return NET_SEND_SUCCESS;
+}
+
+//************************* storage.h emulated implementation ***********************//
+
+// The storage is blank, and writes to it are ignored, so every run starts as the first:
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    memset(data, 0xFF, data_length);
+}
+
+bool storage_is_ready() {
+    return true;
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+}
@@ -0,0 +1,308 @@
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "storage.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * This benchmark measures the transport layer's throughput and latency over a lossy path of 4 hops. This device has the
+ * logical address 0x01, and sends 200 payloads of 48 bytes to 0x05 through 0x02, 0x03 and 0x04, as fast as the transport
+ * layer accepts them.
+ *
+ * The bus is emulated as a queue shared by every device, which sends a frame of up to 23 bytes of a packet every
+ * millisecond. On every hop, each frame and each of DLL's ACKs is lost with the same chance. A frame which isn't
+ * acknowledged is sent again after 10 milliseconds, up to 3 times, like DLL does, and a packet with a frame that runs
+ * out of retries is lost. The receiver acknowledges every payload as soon as it arrives, holding up to three payloads
+ * that arrive out of order, like the transport layer does.
+ *
+ * For each loss rate, the payloads delivered, the data segments sent, the goodput in bytes per second, and the mean and
+ * largest time in milliseconds from a payload being accepted by 'tra_send()' to its delivery are printed. A case stops
+ * once every payload has been delivered, or after 120 seconds.
+ */
+
+// The number of payloads to send for each case:
+#ifndef LOSSY_PATH_BENCHMARK_PAYLOAD_COUNT
+#define LOSSY_PATH_BENCHMARK_PAYLOAD_COUNT (200)
+#endif
+
+#define PAYLOAD_LENGTH (48)
+#define PACKET_HEADER_LENGTH (5)
+#define FRAME_DATA_LENGTH (23)
+#define FRAME_MILLISECONDS (1)
+#define ACK_TIMEOUT_MILLISECONDS (10)
+#define MAX_RETRANSMISSIONS (3)
+#define HOP_COUNT (4)
+#define MAX_CASE_SECONDS (120)
+#define MAX_PACKETS_ON_BUS (48)
+#define RECEIVER_ADDRESS (0x05)
+#define RECEIVER_HELD_PAYLOADS (3)
+
+typedef struct {
+    bool is_used;
+    time arrival_time;
+    net_address source;
+    net_address destination;
+    uint8_t length;
+    uint8_t data[4]; // The start of the packet, which holds a whole acknowledgement or the flags and sequence number of a payload
+} emulated_packet;
+
+const uint8_t loss_percents[] = { 0, 10, 20, 30 };
+
+time current_time = TIME_ZERO;
+uint32_t random_state = 0x2545F491;
+uint8_t loss_percent = 0;
+
+// The emulated network layer's receive callback and data buffer:
+net_receive_callback emulated_receive_callback = NULL;
+uint8_t net_data_buffer[121];
+
+// The emulated bus, and the packets on it which haven't arrived yet:
+time bus_free_time = TIME_ZERO;
+emulated_packet packets_on_bus[MAX_PACKETS_ON_BUS];
+
+// The receiver's end of the connection with this device:
+uint8_t receiver_stream = 0;
+uint8_t receiver_next_expected = 0;
+uint8_t receiver_held_payloads = 0; // Bit 'n - 1' is set if the payload 'n' after the next expected one is held
+bool is_receiver_synchronised = false;
+
+// The time each payload was accepted by 'tra_send()':
+time accepted_times[LOSSY_PATH_BENCHMARK_PAYLOAD_COUNT];
+
+uint16_t payloads_accepted = 0;
+uint16_t payloads_delivered = 0;
+uint16_t segments_sent = 0;
+uint32_t latency_total = 0;
+uint32_t latency_max = 0;
+
+void ignore_payload(net_address source, uint8_t *payload, uint8_t length) {
+}
+
+bool is_frame_received() {
+    // 32-bit xorshift generator with a fixed seed, so that every run sees the same losses:
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return (random_state % 100) >= loss_percent;
+}
+
+bool send_over_bus(net_address source, net_address destination, const uint8_t *data, uint8_t length) {
+    // Wait for the packets already queued for the bus:
+    if (time_delta_milliseconds(bus_free_time, current_time) > 0) {
+        bus_free_time = current_time;
+    }
+
+    // Send each frame over every hop, until it and its ACK get through or it runs out of retries:
+    uint8_t frame_count = (PACKET_HEADER_LENGTH + length + FRAME_DATA_LENGTH - 1) / FRAME_DATA_LENGTH;
+    bool is_delivered = true;
+    for (uint8_t hop = 0; hop < HOP_COUNT && is_delivered; hop++) {
+        for (uint8_t frame = 0; frame < frame_count && is_delivered; frame++) {
+            uint8_t retransmissions = 0;
+            while (true) {
+                bus_free_time = time_add_milliseconds(bus_free_time, FRAME_MILLISECONDS);
+                if (is_frame_received() && is_frame_received()) {
+                    break;
+                }
+                bus_free_time = time_add_milliseconds(bus_free_time, ACK_TIMEOUT_MILLISECONDS);
+                if (++retransmissions > MAX_RETRANSMISSIONS) {
+                    is_delivered = false;
+                    break;
+                }
+            }
+        }
+    }
+    if (is_delivered == false) {
+        return false;
+    }
+
+    for (uint8_t index = 0; index < MAX_PACKETS_ON_BUS; index++) {
+        emulated_packet *packet = &packets_on_bus[index];
+        if (packet->is_used == false) {
+            packet->is_used = true;
+            packet->arrival_time = bus_free_time;
+            packet->source = source;
+            packet->destination = destination;
+            packet->length = length;
+            memcpy(packet->data, data, length < sizeof(packet->data) ? length : sizeof(packet->data));
+            return true;
+        }
+    }
+    return false;
+}
+
+void deliver_payload() {
+    int32_t latency = time_delta_milliseconds(accepted_times[payloads_delivered], current_time);
+    latency_total += latency;
+    if (latency > latency_max) {
+        latency_max = latency;
+    }
+    payloads_delivered++;
+}
+
+void receive_at_receiver(const emulated_packet *packet) {
+    // Take in a payload from this device the way the transport layer does, and acknowledge it:
+    uint8_t flags = packet->data[0];
+    if ((flags & 0x01) == 0) {
+        return;
+    }
+    uint8_t stream = flags >> 4;
+    uint8_t sequence_number = packet->data[1];
+    if ((flags & 0x04) && (is_receiver_synchronised == false || stream != receiver_stream)) {
+        receiver_stream = stream;
+        receiver_next_expected = sequence_number;
+        receiver_held_payloads = 0;
+        is_receiver_synchronised = true;
+    }
+    if (is_receiver_synchronised == false || stream != receiver_stream) {
+        return;
+    }
+    uint8_t offset = sequence_number - receiver_next_expected;
+    if (offset == 0) {
+        deliver_payload();
+        receiver_next_expected++;
+        while (receiver_held_payloads & 1) {
+            deliver_payload();
+            receiver_next_expected++;
+            receiver_held_payloads >>= 1;
+        }
+        receiver_held_payloads >>= 1;
+    } else if (offset <= RECEIVER_HELD_PAYLOADS) {
+        receiver_held_payloads |= 1 << (offset - 1);
+    }
+    uint8_t acknowledgement[4] = { 0x02, receiver_next_expected, receiver_held_payloads, (uint8_t) (receiver_stream << 4) | (RECEIVER_HELD_PAYLOADS + 1) };
+    send_over_bus(RECEIVER_ADDRESS, 0x01, acknowledgement, sizeof(acknowledgement));
+}
+
+void deliver_arrived_packets() {
+    for (uint8_t index = 0; index < MAX_PACKETS_ON_BUS; index++) {
+        emulated_packet *packet = &packets_on_bus[index];
+        if (packet->is_used == false || time_delta_milliseconds(packet->arrival_time, current_time) < 0) {
+            continue;
+        }
+        packet->is_used = false;
+        if (packet->destination == 0x01) {
+            emulated_receive_callback(packet->source, packet->data, packet->length);
+        } else {
+            receive_at_receiver(packet);
+        }
+    }
+}
+
+void run_case() {
+    memset(packets_on_bus, 0, sizeof(packets_on_bus));
+    bus_free_time = current_time;
+    random_state = 0x2545F491;
+    is_receiver_synchronised = false;
+    payloads_accepted = 0;
+    payloads_delivered = 0;
+    segments_sent = 0;
+    latency_total = 0;
+    latency_max = 0;
+    tra_initialise();
+    tra_register_port(0x07, TRA_DELIVERY_RELIABLE, ignore_payload, NULL);
+
+    uint8_t payload[PAYLOAD_LENGTH] = { 0 };
+    int32_t millisecond = 0;
+    while (payloads_delivered < LOSSY_PATH_BENCHMARK_PAYLOAD_COUNT && millisecond < MAX_CASE_SECONDS * (int32_t) 1000) {
+        millisecond++;
+        current_time = time_add_milliseconds(current_time, 1);
+        deliver_arrived_packets();
+        tra_update();
+        while (payloads_accepted < LOSSY_PATH_BENCHMARK_PAYLOAD_COUNT
+            && tra_send(RECEIVER_ADDRESS, 0x07, payload, sizeof(payload), NET_TRAFFIC_CLASS_BULK) == TRA_SEND_SUCCESS) {
+            accepted_times[payloads_accepted++] = current_time;
+        }
+    }
+
+    uart_put_string("  Loss ");
+    uart_print_hex_8(loss_percent);
+    uart_put_string("%: payloads delivered ");
+    uart_print_hex_16(payloads_delivered);
+    uart_put_string(", data segments sent ");
+    uart_print_hex_16(segments_sent);
+    uart_put_string(", bytes per second ");
+    uart_print_hex_16((uint32_t) payloads_delivered * PAYLOAD_LENGTH * 1000 / millisecond);
+    uart_put_string(", latency mean ");
+    uart_print_hex_16(payloads_delivered == 0 ? 0 : latency_total / payloads_delivered);
+    uart_put_string(", max ");
+    uart_print_hex_16(latency_max);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- 4 hops with lossy links ---\n\r");
+    for (uint8_t index = 0; index < sizeof(loss_percents); index++) {
+        loss_percent = loss_percents[index];
+        run_case();
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+void net_set_receive_callback(net_receive_callback callback) {
+    emulated_receive_callback = callback;
+}
+
+uint8_t *net_get_data_buffer() {
+    return net_data_buffer;
+}
+
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked) {
+    // A packet lost on a later hop is only noticed by the transport layer when it isn't acknowledged:
+    if (net_data_buffer[0] & 0x01) {
+        segments_sent++;
+    }
+    send_over_bus(0x01, destination, net_data_buffer, data_length);
+    return NET_SEND_SUCCESS;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* storage.h emulated implementation ***********************//
+
+// The storage is blank, and writes to it are ignored, so every run starts as the first:
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    memset(data, 0xFF, data_length);
+}
+
+bool storage_is_ready() {
+    return true;
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+}
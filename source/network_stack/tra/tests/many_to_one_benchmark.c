@@ -0,0 +1,278 @@
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "storage.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * This benchmark measures how the transport layer's congestion control copes with many senders sending to one sink over
+ * a single shared bus. This device has the logical address 0x01, and sends 48 byte payloads to the sink 0x02 as fast as
+ * the transport layer accepts them. The other senders, from 0x03 onwards, each keep one payload of the same size in
+ * flight to the sink, sending the next as soon as the last is acknowledged, or sending it again after 200 milliseconds.
+ *
+ * The bus is emulated as a queue shared by every device, which sends a frame of up to 23 bytes of a packet every
+ * millisecond. A packet which would have to wait more than 40 milliseconds for the bus is lost, like a packet which DLL
+ * gives up on after losing arbitration for the bus on every retry. The sink acknowledges every payload as soon as it
+ * arrives, holding up to three payloads from this device that arrive out of order, like the transport layer does. The
+ * target holds four sent payloads, so that this device's window can grow past the default table size.
+ *
+ * For each number of senders, the payloads from this device which reached the sink and the data segments it sent in 60
+ * seconds are printed, along with the payloads from the other senders which reached the sink.
+ */
+
+// The number of seconds to run each case for:
+#ifndef MANY_TO_ONE_BENCHMARK_SECONDS
+#define MANY_TO_ONE_BENCHMARK_SECONDS (60)
+#endif
+
+#define PAYLOAD_LENGTH (48)
+#define PACKET_HEADER_LENGTH (5)
+#define FRAME_DATA_LENGTH (23)
+#define FRAME_MILLISECONDS (1)
+#define MAX_BUS_WAIT_MILLISECONDS (40)
+#define SENDER_RETRY_MILLISECONDS (200)
+#define MAX_PACKETS_ON_BUS (48)
+#define SINK_ADDRESS (0x02)
+
+typedef struct {
+    bool is_used;
+    time arrival_time;
+    net_address source;
+    net_address destination;
+    uint8_t length;
+    uint8_t data[4]; // The start of the packet, which holds a whole acknowledgement or the flags and sequence number of a payload
+} emulated_packet;
+
+const uint8_t sender_counts[] = { 2, 4, 8, 12 };
+
+time current_time = TIME_ZERO;
+
+// The emulated network layer's receive callback and data buffer:
+net_receive_callback emulated_receive_callback = NULL;
+uint8_t net_data_buffer[121];
+
+// The emulated bus, and the packets on it which haven't arrived yet:
+time bus_free_time = TIME_ZERO;
+emulated_packet packets_on_bus[MAX_PACKETS_ON_BUS];
+
+// The sink's end of the connection with this device:
+uint8_t sink_stream = 0;
+uint8_t sink_next_expected = 0;
+uint8_t sink_held_payloads = 0; // Bit 'n - 1' is set if the payload 'n' after the next expected one is held
+bool is_sink_synchronised = false;
+
+// The other senders' payloads in flight, indexed by address:
+time sender_sent_times[NET_MAX_ADDRESS + 1];
+bool is_sender_waiting[NET_MAX_ADDRESS + 1];
+
+uint16_t payloads_delivered = 0;
+uint16_t segments_sent = 0;
+uint16_t other_payloads_delivered = 0;
+
+void ignore_payload(net_address source, uint8_t *payload, uint8_t length) {
+}
+
+bool send_over_bus(net_address source, net_address destination, const uint8_t *data, uint8_t length) {
+    // Wait for the packets already queued for the bus, and give up if that takes too long:
+    if (time_delta_milliseconds(bus_free_time, current_time) > 0) {
+        bus_free_time = current_time;
+    }
+    if (time_delta_milliseconds(current_time, bus_free_time) > MAX_BUS_WAIT_MILLISECONDS) {
+        return false;
+    }
+    for (uint8_t index = 0; index < MAX_PACKETS_ON_BUS; index++) {
+        emulated_packet *packet = &packets_on_bus[index];
+        if (packet->is_used == false) {
+            uint8_t frame_count = (PACKET_HEADER_LENGTH + length + FRAME_DATA_LENGTH - 1) / FRAME_DATA_LENGTH;
+            bus_free_time = time_add_milliseconds(bus_free_time, frame_count * FRAME_MILLISECONDS);
+            packet->is_used = true;
+            packet->arrival_time = bus_free_time;
+            packet->source = source;
+            packet->destination = destination;
+            packet->length = length;
+            memcpy(packet->data, data, length < sizeof(packet->data) ? length : sizeof(packet->data));
+            return true;
+        }
+    }
+    return false;
+}
+
+void receive_at_sink(const emulated_packet *packet) {
+    if (packet->source != 0x01) {
+        // Acknowledge a payload from one of the other senders:
+        uint8_t acknowledgement = 0x02;
+        other_payloads_delivered++;
+        send_over_bus(SINK_ADDRESS, packet->source, &acknowledgement, 1);
+        return;
+    }
+
+    // Take in a payload from this device the way the transport layer does, and acknowledge it:
+    uint8_t flags = packet->data[0];
+    if ((flags & 0x01) == 0) {
+        return;
+    }
+    uint8_t stream = flags >> 4;
+    uint8_t sequence_number = packet->data[1];
+    if ((flags & 0x04) && (is_sink_synchronised == false || stream != sink_stream)) {
+        sink_stream = stream;
+        sink_next_expected = sequence_number;
+        sink_held_payloads = 0;
+        is_sink_synchronised = true;
+    }
+    if (is_sink_synchronised == false || stream != sink_stream) {
+        return;
+    }
+    uint8_t offset = sequence_number - sink_next_expected;
+    if (offset == 0) {
+        payloads_delivered++;
+        sink_next_expected++;
+        while (sink_held_payloads & 1) {
+            payloads_delivered++;
+            sink_next_expected++;
+            sink_held_payloads >>= 1;
+        }
+        sink_held_payloads >>= 1;
+    } else if (offset < 4) {
+        sink_held_payloads |= 1 << (offset - 1);
+    }
+    uint8_t acknowledgement[4] = { 0x02, sink_next_expected, sink_held_payloads, (uint8_t) (sink_stream << 4) | 4 };
+    send_over_bus(SINK_ADDRESS, 0x01, acknowledgement, sizeof(acknowledgement));
+}
+
+void deliver_arrived_packets() {
+    for (uint8_t index = 0; index < MAX_PACKETS_ON_BUS; index++) {
+        emulated_packet *packet = &packets_on_bus[index];
+        if (packet->is_used == false || time_delta_milliseconds(packet->arrival_time, current_time) < 0) {
+            continue;
+        }
+        packet->is_used = false;
+        if (packet->destination == 0x01) {
+            emulated_receive_callback(packet->source, packet->data, packet->length);
+        } else if (packet->destination == SINK_ADDRESS) {
+            receive_at_sink(packet);
+        } else {
+            is_sender_waiting[packet->destination] = false;
+        }
+    }
+}
+
+void emulate_other_senders(uint8_t sender_count) {
+    uint8_t payload[PAYLOAD_LENGTH + 3] = { 0x01 };
+    for (net_address sender = 0x03; sender < 0x02 + sender_count; sender++) {
+        if (is_sender_waiting[sender] && time_delta_milliseconds(sender_sent_times[sender], current_time) < SENDER_RETRY_MILLISECONDS) {
+            continue;
+        }
+        send_over_bus(sender, SINK_ADDRESS, payload, sizeof(payload));
+        sender_sent_times[sender] = current_time;
+        is_sender_waiting[sender] = true;
+    }
+}
+
+void run_case(uint8_t sender_count) {
+    memset(packets_on_bus, 0, sizeof(packets_on_bus));
+    memset(is_sender_waiting, 0, sizeof(is_sender_waiting));
+    bus_free_time = current_time;
+    is_sink_synchronised = false;
+    payloads_delivered = 0;
+    segments_sent = 0;
+    other_payloads_delivered = 0;
+    tra_initialise();
+    tra_register_port(0x07, TRA_DELIVERY_RELIABLE, ignore_payload, NULL);
+
+    uint8_t payload[PAYLOAD_LENGTH] = { 0 };
+    for (int32_t millisecond = 0; millisecond < MANY_TO_ONE_BENCHMARK_SECONDS * (int32_t) 1000; millisecond++) {
+        current_time = time_add_milliseconds(current_time, 1);
+        deliver_arrived_packets();
+        emulate_other_senders(sender_count);
+        tra_update();
+        while (tra_send(SINK_ADDRESS, 0x07, payload, sizeof(payload), NET_TRAFFIC_CLASS_BULK) == TRA_SEND_SUCCESS) {
+        }
+    }
+
+    uart_put_string("  Senders ");
+    uart_print_hex_8(sender_count);
+    uart_put_string(": payloads delivered ");
+    uart_print_hex_16(payloads_delivered);
+    uart_put_string(", data segments sent ");
+    uart_print_hex_16(segments_sent);
+    uart_put_string(", payloads from the others ");
+    uart_print_hex_16(other_payloads_delivered);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- Many senders to one sink ---\n\r");
+    for (uint8_t index = 0; index < sizeof(sender_counts); index++) {
+        run_case(sender_counts[index]);
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+void net_set_receive_callback(net_receive_callback callback) {
+    emulated_receive_callback = callback;
+}
+
+uint8_t *net_get_data_buffer() {
+    return net_data_buffer;
+}
+
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked) {
+    // A packet lost on the bus is only noticed by the transport layer when it isn't acknowledged:
+    if (net_data_buffer[0] & 0x01) {
+        segments_sent++;
+    }
+    send_over_bus(0x01, destination, net_data_buffer, data_length);
+    return NET_SEND_SUCCESS;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* storage.h emulated implementation ***********************//
+
+// The storage is blank, and writes to it are ignored, so every run starts as the first:
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    memset(data, 0xFF, data_length);
+}
+
+bool storage_is_ready() {
+    return true;
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+}
@@ -0,0 +1,259 @@
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "storage.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * This test emulates the network layer, and checks how the transport layer splits messages into chunks and puts them
+ * back together. This device has the logical address 0x01. The target uses the same table sizes as the transport
+ * layer test, so that several chunks can be in flight at once.
+ *
+ * Messages are sent and received on the reliable port 0x05, and can't be sent on the unreliable port 0x06.
+ *
+ * Sending a 150 byte message to 0x02, the chunks should be read from the source as slots become free, and sent as three
+ * payloads of 62 (after the message's length), 64 and 24 bytes with the message flag. Payloads and other messages to
+ * 0x02 should be refused until the whole message has been read, and the send callback should only report the message as
+ * delivered once every chunk has been acknowledged.
+ *
+ * Sending a message to 0x04, which loses track of the connection and sends a reset once the first chunk has been
+ * acknowledged, the rest of the message should be dropped and reported to the send callback as given up on, rather than
+ * sent on the new stream without the message's length. A payload sent afterwards should start the new stream.
+ *
+ * Receiving a 130 byte message from 0x03 with its last chunk arriving before the one in the middle, the chunks should be
+ * passed to the message callback in order with their offsets, followed by a payload on its own which goes to the receive
+ * callback. A message which 0x03 restarts its stream partway through, and a message whose chunks run past its length,
+ * should both be abandoned.
+ */
+
+// The emulated current time in milliseconds:
+time current_time = TIME_ZERO;
+
+// The emulated network layer's receive callback and data buffer:
+net_receive_callback emulated_receive_callback = NULL;
+uint8_t net_data_buffer[121];
+
+void tra_receive(net_address source, uint8_t *payload, uint8_t length) {
+    uart_put_string("Payload received from ");
+    uart_print_hex_8(source);
+    uart_put_string(": ");
+    for (uint8_t i = 0; i < length; i++) {
+        uart_print_hex_8(payload[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+void tra_message_received(net_address source, uint16_t offset, uint16_t length, uint8_t *chunk, uint8_t chunk_length) {
+    uart_put_string("Message chunk from ");
+    uart_print_hex_8(source);
+    uart_put_string(" at ");
+    uart_print_hex_16(offset);
+    uart_put_string(" of ");
+    uart_print_hex_16(length);
+    if (chunk == NULL) {
+        uart_put_string(": abandoned\n\r");
+        return;
+    }
+    uart_put_string(": ");
+    uart_print_hex_8(chunk_length);
+    uart_put_string(" bytes, ");
+    uart_print_hex_8(chunk[0]);
+    uart_put_string("..");
+    uart_print_hex_8(chunk[chunk_length - 1]);
+    uart_put_string("\n\r");
+}
+
+void tra_message_read(net_address destination, uint16_t offset, uint8_t *chunk, uint8_t chunk_length) {
+    uart_put_string("Reading message to ");
+    uart_print_hex_8(destination);
+    uart_put_string(" at ");
+    uart_print_hex_16(offset);
+    uart_put_string(": ");
+    uart_print_hex_8(chunk_length);
+    uart_put_string(" bytes\n\r");
+    for (uint8_t i = 0; i < chunk_length; i++) {
+        chunk[i] = offset + i;
+    }
+}
+
+void tra_sent(net_address destination, bool is_delivered) {
+    uart_put_string("Payloads to ");
+    uart_print_hex_8(destination);
+    uart_put_string(is_delivered ? " delivered\n\r" : " given up on\n\r");
+}
+
+void print_status(tra_send_status status) {
+    uart_put_string("Send status: ");
+    uart_print_hex_8(status);
+    uart_put_string("\n\r");
+}
+
+void emulate_segment(net_address source, const uint8_t *segment, uint8_t length) {
+    uart_put_string("Emulating segment from ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r");
+    uint8_t copy[16];
+    for (uint8_t i = 0; i < length; i++) {
+        copy[i] = segment[i];
+    }
+    emulated_receive_callback(source, copy, length);
+}
+
+void emulate_message_chunk(net_address source, uint8_t flags, uint8_t sequence_number, uint16_t message_length, uint16_t offset, uint8_t chunk_length) {
+    uart_put_string("Emulating message chunk from ");
+    uart_print_hex_8(source);
+    uart_put_string(" at ");
+    uart_print_hex_16(offset);
+    uart_put_string("\n\r");
+    uint8_t segment[3 + TRA_MAX_PAYLOAD_LENGTH];
+    uint8_t length = 0;
+    segment[length++] = flags;
+    segment[length++] = sequence_number;
+    segment[length++] = 0x05;
+    if (offset == 0) {
+        segment[length++] = message_length & 0xFF;
+        segment[length++] = message_length >> 8;
+    }
+    for (uint8_t i = 0; i < chunk_length; i++) {
+        segment[length++] = offset + i;
+    }
+    emulated_receive_callback(source, segment, length);
+}
+
+void advance_time(int32_t milliseconds) {
+    current_time = time_add_milliseconds(current_time, milliseconds);
+    tra_update();
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+    tra_initialise();
+    tra_register_port(0x05, TRA_DELIVERY_RELIABLE, tra_receive, tra_message_received);
+    tra_register_port(0x06, TRA_DELIVERY_UNRELIABLE, tra_receive, tra_message_received);
+    tra_set_send_callback(tra_sent);
+
+    uart_put_string("\n\r--- Sending a message to 0x02 ---\n\r");
+    print_status(tra_send_message(0x02, 0x06, 150, tra_message_read, NET_TRAFFIC_CLASS_BULK));
+    print_status(tra_send_message(0x02, 0x05, 150, tra_message_read, NET_TRAFFIC_CLASS_BULK));
+    print_status(tra_send_message(0x02, 0x05, 10, tra_message_read, NET_TRAFFIC_CLASS_BULK));
+    print_status(tra_send(0x02, 0x05, (const uint8_t[]) { 0xA0 }, 1, NET_TRAFFIC_CLASS_BULK));
+    print_status(tra_send_message(0x02, 0x05, 0, tra_message_read, NET_TRAFFIC_CLASS_BULK));
+    advance_time(0);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x01, 0x00, 0x04 }, 4);
+    advance_time(10);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x02, 0x00, 0x04 }, 4);
+    advance_time(10);
+    print_status(tra_send(0x02, 0x05, (const uint8_t[]) { 0xA0 }, 1, NET_TRAFFIC_CLASS_BULK));
+    advance_time(10);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x04, 0x00, 0x04 }, 4);
+    advance_time(10);
+
+    uart_put_string("\n\r--- Sending a message to 0x04 which resets partway through ---\n\r");
+    print_status(tra_send_message(0x04, 0x05, 150, tra_message_read, NET_TRAFFIC_CLASS_BULK));
+    advance_time(0);
+    emulate_segment(0x04, (const uint8_t[]) { 0x02, 0x02, 0x00, 0x14 }, 4);
+    advance_time(10);
+    emulate_segment(0x04, (const uint8_t[]) { 0x18 }, 1);
+    advance_time(10);
+    print_status(tra_send(0x04, 0x05, (const uint8_t[]) { 0xA1 }, 1, NET_TRAFFIC_CLASS_BULK));
+    advance_time(10);
+
+    uart_put_string("\n\r--- Receiving a message from 0x03 out of order, then a payload ---\n\r");
+    emulate_message_chunk(0x03, 0x3D, 0x40, 130, 0, 62);
+    advance_time(1);
+    emulate_message_chunk(0x03, 0x39, 0x42, 130, 126, 4);
+    advance_time(1);
+    emulate_message_chunk(0x03, 0x39, 0x41, 130, 62, 64);
+    advance_time(1);
+    emulate_segment(0x03, (const uint8_t[]) { 0x31, 0x43, 0x05, 0xB0 }, 4);
+    advance_time(20);
+
+    uart_put_string("\n\r--- Receiving a message from 0x03 which it restarts partway through ---\n\r");
+    emulate_message_chunk(0x03, 0x39, 0x44, 200, 0, 62);
+    advance_time(20);
+    emulate_segment(0x03, (const uint8_t[]) { 0x45, 0x90, 0x05, 0xC0 }, 4);
+    advance_time(20);
+
+    uart_put_string("\n\r--- Receiving a message from 0x03 which runs past its length ---\n\r");
+    emulate_message_chunk(0x03, 0x49, 0x91, 70, 0, 62);
+    advance_time(1);
+    emulate_message_chunk(0x03, 0x49, 0x92, 70, 62, 20);
+    advance_time(20);
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+void net_set_receive_callback(net_receive_callback callback) {
+    emulated_receive_callback = callback;
+}
+
+uint8_t *net_get_data_buffer() {
+    return net_data_buffer;
+}
+
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked) {
+    // Only print the start of the segment, since chunks are long:
+    uart_put_string("Send segment to ");
+    uart_print_hex_8(destination);
+    uart_put_string(" at ");
+    uart_print_hex_16(current_time);
+    uart_put_string(", ");
+    uart_print_hex_8(data_length);
+    uart_put_string(" bytes: ");
+    for (uint8_t i = 0; i < data_length && i < 8; i++) {
+        uart_print_hex_8(net_data_buffer[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string(data_length > 8 ? "...\n\r" : "\n\r");
+    return NET_SEND_SUCCESS;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* storage.h emulated implementation ***********************//
+
+// The storage is blank, and writes to it are ignored, so every run starts as the first:
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    memset(data, 0xFF, data_length);
+}
+
+bool storage_is_ready() {
+    return true;
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+}
@@ -0,0 +1,257 @@
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "storage.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * This benchmark measures how the transport layer's congestion control copes with one device sending to many receivers
+ * over a single shared bus. This device has the logical address 0x01, and sends 48 byte payloads to each of the
+ * receivers, from 0x02 onwards, in turn, as fast as the transport layer accepts them.
+ *
+ * The bus is emulated as a queue shared by every device, which sends a frame of up to 23 bytes of a packet every
+ * millisecond. A packet which would have to wait more than 40 milliseconds for the bus is lost, like a packet which DLL
+ * gives up on after losing arbitration for the bus on every retry. Each receiver acknowledges every payload as soon as
+ * it arrives, holding up to three payloads that arrive out of order, like the transport layer does.
+ *
+ * For each number of receivers, the payloads which reached them and the data segments sent in 60 seconds are printed.
+ * The target allows a connection to every receiver, and holds four sent payloads rather than the default two.
+ */
+
+// The number of seconds to run each case for:
+#ifndef ONE_TO_MANY_BENCHMARK_SECONDS
+#define ONE_TO_MANY_BENCHMARK_SECONDS (60)
+#endif
+
+#define PAYLOAD_LENGTH (48)
+#define PACKET_HEADER_LENGTH (5)
+#define FRAME_DATA_LENGTH (23)
+#define FRAME_MILLISECONDS (1)
+#define MAX_BUS_WAIT_MILLISECONDS (40)
+#define MAX_PACKETS_ON_BUS (48)
+
+typedef struct {
+    bool is_used;
+    time arrival_time;
+    net_address source;
+    net_address destination;
+    uint8_t length;
+    uint8_t data[4]; // The start of the packet, which holds a whole acknowledgement or the flags and sequence number of a payload
+} emulated_packet;
+
+// A receiver's end of its connection with this device:
+typedef struct {
+    uint8_t stream;
+    uint8_t next_expected;
+    uint8_t held_payloads; // Bit 'n - 1' is set if the payload 'n' after the next expected one is held
+    bool is_synchronised;
+} emulated_receiver;
+
+const uint8_t receiver_counts[] = { 2, 4, 8, 12 };
+
+time current_time = TIME_ZERO;
+
+// The emulated network layer's receive callback and data buffer:
+net_receive_callback emulated_receive_callback = NULL;
+uint8_t net_data_buffer[121];
+
+// The emulated bus, and the packets on it which haven't arrived yet:
+time bus_free_time = TIME_ZERO;
+emulated_packet packets_on_bus[MAX_PACKETS_ON_BUS];
+
+// The receivers, indexed by address:
+emulated_receiver receivers[NET_MAX_ADDRESS + 1];
+
+uint16_t payloads_delivered = 0;
+uint16_t segments_sent = 0;
+
+void ignore_payload(net_address source, uint8_t *payload, uint8_t length) {
+}
+
+bool send_over_bus(net_address source, net_address destination, const uint8_t *data, uint8_t length) {
+    // Wait for the packets already queued for the bus, and give up if that takes too long:
+    if (time_delta_milliseconds(bus_free_time, current_time) > 0) {
+        bus_free_time = current_time;
+    }
+    if (time_delta_milliseconds(current_time, bus_free_time) > MAX_BUS_WAIT_MILLISECONDS) {
+        return false;
+    }
+    for (uint8_t index = 0; index < MAX_PACKETS_ON_BUS; index++) {
+        emulated_packet *packet = &packets_on_bus[index];
+        if (packet->is_used == false) {
+            uint8_t frame_count = (PACKET_HEADER_LENGTH + length + FRAME_DATA_LENGTH - 1) / FRAME_DATA_LENGTH;
+            bus_free_time = time_add_milliseconds(bus_free_time, frame_count * FRAME_MILLISECONDS);
+            packet->is_used = true;
+            packet->arrival_time = bus_free_time;
+            packet->source = source;
+            packet->destination = destination;
+            packet->length = length;
+            memcpy(packet->data, data, length < sizeof(packet->data) ? length : sizeof(packet->data));
+            return true;
+        }
+    }
+    return false;
+}
+
+void receive_at_receiver(const emulated_packet *packet) {
+    // Take in a payload from this device the way the transport layer does, and acknowledge it:
+    emulated_receiver *receiver = &receivers[packet->destination];
+    uint8_t flags = packet->data[0];
+    if ((flags & 0x01) == 0) {
+        return;
+    }
+    uint8_t stream = flags >> 4;
+    uint8_t sequence_number = packet->data[1];
+    if ((flags & 0x04) && (receiver->is_synchronised == false || stream != receiver->stream)) {
+        receiver->stream = stream;
+        receiver->next_expected = sequence_number;
+        receiver->held_payloads = 0;
+        receiver->is_synchronised = true;
+    }
+    if (receiver->is_synchronised == false || stream != receiver->stream) {
+        return;
+    }
+    uint8_t offset = sequence_number - receiver->next_expected;
+    if (offset == 0) {
+        payloads_delivered++;
+        receiver->next_expected++;
+        while (receiver->held_payloads & 1) {
+            payloads_delivered++;
+            receiver->next_expected++;
+            receiver->held_payloads >>= 1;
+        }
+        receiver->held_payloads >>= 1;
+    } else if (offset < 4) {
+        receiver->held_payloads |= 1 << (offset - 1);
+    }
+    uint8_t acknowledgement[4] = { 0x02, receiver->next_expected, receiver->held_payloads, (uint8_t) (receiver->stream << 4) | 4 };
+    send_over_bus(packet->destination, 0x01, acknowledgement, sizeof(acknowledgement));
+}
+
+void deliver_arrived_packets() {
+    for (uint8_t index = 0; index < MAX_PACKETS_ON_BUS; index++) {
+        emulated_packet *packet = &packets_on_bus[index];
+        if (packet->is_used == false || time_delta_milliseconds(packet->arrival_time, current_time) < 0) {
+            continue;
+        }
+        packet->is_used = false;
+        if (packet->destination == 0x01) {
+            emulated_receive_callback(packet->source, packet->data, packet->length);
+        } else {
+            receive_at_receiver(packet);
+        }
+    }
+}
+
+void run_case(uint8_t receiver_count) {
+    memset(packets_on_bus, 0, sizeof(packets_on_bus));
+    memset(receivers, 0, sizeof(receivers));
+    bus_free_time = current_time;
+    payloads_delivered = 0;
+    segments_sent = 0;
+    tra_initialise();
+    tra_register_port(0x07, TRA_DELIVERY_RELIABLE, ignore_payload, NULL);
+
+    // Offer a payload to each receiver in turn, until none of them has space for one:
+    uint8_t payload[PAYLOAD_LENGTH] = { 0 };
+    net_address next_receiver = 0x02;
+    for (int32_t millisecond = 0; millisecond < ONE_TO_MANY_BENCHMARK_SECONDS * (int32_t) 1000; millisecond++) {
+        current_time = time_add_milliseconds(current_time, 1);
+        deliver_arrived_packets();
+        tra_update();
+        uint8_t busy_count = 0;
+        while (busy_count < receiver_count) {
+            if (tra_send(next_receiver, 0x07, payload, sizeof(payload), NET_TRAFFIC_CLASS_BULK) == TRA_SEND_SUCCESS) {
+                busy_count = 0;
+            } else {
+                busy_count++;
+            }
+            next_receiver = (next_receiver == 0x01 + receiver_count) ? 0x02 : next_receiver + 1;
+        }
+    }
+
+    uart_put_string("  Receivers ");
+    uart_print_hex_8(receiver_count);
+    uart_put_string(": payloads delivered ");
+    uart_print_hex_16(payloads_delivered);
+    uart_put_string(", data segments sent ");
+    uart_print_hex_16(segments_sent);
+    uart_put_string("\n\r");
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+
+    uart_put_string("\n\r--- One sender to many receivers ---\n\r");
+    for (uint8_t index = 0; index < sizeof(receiver_counts); index++) {
+        run_case(receiver_counts[index]);
+    }
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+void net_set_receive_callback(net_receive_callback callback) {
+    emulated_receive_callback = callback;
+}
+
+uint8_t *net_get_data_buffer() {
+    return net_data_buffer;
+}
+
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked) {
+    // A packet lost on the bus is only noticed by the transport layer when it isn't acknowledged:
+    if (net_data_buffer[0] & 0x01) {
+        segments_sent++;
+    }
+    send_over_bus(0x01, destination, net_data_buffer, data_length);
+    return NET_SEND_SUCCESS;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* storage.h emulated implementation ***********************//
+
+// The storage is blank, and writes to it are ignored, so every run starts as the first:
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    memset(data, 0xFF, data_length);
+}
+
+bool storage_is_ready() {
+    return true;
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+}
@@ -0,0 +1,294 @@
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "storage.h"
+#include "time.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * This test emulates the network layer, and checks the segments that the transport layer sends to it. This device has
+ * the logical address 0x01. The target holds four connections, four sent payloads and three payloads which arrived out
+ * of order, rather than the smaller default tables, so that a full window of four payloads can be checked.
+ *
+ * Sending to 0x02, the first payload should be sent on its own with the synchronise flag, and the rest only once 0x02
+ * acknowledges it and advertises its window. The congestion window should start at one payload and grow by one with
+ * each acknowledged payload, up to 0x02's window. When 0x02 reports holding three later payloads but not the first, the
+ * first should be retransmitted straight away and the congestion window halved. A payload which is never acknowledged
+ * should be retransmitted with the timeout doubling each time, until 0x02 is given up on.
+ *
+ * Receiving from 0x03, a payload without the synchronise flag should be answered with a reset. Payloads should then be
+ * delivered in order and exactly once, with out of order ones held and selectively acknowledged, and the
+ * acknowledgement of a single payload in order held back for a short time. A payload from 0x03 after it restarts (with
+ * a new stream) should be delivered, but a late payload from before the restart shouldn't be.
+ *
+ * Sending to 0x04, which still holds an older connection with this device that happens to use the same stream, a new
+ * stream should be started as soon as 0x04 acknowledges the wrong payload. Acknowledgements of the old stream should
+ * then be ignored, and another new stream should be started when 0x04 sends a reset.
+ *
+ * Sending to 0x06, which then starts a new stream of its own as if it had restarted, the next payload should start a
+ * new stream too, rather than waiting for 0x06 to send a reset.
+ *
+ * Payloads are sent and received on the reliable port 0x07, and the unreliable port 0x08. A port can't be registered
+ * twice, and nothing can be sent on a port that isn't registered. With 0x05, a payload on the unreliable port should be
+ * sent straight away as a datagram, and a received datagram passed to that port's callback. A datagram on the reliable
+ * port should be dropped, and a reliable payload on a port that isn't registered should be acknowledged but dropped.
+ *
+ * Finally the device restarts, with its clock starting from zero again. The first payload sent to 0x02 should then start
+ * a different stream from a different sequence number than the first payload sent to it before the restart, as they're
+ * taken from the number of starts kept in storage rather than from the clock.
+ */
+
+// The emulated current time in milliseconds:
+time current_time = TIME_ZERO;
+
+// The emulated storage, which keeps its contents when the device restarts:
+uint8_t storage[STORAGE_SIZE];
+
+// The emulated network layer's receive callback and data buffer:
+net_receive_callback emulated_receive_callback = NULL;
+uint8_t net_data_buffer[121];
+
+void tra_receive(net_address source, uint8_t *payload, uint8_t length) {
+    uart_put_string("Payload received from ");
+    uart_print_hex_8(source);
+    uart_put_string(": ");
+    for (uint8_t i = 0; i < length; i++) {
+        uart_print_hex_8(payload[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+void tra_datagram_received(net_address source, uint8_t *payload, uint8_t length) {
+    uart_put_string("Datagram received from ");
+    uart_print_hex_8(source);
+    uart_put_string(": ");
+    for (uint8_t i = 0; i < length; i++) {
+        uart_print_hex_8(payload[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+}
+
+void tra_sent(net_address destination, bool is_delivered) {
+    uart_put_string("Payloads to ");
+    uart_print_hex_8(destination);
+    uart_put_string(is_delivered ? " delivered\n\r" : " given up on\n\r");
+}
+
+void send_payload(net_address destination, uint8_t value) {
+    uint8_t payload[2] = { 0xA0, value };
+    uart_put_string("Send status: ");
+    uart_print_hex_8(tra_send(destination, 0x07, payload, sizeof(payload), NET_TRAFFIC_CLASS_BULK));
+    uart_put_string("\n\r");
+}
+
+void emulate_segment(net_address source, const uint8_t *segment, uint8_t length) {
+    uart_put_string("Emulating segment from ");
+    uart_print_hex_8(source);
+    uart_put_string("\n\r");
+    uint8_t copy[16];
+    for (uint8_t i = 0; i < length; i++) {
+        copy[i] = segment[i];
+    }
+    emulated_receive_callback(source, copy, length);
+}
+
+void advance_time(int32_t milliseconds) {
+    current_time = time_add_milliseconds(current_time, milliseconds);
+    tra_update();
+}
+
+int main() {
+    uart_initialise();
+    uart_put_string("\n\r============================================================\n\r");
+    memset(storage, 0xFF, sizeof(storage));
+    tra_initialise();
+    tra_register_port(0x07, TRA_DELIVERY_RELIABLE, tra_receive, NULL);
+    tra_register_port(0x08, TRA_DELIVERY_UNRELIABLE, tra_datagram_received, NULL);
+    tra_set_send_callback(tra_sent);
+
+    uart_put_string("\n\r--- Synchronising with 0x02 ---\n\r");
+    send_payload(0x02, 0x00);
+    send_payload(0x02, 0x01);
+    send_payload(0x02, 0x02);
+    advance_time(0);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x01, 0x00, 0x04 }, 4);
+    advance_time(10);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x03, 0x00, 0x04 }, 4);
+    advance_time(10);
+
+    uart_put_string("\n\r--- Filling the window, and exceeding it ---\n\r");
+    send_payload(0x02, 0x03);
+    send_payload(0x02, 0x04);
+    send_payload(0x02, 0x05);
+    send_payload(0x02, 0x06);
+    send_payload(0x02, 0x07);
+    advance_time(10);
+    uart_put_string("Unacknowledged count: ");
+    uart_print_hex_8(tra_get_unacknowledged_count(0x02));
+    uart_put_string("\n\r");
+
+    uart_put_string("\n\r--- Selective acknowledgement of 0x04, 0x05 and 0x06 (0x03 lost) ---\n\r");
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x03, 0x07, 0x01 }, 4);
+    advance_time(10);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x07, 0x00, 0x04 }, 4);
+    advance_time(10);
+
+    uart_put_string("\n\r--- Congestion window of two payloads after the loss ---\n\r");
+    send_payload(0x02, 0x07);
+    send_payload(0x02, 0x08);
+    send_payload(0x02, 0x09);
+    advance_time(10);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x09, 0x00, 0x04 }, 4);
+    advance_time(10);
+    emulate_segment(0x02, (const uint8_t[]) { 0x02, 0x0A, 0x00, 0x04 }, 4);
+    advance_time(10);
+
+    uart_put_string("\n\r--- Retransmission timeouts ---\n\r");
+    send_payload(0x02, 0x0A);
+    advance_time(10);
+    for (uint16_t step = 0; step < 400; step++) {
+        advance_time(100);
+    }
+
+    uart_put_string("\n\r--- Receiving from 0x03 without synchronising ---\n\r");
+    emulate_segment(0x03, (const uint8_t[]) { 0x31, 0x3F, 0x07, 0xB0 }, 4);
+    advance_time(10);
+
+    uart_put_string("\n\r--- Receiving from 0x03 in order, out of order and repeated ---\n\r");
+    emulate_segment(0x03, (const uint8_t[]) { 0x35, 0x40, 0x07, 0xB0 }, 4);
+    advance_time(10);
+    advance_time(10);
+    emulate_segment(0x03, (const uint8_t[]) { 0x31, 0x42, 0x07, 0xB2 }, 4);
+    advance_time(1);
+    emulate_segment(0x03, (const uint8_t[]) { 0x31, 0x41, 0x07, 0xB1 }, 4);
+    advance_time(1);
+    advance_time(20);
+    emulate_segment(0x03, (const uint8_t[]) { 0x35, 0x40, 0x07, 0xB0 }, 4);
+    emulate_segment(0x03, (const uint8_t[]) { 0x31, 0x41, 0x07, 0xB1 }, 4);
+    advance_time(1);
+
+    uart_put_string("\n\r--- Receiving from 0x03 after it restarts, then a late payload from before the restart ---\n\r");
+    emulate_segment(0x03, (const uint8_t[]) { 0x45, 0x90, 0x07, 0xC0 }, 4);
+    advance_time(20);
+    emulate_segment(0x03, (const uint8_t[]) { 0x31, 0x91, 0x07, 0xB3 }, 4);
+    advance_time(1);
+
+    uart_put_string("\n\r--- Sending to 0x04, which holds an older connection with the same stream ---\n\r");
+    current_time = 0x1234;
+    send_payload(0x04, 0x10);
+    send_payload(0x04, 0x11);
+    advance_time(1);
+    emulate_segment(0x04, (const uint8_t[]) { 0x02, 0x77, 0x00, 0x24 }, 4);
+    advance_time(1);
+    emulate_segment(0x04, (const uint8_t[]) { 0x02, 0x03, 0x00, 0x24 }, 4);
+    emulate_segment(0x04, (const uint8_t[]) { 0x02, 0x03, 0x00, 0x34 }, 4);
+    advance_time(1);
+    emulate_segment(0x04, (const uint8_t[]) { 0x38 }, 1);
+    advance_time(1);
+    emulate_segment(0x04, (const uint8_t[]) { 0x02, 0x04, 0x00, 0x44 }, 4);
+    advance_time(1);
+
+    uart_put_string("\n\r--- Ports ---\n\r");
+    uart_put_string("Registered again: ");
+    uart_print_hex_8(tra_register_port(0x07, TRA_DELIVERY_UNRELIABLE, tra_datagram_received, NULL));
+    uart_put_string("\n\rSend status on 0x09: ");
+    uart_print_hex_8(tra_send(0x05, 0x09, (const uint8_t[]) { 0xD0 }, 1, NET_TRAFFIC_CLASS_BULK));
+    uart_put_string("\n\r");
+    tra_send_status status = tra_send(0x05, 0x08, (const uint8_t[]) { 0xD0 }, 1, NET_TRAFFIC_CLASS_BULK);
+    uart_put_string("Send status on 0x08: ");
+    uart_print_hex_8(status);
+    uart_put_string("\n\r");
+    emulate_segment(0x05, (const uint8_t[]) { 0x00, 0x08, 0xD1 }, 3);
+    emulate_segment(0x05, (const uint8_t[]) { 0x00, 0x07, 0xD2 }, 3);
+    emulate_segment(0x05, (const uint8_t[]) { 0x15, 0x20, 0x09, 0xD3 }, 4);
+    advance_time(20);
+
+    uart_put_string("\n\r--- Sending to 0x06, which restarts with a new stream in between ---\n\r");
+    send_payload(0x06, 0x08);
+    advance_time(0);
+    emulate_segment(0x06, (const uint8_t[]) { 0x67, 0x40, 0x07, 0x05, 0x00, 0x44, 0xE0 }, 7);
+    advance_time(20);
+    emulate_segment(0x06, (const uint8_t[]) { 0x75, 0x10, 0x07, 0xE1 }, 4);
+    advance_time(20);
+    send_payload(0x06, 0x09);
+    advance_time(0);
+
+    uart_put_string("\n\r--- Sending to 0x02 after restarting ---\n\r");
+    current_time = TIME_ZERO;
+    tra_initialise();
+    tra_register_port(0x07, TRA_DELIVERY_RELIABLE, tra_receive, NULL);
+    send_payload(0x02, 0x00);
+    advance_time(0);
+
+    uart_put_string("\n\rFinished.\n\r");
+}
+
+//*************************** net.h emulated implementation *************************//
+
+net_address net_get_own_address() {
+    // Use 0x01 as our own address:
+    return 0x01;
+}
+
+void net_set_receive_callback(net_receive_callback callback) {
+    emulated_receive_callback = callback;
+}
+
+uint8_t *net_get_data_buffer() {
+    return net_data_buffer;
+}
+
+net_send_status net_send_data_packet(net_address destination, uint8_t data_length, net_traffic_class traffic_class, bool is_payload_checked) {
+    uart_put_string("Send segment to ");
+    uart_print_hex_8(destination);
+    uart_put_string(" at ");
+    uart_print_hex_16(current_time);
+    uart_put_string(": ");
+    for (uint8_t i = 0; i < data_length; i++) {
+        uart_print_hex_8(net_data_buffer[i]);
+        uart_put_byte(' ');
+    }
+    uart_put_string("\n\r");
+    return NET_SEND_SUCCESS;
+}
+
+//************************** time.h emulated implementation *************************//
+
+time time_now() {
+    return current_time;
+}
+
+int32_t time_delta_milliseconds(time start, time end) {
+    return end - start;
+}
+
+int32_t time_delta_seconds(time start, time end) {
+    return (end - start) / 1000;
+}
+
+time time_add_milliseconds(time t, int32_t milliseconds) {
+    return t + milliseconds;
+}
+
+time time_add_seconds(time t, int32_t seconds) {
+    return t + seconds * 1000;
+}
+
+//************************* storage.h emulated implementation ***********************//
+
+void storage_read(uint16_t address, void *data, uint16_t data_length) {
+    memcpy(data, &storage[address], data_length);
+}
+
+bool storage_is_ready() {
+    return true;
+}
+
+void storage_write_byte(uint16_t address, uint8_t value) {
+    storage[address] = value;
+}
@@ -0,0 +1,628 @@
+#include "network_stack/tra.h"
+#include "network_stack/net.h"
+#include "connections.h"
+#include "ports.h"
+#include "time.h"
+#include <stddef.h>
+#ifdef TRA_BUS_PACING
+#include "network_stack/phy.h"
+#include <stdlib.h>
+#endif
+#include <string.h>
+
+// Flags in the low 4 bits of the first byte of every segment, which say which fields follow it:
+#define SEGMENT_FLAG_DATA 0x01 // The segment carries a payload, preceded by its sequence number
+#define SEGMENT_FLAG_ACKNOWLEDGEMENT 0x02 // The segment carries an acknowledgement of the payloads received from the peer
+#define SEGMENT_FLAG_SYNCHRONISE 0x04 // The payload is the first of a new stream
+#define SEGMENT_FLAG_RESET 0x08 // Without data: the receiver doesn't know the sender's stream, so it must start a new one
+#define SEGMENT_FLAG_MESSAGE 0x08 // With data: the payload is a chunk of a message
+#define SEGMENT_FLAGS_MASK 0x0F
+
+// The high 4 bits of the first byte hold a stream: the payload's stream in a data segment, or the stream of the payload
+// that couldn't be delivered in a reset. The high 4 bits of the window field hold the stream being acknowledged.
+// Streams keep payloads and acknowledgements from before a restart from being mistaken for ones after it:
+#define SEGMENT_STREAM_SHIFT 4
+#define SEGMENT_WINDOW_MASK 0x0F
+
+// Segment header field sizes. A segment with every field is laid out as:
+// [FLAGS] [SEQUENCE NUMBER] [PORT] [NEXT EXPECTED] [SELECTIVE ACKNOWLEDGEMENTS] [WINDOW] [PAYLOAD...]
+#define SEGMENT_FLAGS_SIZE (1)
+#define SEGMENT_DATA_FIELDS_SIZE (2)
+#define SEGMENT_ACKNOWLEDGEMENT_FIELDS_SIZE (3)
+
+// A segment without any flags is a datagram on an unreliable port, which doesn't belong to any connection:
+// [FLAGS] [PORT] [PAYLOAD...]
+#define DATAGRAM_HEADER_SIZE (2)
+
+// A message is sent as a series of payloads with the message flag, the first of which starts with the message's length,
+// so that the receiver knows which chunk is the last one:
+// [LENGTH_L] [LENGTH_H] [CHUNK...]
+#define MESSAGE_HEADER_SIZE (2)
+
+// The number of payloads received out of order after a missing one before the missing one is retransmitted, without
+// waiting for its retransmission timeout:
+#define FAST_RETRANSMIT_THRESHOLD (2)
+
+// How long an acknowledgement of a payload received in order can be held back for, in the hope of sending it with a
+// payload or acknowledging the next payload with it:
+#define ACKNOWLEDGEMENT_DELAY_MILLISECONDS (20)
+
+static tra_send_callback send_callback = NULL;
+
+static void handle_received_packet(net_address source, uint8_t *payload, uint8_t length);
+static void handle_datagram(net_address source, uint8_t *payload, uint8_t length);
+static void handle_acknowledgement(uint8_t connection_index, uint8_t next_expected, uint8_t selective_acknowledgements, uint8_t window, uint8_t stream);
+static void handle_data(uint8_t connection_index, uint8_t sequence_number, tra_port port, const uint8_t *payload, uint8_t length, bool is_message_chunk);
+static void deliver_payload(uint8_t connection_index, tra_port port, uint8_t *payload, uint8_t length, bool is_message_chunk);
+static void abandon_received_message(uint8_t connection_index);
+static void restart_send_stream(uint8_t connection_index);
+static tra_send_slot *queue_payload(uint8_t connection_index, tra_port port, net_traffic_class traffic_class);
+static tra_send_status send_datagram(net_address destination, tra_port port, const uint8_t *data, uint8_t length, net_traffic_class traffic_class);
+static void queue_message_chunks(uint8_t connection_index);
+static void update_connection(uint8_t connection_index, time now);
+static void send_segment(uint8_t connection_index, tra_send_slot *slot, uint8_t flags);
+static uint8_t write_acknowledgement_fields(uint8_t connection_index, uint8_t *segment);
+
+void tra_initialise() {
+    tra_initialise_connections();
+    tra_initialise_ports();
+    net_set_receive_callback(handle_received_packet);
+}
+
+void tra_update() {
+    time now = time_now();
+    for (uint8_t connection_index = 0; connection_index < TRA_MAX_CONNECTIONS; connection_index++) {
+        if (tra_get_connection(connection_index)->is_used) {
+            update_connection(connection_index, now);
+        }
+    }
+}
+
+bool tra_register_port(tra_port port, tra_delivery delivery, tra_receive_callback receive_callback, tra_message_callback message_callback) {
+    return tra_add_port(port, delivery, receive_callback, message_callback);
+}
+
+void tra_set_send_callback(tra_send_callback callback) {
+    send_callback = callback;
+}
+
+tra_send_status tra_send(net_address destination, tra_port port, const uint8_t *data, uint8_t length, net_traffic_class traffic_class) {
+    const tra_port_entry *entry = tra_find_port(port);
+    if (destination > NET_MAX_ADDRESS || destination == net_get_own_address() || entry == NULL || length == 0 || length > TRA_MAX_PAYLOAD_LENGTH || traffic_class > NET_TRAFFIC_CLASS_INTERACTIVE) {
+        return TRA_SEND_INVALID;
+    }
+    if (entry->delivery == TRA_DELIVERY_UNRELIABLE) {
+        return send_datagram(destination, port, data, length, traffic_class);
+    }
+
+    uint8_t connection_index = tra_open_connection(destination);
+    if (connection_index == TRA_MAX_CONNECTIONS) {
+        return TRA_SEND_NO_CONNECTION;
+    }
+    if (tra_get_connection(connection_index)->message_source != NULL) {
+        return TRA_SEND_BUSY;
+    }
+    tra_send_slot *slot = queue_payload(connection_index, port, traffic_class);
+    if (slot == NULL) {
+        return TRA_SEND_BUSY;
+    }
+
+    // Copy the payload into the slot. It's sent at the next update, once it's inside the peer's window:
+    memcpy(slot->payload, data, length);
+    slot->length = length;
+    return TRA_SEND_SUCCESS;
+}
+
+tra_send_status tra_send_message(net_address destination, tra_port port, uint16_t length, tra_message_source source, net_traffic_class traffic_class) {
+    const tra_port_entry *entry = tra_find_port(port);
+    if (destination > NET_MAX_ADDRESS || destination == net_get_own_address() || entry == NULL || entry->delivery != TRA_DELIVERY_RELIABLE || length == 0 || source == NULL
+        || traffic_class > NET_TRAFFIC_CLASS_INTERACTIVE) {
+        return TRA_SEND_INVALID;
+    }
+
+    uint8_t connection_index = tra_open_connection(destination);
+    if (connection_index == TRA_MAX_CONNECTIONS) {
+        return TRA_SEND_NO_CONNECTION;
+    }
+    tra_connection *connection = tra_get_connection(connection_index);
+    if (connection->message_source != NULL) {
+        return TRA_SEND_BUSY;
+    }
+
+    // The chunks are read and queued at each update, as slots become free:
+    connection->message_source = source;
+    connection->message_length = length;
+    connection->message_offset = 0;
+    connection->message_traffic_class = traffic_class;
+    connection->message_port = port;
+    return TRA_SEND_SUCCESS;
+}
+
+uint8_t tra_get_unacknowledged_count(net_address destination) {
+    uint8_t connection_index = tra_find_connection(destination);
+    if (connection_index == TRA_MAX_CONNECTIONS) {
+        return 0;
+    }
+    tra_connection *connection = tra_get_connection(connection_index);
+    return connection->send_next - connection->send_base;
+}
+
+static void handle_received_packet(net_address source, uint8_t *payload, uint8_t length) {
+    if (length < SEGMENT_FLAGS_SIZE) {
+        return;
+    }
+    uint8_t flags = payload[0] & SEGMENT_FLAGS_MASK;
+    uint8_t stream = payload[0] >> SEGMENT_STREAM_SHIFT;
+    if (flags == 0) {
+        handle_datagram(source, payload, length);
+        return;
+    }
+    uint8_t header_size = SEGMENT_FLAGS_SIZE;
+    if (flags & SEGMENT_FLAG_DATA) {
+        header_size += SEGMENT_DATA_FIELDS_SIZE;
+    }
+    if (flags & SEGMENT_FLAG_ACKNOWLEDGEMENT) {
+        header_size += SEGMENT_ACKNOWLEDGEMENT_FIELDS_SIZE;
+    }
+    if (length < header_size || length - header_size > TRA_MAX_PAYLOAD_LENGTH) {
+        return;
+    }
+
+    // Open a new connection for a payload from an unknown peer. If the payload doesn't start a new stream, it belongs to
+    // a connection that has been closed on this side, and it's answered with a reset. Anything else from an unknown peer
+    // is ignored:
+    uint8_t connection_index = tra_find_connection(source);
+    if (connection_index == TRA_MAX_CONNECTIONS && (flags & SEGMENT_FLAG_DATA)) {
+        connection_index = tra_open_connection(source);
+    }
+    if (connection_index == TRA_MAX_CONNECTIONS) {
+        return;
+    }
+    tra_connection *connection = tra_get_connection(connection_index);
+    connection->last_activity_time = time_now();
+
+    // If the peer doesn't know this side's stream, start a new one:
+    if ((flags & SEGMENT_FLAG_RESET) && (flags & SEGMENT_FLAG_DATA) == 0 && stream == connection->send_stream) {
+        restart_send_stream(connection_index);
+    }
+
+    uint8_t field_offset = SEGMENT_FLAGS_SIZE;
+    uint8_t sequence_number = 0;
+    tra_port port = 0;
+    if (flags & SEGMENT_FLAG_DATA) {
+        sequence_number = payload[field_offset];
+        port = payload[field_offset + 1];
+        field_offset += SEGMENT_DATA_FIELDS_SIZE;
+    }
+    if (flags & SEGMENT_FLAG_ACKNOWLEDGEMENT) {
+        uint8_t window = payload[field_offset + 2];
+        handle_acknowledgement(connection_index, payload[field_offset], payload[field_offset + 1], window & SEGMENT_WINDOW_MASK, window >> SEGMENT_STREAM_SHIFT);
+        field_offset += SEGMENT_ACKNOWLEDGEMENT_FIELDS_SIZE;
+    }
+    if (flags & SEGMENT_FLAG_DATA) {
+        // The first payload of a new stream synchronises with it (a repeat of it belongs to the current stream):
+        if ((flags & SEGMENT_FLAG_SYNCHRONISE) && (connection->is_receive_synchronised == false || stream != connection->receive_stream)) {
+            // A peer which starts a new stream has usually opened a new connection, and forgotten this side's stream.
+            // With nothing in flight, this side starts a new stream too, so that the next payload (e.g. the response
+            // to a request) synchronises straight away instead of being answered with a reset:
+            if (connection->is_receive_synchronised && connection->send_base == connection->send_next && connection->message_source == NULL) {
+                restart_send_stream(connection_index);
+            }
+            tra_drop_receive_slots(connection_index);
+            abandon_received_message(connection_index);
+            connection->receive_stream = stream;
+            connection->receive_next = sequence_number;
+            connection->is_receive_synchronised = true;
+        }
+        if (connection->is_receive_synchronised && stream == connection->receive_stream) {
+            handle_data(connection_index, sequence_number, port, &payload[field_offset], length - field_offset, flags & SEGMENT_FLAG_MESSAGE);
+        } else {
+            connection->is_reset_pending = true;
+            connection->reset_stream = stream;
+        }
+    }
+}
+
+static void handle_datagram(net_address source, uint8_t *payload, uint8_t length) {
+    if (length < DATAGRAM_HEADER_SIZE || length - DATAGRAM_HEADER_SIZE > TRA_MAX_PAYLOAD_LENGTH) {
+        return;
+    }
+
+    // Pass the payload straight on from the received packet:
+    const tra_port_entry *entry = tra_find_port(payload[1]);
+    if (entry != NULL && entry->delivery == TRA_DELIVERY_UNRELIABLE && entry->receive_callback != NULL) {
+        entry->receive_callback(source, &payload[DATAGRAM_HEADER_SIZE], length - DATAGRAM_HEADER_SIZE);
+    }
+}
+
+static void handle_acknowledgement(uint8_t connection_index, uint8_t next_expected, uint8_t selective_acknowledgements, uint8_t window, uint8_t stream) {
+    tra_connection *connection = tra_get_connection(connection_index);
+    uint8_t acknowledged_count = next_expected - connection->send_base;
+    uint8_t unacknowledged_count = connection->send_next - connection->send_base;
+
+    // Ignore acknowledgements of older streams:
+    if (stream != connection->send_stream) {
+        return;
+    }
+
+    // While synchronising, the peer is only ever sent the first payload, so an acknowledgement of anything other than
+    // that payload comes from an older connection that the peer still holds, which happened to use the same stream.
+    // Starting a new stream makes the peer drop the older connection:
+    if (connection->is_send_synchronised == false) {
+        if (unacknowledged_count == 0 || tra_find_send_slot(connection_index, connection->send_base)->transmission_count == 0) {
+            return;
+        }
+        if (acknowledged_count != 1) {
+            restart_send_stream(connection_index);
+            return;
+        }
+        connection->is_send_synchronised = true;
+    }
+
+    // Ignore acknowledgements of payloads that haven't been sent:
+    if (acknowledged_count > unacknowledged_count) {
+        return;
+    }
+    connection->peer_window = (window < 1) ? 1 : window;
+
+    // Free the slots of the acknowledged payloads, measuring the round trip time from the newest one as long as it was
+    // only sent once (otherwise it's not known which transmission is being acknowledged):
+    if (acknowledged_count > 0) {
+        tra_send_slot *newest_slot = tra_find_send_slot(connection_index, next_expected - 1);
+        int32_t round_trip_time = 0;
+        if (newest_slot->transmission_count == 1) {
+            round_trip_time = time_delta_milliseconds(newest_slot->sent_time, time_now());
+            tra_add_round_trip_time(connection_index, round_trip_time);
+        } else {
+            tra_reset_retransmission_timeout(connection_index);
+        }
+        for (uint8_t sequence_number = connection->send_base; sequence_number != next_expected; sequence_number++) {
+            tra_find_send_slot(connection_index, sequence_number)->is_used = false;
+        }
+        connection->send_base = next_expected;
+        connection->timeout_count = 0;
+        tra_grow_congestion_window(connection_index, acknowledged_count, round_trip_time);
+        if (connection->send_base == connection->send_next && connection->message_source == NULL && send_callback != NULL) {
+            send_callback(connection->peer, true);
+        }
+    }
+
+    // Mark the payloads that the peer holds out of order, and count how many of them have overtaken each missing payload.
+    // A missing payload which has been overtaken enough times was probably lost, so it's retransmitted straight away:
+    uint8_t overtaking_count = 0;
+    for (uint8_t offset = TRA_MAX_WINDOW - 1; offset >= 1; offset--) {
+        tra_send_slot *slot = tra_find_send_slot(connection_index, connection->send_base + offset);
+        if (slot == NULL || slot->transmission_count == 0) {
+            continue;
+        }
+        if (selective_acknowledgements & (1 << (offset - 1))) {
+            slot->is_selectively_acknowledged = true;
+            overtaking_count++;
+        }
+    }
+    for (uint8_t offset = 0; offset < TRA_MAX_WINDOW; offset++) {
+        tra_send_slot *slot = tra_find_send_slot(connection_index, connection->send_base + offset);
+        if (slot == NULL || slot->transmission_count == 0) {
+            break;
+        }
+        if (slot->is_selectively_acknowledged) {
+            overtaking_count--;
+        } else if (overtaking_count >= FAST_RETRANSMIT_THRESHOLD && slot->is_fast_retransmitted == false) {
+            slot->is_fast_retransmitted = true;
+            slot->is_retransmission_due = true;
+            tra_shrink_congestion_window(connection_index, false);
+        }
+    }
+}
+
+static void handle_data(uint8_t connection_index, uint8_t sequence_number, tra_port port, const uint8_t *payload, uint8_t length, bool is_message_chunk) {
+    tra_connection *connection = tra_get_connection(connection_index);
+    uint8_t offset = sequence_number - connection->receive_next;
+    connection->is_acknowledgement_pending = true;
+
+    if (offset == 0) {
+        // Deliver the payload, followed by any held payloads which were waiting for it:
+        deliver_payload(connection_index, port, (uint8_t *) payload, length, is_message_chunk);
+        connection->receive_next++;
+        tra_receive_slot *slot;
+        while ((slot = tra_find_receive_slot(connection_index, connection->receive_next)) != NULL) {
+            deliver_payload(connection_index, slot->port, slot->payload, slot->length, slot->is_message_chunk);
+            slot->is_used = false;
+            connection->receive_next++;
+        }
+
+        // Acknowledge every second payload straight away, and hold back the acknowledgement of the first in case the
+        // second arrives soon:
+        if (++connection->unacknowledged_receive_count == 1) {
+            connection->acknowledgement_due_time = time_add_milliseconds(time_now(), ACKNOWLEDGEMENT_DELAY_MILLISECONDS);
+            return;
+        }
+    } else if (offset < TRA_MAX_WINDOW && tra_find_receive_slot(connection_index, sequence_number) == NULL) {
+        // Hold a payload which arrived out of order until the ones before it arrive, if there's space:
+        tra_receive_slot *slot = tra_find_free_receive_slot();
+        if (slot != NULL) {
+            memcpy(slot->payload, payload, length);
+            slot->length = length;
+            slot->connection_index = connection_index;
+            slot->sequence_number = sequence_number;
+            slot->port = port;
+            slot->is_message_chunk = is_message_chunk;
+            slot->is_used = true;
+        }
+    }
+
+    // Acknowledge payloads which arrive out of order or more than once straight away, so that the sender finds out
+    // about the gap quickly:
+    connection->acknowledgement_due_time = time_now();
+}
+
+static void deliver_payload(uint8_t connection_index, tra_port port, uint8_t *payload, uint8_t length, bool is_message_chunk) {
+    tra_connection *connection = tra_get_connection(connection_index);
+    const tra_port_entry *entry;
+    if (is_message_chunk == false) {
+        abandon_received_message(connection_index);
+        entry = tra_find_port(port);
+        if (entry != NULL && entry->delivery == TRA_DELIVERY_RELIABLE && entry->receive_callback != NULL) {
+            entry->receive_callback(connection->peer, payload, length);
+        }
+        return;
+    }
+
+    // The first chunk of a message starts with its length, and the rest must be on the same port:
+    if (connection->is_receiving_message == false) {
+        if (length < MESSAGE_HEADER_SIZE) {
+            return;
+        }
+        connection->receive_message_length = payload[0] | ((uint16_t) payload[1] << 8);
+        connection->receive_message_offset = 0;
+        connection->receive_message_port = port;
+        connection->is_receiving_message = true;
+        payload += MESSAGE_HEADER_SIZE;
+        length -= MESSAGE_HEADER_SIZE;
+    }
+
+    // Pass the chunk on, unless it runs past the end of the message:
+    uint16_t offset = connection->receive_message_offset;
+    if (port != connection->receive_message_port || length > connection->receive_message_length - offset) {
+        abandon_received_message(connection_index);
+        return;
+    }
+    connection->receive_message_offset += length;
+    if (connection->receive_message_offset == connection->receive_message_length) {
+        connection->is_receiving_message = false;
+    }
+    entry = tra_find_port(port);
+    if (entry != NULL && entry->delivery == TRA_DELIVERY_RELIABLE && entry->message_callback != NULL) {
+        entry->message_callback(connection->peer, offset, connection->receive_message_length, payload, length);
+    }
+}
+
+static void abandon_received_message(uint8_t connection_index) {
+    tra_connection *connection = tra_get_connection(connection_index);
+    if (connection->is_receiving_message == false) {
+        return;
+    }
+    connection->is_receiving_message = false;
+    const tra_port_entry *entry = tra_find_port(connection->receive_message_port);
+    if (entry != NULL && entry->delivery == TRA_DELIVERY_RELIABLE && entry->message_callback != NULL) {
+        entry->message_callback(connection->peer, connection->receive_message_offset, connection->receive_message_length, NULL, 0);
+    }
+}
+
+static void restart_send_stream(uint8_t connection_index) {
+    // A message dropped partway through won't be delivered, so let the application know:
+    if (tra_restart_send_stream(connection_index) && send_callback != NULL) {
+        send_callback(tra_get_connection(connection_index)->peer, false);
+    }
+}
+
+static tra_send_slot *queue_payload(uint8_t connection_index, tra_port port, net_traffic_class traffic_class) {
+    tra_connection *connection = tra_get_connection(connection_index);
+
+    // Don't queue more payloads than can be in flight at once, so that one destination can't use up every slot:
+    tra_send_slot *slot = tra_find_free_send_slot();
+    if (slot == NULL || (uint8_t) (connection->send_next - connection->send_base) >= TRA_MAX_WINDOW) {
+        return NULL;
+    }
+    slot->connection_index = connection_index;
+    slot->sequence_number = connection->send_next++;
+    slot->port = port;
+    slot->traffic_class = traffic_class;
+    slot->is_message_chunk = false;
+    slot->is_message_start = false;
+    slot->transmission_count = 0;
+    slot->is_selectively_acknowledged = false;
+    slot->is_retransmission_due = false;
+    slot->is_fast_retransmitted = false;
+    slot->is_used = true;
+    return slot;
+}
+
+static void queue_message_chunks(uint8_t connection_index) {
+    tra_connection *connection = tra_get_connection(connection_index);
+
+    // Read as many chunks of the message being sent as there are free slots for:
+    while (connection->message_source != NULL) {
+        tra_send_slot *slot = queue_payload(connection_index, connection->message_port, connection->message_traffic_class);
+        if (slot == NULL) {
+            return;
+        }
+        slot->is_message_chunk = true;
+        slot->is_message_start = connection->message_offset == 0;
+        slot->length = 0;
+        if (connection->message_offset == 0) {
+            slot->payload[0] = connection->message_length & 0xFF;
+            slot->payload[1] = connection->message_length >> 8;
+            slot->length = MESSAGE_HEADER_SIZE;
+        }
+        uint8_t chunk_length = TRA_MAX_PAYLOAD_LENGTH - slot->length;
+        if (chunk_length > connection->message_length - connection->message_offset) {
+            chunk_length = connection->message_length - connection->message_offset;
+        }
+        connection->message_source(connection->peer, connection->message_offset, &slot->payload[slot->length], chunk_length);
+        slot->length += chunk_length;
+        connection->message_offset += chunk_length;
+        if (connection->message_offset == connection->message_length) {
+            connection->message_source = NULL;
+        }
+    }
+}
+
+static void update_connection(uint8_t connection_index, time now) {
+    tra_connection *connection = tra_get_connection(connection_index);
+
+    // Mark every sent payload whose retransmission timeout has passed, unless the peer already holds it. While
+    // synchronising, only the first payload is ever sent:
+    bool is_timed_out = false;
+    for (uint8_t sequence_number = connection->send_base; sequence_number != connection->send_next; sequence_number++) {
+        tra_send_slot *slot = tra_find_send_slot(connection_index, sequence_number);
+        if (slot->transmission_count != 0 && slot->is_selectively_acknowledged == false
+            && time_delta_milliseconds(slot->sent_time, now) >= connection->retransmission_timeout) {
+            slot->is_retransmission_due = true;
+            is_timed_out |= (sequence_number == connection->send_base);
+        }
+    }
+
+    // Back off after the oldest payload times out (the later ones in flight time out around the same time, and only count
+    // once), and give up on the peer if it hasn't acknowledged anything for too many timeouts:
+    if (is_timed_out) {
+        if (++connection->timeout_count > TRA_MAX_RETRANSMISSIONS) {
+            net_address peer = connection->peer;
+            abandon_received_message(connection_index);
+            tra_close_connection(connection_index);
+            if (send_callback != NULL) {
+                send_callback(peer, false);
+            }
+            return;
+        }
+        connection->retransmission_timeout = (connection->retransmission_timeout > TRA_MAX_RETRANSMISSION_TIMEOUT_MILLISECONDS / 2)
+            ? TRA_MAX_RETRANSMISSION_TIMEOUT_MILLISECONDS : connection->retransmission_timeout * 2;
+        tra_shrink_congestion_window(connection_index, true);
+    }
+
+    // Send the due retransmissions and any new payloads that fit in both the peer's window and the congestion window, in
+    // order:
+    queue_message_chunks(connection_index);
+    uint8_t window = 1;
+    if (connection->is_send_synchronised) {
+        window = tra_get_congestion_window(connection_index);
+        if (window > connection->peer_window) {
+            window = connection->peer_window;
+        }
+    }
+    for (uint8_t offset = 0; offset < window; offset++) {
+        tra_send_slot *slot = tra_find_send_slot(connection_index, connection->send_base + offset);
+        if (slot == NULL) {
+            break;
+        }
+        if (slot->is_retransmission_due) {
+            send_segment(connection_index, slot, connection->is_send_synchronised ? 0 : SEGMENT_FLAG_SYNCHRONISE);
+        } else if (slot->transmission_count == 0) {
+#ifdef TRA_BUS_PACING
+            // Space out new payloads while the bus is busy, so that fewer frames compete for it at once. The spacing is
+            // random, so that devices held up by the same busy bus don't all send again together:
+            if (time_delta_milliseconds(connection->next_send_time, now) < 0) {
+                break;
+            }
+            uint8_t utilisation = phy_get_bus_utilisation();
+            if (utilisation > TRA_MAX_PACING_UTILISATION) {
+                utilisation = TRA_MAX_PACING_UTILISATION;
+            }
+            int32_t spacing = (int32_t) (connection->smoothed_round_trip_time / connection->congestion_window) * utilisation / (100 - utilisation);
+            connection->next_send_time = time_add_milliseconds(now, (2 * spacing * (rand() & 0xFF)) >> 8);
+#endif
+            send_segment(connection_index, slot, connection->is_send_synchronised ? 0 : SEGMENT_FLAG_SYNCHRONISE);
+        }
+    }
+
+    // Tell the peer to restart its sequence numbers if it needs to:
+    if (connection->is_reset_pending) {
+        send_segment(connection_index, NULL, SEGMENT_FLAG_RESET);
+    }
+
+    // Send a pending acknowledgement once it's due (it goes with any payload sent above):
+    if (connection->is_acknowledgement_pending && time_delta_milliseconds(connection->acknowledgement_due_time, now) >= 0) {
+        send_segment(connection_index, NULL, 0);
+    }
+
+    // Close the connection once it has been idle for long enough:
+    if (connection->send_base == connection->send_next && connection->message_source == NULL && connection->is_acknowledgement_pending == false
+        && time_delta_seconds(connection->last_activity_time, now) >= TRA_CONNECTION_TIMEOUT_SECONDS) {
+        abandon_received_message(connection_index);
+        tra_close_connection(connection_index);
+    }
+}
+
+static void send_segment(uint8_t connection_index, tra_send_slot *slot, uint8_t flags) {
+    tra_connection *connection = tra_get_connection(connection_index);
+    uint8_t *segment = net_get_data_buffer();
+    uint8_t segment_length = SEGMENT_FLAGS_SIZE;
+    net_traffic_class traffic_class = NET_TRAFFIC_CLASS_INTERACTIVE;
+
+    // Write the payload's stream and sequence number, if there's a payload:
+    uint8_t stream = (flags & SEGMENT_FLAG_RESET) ? connection->reset_stream : 0;
+    if (slot != NULL) {
+        flags |= SEGMENT_FLAG_DATA;
+        stream = connection->send_stream;
+        segment[segment_length] = slot->sequence_number;
+        segment[segment_length + 1] = slot->port;
+        segment_length += SEGMENT_DATA_FIELDS_SIZE;
+        traffic_class = slot->traffic_class;
+        if (slot->is_message_chunk) {
+            flags |= SEGMENT_FLAG_MESSAGE;
+        }
+    }
+
+    // Acknowledge the peer's payloads with every segment, once its sequence numbers are known:
+    if (connection->is_receive_synchronised) {
+        flags |= SEGMENT_FLAG_ACKNOWLEDGEMENT;
+        segment_length += write_acknowledgement_fields(connection_index, &segment[segment_length]);
+        connection->is_acknowledgement_pending = false;
+        connection->unacknowledged_receive_count = 0;
+    }
+    if (flags & SEGMENT_FLAG_RESET) {
+        connection->is_reset_pending = false;
+    }
+    segment[0] = flags | (stream << SEGMENT_STREAM_SHIFT);
+
+    // Write the payload:
+    if (slot != NULL) {
+        memcpy(&segment[segment_length], slot->payload, slot->length);
+        segment_length += slot->length;
+        slot->sent_time = time_now();
+        slot->transmission_count++;
+        slot->is_retransmission_due = false;
+    }
+
+    // The segment's checksum must cover the payload, since an acknowledged payload is never sent again. If the packet
+    // isn't delivered, the payload's retransmission timeout takes care of it:
+    net_send_data_packet(connection->peer, segment_length, traffic_class, true);
+    connection->last_activity_time = time_now();
+}
+
+static uint8_t write_acknowledgement_fields(uint8_t connection_index, uint8_t *segment) {
+    // Set a bit for each of the payloads after the next expected one which is held:
+    tra_connection *connection = tra_get_connection(connection_index);
+    uint8_t selective_acknowledgements = 0;
+    for (uint8_t offset = 1; offset <= 8; offset++) {
+        if (tra_find_receive_slot(connection_index, connection->receive_next + offset) != NULL) {
+            selective_acknowledgements |= 1 << (offset - 1);
+        }
+    }
+
+    segment[0] = connection->receive_next;
+    segment[1] = selective_acknowledgements;
+    segment[2] = tra_get_receive_window() | (connection->receive_stream << SEGMENT_STREAM_SHIFT);
+    return SEGMENT_ACKNOWLEDGEMENT_FIELDS_SIZE;
+}
+
+static tra_send_status send_datagram(net_address destination, tra_port port, const uint8_t *data, uint8_t length, net_traffic_class traffic_class) {
+    uint8_t *segment = net_get_data_buffer();
+    segment[0] = 0;
+    segment[1] = port;
+    memcpy(&segment[DATAGRAM_HEADER_SIZE], data, length);
+
+    // A datagram held until there's a route still counts as sent:
+    net_send_status status = net_send_data_packet(destination, DATAGRAM_HEADER_SIZE + length, traffic_class, true);
+    return (status == NET_SEND_SUCCESS || status == NET_SEND_PENDING) ? TRA_SEND_SUCCESS : TRA_SEND_FAILED;
+}